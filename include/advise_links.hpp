@@ -0,0 +1,185 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_ADVISE_LINKS
+#define JO_TOSDB_ADVISE_LINKS
+
+#include <set>
+#include <vector>
+#include <functional>
+
+/* the engine's DDE advise loops, and pausing them
+
+   While RUNNING every stream the engine has added is 'live': TOS pushes
+   WM_DDE_DATA for it. pause() ends the advise loop of every live stream and
+   'parks' it - the subscription itself (ref-counts, buffers, conversations)
+   is left alone - and resume() links them all again. Both go through bulk
+   callbacks that get every stream at once and return the ones that failed:
+
+     pause  : streams that couldn't be unlinked stay live
+     resume : streams that couldn't be linked stay parked; resume() again
+              (paused or not) retries them
+
+   A failure is usually just an ack that didn't come in time, so the link or
+   unlink may have gone through anyway. Those streams are 'unconfirmed' until
+   a later call succeeds for them: pause() and resume() both include them
+   (an advise loop that's down gets linked, one that's up gets unlinked) and
+   removing one still unlinks it.
+
+   A stream added while PAUSED is parked as soon as it's been linked (the
+   advise ack is how the engine validates an item); removing a parked stream
+   needs no unlink. No locking: the engine only uses this from its IPC
+   thread. */
+
+template<typename K>
+class AdviseLinks{
+public:
+    typedef std::vector<K> streams_type;
+    typedef std::function<streams_type(const streams_type&)> bulk_op_type;
+
+    enum State{
+        RUNNING = 0,
+        PAUSED
+    };
+
+private:
+    std::set<K> _live;
+    std::set<K> _parked;
+    std::set<K> _unconfirmed; /* last link/unlink failed; could be either */
+    State _state;
+    bulk_op_type _link;
+    bulk_op_type _unlink;
+
+    AdviseLinks(const AdviseLinks&);
+    AdviseLinks& operator=(const AdviseLinks&);
+
+    /* 'op' everything in 'from' and everything unconfirmed; what didn't 
+       fail goes to 'to', what did is unconfirmed */
+    size_t
+    _move(bulk_op_type& op, std::set<K>& from, std::set<K>& to)
+    {
+        std::set<K> all(from);
+        all.insert(_unconfirmed.begin(), _unconfirmed.end());
+        if(all.empty())
+            return 0;
+
+        streams_type failed = op( streams_type(all.begin(), all.end()) );
+        std::set<K> keep(failed.begin(), failed.end());
+
+        for(const K& s : all){
+            if(keep.count(s)){
+                _unconfirmed.insert(s);
+            }else{
+                _unconfirmed.erase(s);
+                from.erase(s);
+                to.insert(s);
+            }
+        }
+
+        return keep.size();
+    }
+
+public:
+    AdviseLinks(bulk_op_type link, bulk_op_type unlink)
+        :
+            _state(RUNNING),
+            _link(link),
+            _unlink(unlink)
+        {
+        }
+
+    inline State
+    state() const
+    {
+        return _state;
+    }
+
+    inline size_t
+    live() const
+    {
+        return _live.size();
+    }
+
+    inline size_t
+    parked() const
+    {
+        return _parked.size();
+    }
+
+    inline size_t
+    unconfirmed() const
+    {
+        return _unconfirmed.size();
+    }
+
+    inline bool
+    is_parked(const K& stream) const
+    {
+        return _parked.count(stream) != 0;
+    }
+
+    /* a new stream has been linked; false if we're paused and it couldn't
+       be unlinked (it stays live) */
+    bool
+    added(const K& stream)
+    {
+        if(_state == RUNNING){
+            _live.insert(stream);
+            return true;
+        }
+
+        if( !_unlink(streams_type(1, stream)).empty() ){
+            _live.insert(stream);
+            _unconfirmed.insert(stream);
+            return false;
+        }
+
+        _parked.insert(stream);
+        return true;
+    }
+
+    /* a stream is going away; true if its advise loop is (or may be) up 
+       (the caller still has to unlink it) */
+    bool
+    removed(const K& stream)
+    {
+        bool unsure = (_unconfirmed.erase(stream) != 0);
+        if(_parked.erase(stream))
+            return unsure;
+
+        _live.erase(stream);
+        return true;
+    }
+
+    /* returns how many streams couldn't be unlinked */
+    size_t
+    pause()
+    {
+        _state = PAUSED;
+        return _move(_unlink, _live, _parked);
+    }
+
+    /* returns how many streams couldn't be linked */
+    size_t
+    resume()
+    {
+        _state = RUNNING;
+        return _move(_link, _parked, _live);
+    }
+};
+
+#endif /* JO_TOSDB_ADVISE_LINKS */
@@ -0,0 +1,97 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_BUFFER_RING
+#define JO_TOSDB_BUFFER_RING
+
+#include <algorithm>
+#include <climits>
+
+/* the layout of an engine's stream buffer (BufferHead in tos_databridge.h)
+
+   The header is at offset 0; a string stream's dictionary (string_dict.hpp)
+   comes right after it, at dict_offset; the ring starts at beg_offset. Each
+   element is the value and then its DateTimeStamp, elem_size in all, and
+   the slots are beg_offset + N * elem_size up to end_offset. The engine
+   writes at next_offset and bumps loop_seq each time it wraps around; a
+   reader keeps where next_offset was (less beg_offset) and loop_seq as of
+   its last read.
+
+   Nothing here assumes the header, or anything after it, is smaller than an
+   element: all offsets are taken relative to beg_offset. The engine lays
+   buffers out and writes them w/ these, the client reads them w/ these. */
+
+
+/* set up the header of a buffer of 'raw_sz' bytes w/ a dictionary of
+   'dict_sz' bytes (0 for none) ahead of the ring */
+template<typename Head>
+inline void
+RingInit(Head *head, unsigned int raw_sz, unsigned int dict_sz, unsigned int elem_size)
+{
+    head->loop_seq = 0;
+    head->elem_size = elem_size;
+    head->dict_offset = dict_sz ? sizeof(Head) : 0;
+    head->next_offset = head->beg_offset = sizeof(Head) + dict_sz;
+    head->end_offset = head->beg_offset 
+                     + ((raw_sz - head->beg_offset) / elem_size) * elem_size;
+}
+
+
+/* where the write after the one at 'offset' goes; bumps 'loop_seq' if that
+   wraps around */
+template<typename Head>
+inline unsigned int
+RingNextOffset(const Head *head, unsigned int offset, unsigned int *loop_seq)
+{
+    if(offset + head->elem_size >= head->end_offset){
+        ++(*loop_seq);
+        return head->beg_offset;
+    }
+    return offset + head->elem_size;
+}
+
+
+/* offset of the element written 'back' writes ago (1 = the latest) */
+template<typename Head>
+inline unsigned int
+RingElementOffset(const Head *head, unsigned int next_offset, unsigned int back)
+{
+    unsigned int nslots = (head->end_offset - head->beg_offset) / head->elem_size;
+    unsigned int cur = (next_offset - head->beg_offset) / head->elem_size;
+    unsigned int idx = (cur + nslots - (back % nslots)) % nslots;
+    return head->beg_offset + idx * head->elem_size;
+}
+
+
+/* elements written since a reader's cursor ('cursor_offset', 'cursor_loop_seq'),
+   no more than the ring holds (the rest were written over); < 0 if the
+   cursor is ahead of the ring */
+template<typename Head>
+inline long long
+RingNewElements(const Head *head, unsigned int cursor_offset, unsigned int cursor_loop_seq)
+{
+    unsigned int dlen = head->end_offset - head->beg_offset;
+    long long npos = (long long)(head->next_offset - head->beg_offset) - cursor_offset;
+    long long loop_diff = (long long)head->loop_seq - cursor_loop_seq;
+    if(loop_diff < 0) /* loop_seq wrapped */
+        loop_diff += (long long)UINT_MAX + 1;
+
+    long long n = (npos + loop_diff * dlen) / head->elem_size;
+    return std::min<long long>(n, dlen / head->elem_size);
+}
+
+#endif /* JO_TOSDB_BUFFER_RING */
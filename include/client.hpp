@@ -21,11 +21,133 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #include "tos_databridge.h"
 #include <mutex>
 #include <chrono>
+#include "lock_profile.hpp"
+
+/* per-API call stats - client_stats.cpp
+
+   Each thread counts into its own slab (no shared writes on the call path);
+   TOSDB_GetApiStats sums the slabs. Only the outermost instrumented call on a
+   thread is counted, so C calls that forward to other C calls count once. */
+typedef enum{
+    API_STAT_CONNECT = 0,
+    API_STAT_DISCONNECT,
+    API_STAT_CREATE_BLOCK,
+    API_STAT_CLOSE_BLOCK,
+    API_STAT_CLOSE_BLOCKS,
+    API_STAT_ADD,
+    API_STAT_REMOVE,
+    API_STAT_SET_BLOCK_SIZE,
+    API_STAT_STREAM_INFO,
+    API_STAT_GET,
+    API_STAT_SNAPSHOT,
+    API_STAT_SNAPSHOT_FROM_MARKER,
+    API_STAT_SNAPSHOT_TO_BUFFERS,
+    API_STAT_SNAPSHOT_SAMPLED,
+    API_STAT_ITEM_FRAME,
+    API_STAT_TOPIC_FRAME,
+    API_STAT_STREAM_SUMMARY,
+    /* locks: 'calls' are acquisitions in a counted call, 'lock_waits' the 
+       ones that blocked */
+    API_STAT_LOCK_GLOBAL,
+    API_STAT_LOCK_BUFFERS,
+    API_STAT_COUNT
+} ApiStatId;
+
+long long
+ApiStatTicks();
+
+bool
+ApiStatEnter(ApiStatId id);
+
+void
+ApiStatLeave(ApiStatId id, long long ticks, bool error);
+
+void
+ApiStatLockWait(ApiStatId lock_id, long long ticks);
+
+/* is this thread inside a counted call? */
+bool
+ApiStatInCall();
+
+/* DllMain, DLL_THREAD_DETACH: fold the thread's slab into the totals */
+void
+ApiStatThreadDetach();
+
+inline bool 
+_apiStatIsError(int r) 
+{ 
+    return r != 0; 
+}
+
+template<typename T> 
+inline bool 
+_apiStatIsError(const T&) 
+{ 
+    return false; 
+}
+
+/* time f() against 'id'; a non-zero int return or an exception is an error */
+template<typename F>
+auto
+ApiStatCall(ApiStatId id, F f) -> decltype(f())
+{
+    if( !ApiStatEnter(id) )
+        return f();
+
+    long long t = ApiStatTicks();
+    try{
+        auto r = f();
+        ApiStatLeave(id, ApiStatTicks() - t, _apiStatIsError(r));
+        return r;
+    }catch(...){
+        ApiStatLeave(id, ApiStatTicks() - t, true);
+        throw;
+    }
+}
+
+#define API_STAT_CALL(id, expr) ApiStatCall(id, [&]{ return (expr); })
+
+/* lock_guard that times the wait when the lock is contended; locks taken 
+   outside a counted call (the library's own threads) aren't accounted */
+template<typename M>
+class ApiStatLockGuard{
+    M& _m;
+
+    ApiStatLockGuard(const ApiStatLockGuard&);
+    ApiStatLockGuard& operator=(const ApiStatLockGuard&);
+
+public:
+    ApiStatLockGuard(M& m, ApiStatId lock_id)
+        : 
+            _m(m)
+        {
+            if( !ApiStatInCall() ){
+                _m.lock();
+            }else if(_m.try_lock()){
+                ApiStatLockWait(lock_id, 0);
+            }else{
+                long long t = ApiStatTicks();
+                _m.lock();
+                ApiStatLockWait(lock_id, ApiStatTicks() - t);
+            }
+        }
+
+    ~ApiStatLockGuard()
+        {
+            _m.unlock();
+        }
+};
+
+/* lock sites profiled by TOSDB_GetLockStats (lock_profile.hpp) */
+extern LockProfile global_rmutex_site;
+extern LockProfile buffers_mtx_site;
 
 /* sync access to blocks in client_get/client_admin */
-extern std::recursive_mutex global_rmutex;
+extern ProfiledMutex<std::recursive_mutex> global_rmutex;
 
-#define GLOBAL_RLOCK_GUARD std::lock_guard<std::recursive_mutex> global_rlock_guard_(global_rmutex)
+#define GLOBAL_RLOCK_GUARD \
+    ApiStatLockGuard<ProfiledMutex<std::recursive_mutex>> \
+        global_rlock_guard_(global_rmutex, API_STAT_LOCK_GLOBAL)
 
 /* forward decl - raw_data_block.hpp / raw_data_block.tpp */
 template<typename T,typename T2> class RawDataBlock; 
@@ -52,4 +174,35 @@ GetBlockPtr(std::string id, bool log=true);
 const TOSDBlock*   
 GetBlockOrThrow(std::string id);
 
+/* DateTimeStamp (local time) <-> epoch micro-seconds - client_record.cpp */
+long long
+DateTimeStampToEpochMicro(const DateTimeStamp& dts);
+
+void
+EpochMicroToDateTimeStamp(long long micro, pDateTimeStamp dts);
+
+/* n at once, mktime once per run of stamps from the same second; stamps that
+   were never filled in (tm_mday == 0) come out 0 */
+void
+DateTimeStampsToEpochMicro(const DateTimeStamp* dts, size_type n, long long* dest);
+
+/* DateTimeStampToEpochMicro one stamp at a time, calling mktime only when 
+   the second changes; keep one per loop (or per thread), it isn't synced */
+class EpochMicroCache{
+    struct tm _last;
+    long long _secs;
+    bool _valid;
+
+public:
+    EpochMicroCache()
+        :
+            _secs(0),
+            _valid(false)
+        {
+        }
+
+    long long
+    operator()(const DateTimeStamp& dts);
+};
+
 #endif
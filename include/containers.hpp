@@ -19,9 +19,12 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #define JO_TOSDB_CONTAINERS
 
 #include <unordered_map>
+#include <map>
 #include <set>
 #include <mutex>
+#include <memory>
 #include <string>
+#include <string.h>
 
 template<typename T, typename Eq = std::less<T>>
 class ILSet 
@@ -41,12 +44,12 @@ public:
 
     ILSet(const T& item) 
         {
-            insert(item); 
+            this->insert(item); 
         }
 
     ILSet(T&& item)
         {
-            insert(std::move(item)); // do we need the move ?
+            this->insert(std::move(item)); // do we need the move ?
         }
 
     /* copy from same/base */
@@ -76,7 +79,7 @@ public:
     ILSet(const ILSet<T2,T3>& set, Func func)
         {
             for(auto & i : set) 
-                insert(func(i)); 
+                this->insert(func(i)); 
         }
 
     /*attempt to construct from like base w/ func obj*/
@@ -84,7 +87,7 @@ public:
     ILSet(const std::set<T2,T3>& set, Func func)
         {
             for(auto & i : set) 
-                insert(func(i)); 
+                this->insert(func(i)); 
         }
 
     /*attempt to construct from raw-array of like w/ func obj*/
@@ -92,7 +95,7 @@ public:
     ILSet(const T2* ptr, size_t sz, Func func)
         {
             while(sz--) 
-                insert(func(ptr[sz])); 
+                this->insert(func(ptr[sz])); 
         }
 
     /*attempt to construct from array of like w/ func obj*/
@@ -100,7 +103,7 @@ public:
     ILSet(const T2(&arr)[sz], Func func)
         {
             for(size_t i = 0; i <sz; ++i)
-                insert(func(arr[i])); 
+                this->insert(func(arr[i])); 
         }
 
     /*attempt to construct from raw-array of like*/
@@ -108,7 +111,7 @@ public:
     ILSet(const T2* ptr, size_t sz)
         {
             while(sz--) 
-                insert(ptr[sz]); 
+                this->insert(ptr[sz]); 
         }
 
     /*attempt to construct from array of like*/
@@ -116,7 +119,7 @@ public:
     ILSet(const T2(&arr)[sz])
         {
             for(size_t i = 0; i <sz; ++i)
-                insert(arr[i]); 
+                this->insert(arr[i]); 
         }
 
     /*attempt to construct from like*/
@@ -124,7 +127,7 @@ public:
     ILSet(const ILSet<T2, T3>& set)
         {  
             for(auto & item : set)
-                insert(item);   
+                this->insert(item);   
         }
 
     /*attempt to construct from like base*/
@@ -132,7 +135,7 @@ public:
     ILSet(const std::set<T2, T3>& set)
         {  
             for(auto & item : set)
-                insert(item);   
+                this->insert(item);   
         }
 
     /*move-assign from same 
@@ -167,9 +170,9 @@ public:
     _my_ty& 
     operator=(const std::set<T2,T3>& set)
     {
-        clear();
+        this->clear();
         for(auto & item : set)
-            insert(item);
+            this->insert(item);
         return *this;
     }
 
@@ -178,9 +181,9 @@ public:
     _my_ty& 
     operator=(const ILSet<T2,T3>& set)
     {
-        clear();
+        this->clear();
         for(auto & item : set)
-            insert(item);     
+            this->insert(item);     
         return *this;
     }
 
@@ -189,9 +192,9 @@ public:
     _my_ty& 
     operator=(const T2(&arr)[sz])
     {
-        clear();
+        this->clear();
         for(size_t i = 0; i <sz; ++i)
-            insert(arr[i]); 
+            this->insert(arr[i]); 
         return *this;
     }
 };
@@ -515,9 +518,16 @@ class TwoWayHashMap<T1, T2, true, Hash1, Hash2, Key1Eq, Key2Eq>
     typedef TwoWayHashMap<T1,T2,false,Hash1,Hash2,Key1Eq, Key2Eq> _my_base_ty;    
     typedef std::lock_guard<std::recursive_mutex>  _my_lock_guard_type;
 
-    std::recursive_mutex _mtx;
+    mutable std::recursive_mutex _mtx; /* locked in const methods too */
 
 public:
+    typedef typename _my_base_ty::map1_type map1_type;
+    typedef typename _my_base_ty::pair1_type pair1_type;
+    typedef typename _my_base_ty::iterator1_type iterator1_type;
+    typedef typename _my_base_ty::iterator2_type iterator2_type;
+    typedef typename _my_base_ty::const_iterator1_type const_iterator1_type;
+    typedef typename _my_base_ty::const_iterator2_type const_iterator2_type;
+
     TwoWayHashMap()
         : 
             _my_base_ty()
@@ -27,6 +27,13 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #include <string>
 #include <vector>
 #include <mutex>  
+#include <thread>
+#include <memory>
+#include <sstream>
+#include <typeinfo>
+#include <algorithm>
+
+#include "lock_profile.hpp"
 
 /* implemented in src/data_stream.tpp */
 
@@ -77,6 +84,18 @@ BuildThrowTypeError(const char* method)
 
 };
 
+
+/* the lock site every stream's mutex is profiled under (one per module) */
+template<typename T = void>
+struct DataStreamLockSite_{
+    static LockProfile site;
+};
+
+template<typename T>
+LockProfile DataStreamLockSite_<T>::site("DataStream");
+
+typedef DataStreamLockSite_<> DataStreamLockSite;
+
 template<typename SecTy, typename GenTy>      
 class DataStreamInterface {
 public:
@@ -89,14 +108,45 @@ public:
     /* hard-coded 4 BYTE SIGNED MAX to avoid some of the corner cases. */
     static const size_t MAX_BOUND_SIZE = ((65536LL * 65536 / 2) - 1);
 
+    /* turns a secondary into a long long (e.g. a stamp into epoch micro-
+       seconds); called by copy(..., secondary_as) under the stream's lock */
+    class secondary_converter{
+    public:
+        virtual 
+        ~secondary_converter() 
+            {
+            }
+
+        virtual long long 
+        operator()(const secondary_ty& sec) = 0;
+    };
+
+    /* for copy()s that want the secondaries converted: each goes through 
+       'conv' into 'dest' as it's copied, no secondary_ty array in between 
+       (0s from streams without secondaries) */
+    struct secondary_as{
+        long long *dest;
+        secondary_converter *conv;
+
+        inline void
+        operator()(size_t i, const secondary_ty& sec) const
+        {
+            dest[i] = (*conv)(sec);
+        }
+    };
+
 private:
-    template<typename InTy, typename OutTy>
+    template<typename InTy, typename OutTy, typename SecOutTy>
     size_t 
-    _copy(OutTy *dest, size_t sz, int end, int beg, secondary_ty *sec) const; 
+    _copy(OutTy *dest, size_t sz, int end, int beg, SecOutTy sec) const; 
    
-    template<typename InTy, typename OutTy>
+    template<typename InTy, typename OutTy, typename SecOutTy>
     long long 
-    _copy_using_atomic_marker(OutTy *dest, size_t sz, int beg, secondary_ty *sec) const;
+    _copy_using_atomic_marker(OutTy *dest, size_t sz, int beg, SecOutTy sec) const;
+
+    template<typename SecOutTy>
+    size_t 
+    _copy_strings(std::string *dest, size_t sz, int end, int beg, SecOutTy sec) const;
 
 protected:
     unsigned int _str_push_count;
@@ -170,6 +220,11 @@ push(const InTy v, secondary_ty sec = secondary_ty()) \
 #define VIRTUAL_VOID_COPY_2ARG_DROP(InTy, OutTy) \
 virtual size_t \
 copy(InTy *dest, size_t sz, int end = -1, int beg = 0, secondary_ty *sec = nullptr) const \
+{ \
+    return this->_copy<OutTy>(dest, sz, end, beg, sec); \
+} \
+virtual size_t \
+copy(InTy *dest, size_t sz, int end, int beg, secondary_as sec) const \
 { \
     return this->_copy<OutTy>(dest, sz, end, beg, sec); \
 } 
@@ -177,6 +232,12 @@ copy(InTy *dest, size_t sz, int end = -1, int beg = 0, secondary_ty *sec = nullp
 #define VIRTUAL_VOID_COPY_2ARG_BREAK(InTy, DropBool) \
 virtual size_t \
 copy(InTy *dest, size_t sz, int end = -1, int beg = 0, secondary_ty *sec = nullptr) const \
+{ \
+    BuildThrowTypeError<InTy*,DropBool>("copy()"); \
+    return 0; \
+} \
+virtual size_t \
+copy(InTy *dest, size_t sz, int end, int beg, secondary_as sec) const \
 { \
     BuildThrowTypeError<InTy*,DropBool>("copy()"); \
     return 0; \
@@ -185,6 +246,11 @@ copy(InTy *dest, size_t sz, int end = -1, int beg = 0, secondary_ty *sec = nullp
 #define VIRTUAL_VOID_MARKER_COPY_2ARG_DROP(InTy, OutTy) \
 virtual long long \
 copy_from_marker(InTy *dest, size_t sz, int beg = 0, secondary_ty *sec = nullptr) const \
+{ \
+    return this->_copy_using_atomic_marker< OutTy >(dest, sz, beg, sec); \
+} \
+virtual long long \
+copy_from_marker(InTy *dest, size_t sz, int beg, secondary_as sec) const \
 { \
     return this->_copy_using_atomic_marker< OutTy >(dest, sz, beg, sec); \
 } 
@@ -192,6 +258,12 @@ copy_from_marker(InTy *dest, size_t sz, int beg = 0, secondary_ty *sec = nullptr
 #define VIRTUAL_VOID_MARKER_COPY_2ARG_BREAK(InTy, DropBool) \
 virtual long long \
 copy_from_marker(InTy *dest, size_t sz, int beg = 0, secondary_ty *sec = nullptr) const \
+{ \
+    BuildThrowTypeError<InTy*,DropBool>("copy_from_marker()"); \
+    return 0; \
+} \
+virtual long long \
+copy_from_marker(InTy *dest, size_t sz, int beg, secondary_as sec) const \
 { \
     BuildThrowTypeError<InTy*,DropBool>("copy_from_marker()"); \
     return 0; \
@@ -258,6 +330,21 @@ copy_from_marker(InTy *dest, size_t sz, int beg = 0, secondary_ty *sec = nullptr
          int beg = 0, 
          secondary_ty *sec = nullptr) const;
 
+    virtual size_t 
+    copy(char **dest, 
+         size_t dest_sz, 
+         size_t str_sz, 
+         int end, 
+         int beg, 
+         secondary_as sec) const;
+
+    virtual size_t 
+    copy(std::string *dest, 
+         size_t sz, 
+         int end, 
+         int beg, 
+         secondary_as sec) const;
+
     VIRTUAL_VOID_MARKER_COPY_2ARG_DROP(long long, long)
     VIRTUAL_VOID_MARKER_COPY_2ARG_DROP(long, int)
     VIRTUAL_VOID_MARKER_COPY_2ARG_DROP(int, short)
@@ -278,12 +365,39 @@ copy_from_marker(InTy *dest, size_t sz, int beg = 0, secondary_ty *sec = nullptr
                      int beg = 0, 
                      secondary_ty *sec = nullptr) const;
 
+    virtual long long 
+    copy_from_marker(char **dest, 
+                     size_t dest_sz,   
+                     size_t str_sz,             
+                     int beg, 
+                     secondary_as sec) const;
+
     virtual long long 
     copy_from_marker(std::string *dest, 
                      size_t sz,                     
                      int beg = 0, 
                      secondary_ty *sec = nullptr) const;
 
+    /* numeric streams only (DataStreamTypeError otherwise), values as doubles:
+       every 'stride'th element of [beg, end], starting at beg */
+    virtual size_t
+    copy_strided(double *dest, 
+                 size_t sz, 
+                 size_t stride, 
+                 int end = -1, 
+                 int beg = 0, 
+                 secondary_ty *sec = nullptr) const = 0;
+
+    /* [beg, end] in at most 'sz' (>= 4) points, for plotting: split into sz/4 
+       buckets, each giving its first, min, max and last element (stream order,
+       duplicates dropped); all of [beg, end] if it already fits */
+    virtual size_t
+    copy_decimated(double *dest, 
+                   size_t sz, 
+                   int end = -1, 
+                   int beg = 0, 
+                   secondary_ty *sec = nullptr) const = 0;
+
     virtual void /* SHOULD WE THROW? */ 
     secondary(secondary_ty *dest, int indx) const 
     { 
@@ -308,10 +422,19 @@ class DataStream /* CONTAINS A PRIMARY DEQUE */
     typedef DataStream<Ty,SecTy,GenTy,UseSecondary,Allocator> _my_ty;
     typedef DataStreamInterface<SecTy,GenTy> _my_base_ty;  
 
-    class{
-        static const bool valid = GenTy::TypeCheck<Ty>::value;  
-        static_assert(valid, "DataStream: Ty failed GenTy type-check"); 
-    }_my_ty_static_assert;
+public:
+    /* dependent base; spelled out for compilers that don't look there */
+    typedef typename _my_base_ty::generic_ty generic_ty;
+    typedef typename _my_base_ty::secondary_ty secondary_ty;
+    typedef typename _my_base_ty::both_ty both_ty;
+    typedef typename _my_base_ty::generic_vector_ty generic_vector_ty;
+    typedef typename _my_base_ty::secondary_vector_ty secondary_vector_ty;
+    typedef typename _my_base_ty::secondary_as secondary_as;
+    using _my_base_ty::MAX_BOUND_SIZE;
+
+private:
+
+    static_assert(GenTy::template TypeCheck<Ty>::value, "DataStream: Ty failed GenTy type-check"); 
 
     _my_ty& 
     operator=(const _my_ty &);
@@ -320,7 +443,12 @@ class DataStream /* CONTAINS A PRIMARY DEQUE */
     _push(const Ty v); 
 
 protected:
-    typedef std::lock_guard<std::recursive_mutex> _my_lock_guard_type;
+    typedef ProfiledMutex<std::recursive_mutex> _my_mutex_type;
+    typedef std::lock_guard<_my_mutex_type> _my_lock_guard_type;
+    typedef std::deque<SecTy, typename Allocator::template rebind<SecTy>::other> 
+            _secondary_deque_type;
+
+    using _my_base_ty::_str_push_count;
      
     std::deque<Ty,Allocator> _deque_primary;
 
@@ -332,7 +460,7 @@ protected:
 
     volatile bool _push_has_priority;
 
-    std::recursive_mutex *const _mtx;
+    _my_mutex_type *const _mtx;
 
     inline void 
     _yld_to_push() const
@@ -341,9 +469,9 @@ protected:
             std::this_thread::yield();
     } 
 
-    template<typename T>
+    template<typename DequeTy>
     bool
-    _check_adj(int& end, int& beg, const std::deque<T,Allocator>& d) const;
+    _check_adj(int& end, int& beg, const DequeTy& d) const;
 
     void
     _incr_internal_counts();
@@ -356,6 +484,49 @@ protected:
                  unsigned int end, 
                  unsigned int beg) const;
 
+    template<typename DequeTy> 
+    size_t 
+    _copy_to_ptr(DequeTy& d, 
+                 secondary_as sec, 
+                 size_t sz, 
+                 unsigned int end, 
+                 unsigned int beg) const;
+
+    template<typename T>
+    static inline double
+    _as_double(const T& v)
+    {
+        return (double)v;
+    }
+
+    static inline double
+    _as_double(const std::string& v) 
+    {   /* string streams throw before getting here */
+        return 0.0; 
+    }
+
+    /* copy_from_marker around copy_to(end, beg), the marker's end */
+    template<typename F>
+    long long
+    _copy_from_marker(int beg, F copy_to) const;
+
+    size_t
+    _copy_strided(const _secondary_deque_type *dsec,
+                  double *dest, 
+                  size_t sz, 
+                  size_t stride, 
+                  int end, 
+                  int beg, 
+                  secondary_ty *sec) const;
+
+    size_t
+    _copy_decimated(const _secondary_deque_type *dsec,
+                    double *dest, 
+                    size_t sz, 
+                    int end, 
+                    int beg, 
+                    secondary_ty *sec) const;
+
 public:
     typedef _my_base_ty interface_type;
     typedef Ty value_type;
@@ -426,6 +597,19 @@ public:
                      size_t str_sz,                
                      int beg = 0, 
                      secondary_ty *sec = nullptr) const;
+
+    long long 
+    copy_from_marker(Ty *dest, 
+                     size_t sz,              
+                     int beg, 
+                     secondary_as sec) const;
+    
+    long long 
+    copy_from_marker(char **dest, 
+                     size_t dest_sz, 
+                     size_t str_sz,                
+                     int beg, 
+                     secondary_as sec) const;
       
     size_t 
     copy(Ty *dest, 
@@ -433,6 +617,13 @@ public:
          int end = -1, 
          int beg = 0, 
          secondary_ty *sec = nullptr) const;
+
+    size_t 
+    copy(Ty *dest, 
+         size_t sz, 
+         int end, 
+         int beg, 
+         secondary_as sec) const;
       
     size_t 
     copy(char **dest, 
@@ -442,6 +633,35 @@ public:
          int beg = 0, 
          secondary_ty *sec = nullptr) const;
 
+    size_t 
+    copy(char **dest, 
+         size_t dest_sz, 
+         size_t str_sz, 
+         int end, 
+         int beg, 
+         secondary_as sec) const;
+
+    inline size_t
+    copy_strided(double *dest, 
+                 size_t sz, 
+                 size_t stride, 
+                 int end = -1, 
+                 int beg = 0, 
+                 secondary_ty *sec = nullptr) const
+    {
+        return _copy_strided(nullptr, dest, sz, stride, end, beg, sec);
+    }
+
+    inline size_t
+    copy_decimated(double *dest, 
+                   size_t sz, 
+                   int end = -1, 
+                   int beg = 0, 
+                   secondary_ty *sec = nullptr) const
+    {
+        return _copy_decimated(nullptr, dest, sz, end, beg, sec);
+    }
+
     generic_ty 
     operator[](int indx) const;
 
@@ -464,14 +684,38 @@ class DataStream<Ty, SecTy, GenTy, true, Allocator> /* CONTAINS PRIMARY AND SECO
         : public DataStream<Ty, SecTy, GenTy, false, Allocator> {
     typedef DataStream<Ty,SecTy,GenTy,true,Allocator> _my_ty;
     typedef DataStream<Ty,SecTy,GenTy,false,Allocator> _my_base_ty;
+    typedef typename _my_base_ty::_my_lock_guard_type _my_lock_guard_type;
+
+public:
+    typedef typename _my_base_ty::generic_ty generic_ty;
+    typedef typename _my_base_ty::secondary_ty secondary_ty;
+    typedef typename _my_base_ty::both_ty both_ty;
+    typedef typename _my_base_ty::secondary_vector_ty secondary_vector_ty;
+    typedef typename _my_base_ty::secondary_as secondary_as;
+
+private:
+    using _my_base_ty::_mtx;
+    using _my_base_ty::_qcount;
+    using _my_base_ty::_mark_count;
+    using _my_base_ty::_mark_is_dirty;
+    using _my_base_ty::_str_push_count;
+    using _my_base_ty::_push_has_priority;
+    using _my_base_ty::_yld_to_push;
+    using _my_base_ty::_incr_internal_counts;
+    using _my_base_ty::_check_adj;
+    using _my_base_ty::_copy_to_ptr;
+    using _my_base_ty::_copy_strided;
+    using _my_base_ty::_copy_decimated;
         
-    std::deque<SecTy,Allocator> _deque_secondary;  
+    typename _my_base_ty::_secondary_deque_type _deque_secondary;  
     
     void 
     _push(const Ty v, const secondary_ty sec);
 
 public:
     typedef Ty value_type;
+    using _my_base_ty::MAX_BOUND_SIZE;
+    using _my_base_ty::operator[];
 
     DataStream(size_t sz);
     DataStream(const _my_ty & stream);
@@ -501,6 +745,13 @@ public:
          int beg = 0, 
          secondary_ty *sec = nullptr) const;
 
+    size_t 
+    copy(Ty *dest, 
+         size_t sz, 
+         int end, 
+         int beg, 
+         secondary_as sec) const;
+
     size_t 
     copy(char **dest, 
          size_t dest_sz, 
@@ -508,6 +759,35 @@ public:
          int end = -1, 
          int beg = 0, 
          secondary_ty *sec = nullptr) const;
+
+    size_t 
+    copy(char **dest, 
+         size_t dest_sz, 
+         size_t str_sz, 
+         int end, 
+         int beg, 
+         secondary_as sec) const;
+
+    inline size_t
+    copy_strided(double *dest, 
+                 size_t sz, 
+                 size_t stride, 
+                 int end = -1, 
+                 int beg = 0, 
+                 secondary_ty *sec = nullptr) const
+    {
+        return _copy_strided(&_deque_secondary, dest, sz, stride, end, beg, sec);
+    }
+
+    inline size_t
+    copy_decimated(double *dest, 
+                   size_t sz, 
+                   int end = -1, 
+                   int beg = 0, 
+                   secondary_ty *sec = nullptr) const
+    {
+        return _copy_decimated(&_deque_secondary, dest, sz, end, beg, sec);
+    }
     
     both_ty 
     both(int indx) const;
@@ -525,17 +805,25 @@ public:
 
 class DataStreamError 
         : public std::exception{
+    std::string _info; /* std::exception(const char*) is MSVC-only */
+
 public:
     DataStreamError(const char* info) 
         : 
-            std::exception(info) 
+            _info(info) 
         {
         }
 
     virtual
-    ~DataStreamError()
+    ~DataStreamError() throw()
         {
         }
+
+    virtual const char*
+    what() const throw()
+    {
+        return _info.c_str();
+    }
 };
 
 class DataStreamTypeError 
@@ -186,4 +186,15 @@ public:
 };
 
 
+class TOSDB_RecordError 
+        : public TOSDB_Error{
+public:
+    TOSDB_RecordError(std::string info, std::string tag = "TickRecord")
+        : 
+            TOSDB_Error(info, tag) 
+        {
+        }
+};
+
+
 #endif
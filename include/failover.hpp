@@ -0,0 +1,188 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_FAILOVER
+#define JO_TOSDB_FAILOVER
+
+#include <atomic>
+
+#include "buffer_ring.hpp"
+
+/* hot-standby engines
+
+   A shard can run two engines: the primary (slot 0) and a standby (slot 1,
+   '--standby'). Each has its own IPC channel and its own buffers (the
+   standby's are the 'shadow rings'), and the one that's active mirrors every
+   stream op to the other, so both have the same DDE subscriptions and both
+   write every tick. Clients only talk to, and read from, the active one.
+
+   The two share a small control segment (CreateControlName). Each engine
+   bumps its heartbeat every FAILOVER_HEARTBEAT msec while its message loop
+   is responsive; the inactive one watches the active one's and, if it
+   hasn't moved for FAILOVER_TIMEOUT msec, takes over: it flips 'active' to
+   its own slot and bumps 'generation'. Clients check 'generation' each pass
+   through the buffers and re-map to the new active engine's rings, picking
+   up right after the last tick they got from the old ones (see
+   RingResumeCursor). An engine that comes back (or is respawned) is the
+   standby; if the segment still says it's active it hands over first.
+
+   A new segment is all zeros: slot 0 active, generation 0. */
+
+#define FAILOVER_HEARTBEAT 100  /* msec */
+#define FAILOVER_TIMEOUT 1000   /* msec w/o a heartbeat before we take over */
+#define FAILOVER_STAMP_SKEW 50000 /* usec the engines' stamps of a tick can differ by */
+
+struct EngineControl{
+    std::atomic<unsigned int> active;       /* slot clients use */
+    std::atomic<unsigned int> generation;   /* bumped by every take-over */
+    std::atomic<unsigned int> heartbeat[2]; /* by slot */
+    std::atomic<unsigned int> starts[2];    /* engines started, by slot */
+};
+
+
+/* one engine's side of it; call beat() every FAILOVER_HEARTBEAT msec from a
+   thread that can't be held up by anything else the engine does */
+class FailoverMonitor{
+public:
+    enum Event{
+        NONE = 0,
+        PROMOTED, /* we took over */
+        DEMOTED   /* someone took over from us */
+    };
+
+private:
+    EngineControl *_ctrl;
+    unsigned int _slot;
+    unsigned long long _timeout;
+    unsigned int _last_beat;
+    unsigned long long _last_change;
+    bool _was_active;
+
+public:
+    FailoverMonitor(EngineControl *ctrl,
+                    unsigned int slot,
+                    unsigned long long now_msec,
+                    unsigned long long timeout_msec = FAILOVER_TIMEOUT)
+        :
+            _ctrl(ctrl),
+            _slot(slot),
+            _timeout(timeout_msec),
+            _last_beat(0),
+            _last_change(now_msec),
+            _was_active(ctrl->active.load() == slot)
+        {
+        }
+
+    inline bool
+    active() const
+    {
+        return _ctrl->active.load() == _slot;
+    }
+
+    /* 'healthy' false (our message loop is stuck) skips our own heartbeat
+       and never takes over */
+    Event
+    beat(unsigned long long now_msec, bool healthy = true)
+    {
+        if(healthy)
+            _ctrl->heartbeat[_slot].fetch_add(1);
+
+        unsigned int act = _ctrl->active.load();
+        if(act == _slot){
+            _last_change = now_msec;
+            if(_was_active)
+                return NONE;
+            _was_active = true;
+            return PROMOTED; /* someone made us active */
+        }
+
+        if(_was_active){
+            _was_active = false;
+            _last_change = now_msec;
+            return DEMOTED;
+        }
+
+        unsigned int b = _ctrl->heartbeat[act & 1].load();
+        if(b != _last_beat){
+            _last_beat = b;
+            _last_change = now_msec;
+            return NONE;
+        }
+
+        if(!healthy || now_msec - _last_change < _timeout)
+            return NONE;
+
+        if( !_ctrl->active.compare_exchange_strong(act, _slot) )
+            return NONE; /* lost a race; look again next time */
+
+        _ctrl->generation.fetch_add(1);
+        _was_active = true;
+        _last_change = now_msec;
+        return PROMOTED;
+    }
+};
+
+
+/* is an element of the new ring newer than the last one read from the old?
+   Each engine stamps ticks itself so the two stamps of a tick differ a bit:
+   within FAILOVER_STAMP_SKEW of 'last' the one w/ the same value is the
+   same tick (TOS only sends a stream's value when it changes) and anything
+   else is taken to be newer */
+inline bool
+FailoverNewer(long long stamp, long long last, bool same_value)
+{
+    if(stamp > last + FAILOVER_STAMP_SKEW)
+        return true;
+
+    return stamp > last - FAILOVER_STAMP_SKEW && !same_value;
+}
+
+
+/* a reader moving over to 'head's ring: set its cursor (next_offset -
+   beg_offset, loop_seq) so the next read gets what was written after what
+   it already has. 'newer(offset)' says if the element at 'offset' is newer
+   than the last one it read (FailoverNewer); we walk back from the latest
+   until it isn't. Returns how many elements that leaves to read. */
+template<typename Head, typename Newer>
+unsigned int
+RingResumeCursor(const Head *head,
+                 Newer newer,
+                 unsigned int *cursor_offset,
+                 unsigned int *cursor_loop_seq)
+{
+    unsigned int next = head->next_offset;
+    unsigned int loop_seq = head->loop_seq;
+    unsigned int dlen = head->end_offset - head->beg_offset;
+    unsigned int rel = next - head->beg_offset;
+    unsigned int avail = (loop_seq ? dlen : rel) / head->elem_size;
+
+    unsigned int k = 0;
+    while(k < avail && newer( RingElementOffset(head, next, k + 1) ))
+        ++k;
+
+    long long off = (long long)rel - (long long)k * head->elem_size;
+    if(off < 0){
+        off += dlen;
+        --loop_seq;
+    }
+
+    *cursor_offset = (unsigned int)off;
+    *cursor_loop_seq = loop_seq;
+    return k;
+}
+
+#endif /* JO_TOSDB_FAILOVER */
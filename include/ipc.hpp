@@ -153,6 +153,13 @@ public:
         DisconnectNamedPipe(_main_channel_pipe_hndl);    
     }
 
+    /* for TOSDB_SetThreadSchedule */
+    HANDLE
+    probe_thread()
+    {
+        return _probe_channel_thread.native_handle();
+    }
+
     using IPCBase::send;
     using IPCBase::recv;  
 };
@@ -0,0 +1,213 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_LOCK_PROFILE
+#define JO_TOSDB_LOCK_PROFILE
+
+#include <atomic>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <chrono>
+#endif
+
+/* lock contention profiling
+
+   A LockProfile holds the counters for one lock 'site' - a single mutex or a
+   family of them (e.g every DataStream's mutex) - and ProfiledMutex wraps a
+   mutex type, charging its acquisitions to a site:
+
+     acquisitions  : (outermost) locks taken while the site was enabled
+     contentions   : how many of those had to block
+     wait_ticks    : time spent blocked (max_wait_ticks: longest single wait)
+     hold_ticks    : time from (outermost) lock to unlock (max_hold_ticks)
+
+   A disabled site costs a relaxed load per lock; ticks are in units of
+   LockProfileTicksPerSec(). */
+
+inline long long
+LockProfileTicks()
+{
+#ifdef _WIN32
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+    return t.QuadPart;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+inline long long
+LockProfileTicksPerSec()
+{
+#ifdef _WIN32
+    LARGE_INTEGER f;
+    QueryPerformanceFrequency(&f);
+    return f.QuadPart;
+#else
+    return 1000000000;
+#endif
+}
+
+
+class LockProfile{
+    typedef std::atomic<unsigned long long> _counter_type;
+
+    LockProfile(const LockProfile&);
+    LockProfile& operator=(const LockProfile&);
+
+    static inline void
+    _raise(_counter_type& c, unsigned long long v)
+    {
+        unsigned long long cur = c.load(std::memory_order_relaxed);
+        while(v > cur && !c.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+        {
+        }
+    }
+
+public:
+    const char* const name;
+    std::atomic<bool> enabled;
+
+    _counter_type acquisitions;
+    _counter_type contentions;
+    _counter_type wait_ticks;
+    _counter_type max_wait_ticks;
+    _counter_type hold_ticks;
+    _counter_type max_hold_ticks;
+
+    explicit LockProfile(const char* name, bool enabled = false)
+        :
+            name(name),
+            enabled(enabled)
+        {
+            reset();
+        }
+
+    void
+    reset()
+    {
+        acquisitions.store(0);
+        contentions.store(0);
+        wait_ticks.store(0);
+        max_wait_ticks.store(0);
+        hold_ticks.store(0);
+        max_hold_ticks.store(0);
+    }
+
+    inline void
+    add_wait(long long ticks)
+    {
+        contentions.fetch_add(1, std::memory_order_relaxed);
+        wait_ticks.fetch_add(ticks, std::memory_order_relaxed);
+        _raise(max_wait_ticks, ticks);
+    }
+
+    inline void
+    add_hold(long long ticks)
+    {
+        hold_ticks.fetch_add(ticks, std::memory_order_relaxed);
+        _raise(max_hold_ticks, ticks);
+    }
+};
+
+
+/* M needs lock/try_lock/unlock; recursive mutexes are fine (only the
+   outermost lock/unlock pair is timed) */
+template<typename M>
+class ProfiledMutex{
+    M _mtx;
+    LockProfile& _site;
+    long long _beg;       /* guarded by _mtx; 0 if this hold isn't timed */
+    unsigned int _depth;  /* guarded by _mtx */
+
+    ProfiledMutex(const ProfiledMutex&);
+    ProfiledMutex& operator=(const ProfiledMutex&);
+
+    inline void
+    _acquired(bool timed)
+    {
+        if(_depth++)
+            return;
+
+        _beg = timed ? LockProfileTicks() : 0;
+        if(timed)
+            _site.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+public:
+    explicit ProfiledMutex(LockProfile& site)
+        :
+            _site(site),
+            _beg(0),
+            _depth(0)
+        {
+        }
+
+    void
+    lock()
+    {
+        if( !_site.enabled.load(std::memory_order_relaxed) ){
+            _mtx.lock();
+            _acquired(false);
+            return;
+        }
+
+        if( !_mtx.try_lock() ){
+            long long t = LockProfileTicks();
+            _mtx.lock();
+            _site.add_wait(LockProfileTicks() - t);
+        }
+        _acquired(true);
+    }
+
+    bool
+    try_lock()
+    {
+        if( !_mtx.try_lock() )
+            return false;
+
+        _acquired(_site.enabled.load(std::memory_order_relaxed));
+        return true;
+    }
+
+    void
+    unlock()
+    {
+        long long held = 0;
+
+        if(--_depth == 0 && _beg){
+            held = LockProfileTicks() - _beg;
+            _beg = 0;
+        }
+        _mtx.unlock();
+
+        if(held) /* outside the lock */
+            _site.add_hold(held);
+    }
+
+    inline LockProfile&
+    site() const
+    {
+        return _site;
+    }
+};
+
+#endif /* JO_TOSDB_LOCK_PROFILE */
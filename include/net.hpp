@@ -0,0 +1,168 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_NET
+#define JO_TOSDB_NET
+
+/* implemented in src/vserver/net.cpp
+
+   Sockets and a readiness-based event loop for the virtualization server and
+   its clients. Unlike the rest of the tree this does NOT include
+   tos_databridge.h and builds on linux (epoll) as well as windows (WSAPoll)
+   so the network layer can be run and tested by itself over loopback.
+
+   NOTE: on windows include this BEFORE tos_databridge.h/windows.h so
+         winsock2.h is the first to define the socket API                    */
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET net_socket_type;
+#define NET_INVALID_SOCKET INVALID_SOCKET
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+typedef int net_socket_type;
+#define NET_INVALID_SOCKET (-1)
+#endif
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#define NET_EVENT_READ 0x1
+#define NET_EVENT_WRITE 0x2
+#define NET_EVENT_ERROR 0x4
+
+/* WSAStartup/WSACleanup on windows, a no-op elsewhere */
+bool
+NetStartup();
+
+void
+NetCleanup();
+
+int
+NetLastError();
+
+/* was the last error EWOULDBLOCK/EAGAIN/WSAEWOULDBLOCK */
+bool
+NetWouldBlock(int err);
+
+void
+NetClose(net_socket_type sock);
+
+bool
+NetSetNonBlocking(net_socket_type sock);
+
+bool
+NetSetNoDelay(net_socket_type sock);
+
+/* bind/listen on addr:port (port 0 picks an ephemeral port); returns
+   NET_INVALID_SOCKET on failure */
+net_socket_type
+NetListen(std::string addr, unsigned short port, int backlog = SOMAXCONN);
+
+/* (blocking) connect to addr:port; returns NET_INVALID_SOCKET on failure */
+net_socket_type
+NetConnect(std::string addr, unsigned short port);
+
+/* the port a socket is bound to, 0 on failure */
+unsigned short
+NetLocalPort(net_socket_type sock);
+
+/* 'host:port' of the remote end */
+std::string
+NetPeerName(net_socket_type sock);
+
+/* send/recv 'len' bytes on a blocking socket; false on error/disconnect */
+bool
+NetSendAll(net_socket_type sock, const char* buf, size_t len);
+
+bool
+NetRecvAll(net_socket_type sock, char* buf, size_t len);
+
+/* wait up to 'timeout' msec (-1 == forever) for 'sock' to be readable;
+   false on timeout or error */
+bool
+NetWaitReadable(net_socket_type sock, int timeout);
+
+/* a UDP socket connected to multicast 'group':port (so send() works) that
+   sends out of interface 'iface' (a local address, "" lets the OS pick)
+   with 'ttl' (1 == this subnet); looped back so this host can listen too */
+net_socket_type
+NetMcastSender(std::string group, unsigned short port, std::string iface, int ttl);
+
+/* a non-blocking UDP socket bound to 'port' and joined to 'group' on
+   interface 'iface'; several can share a port on one host */
+net_socket_type
+NetMcastReceiver(std::string group, unsigned short port, std::string iface);
+
+
+class NetReactor{
+/* level-triggered readiness loop: register a socket with the events it's
+   interested in and a callback; poll() waits and dispatches. Callbacks can
+   add/modify/remove sockets (including their own) during dispatch.
+
+   NOT thread-safe; use from the thread that calls poll()                   */
+public:
+    typedef std::function<void(net_socket_type, unsigned int)> callback_type;
+
+private:
+    typedef std::pair<unsigned int, callback_type> _handler_type;
+
+    std::map<net_socket_type, _handler_type> _handlers;
+
+#ifndef _WIN32
+    int _epfd;
+#endif
+
+    NetReactor(const NetReactor&);
+
+    NetReactor&
+    operator=(const NetReactor&);
+
+public:
+    NetReactor();
+
+    ~NetReactor();
+
+    bool
+    add(net_socket_type sock, unsigned int events, callback_type callback);
+
+    bool
+    modify(net_socket_type sock, unsigned int events);
+
+    void
+    remove(net_socket_type sock);
+
+    /* wait up to 'timeout' msec (-1 == forever) and dispatch; returns the
+       number of sockets dispatched or -1 on error */
+    int
+    poll(int timeout);
+
+    inline size_t
+    size() const
+    {
+        return _handlers.size();
+    }
+};
+
+#endif /* JO_TOSDB_NET */
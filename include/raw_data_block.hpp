@@ -28,6 +28,21 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #define RAW_DATA_BLOCK_CLASS RawDataBlock<GenericTy, DateTimeTy>
 #define MAX_BLOCK_COUNT 10
 
+/* makes the streams of a block that doesn't keep them on the heap (a shared
+   block - see shared_data_stream.hpp); the block owns it */
+template<typename GenericTy, typename DateTimeTy>
+class RawDataBlockStreams{
+public:
+    virtual
+    ~RawDataBlockStreams()
+        {
+        }
+
+    /* throws if the stream can't be had */
+    virtual DataStreamInterface<DateTimeTy, GenericTy>*
+    create(std::string item, TOS_Topics::TOPICS topic, size_type sz, bool datetime) = 0;
+};
+
 template<typename GenericTy, typename DateTimeTy>
 class RawDataBlock {        
     static size_type _block_count_;
@@ -38,12 +53,15 @@ class RawDataBlock {
                      TOS_Topics::top_less> _my_row_ty;  
 
     typedef std::unordered_map<std::string, std::unique_ptr<_my_row_ty>> _my_block_ty;
+
+    typedef RawDataBlockStreams<GenericTy, DateTimeTy> _my_streams_ty;
         
     _my_block_ty _block;
     size_type _block_sz;
     str_set_type _item_names;  
     topic_set_type _topic_enums;
     bool _datetime;  
+    std::unique_ptr<_my_streams_ty> _streams; /* NULL: DataStreams */
     std::recursive_mutex *const _mtx;
 
     RawDataBlock(str_set_type items, 
@@ -51,7 +69,7 @@ class RawDataBlock {
                  const size_type sz, 
                  bool datetime);
 
-    RawDataBlock(const size_type sz, bool datetime);
+    RawDataBlock(const size_type sz, bool datetime, _my_streams_ty *streams);
 
     RawDataBlock(const RawDataBlock& block)
         : 
@@ -77,16 +95,17 @@ class RawDataBlock {
     _init();
 
     _my_row_ty*     
-    _insert_topic(_my_row_ty*, TOS_Topics::TOPICS topic);
+    _insert_topic(_my_row_ty*, std::string item, TOS_Topics::TOPICS topic);
 
     std::unique_ptr<_my_row_ty> 
-    _populate_tblock(std::unique_ptr<_my_row_ty> tblock);
+    _populate_tblock(std::string item, std::unique_ptr<_my_row_ty> tblock);
 
 public:
     typedef GenericTy generic_type;
     typedef DateTimeTy datetime_type;
     typedef DataStreamInterface<DateTimeTy, GenericTy> stream_type;
     typedef const DataStreamInterface<DateTimeTy, GenericTy>* stream_const_ptr_type;
+    typedef _my_streams_ty streams_type;
     
     typedef std::vector<generic_type> vector_type; 
     typedef std::pair<std::string, generic_type> pair_type; 
@@ -107,8 +126,11 @@ public:
                 const size_type sz,
                 const bool datetime);
 
+    /* takes 'streams' (deleted if this throws) */
     static RawDataBlock* const 
-    CreateBlock(const size_type sz,const bool datetime);
+    CreateBlock(const size_type sz,
+                const bool datetime, 
+                streams_type *streams = nullptr);
 
     static inline size_type 
     block_count() 
@@ -0,0 +1,194 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_SHARD_MAP
+#define JO_TOSDB_SHARD_MAP
+
+#include <string>
+#include <map>
+#include <fstream>
+#include <sstream>
+
+/* which engine shard owns a stream
+
+   Each engine shard ('--shard N') has its own IPC channel and its own buffer
+   names (see CreateCommChannelName / CreateBufferName); shard 0 is the
+   default engine. The client asks a ShardMap where a topic/item goes:
+
+     1) the shard the item is assigned to, if any
+     2) the shard the topic is assigned to, if any
+     3) a hash of the item
+
+   Hashing the item keeps every topic of a symbol on one engine. The hash is
+   FNV-1a so every client process routes the same way - and they have to:
+   clients share the engines' buffers, so they all need the same map.
+
+   A shard map file has one assignment per line; '#' starts a comment:
+
+     shards  4           # how many engines (1 - TOSDB_MAX_SHARDS)
+     topic   LAST   1    # every LAST stream on shard 1
+     item    SPY    2    # every SPY stream on shard 2
+
+   Assignments to shards >= the shard count are ignored (they route by
+   hash). */
+
+#ifndef TOSDB_MAX_SHARDS
+#define TOSDB_MAX_SHARDS 16
+#endif
+
+class ShardMap{
+    unsigned int _count;
+    std::map<std::string, unsigned int> _topics;
+    std::map<std::string, unsigned int> _items;
+
+    static unsigned int
+    _hash(const std::string& s)
+    {
+        unsigned int h = 2166136261U;
+        for(unsigned char c : s){
+            h ^= c;
+            h *= 16777619U;
+        }
+        return h;
+    }
+
+    unsigned int
+    _lookup(const std::map<std::string, unsigned int>& m, const std::string& key) const
+    {
+        auto f = m.find(key);
+        return (f != m.end() && f->second < _count) ? f->second : _count;
+    }
+
+public:
+    ShardMap()
+        :
+            _count(1)
+        {
+        }
+
+    inline unsigned int
+    count() const
+    {
+        return _count;
+    }
+
+    /* false if 'count' isn't 1 - TOSDB_MAX_SHARDS */
+    bool
+    set_count(unsigned int count)
+    {
+        if(count < 1 || count > TOSDB_MAX_SHARDS)
+            return false;
+
+        _count = count;
+        return true;
+    }
+
+    /* 'shard' >= TOSDB_MAX_SHARDS removes the assignment */
+    void
+    assign_topic(const std::string& topic, unsigned int shard)
+    {
+        if(shard < TOSDB_MAX_SHARDS)
+            _topics[topic] = shard;
+        else
+            _topics.erase(topic);
+    }
+
+    void
+    assign_item(const std::string& item, unsigned int shard)
+    {
+        if(shard < TOSDB_MAX_SHARDS)
+            _items[item] = shard;
+        else
+            _items.erase(item);
+    }
+
+    void
+    clear()
+    {
+        _count = 1;
+        _topics.clear();
+        _items.clear();
+    }
+
+    unsigned int
+    route(const std::string& topic, const std::string& item) const
+    {
+        if(_count == 1)
+            return 0;
+
+        unsigned int s = _lookup(_items, item);
+        if(s < _count)
+            return s;
+
+        s = _lookup(_topics, topic);
+        if(s < _count)
+            return s;
+
+        return _hash(item) % _count;
+    }
+};
+
+
+inline bool
+ReadShardMap(std::string path, ShardMap *shards, std::string *err)
+{
+    std::ifstream file(path);
+    if(!file){
+        *err = "can't open " + path;
+        return false;
+    }
+
+    ShardMap m;
+    std::string line;
+    for(int lineno = 1; std::getline(file, line); ++lineno){
+        size_t c = line.find('#');
+        if(c != std::string::npos)
+            line.erase(c);
+
+        std::istringstream s(line);
+        std::string kind, name, extra;
+        unsigned int shard;
+        if( !(s >> kind) ) /* blank */
+            continue;
+
+        if(kind == "shards"){
+            if( !(s >> shard) || (s >> extra) || !m.set_count(shard) ){
+                *err = path + ':' + std::to_string(lineno) + ": expected 'shards 1-"
+                     + std::to_string(TOSDB_MAX_SHARDS) + "'";
+                return false;
+            }
+            continue;
+        }
+
+        if( (kind != "topic" && kind != "item")
+            || !(s >> name >> shard) || (s >> extra) || shard >= TOSDB_MAX_SHARDS )
+        {
+            *err = path + ':' + std::to_string(lineno) + ": expected 'topic|item name shard'";
+            return false;
+        }
+
+        if(kind == "topic")
+            m.assign_topic(name, shard);
+        else
+            m.assign_item(name, shard);
+    }
+
+    *shards = m;
+    return true;
+}
+
+#endif /* JO_TOSDB_SHARD_MAP */
@@ -0,0 +1,361 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_SHARED_BLOCK
+#define JO_TOSDB_SHARED_BLOCK
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+
+/* blocks that live in shared memory
+
+   A block made w/ TOSDB_CreateSharedBlock keeps each of its streams in its
+   own named segment (CreateSharedBlockName) instead of on the heap, and
+   lists its items and topics in a directory segment. The process that made
+   it is the only one that writes to it - its extract loop pushes into the
+   streams like it would any block's. Other processes on the machine
+   TOSDB_AttachSharedBlock to it: they get a block of their own whose
+   streams are read-only views of the owner's, which the usual Get calls
+   read w/o a lock and w/o decoding anything again.
+
+   A stream segment is a SharedStreamHead and a ring of bound + 1 slots;
+   element N (the N-th pushed) goes in slot N % (bound + 1). The owner
+   writes the slot and then bumps 'count', so a reader that loads 'count'
+   (acquire) sees every element before it. The spare slot is the one being
+   written: a reader copies what it wants, loads 'count' again and drops
+   whatever the owner could have overwritten in the meantime.
+
+   The directory is a seqlock: 'version' is odd while the owner changes it;
+   readers copy it out and try again later if 'version' moved. */
+
+#ifndef TOSDB_STR_DATA_SZ
+#define TOSDB_STR_DATA_SZ 40
+#endif
+
+#ifndef TOSDB_MAX_STR_SZ
+#define TOSDB_MAX_STR_SZ 0xFF
+#endif
+
+#define SHARED_BLOCK_MAX_ITEMS 512
+#define SHARED_BLOCK_MAX_TOPICS 128
+#define SHARED_READ_TRIES 3 /* before we settle for what wasn't overwritten */
+
+typedef struct{
+    std::atomic<unsigned long long> count; /* elements pushed, ever */
+    unsigned int bound;     /* the stream's size; there's a slot more */
+    unsigned int slot_size; /* so a reader can tell it has the right type */
+} SharedStreamHead;
+
+typedef struct{
+    std::atomic<unsigned int> version; /* odd while it's being changed */
+    std::atomic<unsigned int> owner;   /* owner's process id, 0 once it closes */
+    unsigned int block_size;
+    unsigned int datetime;
+    unsigned int nitems;
+    unsigned int ntopics;
+    unsigned int topics[SHARED_BLOCK_MAX_TOPICS]; /* TOS_Topics::TOPICS */
+    char items[SHARED_BLOCK_MAX_ITEMS][TOSDB_MAX_STR_SZ + 1];
+} SharedBlockDir;
+
+
+/* how a value is kept in a slot; strings are truncated like ValToBuf */
+template<typename Ty>
+struct SharedValue{
+    typedef Ty stored_type;
+
+    static inline void
+    store(stored_type *s, const Ty& v)
+    {
+        *s = v;
+    }
+
+    static inline void
+    load(const stored_type& s, Ty *v)
+    {
+        *v = s;
+    }
+};
+
+template<>
+struct SharedValue<std::string>{
+    typedef struct{
+        char str[TOSDB_STR_DATA_SZ];
+    } stored_type;
+
+    static inline void
+    store(stored_type *s, const std::string& v)
+    {
+        size_t n = std::min<size_t>(v.size(), TOSDB_STR_DATA_SZ - 1);
+        memcpy(s->str, v.c_str(), n);
+        s->str[n] = '\0';
+    }
+
+    static inline void
+    load(const stored_type& s, std::string *v)
+    {
+        v->assign(s.str, strnlen(s.str, TOSDB_STR_DATA_SZ));
+    }
+};
+
+
+/* one stream's segment; 'mem' has to be SegmentSize(bound) bytes */
+template<typename Ty, typename SecTy>
+class SharedRing{
+    typedef SharedValue<Ty> _value_ty;
+
+    struct _slot_ty{
+        typename _value_ty::stored_type val;
+        SecTy sec;
+    };
+
+    SharedStreamHead *_head;
+    _slot_ty *_slots;
+
+public:
+    static inline size_t
+    SegmentSize(unsigned int bound)
+    {
+        return sizeof(SharedStreamHead) + (bound + 1) * sizeof(_slot_ty);
+    }
+
+    SharedRing(void *mem)
+        :
+            _head((SharedStreamHead*)mem),
+            _slots((_slot_ty*)((char*)mem + sizeof(SharedStreamHead)))
+        {
+        }
+
+    /* the owner's: starts the segment over */
+    void
+    create(unsigned int bound)
+    {
+        memset((void*)_head, 0, SegmentSize(bound));
+        _head->bound = bound;
+        _head->slot_size = sizeof(_slot_ty);
+        _head->count.store(0, std::memory_order_release);
+    }
+
+    /* a reader's: is this the segment we think it is? */
+    inline bool
+    matches(unsigned int bound) const
+    {
+        return _head->bound == bound && _head->slot_size == sizeof(_slot_ty);
+    }
+
+    inline unsigned int
+    bound() const
+    {
+        return _head->bound;
+    }
+
+    inline unsigned long long
+    count() const
+    {
+        return _head->count.load(std::memory_order_acquire);
+    }
+
+    void
+    push(const Ty& v, const SecTy& sec)
+    {
+        unsigned long long n = _head->count.load(std::memory_order_relaxed);
+        _slot_ty& s = _slots[n % (_head->bound + 1)];
+        _value_ty::store(&s.val, v);
+        s.sec = sec;
+        _head->count.store(n + 1, std::memory_order_release);
+    }
+
+    /* [beg, end] (0 is the latest) as of 'as_of' elements pushed, newest
+       first, into 'vals' and 'secs' (either can be NULL); returns how many
+       are good - those the owner has overwritten since 'as_of' are dropped
+       from the old end, as are indices that were never pushed */
+    size_t
+    read(unsigned long long as_of,
+         size_t beg,
+         size_t end,
+         Ty *vals,
+         SecTy *secs) const
+    {
+        return _read(as_of, beg, end, vals, secs);
+    }
+
+    /* read(), but each secondary is handed to 'sink' - sink(i, sec) - instead
+       of being copied into an array (a torn one's result is dropped w/ it) */
+    template<typename SinkTy>
+    size_t
+    read_into(unsigned long long as_of,
+              size_t beg,
+              size_t end,
+              Ty *vals,
+              const SinkTy& sink) const
+    {
+        return _read(as_of, beg, end, vals, sink);
+    }
+
+    /* read() as of now; tries again if the owner got in the way */
+    size_t
+    read_latest(size_t beg,
+                size_t end,
+                Ty *vals,
+                SecTy *secs,
+                unsigned long long *as_of = NULL) const
+    {
+        return _read_latest(beg, end, vals, secs, as_of);
+    }
+
+    template<typename SinkTy>
+    size_t
+    read_latest_into(size_t beg,
+                     size_t end,
+                     Ty *vals,
+                     const SinkTy& sink,
+                     unsigned long long *as_of = NULL) const
+    {
+        return _read_latest(beg, end, vals, sink, as_of);
+    }
+
+private:
+    static inline void
+    _put(SecTy *secs, size_t i, const SecTy& sec)
+    {
+        if(secs)
+            secs[i] = sec;
+    }
+
+    template<typename SinkTy>
+    static inline void
+    _put(const SinkTy& sink, size_t i, const SecTy& sec)
+    {
+        sink(i, sec);
+    }
+
+    template<typename SecOutTy>
+    size_t
+    _read(unsigned long long as_of,
+          size_t beg,
+          size_t end,
+          Ty *vals,
+          const SecOutTy& secs) const
+    {
+        unsigned int nslots = _head->bound + 1;
+        if(beg > end || beg >= as_of)
+            return 0;
+
+        end = (size_t)std::min<unsigned long long>(end, as_of - 1);
+        for(size_t i = beg; i <= end; ++i){
+            const _slot_ty& s = _slots[(as_of - 1 - i) % nslots];
+            if(vals)
+                _value_ty::load(s.val, vals + (i - beg));
+            _put(secs, i - beg, s.sec);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        unsigned long long now = _head->count.load(std::memory_order_relaxed);
+        /* element N is good if N >= now - bound, i.e. index i if
+           i <= as_of - 1 + bound - now */
+        if(now - as_of >= _head->bound)
+            return 0;
+
+        size_t last_good = (size_t)(as_of - 1 + _head->bound - now);
+        if(last_good < beg)
+            return 0;
+
+        return std::min(end, last_good) - beg + 1;
+    }
+
+    template<typename SecOutTy>
+    size_t
+    _read_latest(size_t beg,
+                 size_t end,
+                 Ty *vals,
+                 const SecOutTy& secs,
+                 unsigned long long *as_of) const
+    {
+        unsigned long long c = 0;
+        size_t n = 0;
+        for(int i = 0; i < SHARED_READ_TRIES; ++i){
+            c = count();
+            n = _read(c, beg, end, vals, secs);
+            if(c <= beg || n == std::min<unsigned long long>(end, c - 1) - beg + 1)
+                break;
+        }
+
+        if(as_of)
+            *as_of = c;
+        return n;
+    }
+};
+
+
+/* the owner's side of the directory */
+inline bool
+SharedBlockDirWrite(SharedBlockDir *dir,
+                    const std::vector<std::string>& items,
+                    const std::vector<unsigned int>& topics)
+{
+    if(items.size() > SHARED_BLOCK_MAX_ITEMS || topics.size() > SHARED_BLOCK_MAX_TOPICS)
+        return false;
+
+    unsigned int v = dir->version.load(std::memory_order_relaxed);
+    dir->version.store(v + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for(size_t i = 0; i < items.size(); ++i){
+        size_t n = std::min<size_t>(items[i].size(), TOSDB_MAX_STR_SZ);
+        memcpy(dir->items[i], items[i].c_str(), n);
+        dir->items[i][n] = '\0';
+    }
+    for(size_t i = 0; i < topics.size(); ++i)
+        dir->topics[i] = topics[i];
+    dir->nitems = (unsigned int)items.size();
+    dir->ntopics = (unsigned int)topics.size();
+
+    dir->version.store(v + 2, std::memory_order_release);
+    return true;
+}
+
+
+/* a reader's; false if the owner was changing it (try again later) */
+inline bool
+SharedBlockDirRead(const SharedBlockDir *dir,
+                   std::vector<std::string> *items,
+                   std::vector<unsigned int> *topics,
+                   unsigned int *version)
+{
+    unsigned int v = dir->version.load(std::memory_order_acquire);
+    if(v & 1)
+        return false;
+
+    unsigned int ni = std::min<unsigned int>(dir->nitems, SHARED_BLOCK_MAX_ITEMS);
+    unsigned int nt = std::min<unsigned int>(dir->ntopics, SHARED_BLOCK_MAX_TOPICS);
+
+    items->clear();
+    for(unsigned int i = 0; i < ni; ++i)
+        items->push_back( std::string(dir->items[i], strnlen(dir->items[i], TOSDB_MAX_STR_SZ)) );
+    topics->assign(dir->topics, dir->topics + nt);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(dir->version.load(std::memory_order_relaxed) != v)
+        return false;
+
+    *version = v;
+    return true;
+}
+
+#endif /* JO_TOSDB_SHARED_BLOCK */
@@ -0,0 +1,273 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_SHARED_DATA_STREAM
+#define JO_TOSDB_SHARED_DATA_STREAM
+
+#include "data_stream.hpp"
+#include "shared_block.hpp"
+
+/* implemented in src/shared_data_stream.tpp */
+
+#define SHARED_DATASTREAM_TEMPLATE \
+    template<typename Ty, \
+             typename SecTy, \
+             typename GenTy, \
+             bool UseSecondary>
+
+#define SHARED_DATASTREAM_CLASS SharedDataStream<Ty, SecTy, GenTy, UseSecondary>
+
+/* a stream of a shared block (shared_block.hpp) - its elements are in a
+   SharedRing, not deques. The owner's is the only one that can be pushed
+   to (the others throw DataStreamError). Reads don't lock: they get what
+   the ring had when they started, less anything the owner overwrote while
+   they were at it. The marker is this process's, not the segment's, and is
+   left to the caller to guard (the client's global_rmutex).
+
+   The size is fixed when the segment is made; bound_size(sz) throws
+   DataStreamInvalidArgument for any other. */
+template<typename Ty,
+         typename SecTy,
+         typename GenTy,
+         bool UseSecondary = false>
+class SharedDataStream
+        : public DataStreamInterface<SecTy, GenTy>{
+    typedef SharedDataStream<Ty,SecTy,GenTy,UseSecondary> _my_ty;
+    typedef DataStreamInterface<SecTy,GenTy> _my_base_ty;
+
+public:
+    typedef typename _my_base_ty::generic_ty generic_ty;
+    typedef typename _my_base_ty::secondary_ty secondary_ty;
+    typedef typename _my_base_ty::both_ty both_ty;
+    typedef typename _my_base_ty::generic_vector_ty generic_vector_ty;
+    typedef typename _my_base_ty::secondary_vector_ty secondary_vector_ty;
+    typedef typename _my_base_ty::secondary_as secondary_as;
+    using _my_base_ty::MAX_BOUND_SIZE;
+
+    /* called w/ the segment when the stream is destroyed (to unmap it) */
+    typedef void(*release_type)(void*);
+
+private:
+    static_assert(GenTy::template TypeCheck<Ty>::value, "SharedDataStream: Ty failed GenTy type-check");
+
+    using _my_base_ty::_str_push_count;
+
+    SharedRing<Ty,SecTy> _ring;
+    void *const _mem;
+    const release_type _release;
+    const bool _owner;
+
+    /* where the marker was put (beg - 1) and how many had been pushed then */
+    mutable long long _mark_base;
+    mutable unsigned long long _mark_at;
+
+    SharedDataStream(const _my_ty &);
+
+    _my_ty&
+    operator=(const _my_ty &);
+
+    void
+    _push(const Ty v, const secondary_ty& sec);
+
+    void
+    _check_adj(int& end, int& beg) const;
+
+    long long
+    _marker(unsigned long long count, bool *dirty) const;
+
+    inline void
+    _set_marker(int beg, unsigned long long at) const
+    {
+        _mark_base = beg - 1;
+        _mark_at = at;
+    }
+
+    /* [beg, end] (already adjusted), at most 'sz' of it; resets the marker */
+    size_t
+    _read(Ty *dest, secondary_ty *sec, size_t sz, int end, int beg) const;
+
+    size_t
+    _read(Ty *dest, secondary_as sec, size_t sz, int end, int beg) const;
+
+    /* copy_from_marker around read_at(as_of, beg, end) - all as of the same
+       count, the marker's end clipped to 'sz' */
+    template<typename F>
+    long long
+    _copy_from_marker(size_t sz, int beg, F read_at) const;
+
+    template<typename T>
+    static inline double
+    _as_double(const T& v)
+    {
+        return (double)v;
+    }
+
+    static inline double
+    _as_double(const std::string& v)
+    {   /* string streams throw before getting here */
+        return 0.0;
+    }
+
+public:
+    typedef _my_base_ty interface_type;
+    typedef Ty value_type;
+
+    /* 'mem' is a segment of SharedRing<Ty,SecTy>::SegmentSize(sz) bytes; the
+       owner starts it over, anyone else checks that it's what they expect
+       (DataStreamError if it isn't) */
+    SharedDataStream(void *mem, size_t sz, bool owner, release_type release);
+
+    virtual
+    ~SharedDataStream();
+
+    inline bool
+    empty() const
+    {
+        return _ring.count() == 0;
+    }
+
+    inline size_t
+    size() const
+    {
+        return (size_t)std::min<unsigned long long>(_ring.count(), _ring.bound());
+    }
+
+    inline size_t
+    bound_size() const
+    {
+        return _ring.bound();
+    }
+
+    size_t
+    bound_size(size_t sz);
+
+    inline bool
+    is_owner() const
+    {
+        return _owner;
+    }
+
+    bool
+    is_marker_dirty() const;
+
+    long long
+    marker_position() const;
+
+    inline void
+    push(const Ty v, secondary_ty sec = secondary_ty())
+    {
+        _str_push_count = 0;
+        _push(v, sec);
+    }
+
+    inline void
+    push(const generic_ty& gen, secondary_ty sec = secondary_ty())
+    {
+        _str_push_count = 0;
+        _push((Ty)gen, sec);
+    }
+
+    long long
+    copy_from_marker(Ty *dest,
+                     size_t sz,
+                     int beg = 0,
+                     secondary_ty *sec = nullptr) const;
+
+    long long
+    copy_from_marker(char **dest,
+                     size_t dest_sz,
+                     size_t str_sz,
+                     int beg = 0,
+                     secondary_ty *sec = nullptr) const;
+
+    long long
+    copy_from_marker(Ty *dest,
+                     size_t sz,
+                     int beg,
+                     secondary_as sec) const;
+
+    long long
+    copy_from_marker(char **dest,
+                     size_t dest_sz,
+                     size_t str_sz,
+                     int beg,
+                     secondary_as sec) const;
+
+    size_t
+    copy(Ty *dest,
+         size_t sz,
+         int end = -1,
+         int beg = 0,
+         secondary_ty *sec = nullptr) const;
+
+    size_t
+    copy(Ty *dest,
+         size_t sz,
+         int end,
+         int beg,
+         secondary_as sec) const;
+
+    size_t
+    copy(char **dest,
+         size_t dest_sz,
+         size_t str_sz,
+         int end = -1,
+         int beg = 0,
+         secondary_ty *sec = nullptr) const;
+
+    size_t
+    copy(char **dest,
+         size_t dest_sz,
+         size_t str_sz,
+         int end,
+         int beg,
+         secondary_as sec) const;
+
+    size_t
+    copy_strided(double *dest,
+                 size_t sz,
+                 size_t stride,
+                 int end = -1,
+                 int beg = 0,
+                 secondary_ty *sec = nullptr) const;
+
+    size_t
+    copy_decimated(double *dest,
+                   size_t sz,
+                   int end = -1,
+                   int beg = 0,
+                   secondary_ty *sec = nullptr) const;
+
+    generic_ty
+    operator[](int indx) const;
+
+    both_ty
+    both(int indx) const;
+
+    void
+    secondary(secondary_ty *dest, int indx) const;
+
+    generic_vector_ty
+    vector(int end = -1, int beg = 0) const;
+
+    secondary_vector_ty
+    secondary_vector(int end = -1, int beg = 0) const;
+};
+
+#include "../src/shared_data_stream.tpp"
+
+#endif
@@ -195,6 +195,7 @@ extern CommandsMap commands_get;
 extern CommandsMap commands_stream;
 extern CommandsMap commands_frame;
 extern CommandsMap commands_local;
+extern CommandsMap commands_watch;
 
 /*wrap a reference so we can get around pair restrictions*/
 class CommandsMapRef{
@@ -0,0 +1,216 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_STRING_DICT
+#define JO_TOSDB_STRING_DICT
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <climits>
+#include <string.h>
+
+/* dictionary encoding of string streams
+
+   String topics (EXCHANGE, LASTX, HTB_ETB...) cycle through a handful of
+   values, so the engine doesn't copy each one into the stream buffer: it
+   writes a code, and the value goes in a dictionary between the buffer's
+   header and its ring (BufferHead.dict_offset).
+
+   The dictionary holds at most TOSDB_DICT_CODES (64) values per stream. A
+   new value takes the least recently used slot, but only once no element
+   left in the ring refers to that slot; the slot's code changes so a reader
+   holding the old one can tell it's gone. If every slot is still referred
+   to - more than 64 different values in one ring's worth of ticks - the
+   value is stored in the element itself (STRING_DICT_INLINE) and counted
+   in inline_count. Nothing written is lost either way.
+
+   An element's value is a code followed by room for an inline string
+   (STRING_DICT_ELEM_SZ); StringDictStore/Load write and read one. Entries
+   are written before any element that uses them, under the buffer's
+   mutex; read them under it too. */
+
+#ifndef TOSDB_STR_DATA_SZ
+#define TOSDB_STR_DATA_SZ 40
+#endif
+
+#define TOSDB_DICT_CODES 64 /* slots per stream buffer */
+
+#define STRING_DICT_INLINE UINT_MAX /* the value follows the code */
+#define STRING_DICT_ELEM_SZ (sizeof(unsigned int) + TOSDB_STR_DATA_SZ)
+
+typedef struct{
+    volatile unsigned int code;    /* the code in this slot, 0 if none */
+    char value[TOSDB_STR_DATA_SZ]; /* null-terminated */
+} StringDictEntry;
+
+typedef struct{
+    volatile unsigned int inline_count; /* values that didn't fit */
+    StringDictEntry entries[TOSDB_DICT_CODES];
+} StringDict;
+
+
+/* the engine's side: one per string stream buffer */
+class StringDictWriter{
+    StringDict *_dict;
+    unsigned int _ring_slots;
+    unsigned long long _ticks;
+    unsigned long long _last_use[TOSDB_DICT_CODES];
+    std::unordered_map<std::string, unsigned int> _codes;
+
+    /* code N lives in slot N % TOSDB_DICT_CODES; 0 means an empty slot */
+    static inline unsigned int
+    _nextCode(unsigned int code, unsigned int slot)
+    {
+        if(!code || code >= STRING_DICT_INLINE - TOSDB_DICT_CODES)
+            return TOSDB_DICT_CODES + slot;
+        return code + TOSDB_DICT_CODES;
+    }
+
+public:
+    /* starts 'dict' over; 'ring_slots' is how many elements the ring holds */
+    StringDictWriter(StringDict *dict, unsigned int ring_slots)
+        :
+            _dict(dict),
+            _ring_slots(ring_slots),
+            _ticks(0)
+        {
+            memset(dict, 0, sizeof(StringDict));
+            memset(_last_use, 0, sizeof(_last_use));
+        }
+
+    inline size_t
+    size() const
+    {
+        return _codes.size();
+    }
+
+    inline unsigned int
+    inlined() const
+    {
+        return _dict->inline_count;
+    }
+
+    /* the code for the next element; STRING_DICT_INLINE if the value has to
+       go in the element */
+    unsigned int
+    encode(std::string val)
+    {
+        if(val.size() >= TOSDB_STR_DATA_SZ) /* truncate like ValToBuf */
+            val.resize(TOSDB_STR_DATA_SZ - 1);
+
+        ++_ticks;
+
+        auto c = _codes.find(val);
+        if(c != _codes.end()){
+            _last_use[c->second % TOSDB_DICT_CODES] = _ticks;
+            return c->second;
+        }
+
+        unsigned int slot = 0;
+        for(unsigned int i = 1; i < TOSDB_DICT_CODES; ++i){
+            if(_last_use[i] < _last_use[slot])
+                slot = i;
+        }
+
+        StringDictEntry& e = _dict->entries[slot];
+        if(e.code && _last_use[slot] + _ring_slots > _ticks){
+            /* still in the ring */
+            ++(_dict->inline_count);
+            return STRING_DICT_INLINE;
+        }
+
+        if(e.code) /* drop what was in the slot */
+            _codes.erase(e.value);
+
+        unsigned int code = _nextCode(e.code, slot);
+        memcpy(e.value, val.c_str(), val.size() + 1);
+        e.code = code;
+
+        _codes[val] = code;
+        _last_use[slot] = _ticks;
+        return code;
+    }
+};
+
+
+/* the client's side: values we've already built, by slot */
+class StringDictReader{
+    std::vector<unsigned int> _codes;
+    std::vector<std::string> _values;
+
+public:
+    StringDictReader()
+        :
+            _codes(TOSDB_DICT_CODES, 0),
+            _values(TOSDB_DICT_CODES)
+        {
+        }
+
+    /* NULL if the code has gone stale */
+    const std::string*
+    lookup(const StringDict *dict, unsigned int code)
+    {
+        unsigned int slot = code % TOSDB_DICT_CODES;
+        const StringDictEntry& e = dict->entries[slot];
+        if(!code || code == STRING_DICT_INLINE || e.code != code)
+            return NULL;
+
+        if(_codes[slot] != code){
+            _values[slot].assign(e.value, strnlen(e.value, TOSDB_STR_DATA_SZ));
+            _codes[slot] = code;
+        }
+        return &_values[slot];
+    }
+};
+
+
+/* an element's value: its code, then the string itself if it's inline */
+inline void
+StringDictStore(void *pos, StringDictWriter *writer, const std::string& val)
+{
+    unsigned int code = writer->encode(val);
+    *(unsigned int*)pos = code;
+    if(code == STRING_DICT_INLINE){
+        char *s = (char*)pos + sizeof(unsigned int);
+        size_t n = std::min<size_t>(val.size(), TOSDB_STR_DATA_SZ - 1);
+        memcpy(s, val.c_str(), n);
+        s[n] = 0;
+    }
+}
+
+/* false if the element's code has gone stale */
+inline bool
+StringDictLoad(const void *pos, const StringDict *dict, StringDictReader *reader,
+               std::string *out)
+{
+    unsigned int code = *(const unsigned int*)pos;
+    if(code == STRING_DICT_INLINE){
+        const char *s = (const char*)pos + sizeof(unsigned int);
+        out->assign(s, strnlen(s, TOSDB_STR_DATA_SZ));
+        return true;
+    }
+
+    const std::string *v = reader->lookup(dict, code);
+    if(!v)
+        return false;
+    *out = *v;
+    return true;
+}
+
+#endif /* JO_TOSDB_STRING_DICT */
@@ -0,0 +1,233 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_THREAD_SCHED
+#define JO_TOSDB_THREAD_SCHED
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cctype>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/* CPU affinity and priority for the internal threads
+
+   SetThreadSchedule pins a thread to the CPUs in 'cpu_mask' (bit N = logical
+   CPU N; 0 leaves the affinity alone) and sets its priority level:
+
+     Windows  : the THREAD_PRIORITY_ values; REALTIME is TIME_CRITICAL (the
+                process' priority class isn't touched)
+     pthreads : REALTIME is SCHED_FIFO, HIGHEST is SCHED_RR (both at their
+                lowest priority; needs CAP_SYS_NICE), anything else goes back
+                to SCHED_OTHER, which has no per-thread levels
+
+   A thread config file has a thread name, a cpu mask and a priority name per
+   line; '#' starts a comment:
+
+     # thread         cpu mask   priority
+     engine_msg       0x4        highest
+     client_extract   0x8        realtime
+
+   The priority values are the public TOSDB_THREAD_PRI_ constants; they're
+   repeated here for code that doesn't include tos_databridge.h (see
+   test/c_cpp/jitter_bench.cpp). */
+
+#ifndef TOSDB_THREAD_PRI_NORMAL
+#define TOSDB_THREAD_PRI_LOWEST -2
+#define TOSDB_THREAD_PRI_BELOW_NORMAL -1
+#define TOSDB_THREAD_PRI_NORMAL 0
+#define TOSDB_THREAD_PRI_ABOVE_NORMAL 1
+#define TOSDB_THREAD_PRI_HIGHEST 2
+#define TOSDB_THREAD_PRI_REALTIME 3
+#define TOSDB_THREAD_PRI_UNCHANGED 99
+#endif
+
+#ifdef _WIN32
+typedef HANDLE native_thread_type;
+#else
+typedef pthread_t native_thread_type;
+#endif
+
+struct ThreadSchedule{
+    std::string thread;
+    unsigned long long cpu_mask;
+    int priority;
+};
+
+
+inline native_thread_type
+CurrentNativeThread()
+{
+#ifdef _WIN32
+    return GetCurrentThread(); /* pseudo-handle: only good in this thread */
+#else
+    return pthread_self();
+#endif
+}
+
+
+inline bool
+ThreadPriorityIsValid(int priority)
+{
+    return (priority >= TOSDB_THREAD_PRI_LOWEST && priority <= TOSDB_THREAD_PRI_REALTIME)
+           || priority == TOSDB_THREAD_PRI_UNCHANGED;
+}
+
+
+/* returns 0 or the system error */
+inline int
+SetThreadSchedule(native_thread_type thread, unsigned long long cpu_mask, int priority)
+{
+#ifdef _WIN32
+    if(cpu_mask && !SetThreadAffinityMask(thread, (DWORD_PTR)cpu_mask))
+        return (int)GetLastError();
+
+    if(priority == TOSDB_THREAD_PRI_UNCHANGED)
+        return 0;
+
+    int p = (priority == TOSDB_THREAD_PRI_REALTIME) ? THREAD_PRIORITY_TIME_CRITICAL : priority;
+    if( !SetThreadPriority(thread, p) )
+        return (int)GetLastError();
+
+    return 0;
+#else
+    if(cpu_mask){
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(int i = 0; i < 64 && i < CPU_SETSIZE; ++i){
+            if((cpu_mask >> i) & 1)
+                CPU_SET(i, &set);
+        }
+        int e = pthread_setaffinity_np(thread, sizeof(set), &set);
+        if(e)
+            return e;
+    }
+
+    if(priority == TOSDB_THREAD_PRI_UNCHANGED)
+        return 0;
+
+    int policy = SCHED_OTHER;
+    if(priority == TOSDB_THREAD_PRI_REALTIME)
+        policy = SCHED_FIFO;
+    else if(priority == TOSDB_THREAD_PRI_HIGHEST)
+        policy = SCHED_RR;
+
+    sched_param sp = sched_param();
+    sp.sched_priority = (policy == SCHED_OTHER) ? 0 : sched_get_priority_min(policy);
+    return pthread_setschedparam(thread, policy, &sp);
+#endif
+}
+
+
+/* the TOSDB_THREAD_[] id for a config file thread name; -1 if unknown */
+inline int
+ParseThreadName(std::string name)
+{
+    static const char* NAMES[] = {
+        "engine_msg", "engine_ipc", "engine_probe", "client_extract"
+    };
+
+    for(int i = 0; i < 4; ++i){
+        if(name == NAMES[i])
+            return i;
+    }
+
+    return -1;
+}
+
+
+inline bool
+ParseThreadPriority(std::string name, int *priority)
+{
+    static const char* NAMES[] = {
+        "lowest", "below_normal", "normal", "above_normal", "highest", "realtime"
+    };
+
+    for(std::string::iterator i = name.begin(); i != name.end(); ++i)
+        *i = (char)tolower(*i);
+
+    for(int i = 0; i < 6; ++i){
+        if(name == NAMES[i]){
+            *priority = TOSDB_THREAD_PRI_LOWEST + i;
+            return true;
+        }
+    }
+
+    if(name == "unchanged" || name == "-"){
+        *priority = TOSDB_THREAD_PRI_UNCHANGED;
+        return true;
+    }
+
+    return false;
+}
+
+
+/* false if 'path' can't be read or has a bad line ('err' says which) */
+inline bool
+ReadThreadConfig(std::string path, std::vector<ThreadSchedule> *scheds, std::string *err)
+{
+    std::ifstream file(path);
+    if(!file){
+        *err = "can't open " + path;
+        return false;
+    }
+
+    std::string line;
+    for(int lineno = 1; std::getline(file, line); ++lineno){
+        size_t c = line.find('#');
+        if(c != std::string::npos)
+            line.erase(c);
+
+        std::istringstream s(line);
+        std::string thread, mask, priority, extra;
+        if( !(s >> thread) ) /* blank */
+            continue;
+
+        ThreadSchedule sched;
+        sched.thread = thread;
+
+        if( !(s >> mask >> priority) || (s >> extra) ){
+            *err = path + ':' + std::to_string(lineno) + ": expected 'thread mask priority'";
+            return false;
+        }
+
+        try{
+            sched.cpu_mask = std::stoull(mask, nullptr, 0);
+        }catch(...){
+            *err = path + ':' + std::to_string(lineno) + ": bad cpu mask '" + mask + "'";
+            return false;
+        }
+
+        if( !ParseThreadPriority(priority, &sched.priority) ){
+            *err = path + ':' + std::to_string(lineno) + ": bad priority '" + priority + "'";
+            return false;
+        }
+
+        scheds->push_back(sched);
+    }
+
+    return true;
+}
+
+#endif /* JO_TOSDB_THREAD_SCHED */
@@ -0,0 +1,160 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_TICK_RECORD
+#define JO_TOSDB_TICK_RECORD
+
+#include "tos_databridge.h"
+#include <fstream>
+#include <map>
+#include <vector>
+
+/* implemented in src/client/client_record.cpp
+
+   A recorded 'segment' is two files:
+
+   [path]      TickSegmentHeader followed by variable-length tick records
+               (TickRecordHead + raw value bytes) in the order they came off
+               the shared buffers. Each record stores the offset of the previous
+               record of the SAME stream, chaining a stream backwards through
+               the interleaved file.
+
+   [path].idx  TickIndexHeader, a TickIndexStream for each stream and then
+               each stream's sparse time index (one TickIndexEntry every
+               TOSDB_TICK_INDEX_INTERVAL ticks). Written when the segment is
+               closed.
+
+   A query binary-searches the sparse index for the first entry past the end
+   of the time range and walks the offset chain back to its start, mapping
+   only the parts of the segment it touches.                                 */
+
+#define TOSDB_TICK_SEG_MAGIC "TOSDBTK1"
+#define TOSDB_TICK_IDX_MAGIC "TOSDBIX1"
+#define TOSDB_TICK_IDX_EXT ".idx"
+#define TOSDB_TICK_INDEX_INTERVAL 64
+#define TOSDB_TICK_NULL_OFFSET 0ULL
+
+#pragma pack(push, 1)
+
+typedef struct{
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+} TickSegmentHeader;
+
+typedef struct{
+    uint32_t stream_id;
+    uint32_t len; /* value bytes that follow */
+    int64_t  micro; /* epoch micro-seconds */
+    uint64_t prev_offset; /* TOSDB_TICK_NULL_OFFSET if first of stream */
+} TickRecordHead;
+
+typedef struct{
+    char     magic[8];
+    uint32_t nstreams;
+    uint32_t interval;
+} TickIndexHeader;
+
+typedef struct{
+    char     item[TOSDB_MAX_STR_SZ + 1];
+    char     topic[TOSDB_MAX_STR_SZ + 1];
+    uint32_t stream_id;
+    uint64_t count;
+    uint64_t first_offset;
+    uint64_t last_offset;
+    int64_t  first_micro;
+    int64_t  last_micro;
+    uint64_t nentries; /* sparse entries, stored in stream_id order */
+} TickIndexStream;
+
+typedef struct{
+    int64_t  micro;
+    uint64_t offset;
+} TickIndexEntry;
+
+#pragma pack(pop)
+
+
+class TickRecorder{
+/* appends ticks to a segment; NOT thread-safe, caller syncs */
+    struct _stream_state{
+        uint32_t id;
+        uint64_t count;
+        uint64_t first_offset;
+        uint64_t last_offset;
+        int64_t first_micro;
+        int64_t last_micro;
+        std::vector<TickIndexEntry> sparse;
+    };
+
+    typedef std::map<std::pair<TOS_Topics::TOPICS,std::string>, _stream_state> _streams_ty;
+
+    std::string _path;
+    std::ofstream _file;
+    uint64_t _offset;
+    _streams_ty _streams;
+    bool _closed;
+    bool _failed; /* a write failed; the rest of the ticks are dropped */
+
+    TickRecorder(const TickRecorder&);
+
+    TickRecorder&
+    operator=(const TickRecorder&);
+
+    void
+    _write_index();
+
+public:
+    explicit TickRecorder(std::string path);
+
+    ~TickRecorder();
+
+    /* once a write fails (disk full etc.) it's logged and the segment stops
+       growing; close() still indexes what made it */
+    void
+    append(TOS_Topics::TOPICS topic_t,
+           const std::string& item,
+           const char* val,
+           uint32_t len,
+           int64_t micro);
+
+    /* flush the segment and write the sidecar index */
+    void
+    close();
+
+    inline const std::string&
+    path() const
+    {
+        return _path;
+    }
+};
+
+
+/* visit each recorded tick of item/topic in [beg_micro, end_micro], oldest
+   first; throws TOSDB_Error if the segment or its index can't be read */
+typedef void(*tick_visitor_ty)(const char* val, uint32_t len, int64_t micro, void* arg);
+
+uint64_t
+VisitRecordedTicks(std::string path,
+                   std::string item,
+                   TOS_Topics::TOPICS topic_t,
+                   int64_t beg_micro,
+                   int64_t end_micro,
+                   tick_visitor_ty visitor,
+                   void* arg);
+
+#endif
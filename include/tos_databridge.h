@@ -189,6 +189,29 @@ typedef struct{
 #define TOSDB_CONN_ENGINE 1
 #define TOSDB_CONN_ENGINE_TOS 2
 
+/* engine routing classes (TOSDB_SetStreamPriority) */
+#define TOSDB_PRIORITY_DEFAULT -1
+#define TOSDB_PRIORITY_HIGH 0
+#define TOSDB_PRIORITY_NORMAL 1
+#define TOSDB_PRIORITY_LOW 2
+
+/* internal threads and their priority levels (TOSDB_SetThreadSchedule) */
+#define TOSDB_THREAD_ENGINE_MSG 0     /* engine: DDE/window messages */
+#define TOSDB_THREAD_ENGINE_IPC 1     /* engine: main IPC loop */
+#define TOSDB_THREAD_ENGINE_PROBE 2   /* engine: IPC probe listener */
+#define TOSDB_THREAD_CLIENT_EXTRACT 3 /* client: shared buffer extraction */
+
+#define TOSDB_THREAD_PRI_LOWEST -2
+#define TOSDB_THREAD_PRI_BELOW_NORMAL -1
+#define TOSDB_THREAD_PRI_NORMAL 0
+#define TOSDB_THREAD_PRI_ABOVE_NORMAL 1
+#define TOSDB_THREAD_PRI_HIGHEST 2
+#define TOSDB_THREAD_PRI_REALTIME 3
+#define TOSDB_THREAD_PRI_UNCHANGED 99
+
+/* engine shards (TOSDB_SetShardCount); shard 0 is the default engine */
+#define TOSDB_MAX_SHARDS 16
+
 #define TOSDB_INTGR_BIT ((type_bits_type)0x80)
 #define TOSDB_QUAD_BIT ((type_bits_type)0x40)
 #define TOSDB_STRING_BIT ((type_bits_type)0x20)
@@ -201,6 +224,7 @@ typedef struct{
 #define TOSDB_PROBE_WAIT ((int)Moderate * 3) 
 #define TOSDB_MIN_TIMEOUT 1500
 #define TOSDB_SHEM_BUF_SZ 4096
+#define TOSDB_MAX_HISTORY 4000000 /* ticks per stream buffer ('--history N') */
 #define TOSDB_BLOCK_ID_SZ 63 
 /* adjust to avoid mem issues with INT_MAX(2**32) */
 #define TOSDB_MAX_BLOCK_SZ 16777216 /* 2**24 */
@@ -243,6 +267,19 @@ typedef enum{
     high 
 }Severity;  
 
+/* what the engine keeps on a stream as it writes it, in the stream's shared 
+   buffer (TOSDB_GetStreamSummary); the session is the (local) day of the 
+   latest tick, the first tick of a new day starts it over */
+typedef struct{
+    unsigned long long count;     /* ticks this session */
+    DateTimeStamp      last_time; /* of the latest tick */
+    double             open;      /* numeric topics */
+    double             high;
+    double             low;
+    double             last;
+    char               last_str[TOSDB_STR_DATA_SZ]; /* string topics */
+} StreamSummary, *pStreamSummary;
+
 /* following block will contain back-end stuff shared by various mods;
    to access you should define 'THIS_IMPORTS_IMPLEMENTATION'  */
 #if defined(THIS_EXPORTS_IMPLEMENTATION) || defined(THIS_IMPORTS_IMPLEMENTATION)
@@ -269,9 +306,30 @@ class DLL_SPEC_IMPL IPCMaster;
 class DLL_SPEC_IMPL IPCSlave;
 
 /* for C code: create a string of form: "TOSDB_[topic name]_[item name]"  
-   only alpha-numerics */
+   only alpha-numerics; shards other than 0 add "S[shard]_" after "TOSDB_", 
+   standby engines (failover.hpp) "B_" after that */
+DLL_SPEC_IMPL std::string 
+CreateBufferName(std::string topic_str, 
+                 std::string item, 
+                 unsigned int shard=0, 
+                 bool standby=false);
+
+/* TOSDB_COMM_CHANNEL for shard 0, "[TOSDB_COMM_CHANNEL]_shard[shard]" otherwise; 
+   "_standby" added for standby engines */
+DLL_SPEC_IMPL std::string 
+CreateCommChannelName(unsigned int shard, bool standby=false);
+
+/* the control segment a shard's primary and standby engines share */
+DLL_SPEC_IMPL std::string 
+CreateControlName(unsigned int shard);
+
+/* a shared block's directory segment, "TOSDB_SB_[block id]", or one of its 
+   streams, "TOSDB_SB_[block id]_[topic name]_[item name]" (shared_block.hpp);
+   only alpha-numerics, in the session's namespace */
 DLL_SPEC_IMPL std::string 
-CreateBufferName(std::string topic_str, std::string item);
+CreateSharedBlockName(std::string id, 
+                      std::string topic_str="", 
+                      std::string item="");
 
 DLL_SPEC_IMPL std::string
 BuildLogPath(std::string name);
@@ -294,6 +352,9 @@ ParseArgs(std::vector<std::string>& vec, std::string str);
 #define TOSDB_SIG_GOOD 7 
 #define TOSDB_SIG_BAD 8 
 #define TOSDB_SIG_TEST 9
+#define TOSDB_SIG_PRIORITY 10
+#define TOSDB_SIG_THREAD 11
+#define TOSDB_SIG_MIRROR 12
 
 /* for securing shared memory buffers */
 typedef const enum{ 
@@ -311,6 +372,8 @@ typedef struct{
     volatile unsigned int beg_offset;  /* logical location (after header) */  
     volatile unsigned int end_offset;  /* logical location (after header) */ 
     volatile unsigned int next_offset; /* logical location of next write */  
+    volatile unsigned int dict_offset; /* string dictionary, 0 if none (string_dict.hpp) */
+    StreamSummary summary;             /* updated w/ each write, under the buffer's mutex */
 } BufferHead, *pBufferHead; 
 
 /* we still need to export this for DumpBufferStatus in engine.cpp */
@@ -613,6 +676,19 @@ TOSDB_ConnectionState();
 EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int            
 TOSDB_CreateBlock(LPCSTR id, size_type sz, BOOL is_datetime, size_type timeout) ;
 
+/* a block whose streams live in shared memory, for other processes on this 
+   machine to TOSDB_AttachSharedBlock to; only we write to it, and its size 
+   can't be changed */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int            
+TOSDB_CreateSharedBlock(LPCSTR id, size_type sz, BOOL is_datetime, size_type timeout);
+
+/* a block of our own, 'id', that reads the streams of the shared block 'id' 
+   another process made; it has the owner's size, items and topics (and 
+   follows them as they change) and can't be added to or removed from 
+   (TOSDB_ERROR_SET_STATE). Doesn't need a connection to the engine. */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int            
+TOSDB_AttachSharedBlock(LPCSTR id);
+
 EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int            
 TOSDB_CloseBlock(LPCSTR id);
 
@@ -643,6 +719,22 @@ TOSDB_GetLatency();
 EXT_C_SPEC DLL_SPEC_IFACE NO_THROW unsigned long 
 TOSDB_SetLatency(UpdateLatency latency);
 
+/* streams added to a block from here on start w/ what the engine kept of 
+   them (see '--history N' in README_SERVICE): the last 'max_ticks', only 
+   those from the last 'max_secs' seconds, or both (0 is no limit); 0/0, the 
+   default, turns it off */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_SetPrefill(size_type max_ticks, size_type max_secs);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_GetPrefill(size_type *max_ticks, size_type *max_secs);
+
+/* the engine's summary of a stream, straight from its shared buffer - no 
+   block needed, but the stream has to be in one (of any client) for the 
+   engine to have it; TOSDB_ERROR_SHEM_BUFFER if it doesn't */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_GetStreamSummary(LPCSTR item, LPCSTR topic_str, pStreamSummary summary);
+
 EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
 TOSDB_Add(LPCSTR id, LPCSTR* items, size_type items_len, LPCSTR* topics_str , size_type topics_len);
 
@@ -688,6 +780,28 @@ TOSDB_GetPreCachedTopicNames(LPCSTR id, LPSTR* dest, size_type array_len, size_t
 EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int          
 TOSDB_GetPreCachedItemNames(LPCSTR id, LPSTR* dest, size_type array_len, size_type str_len);
 
+/* 'Packed' versions of the string calls write into one buffer instead of an array of them:
+   array_len strings, each NUL-terminated, back to back in 'dest' (dest_len bytes), string i
+   starting at dest[offsets[i]] (slots there's no data for get ""). *dest_needed (if not NULL) 
+   gets the bytes required; if dest_len is smaller nothing is written and they return 
+   TOSDB_ERROR_BAD_INPUT_BUFFER. Pass dest == NULL to just get the size. */
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int
+TOSDB_GetTopicNamesPacked(LPCSTR id, LPSTR dest, size_type dest_len, size_type* offsets, 
+                          size_type array_len, size_type* dest_needed);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int
+TOSDB_GetItemNamesPacked(LPCSTR id, LPSTR dest, size_type dest_len, size_type* offsets, 
+                         size_type array_len, size_type* dest_needed);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int
+TOSDB_GetPreCachedTopicNamesPacked(LPCSTR id, LPSTR dest, size_type dest_len, size_type* offsets, 
+                                   size_type array_len, size_type* dest_needed);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int
+TOSDB_GetPreCachedItemNamesPacked(LPCSTR id, LPSTR dest, size_type dest_len, size_type* offsets, 
+                                  size_type array_len, size_type* dest_needed);
+
 EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int            
 TOSDB_GetTypeBits(LPCSTR topic_str, type_bits_type* type_bits);
 
@@ -715,6 +829,112 @@ TOSDB_DumpSharedBufferStatus();
 EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
 TOSDB_RemoveOrphanedStream(LPCSTR item, LPCSTR topic_str);
 
+/* set the class the engine routes an item, a topic, or one item/topic stream 
+   in (NULL or "" for 'any' item/topic). When DDE data backs up the engine 
+   routes TOSDB_PRIORITY_HIGH first, then NORMAL, then LOW; queued LOW ticks 
+   of the same stream are conflated (only the latest is written). Stream 
+   settings beat item settings beat topic settings; TOSDB_PRIORITY_DEFAULT 
+   removes a setting (NULL/NULL removes all of them). By default BID, ASK, 
+   LAST and their sizes are HIGH, string topics LOW, everything else NORMAL. 
+   Queue stats go to the TOSDB_DumpSharedBufferStatus file. */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_SetStreamPriority(LPCSTR item, LPCSTR topic_str, int priority);
+
+/* pin one of the internal threads (TOSDB_THREAD_[]) to the CPUs in cpu_mask 
+   (bit N = logical CPU N; 0 leaves it alone) and set its priority 
+   (TOSDB_THREAD_PRI_[]). Engine threads are set through the engine; the 
+   client's extraction thread keeps its setting across (re)connects. 
+   REALTIME is THREAD_PRIORITY_TIME_CRITICAL - use a dedicated core. */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_SetThreadSchedule(int thread, unsigned long long cpu_mask, int priority);
+
+/* apply a thread config file: 'thread cpu_mask priority' per line, e.g 
+   'engine_msg 0x4 highest' ('#' comments); the engine also reads 
+   tos-databridge-threads.cfg from its own directory when it starts */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_LoadThreadConfig(LPCSTR path);
+
+/* spread streams over 'n' engines (1 - TOSDB_MAX_SHARDS), each started with 
+   'tos-databridge-serv --shards n' (or as 'tos-databridge-engine --shard N'). 
+   A stream goes to the shard its item is assigned to, else to the shard its 
+   topic is assigned to, else to one picked by hashing the item. Every client 
+   using the engines needs the same map; it can only be changed while this 
+   client isn't connected and has no streams (TOSDB_ERROR_SET_STATE). */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_SetShardCount(unsigned int n);
+
+/* assign an item OR a topic (the other NULL or "") to 'shard'; a shard >= 
+   TOSDB_MAX_SHARDS removes the assignment */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_AssignShard(LPCSTR item, LPCSTR topic_str, unsigned int shard);
+
+/* replace the shard count and assignments with a shard map file: 'shards n', 
+   'topic name shard' or 'item name shard' per line ('#' comments) */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_LoadShardMap(LPCSTR path);
+
+/* write every tick pulled off the shared buffers to a segment at 'path'; the 
+   sidecar index ('path'.idx) is written when the segment is closed by 
+   TOSDB_StopRecording (or another call to TOSDB_StartRecording) */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_StartRecording(LPCSTR path);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_StopRecording();
+
+/* per-API call stats, summed over every thread, since load or the last reset. 
+   Each row is a group of calls (e.g "GetStreamSnapshot" counts every typed 
+   snapshot call) and times are in micro-seconds; 'lock_waits' / 
+   'lock_wait_micro' are how often and how long calls blocked on the library's 
+   internal locks. The last rows are those locks themselves ("lock:..."): 
+   'calls' is acquisitions, 'max_micro' the longest wait. TOSDB_GetApiStats 
+   fills up to array_len rows; *get_size gets the number of rows there are 
+   (pass dest == NULL to just get that). */
+#define TOSDB_API_STAT_NAME_SZ 32
+
+typedef struct{
+    char               name[TOSDB_API_STAT_NAME_SZ];
+    unsigned long long calls;
+    unsigned long long errors;
+    unsigned long long total_micro;
+    unsigned long long max_micro;
+    unsigned long long lock_waits;
+    unsigned long long lock_wait_micro;
+} ApiStats, *pApiStats;
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_GetApiStats(pApiStats dest, size_type array_len, size_type* get_size);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_ResetApiStats();
+
+/* lock contention profile of the library's own locks: "global_rmutex", 
+   "buffers_mtx" and "DataStream" (every stream's mutex, together). Off by 
+   default - TOSDB_SetLockProfiling(TRUE) turns it on (FALSE off; counts are 
+   kept). 'contentions' is how many acquisitions had to block; wait times are
+   time spent blocked, hold times from lock to unlock, in micro-seconds. 
+   TOSDB_GetLockStats fills like TOSDB_GetApiStats. The engine's buffer_mtx and
+   topic_mtx are always profiled and written to the TOSDB_DumpSharedBufferStatus
+   file. */
+typedef struct{
+    char               name[TOSDB_API_STAT_NAME_SZ];
+    unsigned long long acquisitions;
+    unsigned long long contentions;
+    unsigned long long wait_micro;
+    unsigned long long max_wait_micro;
+    unsigned long long hold_micro;
+    unsigned long long max_hold_micro;
+} LockStats, *pLockStats;
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_SetLockProfiling(BOOL on);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_GetLockStats(pLockStats dest, size_type array_len, size_type* get_size);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int           
+TOSDB_ResetLockStats();
+
 #ifdef __cplusplus
 
 /* (extended) 'Administrative' C++ API  -  client_admin.cpp
@@ -938,6 +1158,48 @@ EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int
 TOSDB_GetStreamSnapshotStrings(LPCSTR id, LPCSTR item, LPCSTR topic_str, LPSTR* dest, size_type array_len, size_type str_len, 
                                pDateTimeStamp datetime, long end, long beg);
 
+/* see 'Packed' above */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetStreamSnapshotStringsPacked(LPCSTR id, LPCSTR item, LPCSTR topic_str, LPSTR dest, size_type dest_len,
+                                     size_type* offsets, size_type array_len, size_type* dest_needed,
+                                     pDateTimeStamp datetime, long end, long beg);
+
+/* numeric topics straight into caller-owned contiguous arrays: 'dest' holds array_len 
+   values of the topic's own type (see TOSDB_GetTypeBits; strings aren't supported) and 
+   'epoch_micro' (if not NULL) array_len time-stamps as micro-seconds since the epoch - 
+   no per-element structs for the caller to convert (numpy.frombuffer etc.). The values 
+   are one copy out of the stream; each stamp is converted as it's copied, under the 
+   stream's lock, which costs a mktime per distinct second (slots past what the stream 
+   holds come back 0) */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetStreamSnapshotToBuffers(LPCSTR id, LPCSTR item, LPCSTR topic_str, void* dest, size_type array_len,
+                                 long long* epoch_micro, long end, long beg);
+
+/* the same for 'nitems' items at once (one call, one lock): item i's [beg, end] (clipped to
+   what the stream holds) goes to dest[offsets[i]] ... dest[offsets[i+1] - 1], 'offsets'
+   holding nitems + 1 entries. array_len must be at least nitems * (end - beg + 1)
+   (TOSDB_ERROR_BAD_INPUT_BUFFER otherwise) */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int
+TOSDB_GetStreamSnapshotsToBuffers(LPCSTR id, LPCSTR* items, size_type nitems, LPCSTR topic_str, void* dest,
+                                  size_type array_len, long long* epoch_micro, size_type* offsets, long end,
+                                  long beg);
+
+
+/* numeric topics as doubles, for charting, without fetching the whole range: 
+   'Strided' returns every stride'th element of [beg, end]; 'Decimated' fits 
+   [beg, end] into at most array_len (>= 4) points by splitting it into array_len / 4 
+   buckets and returning each one's first, min, max and last (so spikes survive). 
+   'epoch_micro' (if not NULL) gets the matching time-stamps, 'get_size' the number 
+   of points written. Both are done in the stream, under one lock.  */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int
+TOSDB_GetStreamSnapshotStrided(LPCSTR id, LPCSTR item, LPCSTR topic_str, double* dest, size_type array_len,
+                               long long* epoch_micro, size_type stride, long end, long beg, 
+                               size_type* get_size);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int
+TOSDB_GetStreamSnapshotDecimated(LPCSTR id, LPCSTR item, LPCSTR topic_str, double* dest, size_type array_len,
+                                 long long* epoch_micro, long end, long beg, size_type* get_size);
+
 
 /* 'guaranteed' to be contiguous between calls (Get, GetStreamSnapshot, GetStreamSnapshot) */
 
@@ -1000,6 +1262,13 @@ EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int
 TOSDB_GetItemFrameStrings(LPCSTR id, LPCSTR topic_str, LPSTR* dest, size_type array_len, size_type str_len, 
                           LPSTR* label_dest, size_type label_str_len, pDateTimeStamp datetime); 
 
+/* see 'Packed' above; labels are packed the same way into label_dest if it isn't NULL */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetItemFrameStringsPacked(LPCSTR id, LPCSTR topic_str, LPSTR dest, size_type dest_len, size_type* offsets,
+                                size_type array_len, size_type* dest_needed, LPSTR label_dest, 
+                                size_type label_dest_len, size_type* label_offsets, 
+                                size_type* label_dest_needed, pDateTimeStamp datetime);
+
 #ifdef __cplusplus  
 
 /* get all the most recent topic values for a particular item */
@@ -1023,6 +1292,12 @@ EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int
 TOSDB_GetTopicFrameStrings(LPCSTR id, LPCSTR item, LPSTR* dest, size_type array_len, size_type str_len, 
                            LPSTR* label_dest, size_type label_str_len, pDateTimeStamp datetime); 
 
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetTopicFrameStringsPacked(LPCSTR id, LPCSTR item, LPSTR dest, size_type dest_len, size_type* offsets,
+                                 size_type array_len, size_type* dest_needed, LPSTR label_dest, 
+                                 size_type label_dest_len, size_type* label_offsets, 
+                                 size_type* label_dest_needed, pDateTimeStamp datetime);
+
 #ifdef __cplusplus
 
 /* get all the most recent item and topic values */
@@ -1040,6 +1315,155 @@ template<>
 DLL_SPEC_IFACE generic_dts_matrix_type 
 TOSDB_GetTotalFrame<true>(std::string id);
 
+#endif
+
+/* 'WithEpoch' C API  -  client_get.cpp
+
+   the same as the calls above that return DateTimeStamps but with time-stamps as 
+   micro-seconds since the epoch (int64) in a flat array instead; saves converting 
+   each struct on the other side of the call. Each stamp is converted as it's 
+   copied out of the stream (or frame), no DateTimeStamps in between. 'epoch_micro' 
+   can be NULL, slots with no data come back 0.   */
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetDoubleWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, long indx, ext_price_type* dest, 
+                         long long* epoch_micro);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetFloatWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, long indx, def_price_type* dest, 
+                        long long* epoch_micro);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetLongLongWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, long indx, ext_size_type* dest, 
+                           long long* epoch_micro);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetLongWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, long indx, def_size_type* dest, 
+                       long long* epoch_micro);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetStringWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, long indx, LPSTR dest, 
+                         size_type str_len, long long* epoch_micro);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetStreamSnapshotDoublesWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, ext_price_type* dest, 
+                                        size_type array_len, long long* epoch_micro, long end, long beg); 
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetStreamSnapshotFloatsWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, def_price_type* dest, 
+                                       size_type array_len, long long* epoch_micro, long end, long beg); 
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetStreamSnapshotLongLongsWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, ext_size_type* dest, 
+                                          size_type array_len, long long* epoch_micro, long end, long beg); 
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetStreamSnapshotLongsWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, def_size_type* dest, 
+                                      size_type array_len, long long* epoch_micro, long end, long beg); 
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetStreamSnapshotStringsWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, LPSTR* dest, 
+                                        size_type array_len, size_type str_len, long long* epoch_micro, 
+                                        long end, long beg);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetStreamSnapshotStringsPackedWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, LPSTR dest, 
+                                              size_type dest_len, size_type* offsets, size_type array_len, 
+                                              size_type* dest_needed, long long* epoch_micro, long end, 
+                                              long beg);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetStreamSnapshotDoublesFromMarkerWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, 
+                                                  ext_price_type* dest, size_type array_len, 
+                                                  long long* epoch_micro, long beg, long *get_size);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetStreamSnapshotFloatsFromMarkerWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, 
+                                                 def_price_type* dest, size_type array_len, 
+                                                 long long* epoch_micro, long beg, long *get_size);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetStreamSnapshotLongLongsFromMarkerWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, 
+                                                    ext_size_type* dest, size_type array_len, 
+                                                    long long* epoch_micro, long beg, long *get_size);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetStreamSnapshotLongsFromMarkerWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, 
+                                                def_size_type* dest, size_type array_len, 
+                                                long long* epoch_micro, long beg, long *get_size);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetStreamSnapshotStringsFromMarkerWithEpoch(LPCSTR id, LPCSTR item, LPCSTR topic_str, LPSTR* dest, 
+                                                  size_type array_len, size_type str_len, 
+                                                  long long* epoch_micro, long beg, long *get_size);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetItemFrameDoublesWithEpoch(LPCSTR id, LPCSTR topic_str, ext_price_type* dest, size_type array_len, 
+                                   LPSTR* label_dest, size_type label_str_len, long long* epoch_micro);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetItemFrameFloatsWithEpoch(LPCSTR id, LPCSTR topic_str, def_price_type* dest, size_type array_len, 
+                                  LPSTR* label_dest, size_type label_str_len, long long* epoch_micro);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetItemFrameLongLongsWithEpoch(LPCSTR id, LPCSTR topic_str, ext_size_type* dest, size_type array_len, 
+                                     LPSTR* label_dest, size_type label_str_len, long long* epoch_micro);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetItemFrameLongsWithEpoch(LPCSTR id, LPCSTR topic_str, def_size_type* dest, size_type array_len, 
+                                 LPSTR* label_dest, size_type label_str_len, long long* epoch_micro);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetItemFrameStringsWithEpoch(LPCSTR id, LPCSTR topic_str, LPSTR* dest, size_type array_len, 
+                                   size_type str_len, LPSTR* label_dest, size_type label_str_len, 
+                                   long long* epoch_micro);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetItemFrameStringsPackedWithEpoch(LPCSTR id, LPCSTR topic_str, LPSTR dest, size_type dest_len, 
+                                         size_type* offsets, size_type array_len, size_type* dest_needed, 
+                                         LPSTR label_dest, size_type label_dest_len, 
+                                         size_type* label_offsets, size_type* label_dest_needed, 
+                                         long long* epoch_micro);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetTopicFrameStringsWithEpoch(LPCSTR id, LPCSTR item, LPSTR* dest, size_type array_len, 
+                                    size_type str_len, LPSTR* label_dest, size_type label_str_len, 
+                                    long long* epoch_micro);
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetTopicFrameStringsPackedWithEpoch(LPCSTR id, LPCSTR item, LPSTR dest, size_type dest_len, 
+                                          size_type* offsets, size_type array_len, size_type* dest_needed, 
+                                          LPSTR label_dest, size_type label_dest_len, 
+                                          size_type* label_offsets, size_type* label_dest_needed, 
+                                          long long* epoch_micro);
+
+/* 'Recorded' C/C++ API  -  client_record.cpp
+
+   ticks of an item/topic in [beg_micro, end_micro] (epoch micro-seconds), oldest 
+   first, from a closed segment written by TOSDB_StartRecording. Only the first 
+   'array_len' are returned; use TOSDB_GetRecordedCount to size the arrays.   */
+
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetRecordedCount(LPCSTR path, LPCSTR item, LPCSTR topic_str, long long beg_micro, 
+                       long long end_micro, size_type* count);
+
+/* numeric topics */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetRecordedDoubles(LPCSTR path, LPCSTR item, LPCSTR topic_str, long long beg_micro, long long end_micro,
+                         ext_price_type* dest, size_type array_len, pDateTimeStamp datetime, size_type* get_size);
+
+/* 'str_len' includes the null; 0 is TOSDB_ERROR_BAD_INPUT */
+EXT_C_SPEC DLL_SPEC_IFACE NO_THROW int  
+TOSDB_GetRecordedStrings(LPCSTR path, LPCSTR item, LPCSTR topic_str, long long beg_micro, long long end_micro,
+                         LPSTR* dest, size_type array_len, size_type str_len, pDateTimeStamp datetime, 
+                         size_type* get_size);
+
+#ifdef __cplusplus
+
+DLL_SPEC_IFACE generic_dts_vectors_type 
+TOSDB_GetRecorded(std::string path, std::string item, TOS_Topics::TOPICS topic_t, 
+                  long long beg_micro, long long end_micro);
+
 
 /* OSTREAM OVERLOADS - client_out.cpp */
 
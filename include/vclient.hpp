@@ -0,0 +1,374 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_VCLIENT
+#define JO_TOSDB_VCLIENT
+
+#include "net.hpp"
+#include "vprotocol.hpp"
+
+#include <deque>
+
+/* implemented in src/vserver/vclient.cpp
+
+   C++ client for tos-databridge-vserver; only needs net.cpp and vclient.cpp,
+   NOT the tos-databridge DLL, so it builds wherever they do (windows, linux).
+
+   VClient is the raw (blocking) connection: send() queues a request and
+   returns its id without waiting, wait() flushes and reads until that id's
+   reply arrives. Queue as many as you like before waiting - they all go out
+   in one write and the server answers them in order.
+
+   VRemoteBlock wraps the block calls; a non-VSTATUS_OK reply throws
+   VStatusError with the status (VSTATUS_[] or TOSDB_ERROR_[]).
+
+   VMirror subscribes to streams of one or more VRemoteBlocks and keeps a
+   local copy of each, updated from the TICKS frames the server pushes; the
+   frames queue up in the VClient until update() is called.                 */
+
+#define VCLIENT_DEF_BLOCK_TIMEOUT 2000 /* TOSDB_DEF_TIMEOUT */
+
+class VStatusError
+        : public VProtocolError{
+    int16_t _status;
+
+public:
+    VStatusError(std::string info, int16_t status)
+        :
+            VProtocolError(info),
+            _status(status)
+        {
+        }
+
+    inline int16_t
+    status() const
+    {
+        return _status;
+    }
+};
+
+
+class VClient{
+public:
+    struct reply_type{
+        VFrameHeader head;
+        std::vector<char> body;
+    };
+
+private:
+    net_socket_type _sock;
+    uint32_t _next_id;
+    std::vector<char> _out;
+    std::map<uint32_t, reply_type> _early; /* replies read ahead of the one we wanted */
+    std::deque<reply_type> _pushed; /* unsolicited frames, oldest first */
+
+    VClient(const VClient&);
+
+    VClient&
+    operator=(const VClient&);
+
+    reply_type
+    _read_reply();
+
+public:
+    /* throws VProtocolError if we can't connect */
+    VClient(std::string addr, unsigned short port = VPROTO_DEF_PORT);
+
+    ~VClient();
+
+    /* queue a request (NOT sent until flush/wait); returns its id */
+    uint32_t
+    send(uint16_t op, const std::vector<char>& body);
+
+    void
+    flush();
+
+    /* block until the reply for 'id' arrives */
+    reply_type
+    wait(uint32_t id);
+
+    inline reply_type
+    call(uint16_t op, const std::vector<char>& body)
+    {
+        return wait( send(op, body) );
+    }
+
+    /* call and throw VStatusError on a bad status */
+    reply_type
+    call_checked(uint16_t op, const std::vector<char>& body);
+
+    /* the next unsolicited (VPROTO_PUSH_ID) frame, waiting up to 'timeout'
+       msec (-1 == forever) for one; false if none arrived */
+    bool
+    next_push(reply_type* frame, int timeout = 0);
+
+    inline size_t
+    pushed_count() const
+    {
+        return _pushed.size();
+    }
+
+    /* admin */
+    uint32_t
+    ping();
+
+    bool
+    connected();
+
+    uint32_t
+    connection_state();
+
+    uint32_t
+    get_block_limit();
+
+    uint32_t
+    set_block_limit(uint32_t limit);
+
+    uint32_t
+    get_block_count();
+
+    uint8_t
+    type_bits(std::string topic);
+};
+
+
+class VRemoteBlock{
+    VClient& _client;
+    std::string _id;
+    bool _datetime;
+    bool _packed;
+    bool _closed;
+
+    VRemoteBlock(const VRemoteBlock&);
+
+    VRemoteBlock&
+    operator=(const VRemoteBlock&);
+
+    std::vector<char>
+    _body() const; /* starts with our id */
+
+    std::vector<std::string>
+    _names(uint16_t op);
+
+    void
+    _change(uint16_t op, const std::vector<std::string>& strs);
+
+    inline uint8_t
+    _flags(bool datetime) const
+    {
+        return (datetime ? VARRAY_DTS : 0) | (_packed ? VARRAY_PACKED : 0);
+    }
+
+public:
+    VRemoteBlock(VClient& client,
+                 std::string id,
+                 uint32_t size = 1000,
+                 bool datetime = false,
+                 uint32_t timeout = VCLIENT_DEF_BLOCK_TIMEOUT);
+
+    /* closes the block; use close() to see errors */
+    ~VRemoteBlock();
+
+    void
+    close();
+
+    inline const std::string&
+    id() const
+    {
+        return _id;
+    }
+
+    inline bool
+    is_using_datetime() const
+    {
+        return _datetime;
+    }
+
+    /* ask for delta-packed integer columns (VARRAY_PACKED); on by default */
+    inline void
+    set_packed(bool packed)
+    {
+        _packed = packed;
+    }
+
+    uint32_t
+    get_block_size();
+
+    void
+    set_block_size(uint32_t size);
+
+    uint32_t
+    stream_occupancy(std::string item, std::string topic);
+
+    inline void
+    add_items(const std::vector<std::string>& items)
+    {
+        _change(VOP_ADD_ITEMS, items);
+    }
+
+    inline void
+    add_topics(const std::vector<std::string>& topics)
+    {
+        _change(VOP_ADD_TOPICS, topics);
+    }
+
+    inline void
+    remove_items(const std::vector<std::string>& items)
+    {
+        _change(VOP_REMOVE_ITEMS, items);
+    }
+
+    inline void
+    remove_topics(const std::vector<std::string>& topics)
+    {
+        _change(VOP_REMOVE_TOPICS, topics);
+    }
+
+    inline std::vector<std::string>
+    items()
+    {
+        return _names(VOP_GET_ITEMS);
+    }
+
+    inline std::vector<std::string>
+    topics()
+    {
+        return _names(VOP_GET_TOPICS);
+    }
+
+    inline std::vector<std::string>
+    items_precached()
+    {
+        return _names(VOP_GET_ITEMS_PRECACHED);
+    }
+
+    inline std::vector<std::string>
+    topics_precached()
+    {
+        return _names(VOP_GET_TOPICS_PRECACHED);
+    }
+
+    VValue
+    get(std::string item, std::string topic, long indx = 0, bool datetime = false);
+
+    /* pipelined get: queue now, collect with get_result (in any order) */
+    uint32_t
+    get_async(std::string item, std::string topic, long indx = 0, bool datetime = false);
+
+    VValue
+    get_result(uint32_t req_id, bool datetime = false);
+
+    VArray
+    stream_snapshot(std::string item,
+                    std::string topic,
+                    long end = -1,
+                    long beg = 0,
+                    bool smart_size = true,
+                    bool datetime = false);
+
+    /* 'get_size' as in the C call: 0 if beg is past the marker, negative if
+       data was lost; 'dirty' is the marker state before the call */
+    VArray
+    stream_snapshot_from_marker(std::string item,
+                                std::string topic,
+                                long beg,
+                                uint32_t margin_of_safety,
+                                bool datetime,
+                                long* get_size,
+                                bool* dirty = nullptr);
+
+    VArray
+    item_frame(std::string topic, bool datetime = false,
+               std::vector<std::string>* labels = nullptr);
+
+    VArray
+    topic_frame(std::string item, bool datetime = false,
+                std::vector<std::string>* labels = nullptr);
+};
+
+
+
+class VMirror{
+public:
+    typedef std::pair<std::string, std::string> stream_key_type; /* item, topic */
+    typedef std::deque<VValue> stream_type; /* most recent first */
+
+private:
+    struct _block_type{
+        size_t depth;
+        uint64_t dropped; /* by the server; never made it into a frame */
+        uint64_t conflated; /* sent as part of a later point */
+        std::map<stream_key_type, stream_type> streams;
+    };
+
+    VClient& _client;
+    std::map<std::string, _block_type> _blocks;
+
+    VMirror(const VMirror&);
+
+    VMirror&
+    operator=(const VMirror&);
+
+    size_t
+    _apply(const VClient::reply_type& frame);
+
+    const _block_type&
+    _block(const std::string& block_id) const;
+
+public:
+    explicit VMirror(VClient& client)
+        :
+            _client(client)
+        {
+        }
+
+    /* keep the last 'depth' points of each stream; 'policy' is what the
+       server should do if we fall behind (VPUSH_DROP or VPUSH_CONFLATE)   */
+    void
+    subscribe(VRemoteBlock& block,
+              const std::vector<stream_key_type>& streams,
+              uint8_t policy = VPUSH_CONFLATE,
+              size_t depth = 1000);
+
+    /* no streams == all of the block's */
+    void
+    unsubscribe(VRemoteBlock& block,
+                const std::vector<stream_key_type>& streams = std::vector<stream_key_type>());
+
+    /* apply every pushed frame, waiting up to 'timeout' msec for the first;
+       returns the number of points added                                   */
+    size_t
+    update(int timeout = 0);
+
+    /* throw std::out_of_range if not subscribed */
+    const stream_type&
+    stream(const std::string& block_id, std::string item, std::string topic) const;
+
+    inline uint64_t
+    dropped(const std::string& block_id) const
+    {
+        return _block(block_id).dropped;
+    }
+
+    inline uint64_t
+    conflated(const std::string& block_id) const
+    {
+        return _block(block_id).conflated;
+    }
+};
+
+#endif /* JO_TOSDB_VCLIENT */
@@ -0,0 +1,143 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_VHANDLER
+#define JO_TOSDB_VHANDLER
+
+#include "vserver.hpp" /* before tos_databridge.h, see net.hpp */
+#include "vmulticast.hpp"
+#include "tos_databridge.h"
+
+#include <chrono>
+#include <set>
+
+/* implemented in src/vserver/vhandler.cpp
+
+   The VRequestHandler behind tos-databridge-vserver: decodes each request,
+   makes the (C) API call against the local client library and encodes the
+   result. Blocks are tracked per connection; a connection can only see the
+   blocks it created and they're closed when it disconnects.
+
+   Subscribed streams are read from their markers every 'push_interval' msec
+   (from on_idle) and pushed to the owning connection as TICKS frames.
+
+   With multicast() the handler also reads a block of its own on the same
+   schedule and publishes it to a multicast group, answering the recovery
+   requests (MCAST_RETRANSMIT etc.) from any connection.                    */
+
+#define VHANDLER_DEF_PUSH_INTERVAL 10 /* msec */
+#define VHANDLER_PUSH_MARGIN 100 /* margin_of_safety for the marker reads */
+#define VHANDLER_MCAST_BLOCK "_VSERVER_MCAST_"
+
+class TOSDB_VHandler
+        : public VRequestHandler{
+    typedef std::set<std::string> _blocks_type;
+    typedef std::pair<std::string, std::string> _stream_type; /* item, topic */
+
+    struct _sub_type{
+        std::set<_stream_type> streams;
+        uint8_t policy;
+        bool use_dts;
+        bool packed;
+        uint32_t dropped; /* since the last TICKS we managed to send */
+    };
+
+    typedef std::map<std::string, _sub_type> _subs_type; /* by block id */
+
+    std::map<vconn_id_type, _blocks_type> _blocks;
+    std::map<vconn_id_type, _subs_type> _subs;
+    bool _verbose;
+    std::chrono::milliseconds _push_interval;
+    std::chrono::steady_clock::time_point _last_push;
+    VMcastPublisher* _mcast;
+    std::vector<_stream_type> _mcast_streams;
+    bool _mcast_dts;
+
+    bool
+    _owns(vconn_id_type conn, const std::string& id) const;
+
+    int16_t
+    _admin(uint16_t op, VReader& in, VWriter& out);
+
+    int16_t
+    _block(vconn_id_type conn, uint16_t op, VReader& in, VWriter& out);
+
+    int16_t
+    _data(uint16_t op, const std::string& id, VReader& in, VWriter& out);
+
+    int16_t
+    _subscribe(vconn_id_type conn, uint16_t op, const std::string& id, VReader& in);
+
+    void
+    _push(VServer& server, vconn_id_type conn, const std::string& id, _sub_type& sub);
+
+    void
+    _publish();
+
+public:
+    explicit TOSDB_VHandler(bool verbose = false,
+                            unsigned int push_interval = VHANDLER_DEF_PUSH_INTERVAL)
+        :
+            _verbose(verbose),
+            _push_interval(push_interval),
+            _mcast(nullptr),
+            _mcast_dts(false)
+        {
+        }
+
+    /* close any blocks that are still open */
+    ~TOSDB_VHandler();
+
+    int16_t
+    handle(vconn_id_type conn, uint16_t op, VReader& in, VWriter& out);
+
+    void
+    on_connect(vconn_id_type conn, const std::string& peer);
+
+    void
+    on_disconnect(vconn_id_type conn);
+
+    void
+    on_idle(VServer& server);
+
+    /* publish every new point of items x topics to 'publisher' (which must
+       outlive us), read from a block of our own (VHANDLER_MCAST_BLOCK);
+       returns a TOSDB_ERROR_[] code                                        */
+    int
+    multicast(VMcastPublisher& publisher,
+              const std::vector<std::string>& items,
+              const std::vector<std::string>& topics,
+              size_type block_size,
+              bool use_dts);
+
+    inline unsigned int
+    push_interval() const
+    {
+        return (unsigned int)_push_interval.count();
+    }
+
+    inline size_t
+    block_count() const
+    {
+        size_t n = 0;
+        for(auto& b : _blocks)
+            n += b.second.size();
+        return n;
+    }
+};
+
+#endif /* JO_TOSDB_VHANDLER */
@@ -0,0 +1,252 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_VMULTICAST
+#define JO_TOSDB_VMULTICAST
+
+#include "net.hpp"
+#include "vprotocol.hpp"
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+
+/* implemented in src/vserver/vmulticast.cpp
+
+   Multicast fan-out of ticks: one publisher (tos-databridge-vserver
+   --mcast) sends every new point of a fixed set of streams to a multicast
+   group once, however many boxes on the segment are listening.
+
+   Each datagram is a VMcastHeader followed by 'count' records
+
+       string item, string topic, array (new points, most recent first)
+
+   (vprotocol.hpp encodings) and is never bigger than VMCAST_MAX_DATAGRAM.
+   Datagrams are numbered 1, 2, 3 ... per 'session' (a publisher restart
+   starts a new one); a datagram with count == 0 is a heartbeat repeating
+   the last number sent, so a receiver notices a lost tail when things go
+   quiet.
+
+   UDP can drop or reorder, so the publisher keeps its last 'history'
+   datagrams and answers MCAST_RETRANSMIT/MCAST_SNAPSHOT requests over the
+   (TCP) vserver connection. VMcastReceiver holds datagrams that arrive
+   early, asks for what's missing once a gap has been open for
+   'gap_timeout' msec and, if the publisher no longer has it, starts over
+   from a snapshot.
+
+   Portable (no tos_databridge.h) like net.hpp, so both ends can be run
+   over loopback multicast on one linux host.                               */
+
+#define VMCAST_MAGIC 0x4D54 /* 'TM' */
+#define VMCAST_DEF_PORT 55504
+#define VMCAST_MAX_DATAGRAM 1400 /* stay under a typical ethernet MTU */
+#define VMCAST_DEF_HISTORY 16384 /* datagrams kept for retransmit */
+#define VMCAST_HEARTBEAT_INTERVAL 250 /* msec */
+#define VMCAST_DEF_GAP_TIMEOUT 20 /* msec */
+#define VMCAST_MAX_RETRANSMIT 1024 /* datagrams per request */
+
+typedef struct{
+    uint16_t magic; /* VMCAST_MAGIC */
+    uint16_t count; /* of records; 0 == heartbeat */
+    uint32_t session;
+    uint64_t seq;
+} VMcastHeader;
+
+static_assert(sizeof(VMcastHeader) == 16, "VMcastHeader must be 16 bytes");
+
+
+class VMcastPublisher{
+/* NOT thread-safe; publish/flush/heartbeat/handle from one thread (the
+   vserver's) */
+public:
+    typedef std::pair<std::string, std::string> stream_key_type; /* item, topic */
+
+private:
+    net_socket_type _sock;
+    uint32_t _session;
+    uint64_t _seq; /* last sent */
+    std::deque<std::vector<char>> _history; /* back() is _seq */
+    size_t _history_max;
+    std::map<stream_key_type, VArray> _latest; /* one point each */
+    std::vector<char> _cur; /* datagram being filled */
+    uint16_t _cur_count;
+    std::chrono::steady_clock::time_point _last_send;
+    std::function<bool(uint64_t)> _drop;
+
+    VMcastPublisher(const VMcastPublisher&);
+
+    VMcastPublisher&
+    operator=(const VMcastPublisher&);
+
+    void
+    _begin();
+
+    void
+    _send();
+
+public:
+    /* throws VProtocolError if we can't open the socket */
+    VMcastPublisher(std::string group,
+                    unsigned short port = VMCAST_DEF_PORT,
+                    std::string iface = "",
+                    int ttl = 1,
+                    size_t history = VMCAST_DEF_HISTORY);
+
+    ~VMcastPublisher();
+
+    /* add new points of a stream (most recent first); big arrays are split
+       across datagrams. Goes out when a datagram fills or on flush().     */
+    void
+    publish(const std::string& item, const std::string& topic, const VArray& ticks);
+
+    void
+    flush();
+
+    /* send a heartbeat if nothing has gone out for VMCAST_HEARTBEAT_INTERVAL;
+       call regularly */
+    void
+    heartbeat();
+
+    /* answer MCAST_RETRANSMIT/MCAST_SNAPSHOT; VSTATUS_BAD_OP for anything else */
+    int16_t
+    handle(uint16_t op, VReader& in, VWriter& out);
+
+    inline uint32_t
+    session() const
+    {
+        return _session;
+    }
+
+    inline uint64_t
+    seq() const
+    {
+        return _seq;
+    }
+
+    /* testing: datagrams 'drop' returns true for aren't sent (but are kept
+       for retransmit), to simulate loss */
+    inline void
+    set_drop_filter(std::function<bool(uint64_t)> drop)
+    {
+        _drop = drop;
+    }
+};
+
+
+class VClient;
+
+class VMcastReceiver{
+/* joins the group and keeps a local copy of every stream published, like
+   VMirror does for pushed ticks. update() does all the work; NOT
+   thread-safe.                                                            */
+public:
+    typedef std::pair<std::string, std::string> stream_key_type; /* item, topic */
+    typedef std::deque<VValue> stream_type; /* most recent first */
+
+    struct stats_type{
+        uint64_t datagrams; /* applied, including retransmits */
+        uint64_t duplicates;
+        uint64_t gaps; /* detected */
+        uint64_t retransmitted; /* datagrams recovered over TCP */
+        uint64_t lost; /* datagrams skipped by a snapshot */
+        uint64_t snapshots;
+    };
+
+private:
+    net_socket_type _sock;
+    std::string _recovery_addr;
+    unsigned short _recovery_port;
+    std::unique_ptr<VClient> _client;
+    size_t _depth;
+    std::chrono::milliseconds _gap_timeout;
+    bool _synced;
+    uint32_t _session;
+    uint64_t _next; /* seq we're waiting for */
+    uint64_t _known; /* highest seq we know was sent */
+    std::map<uint64_t, std::vector<char>> _ahead; /* arrived before _next */
+    std::chrono::steady_clock::time_point _gap_since;
+    std::map<stream_key_type, stream_type> _streams;
+    stats_type _stats;
+    std::vector<char> _buf;
+
+    VMcastReceiver(const VMcastReceiver&);
+
+    VMcastReceiver&
+    operator=(const VMcastReceiver&);
+
+    size_t
+    _on_datagram(const char* p, size_t len);
+
+    size_t
+    _drain();
+
+    size_t
+    _apply(const char* p, size_t len);
+
+    size_t
+    _recover();
+
+    size_t
+    _snapshot();
+
+    VClient&
+    _recovery();
+
+public:
+    /* 'recovery_addr':port is the publisher's vserver (TCP); with an empty
+       address gaps are counted and skipped. Throws VProtocolError if we
+       can't join the group.                                              */
+    VMcastReceiver(std::string group,
+                   unsigned short port,
+                   std::string recovery_addr,
+                   unsigned short recovery_port = VPROTO_DEF_PORT,
+                   std::string iface = "",
+                   size_t depth = 1000,
+                   unsigned int gap_timeout = VMCAST_DEF_GAP_TIMEOUT);
+
+    ~VMcastReceiver();
+
+    /* apply every datagram that's arrived (waiting up to 'timeout' msec for
+       the first) and recover any gap that's timed out; returns the number
+       of points added. Throws VProtocolError/VStatusError if the publisher
+       can't be reached for recovery (we reconnect on the next call).      */
+    size_t
+    update(int timeout = 0);
+
+    /* throws std::out_of_range if nothing's been received for it */
+    const stream_type&
+    stream(std::string item, std::string topic) const;
+
+    std::vector<stream_key_type>
+    streams() const;
+
+    /* highest datagram applied */
+    inline uint64_t
+    seq() const
+    {
+        return _next - 1;
+    }
+
+    inline const stats_type&
+    stats() const
+    {
+        return _stats;
+    }
+};
+
+#endif /* JO_TOSDB_VMULTICAST */
@@ -0,0 +1,652 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_VPROTOCOL
+#define JO_TOSDB_VPROTOCOL
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+/* The binary protocol spoken by tos-databridge-vserver (src/vserver) and its
+   clients (vclient.hpp, python/tosdb/vnative.py). Header-only and, like
+   net.hpp, independent of tos_databridge.h.
+
+   Every message is a frame: a 12 byte VFrameHeader followed by 'length' bytes
+   of body. Clients choose 'id' and the server echoes it back, so any number
+   of requests can be written before reading the replies (pipelining);
+   replies come back in request order. Multi-byte fields are little-endian
+   (the native order of every platform we build for).
+
+   body encodings:
+
+     string   u16 len, bytes (no null)
+     strings  u32 count, string[count]
+     value    u8 type, <type> (float:4 double:8 long:i32 long long:i64 string)
+     array    u8 type, u8 flags, u32 count, values, micros
+              values: <type>[count]
+              micros: i64[count], micro-seconds since the epoch (only if
+                      flags & VARRAY_DTS)
+
+   'type' is the TOSDB type bits of the topic (TOSDB_INTGR_BIT etc.)
+
+   Arrays are columns so a client can take the values as one native array
+   (numpy.frombuffer etc.). If flags & VARRAY_PACKED, integer columns (long,
+   long long values and the micros) are delta-packed instead:
+
+     u8 width (1, 2, 4 or 8), i64 first, int<width> delta[count - 1]
+
+   (nothing at all if count == 0) where value[i] = value[i-1] + delta[i-1]
+   with 64 bit wrap-around; ticks and their time-stamps are close together
+   so this is usually 2-8x smaller. Requests with a 'u8 flags' field ask for
+   VARRAY_DTS and/or VARRAY_PACKED with it; float/double/string columns are
+   never packed.
+
+   requests (-> reply body, if status == VSTATUS_OK):
+
+     PING                 -> u32 VPROTO_VERSION
+     CONNECTED            -> u8
+     CONNECTION_STATE     -> u32
+     GET_BLOCK_LIMIT      -> u32
+     SET_BLOCK_LIMIT      u32 -> u32
+     GET_BLOCK_COUNT      -> u32
+     TYPE_BITS            string topic -> u8
+
+     CREATE_BLOCK         string id, u32 size, u8 datetime, u32 timeout ->
+     CLOSE_BLOCK          string id ->
+     GET_BLOCK_SIZE       string id -> u32
+     SET_BLOCK_SIZE       string id, u32 size ->
+     IS_USING_DATETIME    string id -> u8
+     ADD_ITEMS            string id, strings ->  (ADD_TOPICS etc. the same)
+     GET_ITEMS            string id -> strings   (GET_TOPICS etc. the same)
+     STREAM_OCCUPANCY     string id, string item, string topic -> u32
+
+     GET                  string id, string item, string topic, i32 indx,
+                          u8 flags -> value [, i64 micro]
+     STREAM_SNAPSHOT      string id, string item, string topic, i32 end,
+                          i32 beg, u8 smart_size, u8 flags -> array
+     STREAM_SNAPSHOT_FROM_MARKER
+                          string id, string item, string topic, i32 beg,
+                          u32 margin, u8 flags -> u8 dirty, i32 get_size, array
+     ITEM_FRAME           string id, string topic, u8 flags -> strings, array
+     TOPIC_FRAME          string id, string item, u8 flags -> strings, array
+
+     SUBSCRIBE            string id, u8 policy, u8 flags, u32 count,
+                          (string item, string topic)[count] ->
+     UNSUBSCRIBE          string id, u32 count, (string item, string topic)[count]
+                          -> (count == 0 drops all of the block's streams)
+
+   pushed by the server, unasked, with id == VPROTO_PUSH_ID:
+
+     TICKS                string id, u32 dropped, u32 count,
+                          (string item, string topic, i32 get_size, array)[count]
+
+   Once subscribed, new data in each stream is read from its marker (so don't
+   mix with STREAM_SNAPSHOT_FROM_MARKER on the same stream) and batched into
+   one TICKS frame per block, most recent first like the marker calls.
+   'get_size' is the number of new points (negative if the block was too
+   small to hold them all); if the client's send queue backs up the server
+   either drops the ticks, counting them in 'dropped', or conflates each
+   stream to its latest point (array count 1 < get_size), per 'policy'.
+
+   A block belongs to the connection that created it and is closed when that
+   connection goes away.
+
+   served by a server that's also multicasting (see vmulticast.hpp):
+
+     MCAST_RETRANSMIT     u32 session, u64 first, u32 count ->
+                          u32 session, u64 first, u32 n, (u16 len, datagram)[n]
+     MCAST_SNAPSHOT       -> u32 session, u64 seq, u32 count,
+                          (string item, string topic, array)[count]
+
+   RETRANSMIT returns whatever part of [first, first + count) the publisher
+   still has, starting at the reply's 'first'; SNAPSHOT the latest point of
+   every stream published, as of datagram 'seq'.                            */
+
+#define VPROTO_VERSION 1
+#define VPROTO_HEADER_SZ 12
+#define VPROTO_MAX_BODY_SZ (64 * 1024 * 1024)
+#define VPROTO_DEF_PORT 55503
+#define VPROTO_PUSH_ID 0 /* never used for a request */
+
+/* SUBSCRIBE policy for a slow consumer */
+#define VPUSH_DROP 0
+#define VPUSH_CONFLATE 1
+
+/* must match TOSDB_*_BIT in tos_databridge.h */
+#define VTYPE_INTGR_BIT ((uint8_t)0x80)
+#define VTYPE_QUAD_BIT ((uint8_t)0x40)
+#define VTYPE_STRING_BIT ((uint8_t)0x20)
+
+/* array flags */
+#define VARRAY_DTS 0x01
+#define VARRAY_PACKED 0x02
+
+/* status > 0 is a protocol/server problem, < 0 is a TOSDB_ERROR_[] code
+   returned by the underlying C API call */
+#define VSTATUS_OK 0
+#define VSTATUS_BAD_REQUEST 1 /* malformed body */
+#define VSTATUS_BAD_OP 2 /* unknown opcode */
+#define VSTATUS_EXCEPTION 3 /* body holds a string describing it */
+
+typedef enum{
+    VOP_PING = 1,
+    /* admin */
+    VOP_CONNECTED = 10,
+    VOP_CONNECTION_STATE,
+    VOP_GET_BLOCK_LIMIT,
+    VOP_SET_BLOCK_LIMIT,
+    VOP_GET_BLOCK_COUNT,
+    VOP_TYPE_BITS,
+    /* block */
+    VOP_CREATE_BLOCK = 20,
+    VOP_CLOSE_BLOCK,
+    VOP_GET_BLOCK_SIZE,
+    VOP_SET_BLOCK_SIZE,
+    VOP_IS_USING_DATETIME,
+    VOP_ADD_ITEMS,
+    VOP_ADD_TOPICS,
+    VOP_REMOVE_ITEMS,
+    VOP_REMOVE_TOPICS,
+    VOP_GET_ITEMS,
+    VOP_GET_TOPICS,
+    VOP_GET_ITEMS_PRECACHED,
+    VOP_GET_TOPICS_PRECACHED,
+    VOP_STREAM_OCCUPANCY,
+    /* data */
+    VOP_GET = 40,
+    VOP_STREAM_SNAPSHOT,
+    VOP_STREAM_SNAPSHOT_FROM_MARKER,
+    VOP_ITEM_FRAME,
+    VOP_TOPIC_FRAME,
+    /* streaming */
+    VOP_SUBSCRIBE = 50,
+    VOP_UNSUBSCRIBE,
+    VOP_TICKS = 60,
+    /* multicast recovery */
+    VOP_MCAST_RETRANSMIT = 70,
+    VOP_MCAST_SNAPSHOT
+} VOpCode;
+
+typedef struct{
+    uint32_t length; /* of the body that follows */
+    uint32_t id; /* chosen by the client, echoed by the server */
+    uint16_t op;
+    int16_t status; /* VSTATUS_[] or TOSDB_ERROR_[] in replies, 0 in requests */
+} VFrameHeader;
+
+static_assert(sizeof(VFrameHeader) == VPROTO_HEADER_SZ, "VFrameHeader must be 12 bytes");
+
+
+class VProtocolError
+        : public std::runtime_error{
+public:
+    explicit VProtocolError(std::string info)
+        :
+            std::runtime_error(info)
+        {
+        }
+};
+
+
+class VWriter{
+/* appends to a (caller owned) byte buffer; 'packed' writers delta-pack the
+   integer columns (see put_int_column) */
+    std::vector<char>& _buf;
+    bool _packed;
+
+public:
+    explicit VWriter(std::vector<char>& buf, bool packed = false)
+        :
+            _buf(buf),
+            _packed(packed)
+        {
+        }
+
+    inline bool
+    packed() const
+    {
+        return _packed;
+    }
+
+    inline void
+    set_packed(bool packed)
+    {
+        _packed = packed;
+    }
+
+    template<typename T>
+    void
+    put(T val)
+    {
+        const char* p = (const char*)&val;
+        _buf.insert(_buf.end(), p, p + sizeof(T));
+    }
+
+    void
+    put_bytes(const char* p, size_t len)
+    {
+        _buf.insert(_buf.end(), p, p + len);
+    }
+
+    void
+    put_string(const char* s, size_t len)
+    {
+        if(len > UINT16_MAX)
+            len = UINT16_MAX;
+        put<uint16_t>((uint16_t)len);
+        put_bytes(s, len);
+    }
+
+    void
+    put_string(const std::string& s)
+    {
+        put_string(s.c_str(), s.size());
+    }
+
+    template<typename C>
+    void
+    put_strings(const C& strs)
+    {
+        put<uint32_t>((uint32_t)strs.size());
+        for(auto& s : strs)
+            put_string(s);
+    }
+
+    /* the array header; caller writes the values (and micros) that follow */
+    void
+    put_array_head(uint8_t type, bool has_dts, uint32_t count)
+    {
+        put<uint8_t>(type);
+        put<uint8_t>((has_dts ? VARRAY_DTS : 0) | (_packed ? VARRAY_PACKED : 0));
+        put<uint32_t>(count);
+    }
+
+    /* an integer column; 'width' (4 or 8) is its size when not packed */
+    void
+    put_int_column(const int64_t* vals, uint32_t n, size_t width)
+    {
+        if(!_packed){
+            for(uint32_t i = 0; i < n; ++i){
+                if(width == 8)
+                    put<int64_t>(vals[i]);
+                else
+                    put<int32_t>((int32_t)vals[i]);
+            }
+            return;
+        }
+
+        if(n == 0)
+            return;
+
+        /* narrowest width that holds every delta */
+        uint64_t mag = 0;
+        for(uint32_t i = 1; i < n; ++i){
+            int64_t d = (int64_t)((uint64_t)vals[i] - (uint64_t)vals[i-1]);
+            mag |= (d < 0) ? ~(uint64_t)d : (uint64_t)d;
+        }
+        uint8_t dw = (mag < 0x80) ? 1 : (mag < 0x8000) ? 2 : (mag < 0x80000000) ? 4 : 8;
+
+        put<uint8_t>(dw);
+        put<int64_t>(vals[0]);
+        size_t off = _buf.size();
+        _buf.resize(off + (size_t)dw * (n - 1));
+        for(uint32_t i = 1; i < n; ++i){
+            int64_t d = (int64_t)((uint64_t)vals[i] - (uint64_t)vals[i-1]);
+            memcpy(&_buf[off + (size_t)dw * (i - 1)], &d, dw); /* low bytes (LE) */
+        }
+    }
+
+    inline size_t
+    size() const
+    {
+        return _buf.size();
+    }
+};
+
+
+class VReader{
+/* reads from a (caller owned) byte range; throws VProtocolError if we try to
+   read past the end */
+    const char* _cur;
+    const char* _end;
+
+    void
+    _check(size_t n) const
+    {
+        if((size_t)(_end - _cur) < n)
+            throw VProtocolError("read past end of message");
+    }
+
+public:
+    VReader(const char* beg, size_t len)
+        :
+            _cur(beg),
+            _end(beg + len)
+        {
+        }
+
+    template<typename T>
+    T
+    get()
+    {
+        T val;
+        _check(sizeof(T));
+        memcpy(&val, _cur, sizeof(T));
+        _cur += sizeof(T);
+        return val;
+    }
+
+    const char*
+    get_bytes(size_t len)
+    {
+        _check(len);
+        const char* p = _cur;
+        _cur += len;
+        return p;
+    }
+
+    std::string
+    get_string()
+    {
+        uint16_t len = get<uint16_t>();
+        return std::string(get_bytes(len), len);
+    }
+
+    std::vector<std::string>
+    get_strings()
+    {
+        uint32_t n = get<uint32_t>();
+        std::vector<std::string> strs;
+        strs.reserve(n < 1024 ? n : 1024); /* don't trust n to reserve */
+        while(n--)
+            strs.push_back(get_string());
+        return strs;
+    }
+
+    inline size_t
+    remaining() const
+    {
+        return _end - _cur;
+    }
+};
+
+
+/* a decoded value/array; float/double go in 'reals', long/long long in
+   'ints' so a client only has to handle three representations */
+struct VValue{
+    uint8_t type;
+    int64_t i;
+    double r;
+    std::string s;
+    int64_t micro;
+
+    VValue()
+        :
+            type(0),
+            i(0),
+            r(0),
+            micro(0)
+        {
+        }
+};
+
+struct VArray{
+    uint8_t type;
+    std::vector<int64_t> ints;
+    std::vector<double> reals;
+    std::vector<std::string> strs;
+    std::vector<int64_t> micros; /* empty if the array has no date-time */
+
+    VArray()
+        :
+            type(0)
+        {
+        }
+
+    inline size_t
+    size() const
+    {
+        if(type & VTYPE_STRING_BIT)
+            return strs.size();
+        return (type & VTYPE_INTGR_BIT) ? ints.size() : reals.size();
+    }
+
+    VValue
+    value(size_t i) const
+    {
+        VValue val;
+        val.type = type;
+        if(type & VTYPE_STRING_BIT)
+            val.s = strs[i];
+        else if(type & VTYPE_INTGR_BIT)
+            val.i = ints[i];
+        else
+            val.r = reals[i];
+        if(!micros.empty())
+            val.micro = micros[i];
+        return val;
+    }
+};
+
+
+/* the one place that knows how each type looks on the wire */
+inline size_t
+VTypeWireSize(uint8_t type)
+{
+    if(type & VTYPE_STRING_BIT)
+        return 0; /* variable */
+    return (type & VTYPE_QUAD_BIT) ? 8 : 4;
+}
+
+
+inline void
+VGetScalar(VReader& rdr, uint8_t type, VValue* val)
+{
+    val->type = type;
+    if(type & VTYPE_STRING_BIT)
+        val->s = rdr.get_string();
+    else if(type & VTYPE_INTGR_BIT)
+        val->i = (type & VTYPE_QUAD_BIT) ? rdr.get<int64_t>() : rdr.get<int32_t>();
+    else
+        val->r = (type & VTYPE_QUAD_BIT) ? rdr.get<double>() : rdr.get<float>();
+}
+
+
+inline VValue
+VGetValue(VReader& rdr, bool has_dts)
+{
+    VValue val;
+    VGetScalar(rdr, rdr.get<uint8_t>(), &val);
+    if(has_dts)
+        val.micro = rdr.get<int64_t>();
+    return val;
+}
+
+
+/* read an integer column of 'n' written by VWriter::put_int_column */
+inline void
+VGetIntColumn(VReader& rdr, uint32_t n, bool packed, size_t width, int64_t* dest)
+{
+    if(!packed){
+        const char* p = rdr.get_bytes(width * n);
+        VReader col(p, width * n);
+        for(uint32_t i = 0; i < n; ++i)
+            dest[i] = (width == 8) ? col.get<int64_t>() : col.get<int32_t>();
+        return;
+    }
+
+    if(n == 0)
+        return;
+
+    uint8_t dw = rdr.get<uint8_t>();
+    if(dw != 1 && dw != 2 && dw != 4 && dw != 8)
+        throw VProtocolError("bad packed column width");
+
+    dest[0] = rdr.get<int64_t>();
+    const char* p = rdr.get_bytes((size_t)dw * (n - 1));
+    for(uint32_t i = 1; i < n; ++i, p += dw){
+        int64_t d;
+        switch(dw){
+        case 1: d = *(const int8_t*)p; break;
+        case 2: { int16_t v; memcpy(&v, p, 2); d = v; break; }
+        case 4: { int32_t v; memcpy(&v, p, 4); d = v; break; }
+        default: memcpy(&d, p, 8);
+        }
+        dest[i] = (int64_t)((uint64_t)dest[i-1] + (uint64_t)d);
+    }
+}
+
+
+inline VArray
+VGetArray(VReader& rdr)
+{
+    VArray arr;
+    arr.type = rdr.get<uint8_t>();
+    uint8_t flags = rdr.get<uint8_t>();
+    bool packed = (flags & VARRAY_PACKED) != 0;
+    uint32_t n = rdr.get<uint32_t>();
+    if(n > rdr.remaining())
+        throw VProtocolError("bad array count");
+
+    size_t wsz = VTypeWireSize(arr.type);
+    if(arr.type & VTYPE_STRING_BIT){
+        arr.strs.reserve(n < 1024 ? n : 1024);
+        for(uint32_t i = 0; i < n; ++i)
+            arr.strs.push_back(rdr.get_string());
+    }else if(arr.type & VTYPE_INTGR_BIT){
+        arr.ints.resize(n);
+        if(n)
+            VGetIntColumn(rdr, n, packed, wsz, &arr.ints[0]);
+    }else{
+        /* fixed-size column; check the whole thing before we size anything */
+        const char* p = rdr.get_bytes(wsz * n);
+        VReader col(p, wsz * n);
+        arr.reals.resize(n);
+        for(uint32_t i = 0; i < n; ++i)
+            arr.reals[i] = (wsz == 8) ? col.get<double>() : col.get<float>();
+    }
+
+    if(flags & VARRAY_DTS){
+        arr.micros.resize(n);
+        if(n)
+            VGetIntColumn(rdr, n, packed, sizeof(int64_t), &arr.micros[0]);
+    }
+
+    return arr;
+}
+
+
+/* write elements [beg, end) of 'arr' as an array (the inverse of VGetArray) */
+inline void
+VPutArray(VWriter& w, const VArray& arr, size_t beg, size_t end)
+{
+    uint32_t n = (uint32_t)(end - beg);
+    bool has_dts = !arr.micros.empty();
+    size_t wsz = VTypeWireSize(arr.type);
+
+    w.put_array_head(arr.type, has_dts, n);
+    if(arr.type & VTYPE_STRING_BIT){
+        for(size_t i = beg; i < end; ++i)
+            w.put_string(arr.strs[i]);
+    }else if(arr.type & VTYPE_INTGR_BIT){
+        w.put_int_column(n ? &arr.ints[beg] : nullptr, n, wsz);
+    }else{
+        for(size_t i = beg; i < end; ++i){
+            if(wsz == 8)
+                w.put<double>(arr.reals[i]);
+            else
+                w.put<float>((float)arr.reals[i]);
+        }
+    }
+
+    if(has_dts)
+        w.put_int_column(n ? &arr.micros[beg] : nullptr, n, sizeof(int64_t));
+}
+
+
+inline void
+VPutArray(VWriter& w, const VArray& arr)
+{
+    VPutArray(w, arr, 0, arr.size());
+}
+
+
+/* write 'n' numeric 'vals' of 'type', then 'micros' if not NULL, as an array;
+   how the server writes snapshot and frame replies (src/vserver/vhandler.cpp) */
+template<typename T>
+inline void
+VPutArray(VWriter& w, uint8_t type, const T* vals, const int64_t* micros, uint32_t n)
+{
+    size_t wsz = VTypeWireSize(type);
+
+    w.put_array_head(type, micros != nullptr, n);
+    if(type & VTYPE_INTGR_BIT){
+        std::vector<int64_t> col(vals, vals + n);
+        w.put_int_column(n ? &col[0] : nullptr, n, wsz);
+    }else{
+        for(uint32_t i = 0; i < n; ++i){
+            if(wsz == 8)
+                w.put<double>((double)vals[i]);
+            else
+                w.put<float>((float)vals[i]);
+        }
+    }
+
+    if(micros)
+        w.put_int_column(micros, n, sizeof(int64_t));
+}
+
+
+/* start a frame at the end of 'buf'; returns its offset for VEndFrame */
+inline size_t
+VBeginFrame(std::vector<char>& buf, uint32_t id, uint16_t op)
+{
+    size_t off = buf.size();
+    VFrameHeader head = {0, id, op, 0};
+    buf.insert(buf.end(), (const char*)&head, (const char*)&head + VPROTO_HEADER_SZ);
+    return off;
+}
+
+
+/* patch the length (everything written since VBeginFrame) and status */
+inline void
+VEndFrame(std::vector<char>& buf, size_t off, int16_t status)
+{
+    VFrameHeader head;
+    memcpy(&head, &buf[off], VPROTO_HEADER_SZ);
+    head.length = (uint32_t)(buf.size() - off - VPROTO_HEADER_SZ);
+    head.status = status;
+    memcpy(&buf[off], &head, VPROTO_HEADER_SZ);
+}
+
+
+/* true if a complete header is available; throws on a bogus length */
+inline bool
+VPeekHeader(const char* p, size_t len, VFrameHeader* head)
+{
+    if(len < VPROTO_HEADER_SZ)
+        return false;
+    memcpy(head, p, VPROTO_HEADER_SZ);
+    if(head->length > VPROTO_MAX_BODY_SZ)
+        throw VProtocolError("frame body too large");
+    return true;
+}
+
+#endif /* JO_TOSDB_VPROTOCOL */
@@ -0,0 +1,169 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JO_TOSDB_VSERVER
+#define JO_TOSDB_VSERVER
+
+#include "net.hpp"
+#include "vprotocol.hpp"
+
+#include <atomic>
+
+/* implemented in src/vserver/vserver.cpp
+
+   The (portable) server side of the virtualization protocol: accepts
+   connections, splits the incoming byte stream into frames and hands each
+   request to a VRequestHandler, queueing the replies in request order. What
+   a request actually *does* is up to the handler; the windows executable
+   plugs in one that calls the TOSDB API (src/vserver/vhandler.cpp), the
+   loopback test plugs in its own.
+
+   Handlers can also push unsolicited frames (id VPROTO_PUSH_ID) from
+   on_idle; they go through the same per-connection send queue as replies. */
+
+#define VSERVER_POLL_TIMEOUT 100 /* msec */
+#define VSERVER_READ_CHUNK (64 * 1024)
+
+/* stop reading a connection's requests while this much is waiting to be
+   sent to it; a client that pipelines but never reads can't grow us */
+#define VSERVER_MAX_PENDING_OUT (16 * 1024 * 1024)
+
+/* past this much queued output a connection counts as a slow consumer and
+   pushes should be dropped/conflated (push() refuses past MAX_PENDING_OUT) */
+#define VSERVER_PUSH_HIGH_WATER (1024 * 1024)
+
+typedef uint64_t vconn_id_type;
+
+class VServer;
+
+class VRequestHandler{
+public:
+    virtual
+    ~VRequestHandler()
+        {
+        }
+
+    /* handle one request; write the reply body to 'out' and return its
+       status. Can throw; VProtocolError becomes VSTATUS_BAD_REQUEST, any
+       other std::exception VSTATUS_EXCEPTION                                */
+    virtual int16_t
+    handle(vconn_id_type conn, uint16_t op, VReader& in, VWriter& out) = 0;
+
+    virtual void
+    on_connect(vconn_id_type conn, const std::string& peer)
+    {
+    }
+
+    virtual void
+    on_disconnect(vconn_id_type conn)
+    {
+    }
+
+    /* called once per pass through the loop (at least every
+       VSERVER_POLL_TIMEOUT msec) on the server thread; the place to push */
+    virtual void
+    on_idle(VServer& server)
+    {
+    }
+};
+
+
+class VServer{
+    struct _conn_type{
+        vconn_id_type id;
+        std::string peer;
+        std::vector<char> in;
+        std::vector<char> out;
+        size_t out_pos;
+    };
+
+    VRequestHandler& _handler;
+    NetReactor _reactor;
+    net_socket_type _listener;
+    std::map<net_socket_type, _conn_type> _conns;
+    std::map<vconn_id_type, net_socket_type> _socks;
+    vconn_id_type _next_id;
+    std::atomic<bool> _running;
+
+    VServer(const VServer&);
+
+    VServer&
+    operator=(const VServer&);
+
+    void
+    _on_accept(net_socket_type sock, unsigned int events);
+
+    void
+    _on_conn(net_socket_type sock, unsigned int events);
+
+    bool
+    _read(net_socket_type sock, _conn_type& conn);
+
+    bool
+    _write(net_socket_type sock, _conn_type& conn);
+
+    void
+    _dispatch(_conn_type& conn);
+
+    void
+    _update_interest(net_socket_type sock, _conn_type& conn);
+
+    void
+    _close(net_socket_type sock);
+
+public:
+    /* throws VProtocolError if we can't listen on addr:port */
+    VServer(std::string addr, unsigned short port, VRequestHandler& handler);
+
+    ~VServer();
+
+    /* loop until stop() (returns immediately if stop() was already called) */
+    void
+    run(int timeout = VSERVER_POLL_TIMEOUT);
+
+    /* a single pass: poll, dispatch, on_idle */
+    void
+    run_once(int timeout = VSERVER_POLL_TIMEOUT);
+
+    /* safe to call from any thread */
+    inline void
+    stop()
+    {
+        _running.store(false);
+    }
+
+    /* the port we're actually listening on (if constructed with port 0) */
+    unsigned short
+    port() const;
+
+    /* queue an unsolicited frame to 'conn'; false if it's gone or its
+       queue is already at VSERVER_MAX_PENDING_OUT. Server thread only.    */
+    bool
+    push(vconn_id_type conn, uint16_t op, const std::vector<char>& body);
+
+    /* bytes queued for 'conn' but not yet sent (0 if it's gone) */
+    size_t
+    pending(vconn_id_type conn) const;
+
+    inline size_t
+    connection_count() const
+    {
+        return _conns.size();
+    }
+};
+
+#endif /* JO_TOSDB_VSERVER */
@@ -21,6 +21,10 @@ import com.sun.jna.Library;
 import com.sun.jna.NativeLong;
 import com.sun.jna.Pointer;
 
+import java.nio.Buffer;
+import java.nio.IntBuffer;
+import java.nio.LongBuffer;
+
 /**
  * JNA interface used to access the underlying C Lib.
  *
@@ -75,6 +79,13 @@ public interface CLib extends Library {
     int TOSDB_GetStreamSnapshotLongLongs(String name, String item, String topic, long[] arrayVals,
                                          int arraySz, DateTime[] arrayDateTime, int end, int beg);
 
+    int TOSDB_GetStreamSnapshotToBuffers(String name, String item, String topic, Buffer dest,
+                                         int arraySz, LongBuffer epochMicro, int end, int beg);
+
+    int TOSDB_GetStreamSnapshotsToBuffers(String name, String[] items, int nItems, String topic,
+                                          Buffer dest, int arraySz, LongBuffer epochMicro,
+                                          IntBuffer offsets, int end, int beg);
+
     int TOSDB_IsMarkerDirty(String name, String item, String topic, int[] ptrVal);
     int TOSDB_GetMarkerPosition(String name, String item, String topic, long[] ptrVal);
 
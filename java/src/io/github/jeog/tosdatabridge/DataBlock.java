@@ -977,6 +977,114 @@ public class DataBlock {
                 String.class);
     }
 
+    /**
+     * Copies as many of the most recent data-points of a (numeric) stream as fit into
+     * a SnapshotBuffer, without per-element marshalling or boxing.
+     *
+     * @param item  item string of stream
+     * @param topic topic enum of stream (not a string topic)
+     * @param dest  buffer to fill (contents are overwritten)
+     * @return number of data-points copied
+     * @throws LibraryNotLoaded     C lib has not been loaded
+     * @throws CLibException        error code returned by C lib
+     * @throws InvalidItemOrTopic invalid item or topic argument
+     * @see SnapshotBuffer
+     */
+    public int
+    getStreamSnapshotToBuffer(String item, Topic topic, SnapshotBuffer dest)
+            throws LibraryNotLoaded, CLibException, InvalidItemOrTopic {
+        try {
+            return getStreamSnapshotToBuffer(item, topic, dest,
+                    Math.min(_size, dest.getCapacity()) - 1, 0);
+        } catch (DataIndexException e) {
+            /* SHOULD NEVER GET HERE */
+            throw new RuntimeException("getStreamSnapshotToBuffer failed to suppress DataIndexException");
+        }
+    }
+
+    /**
+     * Copies multiple contiguous data-points of a (numeric) stream into a SnapshotBuffer,
+     * without per-element marshalling or boxing. Time-stamps are copied too if the
+     * buffer holds them.
+     *
+     * @param item  item string of stream
+     * @param topic topic enum of stream (not a string topic)
+     * @param dest  buffer to fill (contents are overwritten)
+     * @param end   least recent index/position from which data is pulled
+     * @param beg   most recent index/position from which data is pulled
+     * @return number of data-points copied
+     * @throws LibraryNotLoaded     C lib has not been loaded
+     * @throws CLibException        error code returned by C lib
+     * @throws DataIndexException   invalid index/position value(s), or more than dest holds
+     * @throws InvalidItemOrTopic invalid item or topic argument
+     * @see SnapshotBuffer
+     */
+    public int
+    getStreamSnapshotToBuffer(String item, Topic topic, SnapshotBuffer dest, int end, int beg)
+            throws LibraryNotLoaded, CLibException, DataIndexException, InvalidItemOrTopic {
+        item = _handleRawItemTopic(item, topic, true);
+        int typeBits = _handleBufferTopic(topic);
+        int[] range = _handleBufferRange(end, beg, 1, dest);
+
+        int occ = getStreamOccupancy(item, topic);
+        if (occ == 0 || occ <= range[1]) {
+            dest.setContents(typeBits, 1, 0);
+            return 0;
+        }
+        end = Math.min(range[0], occ - 1);
+        beg = range[1];
+        int size = end - beg + 1;
+
+        int err = TOSDataBridge.getCLibrary()
+                .TOSDB_GetStreamSnapshotToBuffers(_name, item, topic.val, dest.valuesBuffer(),
+                        size, dest.epochMicrosBuffer(), end, beg);
+        if (err != 0) {
+            throw new CLibException("TOSDB_GetStreamSnapshotToBuffers", err);
+        }
+        dest.setContents(typeBits, 1, size);
+        return size;
+    }
+
+    /**
+     * Copies multiple contiguous data-points of a (numeric) topic for a number of
+     * items into a SnapshotBuffer in one call, stream i holding items[i]'s data.
+     *
+     * @param items item strings of streams
+     * @param topic topic enum of streams (not a string topic)
+     * @param dest  buffer to fill (contents are overwritten); needs room for
+     *              items.size() * (end - beg + 1) data-points
+     * @param end   least recent index/position from which data is pulled
+     * @param beg   most recent index/position from which data is pulled
+     * @return total number of data-points copied
+     * @throws LibraryNotLoaded     C lib has not been loaded
+     * @throws CLibException        error code returned by C lib
+     * @throws DataIndexException   invalid index/position value(s), or more than dest holds
+     * @throws InvalidItemOrTopic invalid item or topic argument
+     * @see SnapshotBuffer
+     */
+    public int
+    getStreamSnapshotsToBuffer(List<String> items, Topic topic, SnapshotBuffer dest, int end,
+                               int beg)
+            throws LibraryNotLoaded, CLibException, DataIndexException, InvalidItemOrTopic {
+        _handleRawTopic(topic, true);
+        String[] rawItems = new String[items.size()];
+        for (int i = 0; i < rawItems.length; ++i) {
+            rawItems[i] = _handleRawItem(items.get(i), true);
+        }
+        int typeBits = _handleBufferTopic(topic);
+        int[] range = _handleBufferRange(end, beg, rawItems.length, dest);
+
+        int err = TOSDataBridge.getCLibrary()
+                .TOSDB_GetStreamSnapshotsToBuffers(_name, rawItems, rawItems.length, topic.val,
+                        dest.valuesBuffer(), dest.getCapacity(), dest.epochMicrosBuffer(),
+                        dest.offsetsBuffer(), range[0], range[1]);
+        if (err != 0) {
+            throw new CLibException("TOSDB_GetStreamSnapshotsToBuffers", err);
+        }
+        dest.setContents(typeBits, rawItems.length);
+        return dest.size();
+    }
+
     /**
      * Returns mapping of all item names to most recent item values for a particular topic.
      *
@@ -1305,6 +1413,37 @@ public class DataBlock {
         return _handleRawItem(item, throwIfNotInBlock);
     }
 
+    private int
+    _handleBufferTopic(Topic topic) throws LibraryNotLoaded, CLibException, InvalidItemOrTopic {
+        int typeBits = TOSDataBridge.getTypeBits(topic);
+        if (typeBits == TOSDataBridge.STRING_BIT) {
+            throw new InvalidItemOrTopic("string topic can't be copied to a SnapshotBuffer: "
+                    + topic);
+        }
+        return typeBits;
+    }
+
+    /* returns {end, beg} */
+    private int[]
+    _handleBufferRange(int end, int beg, int nStreams, SnapshotBuffer dest)
+            throws DataIndexException {
+        if (end < 0) {
+            end += _size;
+        }
+        if (beg < 0) {
+            beg += _size;
+        }
+        int size = end - beg + 1;
+        if ((beg < 0) || (end < 0) || (beg >= _size) || (end >= _size) || (size <= 0)) {
+            throw new DataIndexException("invalid 'beg' and/or 'end' index");
+        }
+        if (nStreams > dest.getMaxStreams() || (long) size * nStreams > dest.getCapacity()) {
+            throw new DataIndexException("SnapshotBuffer too small for " + nStreams
+                    + " stream(s) of " + size);
+        }
+        return new int[]{end, beg};
+    }
+
     private int
     _getBlockSize() throws LibraryNotLoaded, CLibException {
         int[] size = {0};
@@ -0,0 +1,266 @@
+/*
+Copyright (C) 2017 Jonathon Ogden   <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+package io.github.jeog.tosdatabridge;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.IntBuffer;
+import java.nio.LongBuffer;
+
+/**
+ * Reusable off-heap (direct) buffers that DataBlock's bulk snapshot calls
+ * (getStreamSnapshotToBuffer, getStreamSnapshotsToBuffer) fill.
+ * <p>
+ * The C lib writes values - in the topic's own type - and, optionally, time-stamps -
+ * as micro-seconds since the epoch - straight into native memory: nothing is
+ * marshalled, boxed or allocated per element. One or more streams are held back to
+ * back, stream i starting at offset(i), most recent first.
+ * <p>
+ * Contents are overwritten by the next call that uses the buffer; NOT thread-safe.
+ *
+ * @author Jonathon Ogden
+ * @version 0.8
+ */
+public final class SnapshotBuffer {
+    private static final int MAX_ELEM_SZ = 8;
+
+    private final int _capacity;
+    private final int _maxStreams;
+    private final ByteBuffer _values;
+    private final LongBuffer _epochMicros;
+    private final IntBuffer _offsets;
+    private int _typeBits = 0;
+    private int _nStreams = 0;
+
+    /**
+     * SnapshotBuffer Constructor.
+     *
+     * @param capacity total number of elements (across all streams) it can hold
+     * @param maxStreams most streams one call can fill
+     * @param withEpochMicros also hold a time-stamp for each element (block
+     *                        must be a DataBlockWithDateTime, 0 otherwise)
+     */
+    public SnapshotBuffer(int capacity, int maxStreams, boolean withEpochMicros) {
+        if (capacity < 1 || maxStreams < 1) {
+            throw new IllegalArgumentException("capacity and maxStreams must be > 0");
+        }
+        _capacity = capacity;
+        _maxStreams = maxStreams;
+        _values = ByteBuffer.allocateDirect(capacity * MAX_ELEM_SZ).order(ByteOrder.nativeOrder());
+        _epochMicros = withEpochMicros
+                ? ByteBuffer.allocateDirect(capacity * 8).order(ByteOrder.nativeOrder()).asLongBuffer()
+                : null;
+        _offsets = ByteBuffer.allocateDirect((maxStreams + 1) * 4).order(ByteOrder.nativeOrder())
+                .asIntBuffer();
+    }
+
+    /**
+     * SnapshotBuffer Constructor for single-stream snapshots.
+     *
+     * @param capacity number of elements it can hold
+     * @param withEpochMicros also hold a time-stamp for each element
+     */
+    public SnapshotBuffer(int capacity, boolean withEpochMicros) {
+        this(capacity, 1, withEpochMicros);
+    }
+
+    public int
+    getCapacity() {
+        return _capacity;
+    }
+
+    public int
+    getMaxStreams() {
+        return _maxStreams;
+    }
+
+    public boolean
+    hasEpochMicros() {
+        return _epochMicros != null;
+    }
+
+    /**
+     * @return type bits (TOSDataBridge.INTGR_BIT etc.) of the values last written
+     */
+    public int
+    getTypeBits() {
+        return _typeBits;
+    }
+
+    /**
+     * @return number of streams last written
+     */
+    public int
+    getStreamCount() {
+        return _nStreams;
+    }
+
+    /**
+     * @return total number of elements last written
+     */
+    public int
+    size() {
+        return _offsets.get(_nStreams);
+    }
+
+    public int
+    size(int stream) {
+        _checkStream(stream);
+        return _offsets.get(stream + 1) - _offsets.get(stream);
+    }
+
+    public int
+    offset(int stream) {
+        _checkStream(stream);
+        return _offsets.get(stream);
+    }
+
+    /**
+     * @param indx element index across all streams (offset(stream) + i)
+     * @return value, converted to long if topic is a floating point type
+     */
+    public long
+    getLong(int indx) {
+        _checkIndx(indx);
+        switch (_typeBits) {
+            case TOSDataBridge.INTGR_BIT | TOSDataBridge.QUAD_BIT:
+                return _values.getLong(indx * 8);
+            case TOSDataBridge.INTGR_BIT:
+                return _values.getInt(indx * 4);
+            case TOSDataBridge.QUAD_BIT:
+                return (long) _values.getDouble(indx * 8);
+            default:
+                return (long) _values.getFloat(indx * 4);
+        }
+    }
+
+    public long
+    getLong(int stream, int indx) {
+        return getLong(_streamIndx(stream, indx));
+    }
+
+    /**
+     * @param indx element index across all streams (offset(stream) + i)
+     * @return value, converted to double if topic is an integral type
+     */
+    public double
+    getDouble(int indx) {
+        _checkIndx(indx);
+        switch (_typeBits) {
+            case TOSDataBridge.INTGR_BIT | TOSDataBridge.QUAD_BIT:
+                return _values.getLong(indx * 8);
+            case TOSDataBridge.INTGR_BIT:
+                return _values.getInt(indx * 4);
+            case TOSDataBridge.QUAD_BIT:
+                return _values.getDouble(indx * 8);
+            default:
+                return _values.getFloat(indx * 4);
+        }
+    }
+
+    public double
+    getDouble(int stream, int indx) {
+        return getDouble(_streamIndx(stream, indx));
+    }
+
+    /**
+     * @param indx element index across all streams (offset(stream) + i)
+     * @return micro-seconds since the epoch
+     */
+    public long
+    getEpochMicro(int indx) {
+        if (_epochMicros == null) {
+            throw new IllegalStateException("SnapshotBuffer has no epoch micros");
+        }
+        _checkIndx(indx);
+        return _epochMicros.get(indx);
+    }
+
+    public long
+    getEpochMicro(int stream, int indx) {
+        return getEpochMicro(_streamIndx(stream, indx));
+    }
+
+    /**
+     * @return read-only view of the raw values (native byte order; element size from
+     * getTypeBits) for bulk access
+     */
+    public ByteBuffer
+    getValues() {
+        return _values.asReadOnlyBuffer().order(ByteOrder.nativeOrder());
+    }
+
+    /**
+     * @return read-only view of the raw time-stamps, or null
+     */
+    public LongBuffer
+    getEpochMicros() {
+        return _epochMicros == null ? null : _epochMicros.asReadOnlyBuffer();
+    }
+
+    /* package-private: what DataBlock passes to the C lib */
+    ByteBuffer
+    valuesBuffer() {
+        return _values;
+    }
+
+    LongBuffer
+    epochMicrosBuffer() {
+        return _epochMicros;
+    }
+
+    IntBuffer
+    offsetsBuffer() {
+        return _offsets;
+    }
+
+    void
+    setContents(int typeBits, int nStreams) {
+        _typeBits = typeBits;
+        _nStreams = nStreams;
+    }
+
+    void
+    setContents(int typeBits, int nStreams, int size) {
+        _offsets.put(0, 0);
+        _offsets.put(1, size);
+        setContents(typeBits, nStreams);
+    }
+
+    private int
+    _streamIndx(int stream, int indx) {
+        if (indx < 0 || indx >= size(stream)) {
+            throw new IndexOutOfBoundsException("invalid index for stream " + stream + ": " + indx);
+        }
+        return _offsets.get(stream) + indx;
+    }
+
+    private void
+    _checkStream(int stream) {
+        if (stream < 0 || stream >= _nStreams) {
+            throw new IndexOutOfBoundsException("invalid stream: " + stream);
+        }
+    }
+
+    private void
+    _checkIndx(int indx) {
+        if (indx < 0 || indx >= size()) {
+            throw new IndexOutOfBoundsException("invalid index: " + indx);
+        }
+    }
+}
@@ -55,14 +55,17 @@ from ctypes import CDLL as _CDLL, \
                    c_ulong as _ulong_, \
                    c_long as _long_, \
                    c_longlong as _longlong_, \
+                   c_ulonglong as _ulonglong_, \
                    c_char_p as _str_, \
                    c_char as _char_, \
                    c_ubyte as _uchar_, \
                    c_int as _int_, \
                    c_void_p as _pvoid_, \
+                   sizeof as _sizeof, \
                    c_uint as _uint_, \
                    c_uint32 as _uint32_, \
-                   c_uint8 as _uint8_
+                   c_uint8 as _uint8_, \
+                   Structure as _Structure
                    
 
 _pchar_ = _PTR_(_char_)
@@ -76,11 +79,18 @@ _map_cstr = _partial(map,_cast_cstr)
 _map_dt = _partial(map, TOSDB_DateTime)
 _zip_cstr_dt = lambda cstr, dt: zip(_map_cstr(cstr),_map_dt(dt))
 
+# strings from a 'Packed' call: NUL-terminated, back to back, 'used' bytes in all
+_unpack_strs = lambda buf, used: [s.decode() for s in buf.raw[:used].split(b'\0')[:-1]]
+
 DLL_BASE_NAME = "tos-databridge"
 DLL_DEPENDS1_NAME = "_tos-databridge"
 SYS_ARCH_TYPE = "x64" if (_log(_maxsize * 2, 2) > 33) else "x86"
 MIN_MARGIN_OF_SAFETY = 10
 
+# numpy dtypes of the values TOSDB_GetStreamSnapshotToBuffers writes, by
+# _type_switch name (long is 32 bits on windows, x64 too)
+_NUMPY_DTYPES = {"LongLong":'<i8', "Long":'<i4', "Double":'<f8', "Float":'<f4'}
+
 _REGEX_NON_ALNUM = _compile("[\W+]")
 _REGEX_LETTER = _compile("[a-zA-Z]")
 _VER_SFFX = '[\d]{1,2}.[\d]{1,2}'
@@ -365,36 +375,439 @@ def type_string(topic):
 
     return s.value.decode()
 
+
+def start_recording(path):
+    """ Record every tick the C Lib pulls from the engine to a segment file 
+
+    A sidecar index ('path'.idx) is written when the segment is closed by 
+    stop_recording() (or another call to start_recording()).
+
+    start_recording(path)
+
+    path :: str :: path of the segment file
+
+    throws TOSDB_CLibError
+    """
+    _lib_call("TOSDB_StartRecording", path.encode("ascii"), arg_types=(_str_,))
+
+
+def stop_recording():
+    """ Close the segment being recorded to and write its index
+
+    stop_recording()
+
+    throws TOSDB_CLibError
+    """
+    _lib_call("TOSDB_StopRecording")
+
+
+def get_recorded(path, item, topic, beg, end, date_time=False, 
+                 data_str_max=STR_DATA_SZ):
+    """ Return the recorded ticks of item/topic in a time range, oldest first 
+
+    Uses the segment's index to locate the range, reading only the pages of 
+    the segment that hold it. Numeric topics are returned as floats.
+
+    get_recorded(path, item, topic, beg, end, date_time=False, 
+                 data_str_max=STR_DATA_SZ)
+
+    path         :: str  :: path of a closed segment file
+    item         :: str  :: item string
+    topic        :: str  :: topic string
+    beg          :: datetime or int :: start of range (int = epoch microseconds)
+    end          :: datetime or int :: end of range (int = epoch microseconds)
+    date_time    :: bool :: include TOSDB_DateTime objects 
+    data_str_max :: int  :: maximum length of string data returned 
+
+    if date_time == True:  returns -> list of 2-tuple
+    else:                  returns -> list
+
+    throws TOSDB_CLibError
+    """
+    tomicro = lambda t: t if isinstance(t, int) else int(t.timestamp() * 1000000)
+    path = path.encode("ascii")
+    item = item.upper().encode("ascii")
+    topic = topic.upper().encode("ascii")
+    beg = tomicro(beg)
+    end = tomicro(end)
+
+    n = _uint32_()
+    _lib_call("TOSDB_GetRecordedCount", path, item, topic, beg, end, _pointer(n),
+              arg_types=(_str_, _str_, _str_, _longlong_, _longlong_, _PTR_(_uint32_)))
+
+    size = n.value
+    if size == 0:
+        return []
+
+    dts = (_DateTimeStamp * size)()
+    g = _uint32_()
+
+    if _type_switch( type_bits(topic.decode()) )[0] == "String":
+        strs = _gen_str_buffers(data_str_max+1, size)
+        pstrs = _gen_str_buffers_ptrs(strs)
+        _lib_call("TOSDB_GetRecordedStrings", path, item, topic, beg, end,
+                  pstrs, size, data_str_max + 1,
+                  dts if date_time else _PTR_(_DateTimeStamp)(),
+                  _pointer(g),
+                  arg_types=(_str_, _str_, _str_, _longlong_, _longlong_, _ppchar_,
+                             _uint32_, _uint32_, _PTR_(_DateTimeStamp), _PTR_(_uint32_)))
+        g = g.value
+        return list(_zip_cstr_dt(pstrs[:g],dts[:g]) if date_time else _map_cstr(pstrs[:g]))
+    else:
+        nums = (_double_ * size)()
+        _lib_call("TOSDB_GetRecordedDoubles", path, item, topic, beg, end,
+                  nums, size,
+                  dts if date_time else _PTR_(_DateTimeStamp)(),
+                  _pointer(g),
+                  arg_types=(_str_, _str_, _str_, _longlong_, _longlong_, _PTR_(_double_),
+                             _uint32_, _PTR_(_DateTimeStamp), _PTR_(_uint32_)))
+        g = g.value
+        return list(zip(nums[:g], _map_dt(dts[:g])) if date_time else nums[:g])
+
+
+class _ApiStats(_Structure):
+    """ 'private' mirror of the C ApiStats struct """
+    _fields_ = [("name", _char_ * 32),
+                ("calls", _ulonglong_),
+                ("errors", _ulonglong_),
+                ("total_micro", _ulonglong_),
+                ("max_micro", _ulonglong_),
+                ("lock_waits", _ulonglong_),
+                ("lock_wait_micro", _ulonglong_)]
+
+_ApiStat = _namedtuple("ApiStat", ["calls", "errors", "total_micro", "max_micro",
+                                   "lock_waits", "lock_wait_micro"])
+
+def api_stats():
+    """ Return the C Lib's per-call counters and timings 
+
+    Calls are grouped by family (e.g 'GetStreamSnapshot' covers every typed 
+    and packed version). The 'lock:...' entries count acquisitions of the 
+    library's internal locks made inside those calls; their timings are 
+    only the contended waits. 
+    Times are in micro-seconds and cover all threads since the last reset.
+
+    api_stats()
+
+    returns -> dict of {name : ApiStat namedtuple}
+
+    throws TOSDB_CLibError
+    """
+    n = _uint32_()
+    _lib_call("TOSDB_GetApiStats", _PTR_(_ApiStats)(), 0, _pointer(n),
+              arg_types=(_PTR_(_ApiStats), _uint32_, _PTR_(_uint32_)))
+    stats = (_ApiStats * n.value)()
+    _lib_call("TOSDB_GetApiStats", stats, n.value, _pointer(n),
+              arg_types=(_PTR_(_ApiStats), _uint32_, _PTR_(_uint32_)))
+    return {s.name.decode() : _ApiStat(s.calls, s.errors, s.total_micro, s.max_micro,
+                                       s.lock_waits, s.lock_wait_micro) for s in stats}
+
+
+def reset_api_stats():
+    """ Zero the C Lib's per-call counters and timings 
+
+    reset_api_stats()
+
+    throws TOSDB_CLibError
+    """
+    _lib_call("TOSDB_ResetApiStats")
+
+
+class _LockStats(_Structure):
+    """ 'private' mirror of the C LockStats struct """
+    _fields_ = [("name", _char_ * 32),
+                ("acquisitions", _ulonglong_),
+                ("contentions", _ulonglong_),
+                ("wait_micro", _ulonglong_),
+                ("max_wait_micro", _ulonglong_),
+                ("hold_micro", _ulonglong_),
+                ("max_hold_micro", _ulonglong_)]
+
+_LockStat = _namedtuple("LockStat", ["acquisitions", "contentions", "wait_micro", 
+                                     "max_wait_micro", "hold_micro", "max_hold_micro"])
+
+def set_lock_profiling(on):
+    """ Turn profiling of the C Lib's internal locks on/off 
+
+    set_lock_profiling(on)
+
+    on :: bool :: profile locks (counts are kept when turned off)
+
+    throws TOSDB_CLibError
+    """
+    _lib_call("TOSDB_SetLockProfiling", 1 if on else 0, arg_types=(_int_,))
+
+
+def lock_stats():
+    """ Return the contention profile of the C Lib's internal locks
+
+    'DataStream' covers every stream's mutex. Times are in micro-seconds.
+    (The engine's locks are written to the TOSDB_DumpSharedBufferStatus file.)
+
+    lock_stats()
+
+    returns -> dict of {name : LockStat namedtuple}
+
+    throws TOSDB_CLibError
+    """
+    n = _uint32_()
+    _lib_call("TOSDB_GetLockStats", _PTR_(_LockStats)(), 0, _pointer(n),
+              arg_types=(_PTR_(_LockStats), _uint32_, _PTR_(_uint32_)))
+    stats = (_LockStats * n.value)()
+    _lib_call("TOSDB_GetLockStats", stats, n.value, _pointer(n),
+              arg_types=(_PTR_(_LockStats), _uint32_, _PTR_(_uint32_)))
+    return {s.name.decode() : _LockStat(s.acquisitions, s.contentions, s.wait_micro,
+                                        s.max_wait_micro, s.hold_micro, s.max_hold_micro)
+            for s in stats}
+
+
+def reset_lock_stats():
+    """ Zero the C Lib's lock profile
+
+    reset_lock_stats()
+
+    throws TOSDB_CLibError
+    """
+    _lib_call("TOSDB_ResetLockStats")
+
+
+def set_stream_priority(item, topic, priority):
+    """ Set the class the engine routes an item/topic/stream in under load
+
+    set_stream_priority(item, topic, priority)
+
+    item     :: str :: item (None or "" for any item)
+    topic    :: str :: topic (None or "" for any topic)
+    priority :: int :: TOSDB_PRIORITY_HIGH, _NORMAL, _LOW or _DEFAULT (remove)
+
+    throws TOSDB_CLibError
+    """
+    item = item.upper().encode("ascii") if item else None
+    topic = topic.upper().encode("ascii") if topic else None
+    _lib_call("TOSDB_SetStreamPriority", item, topic, priority,
+              arg_types=(_str_, _str_, _int_))
+
+
+def set_thread_schedule(thread, cpu_mask, priority):
+    """ Pin one of the internal threads to CPUs and set its priority
+
+    set_thread_schedule(thread, cpu_mask, priority)
+
+    thread   :: int :: TOSDB_THREAD_ENGINE_MSG, _ENGINE_IPC, _ENGINE_PROBE or 
+                       _CLIENT_EXTRACT
+    cpu_mask :: int :: bit N = logical CPU N (0 leaves it alone)
+    priority :: int :: TOSDB_THREAD_PRI_LOWEST ... _REALTIME (or _UNCHANGED)
+
+    throws TOSDB_CLibError
+    """
+    _lib_call("TOSDB_SetThreadSchedule", thread, cpu_mask, priority,
+              arg_types=(_int_, _ulonglong_, _int_))
+
+
+def load_thread_config(path):
+    """ Apply a thread config file ('thread cpu_mask priority' per line)
+
+    load_thread_config(path)
+
+    path :: str :: path of the config file
+
+    throws TOSDB_CLibError
+    """
+    _lib_call("TOSDB_LoadThreadConfig", path.encode("ascii"), arg_types=(_str_,))
+
+
+def set_shard_count(n):
+    """ Spread streams over 'n' engines (started w/ 'tos-databridge-serv --shards n')
+
+    set_shard_count(n)
+
+    n :: int :: 1 ... TOSDB_MAX_SHARDS
+
+    (only while disconnected w/ no streams; every client needs the same map)
+
+    throws TOSDB_CLibError
+    """
+    _lib_call("TOSDB_SetShardCount", n, arg_types=(_uint_,))
+
+
+def assign_shard(item, topic, shard):
+    """ Send every stream of an item OR a topic to one shard
+
+    assign_shard(item, topic, shard)
+
+    item  :: str :: item (None or "" if assigning a topic)
+    topic :: str :: topic (None or "" if assigning an item)
+    shard :: int :: shard (>= TOSDB_MAX_SHARDS removes the assignment)
+
+    throws TOSDB_CLibError
+    """
+    item = item.upper().encode("ascii") if item else None
+    topic = topic.upper().encode("ascii") if topic else None
+    _lib_call("TOSDB_AssignShard", item, topic, shard,
+              arg_types=(_str_, _str_, _uint_))
+
+
+def load_shard_map(path):
+    """ Load a shard map file ('shards n', 'topic name shard', 'item name shard')
+
+    load_shard_map(path)
+
+    path :: str :: path of the shard map file
+
+    throws TOSDB_CLibError
+    """
+    _lib_call("TOSDB_LoadShardMap", path.encode("ascii"), arg_types=(_str_,))
+
+
+def set_prefill(max_ticks, max_secs):
+    """ Start streams added to blocks w/ what the engine kept of them
+
+    set_prefill(max_ticks, max_secs)
+
+    max_ticks :: int :: only the last max_ticks (0 for no limit)
+    max_secs  :: int :: only those from the last max_secs seconds (0 for no limit)
+
+    (0 and 0 turns it off; the engine has to be started w/ '--history N')
+
+    throws TOSDB_CLibError
+    """
+    _lib_call("TOSDB_SetPrefill", max_ticks, max_secs, arg_types=(_uint32_, _uint32_))
+
+
+def get_prefill():
+    """ Returns (max_ticks, max_secs) set by set_prefill
+
+    get_prefill()
+
+    throws TOSDB_CLibError
+    """
+    ticks = _uint32_()
+    secs = _uint32_()
+    _lib_call("TOSDB_GetPrefill", _pointer(ticks), _pointer(secs),
+              arg_types=(_PTR_(_uint32_), _PTR_(_uint32_)))
+    return (ticks.value, secs.value)
+
+
+class _StreamSummary(_Structure):
+    """ 'private' mirror of the C StreamSummary struct """
+    _fields_ = [("count", _ulonglong_),
+                ("last_time", _DateTimeStamp),
+                ("open", _double_),
+                ("high", _double_),
+                ("low", _double_),
+                ("last", _double_),
+                ("last_str", _char_ * STR_DATA_SZ)]
+
+StreamSummary = _namedtuple("StreamSummary", ["count", "last_time", "open", "high", 
+                                             "low", "last"])
+
+def stream_summary(item, topic):
+    """ Returns what the engine keeps on a stream, w/o a block
+
+    Reads the count, last value and time, and (numeric topics) the session 
+    open/high/low straight from the stream's shared buffer. The session is the 
+    day of the latest tick. The stream has to be in a block (of any client) 
+    for the engine to have it.
+
+    stream_summary(item, topic)
+
+    item  :: str :: item string ('SPY', 'QQQ', etc)
+    topic :: str :: topic string ('LAST','ASK', etc)
+
+    returns -> StreamSummary namedtuple (open/high/low are None, and last a 
+               str, for string topics)
+
+    throws TOSDB_CLibError
+    """
+    s = _StreamSummary()
+    _lib_call("TOSDB_GetStreamSummary",
+              item.upper().encode("ascii"),
+              topic.upper().encode("ascii"),
+              _pointer(s),
+              arg_types=(_str_, _str_, _PTR_(_StreamSummary)))
+
+    t = TOSDB_DateTime(s.last_time) if s.count else None
+    if type_bits(topic) == STRING_BIT:
+        return StreamSummary(s.count, t, None, None, None, s.last_str.decode())
+    return StreamSummary(s.count, t, s.open, s.high, s.low, s.last)
+
+
+def attach_shared_block(shared_name):
+    """ Returns a block that reads a shared block another process made
+
+    The other process makes it w/ TOSDB_DataBlock(..., shared_name=...). The
+    block has the owner's size, date_time, items and topics, and follows the 
+    items/topics as the owner changes them; it can't be added to, removed 
+    from or resized. Doesn't need a connection to the engine.
+
+    attach_shared_block(shared_name)
+
+    shared_name :: str :: the name the owner gave the block
+
+    returns -> TOSDB_DataBlock
+
+    throws TOSDB_CLibError
+    """
+    blk = TOSDB_DataBlock.__new__(TOSDB_DataBlock)
+    blk._attach(shared_name)
+    return blk
+
         
 class TOSDB_DataBlock(_TOSDB_DataBlock):
     """ The base object for storing TOS data (NOT THREAD SAFE)
 
-    __init__(self, size=1000, date_time=False, timeout=DEF_TIMEOUT)
+    __init__(self, size=1000, date_time=False, timeout=DEF_TIMEOUT, 
+             shared_name=None)
 
-    size      :: int  :: how much historical data can be inserted
-    date_time :: bool :: should block include date-time with each data-point?
-    timeout   :: int  :: how long to wait for responses from engine, TOS-DDE server,
-                         and/or internal IPC/Concurrency mechanisms (milliseconds)
+    size        :: int  :: how much historical data can be inserted
+    date_time   :: bool :: should block include date-time with each data-point?
+    timeout     :: int  :: how long to wait for responses from engine, TOS-DDE server,
+                           and/or internal IPC/Concurrency mechanisms (milliseconds)
+    shared_name :: str  :: keep the block in shared memory, under this name, for
+                           other processes to attach_shared_block() to (its
+                           size can't be changed)
 
     throws TOSDB_CLibError
     """    
-    def __init__(self, size=1000, date_time=False, timeout=DEF_TIMEOUT):        
-        self._name = (_uuid4().hex).encode("ascii")
+    def __init__(self, size=1000, date_time=False, timeout=DEF_TIMEOUT, 
+                 shared_name=None):        
+        name = shared_name if shared_name else _uuid4().hex
+        self._init_fields(name, size, date_time, timeout)
+        _lib_call("TOSDB_CreateSharedBlock" if shared_name else "TOSDB_CreateBlock",
+                  self._name,
+                  size,
+                  date_time,
+                  timeout,
+                  arg_types=(_str_,_uint32_,_int_,_uint32_))                 
+        self._valid= True
+
+
+    def _init_fields(self, name, size, date_time, timeout, attached=False):
+        self._name = name.encode("ascii")
         self._block_size = size
         self._timeout = timeout
         self._date_time = date_time
+        self._attached = attached # reads another process's shared block
         self._items = []   
         self._topics = []
         self._items_precached = []   
         self._topics_precached = []        
+        self._ndarray_cache = {} # (item,topic) -> arrays for stream_snapshot_ndarray(reuse=True)
         self._valid = False
-        _lib_call("TOSDB_CreateBlock",
+
+
+    def _attach(self, shared_name):
+        self._init_fields(shared_name, 0, False, DEF_TIMEOUT, True)
+        _lib_call("TOSDB_AttachSharedBlock", self._name, arg_types=(_str_,))
+        self._valid = True
+        self._block_size = self.get_block_size()
+        d = _uint32_()
+        _lib_call("TOSDB_IsUsingDateTime",
                   self._name,
-                  size,
-                  date_time,
-                  timeout,
-                  arg_types=(_str_,_uint32_,_int_,_uint32_))                 
-        self._valid= True
+                  _pointer(d),
+                  arg_types=(_str_,_PTR_(_uint32_)))
+        self._date_time = bool(d.value)
+        self._sync_items_topics()
 
 
     @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
@@ -465,17 +878,8 @@ class TOSDB_DataBlock(_TOSDB_DataBlock):
 
     def _get_items_or_topics(self, fname, str_max=MAX_STR_SZ):
         size = self._get_item_or_topic_count(fname) 
-        strs = _gen_str_buffers(str_max+1, size)
-        pstrs = _gen_str_buffers_ptrs(strs)   
-            
-        _lib_call("TOSDB_Get" + fname + "Names", 
-                  self._name, 
-                  pstrs, 
-                  size, 
-                  str_max + 1, 
-                  arg_types=(_str_,  _ppchar_, _uint32_, _uint32_))               
-        
-        return list(map(_cast_cstr,pstrs))
+        return _lib_call_packed("TOSDB_Get" + fname + "NamesPacked", (self._name,),
+                                (_str_,), size, size * (str_max + 1))
 
     
     def _sync_items_topics(self):
@@ -535,11 +939,15 @@ class TOSDB_DataBlock(_TOSDB_DataBlock):
 
     @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
     def items(self, str_max=MAX_STR_SZ):
+        if self._attached: # the owner may have changed them
+            self._sync_items_topics()
         return list(self._items)
 
 
     @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
     def topics(self, str_max=MAX_STR_SZ):
+        if self._attached:
+            self._sync_items_topics()
         return list(self._topics)
 
     
@@ -718,24 +1126,18 @@ class TOSDB_DataBlock(_TOSDB_DataBlock):
 
     def _stream_snapshot_strings(self, item, topic, date_time, end, beg, size,
                                  data_str_max):
-        strs = _gen_str_buffers(data_str_max+1, size)
-        pstrs = _gen_str_buffers_ptrs(strs) 
         dts = (_DateTimeStamp * size)()
                                  
-        _lib_call("TOSDB_GetStreamSnapshotStrings", 
-                  self._name,
-                  item.encode("ascii"), 
-                  topic.encode("ascii"),
-                  pstrs, 
-                  size, 
-                  data_str_max + 1,                
-                  dts if date_time else _PTR_(_DateTimeStamp)(),
-                  end, 
-                  beg,
-                  arg_types=(_str_, _str_, _str_, _ppchar_, _uint32_, _uint32_, 
-                             _PTR_(_DateTimeStamp), _long_, _long_))   
+        strs = _lib_call_packed("TOSDB_GetStreamSnapshotStringsPacked", 
+                                (self._name, item.encode("ascii"), topic.encode("ascii")),
+                                (_str_, _str_, _str_),
+                                size, 
+                                size * 16, # most are short; grows if not 
+                                (dts if date_time else _PTR_(_DateTimeStamp)(), end, beg),
+                                (_PTR_(_DateTimeStamp), _long_, _long_))
+        strs = [s[:data_str_max] for s in strs]
         
-        return list(_zip_cstr_dt(pstrs,dts) if date_time else _map_cstr(pstrs)) 
+        return list(zip(strs, _map_dt(dts)) if date_time else strs) 
 
         
     def _stream_snapshot_numbers(self, tytup, item, topic, date_time, end, beg, size):
@@ -756,7 +1158,192 @@ class TOSDB_DataBlock(_TOSDB_DataBlock):
         
         return list(zip(nums,_map_dt(dts)) if date_time else nums)
 
-                                 
+
+    def stream_snapshot_into(self, item, topic, dest, micro_dest=None, end=-1,
+                             beg=0, smart_size=True):
+        """ Copy a numeric stream straight into caller-owned buffers.
+
+        dest and micro_dest are writable buffer-protocol objects (bytearray,
+        array.array, numpy arrays etc.). dest gets the values in the topic's
+        own type (see _NUMPY_DTYPES), micro_dest (optional, needs a date_time
+        block) int64 micro-seconds since the epoch. Both must be big enough
+        for the range; nothing is allocated per element.
+
+        returns -> # of elements written
+        """
+        item = self._handle_raw_item(item)
+        topic = self._handle_raw_topic(topic)
+
+        if micro_dest is not None and not self._date_time:
+            raise TOSDB_DateTimeError("date_time not available for this block")
+
+        tytup = _type_switch( type_bits(topic) )
+        if tytup[0] == "String":
+            raise TOSDB_TypeError("string topics can't be copied into buffers")
+
+        end, beg, size = self._snapshot_range(item, topic, end, beg, smart_size)
+        if size == 0:
+            return 0
+
+        vals = memoryview(dest).cast('B')
+        if vals.readonly or len(vals) < size * _sizeof(tytup[1]):
+            raise TOSDB_ValueError("'dest' not writable or too small")
+        micros = _PTR_(_longlong_)()
+        if micro_dest is not None:
+            m = memoryview(micro_dest).cast('B')
+            if m.readonly or len(m) < size * _sizeof(_longlong_):
+                raise TOSDB_ValueError("'micro_dest' not writable or too small")
+            micros = _cast((_char_ * len(m)).from_buffer(m), _PTR_(_longlong_))
+
+        _lib_call("TOSDB_GetStreamSnapshotToBuffers",
+                  self._name,
+                  item.encode("ascii"),
+                  topic.encode("ascii"),
+                  (_char_ * len(vals)).from_buffer(vals),
+                  size,
+                  micros,
+                  end,
+                  beg,
+                  arg_types=(_str_, _str_, _str_, _pvoid_, _uint32_,
+                             _PTR_(_longlong_), _long_, _long_))
+        return size
+
+
+    def stream_snapshot_ndarray(self, item, topic, date_time=False, end=-1,
+                                beg=0, smart_size=True, reuse=False):
+        """ Numeric stream snapshot as numpy arrays (requires numpy).
+
+        returns -> (values, micros) ; micros is an int64 array of micro-seconds
+        since the epoch if date_time, else None
+
+        reuse=True keeps one pair of arrays per stream on the block and returns
+        views into them: no allocation after the first call, but the result is
+        only good until the next reuse=True call for that stream.
+        """
+        import numpy
+
+        item = self._handle_raw_item(item)
+        topic = self._handle_raw_topic(topic)
+
+        if date_time and not self._date_time:
+            raise TOSDB_DateTimeError("date_time not available for this block")
+
+        tytup = _type_switch( type_bits(topic) )
+        if tytup[0] == "String":
+            raise TOSDB_TypeError("string topics can't be copied into arrays")
+
+        end, beg, size = self._snapshot_range(item, topic, end, beg, smart_size)
+        if reuse:
+            key = (item, topic)
+            bufs = self._ndarray_cache.get(key)
+            if bufs is None or len(bufs[0]) < size \
+               or (date_time and bufs[1] is None):
+                bufs = (numpy.empty(self._block_size, _NUMPY_DTYPES[tytup[0]]),
+                        numpy.empty(self._block_size, '<i8') if date_time else None)
+                self._ndarray_cache[key] = bufs
+            vals = bufs[0][:size]
+            micros = bufs[1][:size] if date_time else None
+        else:
+            vals = numpy.empty(size, _NUMPY_DTYPES[tytup[0]])
+            micros = numpy.empty(size, '<i8') if date_time else None
+
+        if size:
+            self.stream_snapshot_into(item, topic, vals, micros, end, beg, False)
+        return (vals, micros)
+
+
+    def stream_snapshot_strided(self, item, topic, stride, date_time=False,
+                                end=-1, beg=0, smart_size=True):
+        """ Every stride'th value of a numeric stream, as floats.
+
+        returns -> (values, micros) ; micros is a list of micro-seconds since
+        the epoch if date_time, else None
+        """
+        if stride < 1:
+            raise TOSDB_ValueError("stride must be >= 1")
+        item, topic, end, beg, size = self._sampled_args(item, topic, date_time,
+                                                         end, beg, smart_size)
+        n = -(-size // stride) # ceil
+        return self._stream_snapshot_sampled("TOSDB_GetStreamSnapshotStrided", 
+                                             item, topic, n, (stride,), (_uint32_,),
+                                             date_time, end, beg)
+
+
+    def stream_snapshot_decimated(self, item, topic, points, date_time=False,
+                                  end=-1, beg=0, smart_size=True):
+        """ A numeric stream cut down to at most 'points' (>= 4) values, as
+        floats, for plotting: the range is split into points // 4 buckets, each
+        giving its first, min, max and last value, so spikes aren't lost.
+
+        returns -> (values, micros) ; micros is a list of micro-seconds since
+        the epoch if date_time, else None
+        """
+        if points < 4:
+            raise TOSDB_ValueError("points must be >= 4")
+        item, topic, end, beg, size = self._sampled_args(item, topic, date_time,
+                                                         end, beg, smart_size)
+        return self._stream_snapshot_sampled("TOSDB_GetStreamSnapshotDecimated",
+                                             item, topic, min(points, size), (), (),
+                                             date_time, end, beg)
+
+
+    def _sampled_args(self, item, topic, date_time, end, beg, smart_size):
+        item = self._handle_raw_item(item)
+        topic = self._handle_raw_topic(topic)
+        if date_time and not self._date_time:
+            raise TOSDB_DateTimeError("date_time not available for this block")
+        if _type_switch( type_bits(topic) )[0] == "String":
+            raise TOSDB_TypeError("string topics can't be sampled")
+        return (item, topic) + self._snapshot_range(item, topic, end, beg, smart_size)
+
+
+    def _stream_snapshot_sampled(self, fname, item, topic, n, extra_args, 
+                                 extra_types, date_time, end, beg):
+        if n == 0:
+            return ([], [] if date_time else None)
+        n = max(n, 4) # decimated needs room for one bucket
+        vals = (_double_ * n)()
+        micros = (_longlong_ * n)()
+        get_size = _uint32_()
+        _lib_call(fname,
+                  self._name,
+                  item.encode("ascii"),
+                  topic.encode("ascii"),
+                  vals,
+                  n,
+                  micros if date_time else _PTR_(_longlong_)(),
+                  *(extra_args + (end, beg, _pointer(get_size))),
+                  arg_types=(_str_, _str_, _str_, _PTR_(_double_), _uint32_, 
+                             _PTR_(_longlong_)) + extra_types 
+                             + (_long_, _long_, _PTR_(_uint32_)))
+        size = get_size.value
+        return (vals[:size], micros[:size] if date_time else None)
+
+
+    def _snapshot_range(self, item, topic, end, beg, smart_size):
+        # same checks/adjustments as stream_snapshot; returns (end, beg, size)
+        if end < 0:
+            end += self._block_size
+        if beg < 0:
+            beg += self._block_size
+        size = (end - beg) + 1
+        if beg < 0 \
+           or end < 0 \
+           or beg >= self._block_size \
+           or end >= self._block_size \
+           or size <= 0:
+            raise TOSDB_IndexError("invalid 'beg' and/or 'end' index value(s)")
+
+        if smart_size:
+            so = self.stream_occupancy(item, topic)
+            if so == 0 or so <= beg:
+                return (end, beg, 0)
+            end = min(end, so - 1)
+            beg = min(beg, so - 1)
+            size = (end - beg) + 1
+        return (end, beg, size)
+
+
     @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
     def stream_snapshot_from_marker(self, item, topic, date_time=False, beg=0, 
                                     margin_of_safety=100, throw_if_data_lost=True,
@@ -893,27 +1480,15 @@ class TOSDB_DataBlock(_TOSDB_DataBlock):
 
     def _item_frame_strings(self, topic, date_time, labels, size, data_str_max,
                             label_str_max):
-        strs = _gen_str_buffers(data_str_max+1, size)
-        labs = _gen_str_buffers(label_str_max+1, size)                
-        pstrs = _gen_str_buffers_ptrs(strs)
-        plabs = _gen_str_buffers_ptrs(labs)  
         dts = (_DateTimeStamp * size)()
-                                 
-        _lib_call("TOSDB_GetItemFrameStrings", 
-                  self._name, 
-                  topic.encode("ascii"),
-                  pstrs, 
-                  size, 
-                  data_str_max + 1,
-                  plabs if labels else _ppchar_(), 
-                  label_str_max + 1,
-                  dts if date_time else _PTR_(_DateTimeStamp)(),
-                  arg_types=(_str_, _str_, _ppchar_, _uint32_, _uint32_,
-                             _ppchar_, _uint32_, _PTR_(_DateTimeStamp)))       
+        strs, labs = _lib_call_frame_packed("TOSDB_GetItemFrameStringsPacked",
+                                            self._name, topic, size, data_str_max,
+                                            label_str_max, labels, 
+                                            dts if date_time else _PTR_(_DateTimeStamp)())
 
-        dat = list(_zip_cstr_dt(pstrs, dts) if date_time else _map_cstr(pstrs))
+        dat = list(zip(strs, _map_dt(dts)) if date_time else strs)
         if labels:            
-            nt = _gen_namedtuple(_str_clean(topic)[0], _str_clean(*_map_cstr(plabs)))            
+            nt = _gen_namedtuple(_str_clean(topic)[0], _str_clean(*labs))            
             return nt(*dat)
         else:
             return dat                                
@@ -954,27 +1529,15 @@ class TOSDB_DataBlock(_TOSDB_DataBlock):
             raise TOSDB_DateTimeError("date_time not available for this block")       
         
         size = self._get_item_or_topic_count("Topic")
-        strs = _gen_str_buffers(data_str_max+1, size)
-        labs = _gen_str_buffers(label_str_max+1, size)                
-        pstrs = _gen_str_buffers_ptrs(strs)
-        plabs = _gen_str_buffers_ptrs(labs)  
         dts = (_DateTimeStamp * size)()
-            
-        _lib_call("TOSDB_GetTopicFrameStrings", 
-                  self._name, 
-                  item.encode("ascii"),
-                  pstrs, 
-                  size, 
-                  data_str_max + 1,                                            
-                  plabs if labels else _ppchar_(), 
-                  label_str_max + 1,
-                  dts if date_time else _PTR_(_DateTimeStamp)(),
-                  arg_types=(_str_, _str_, _ppchar_, _uint32_, _uint32_,
-                             _ppchar_, _uint32_, _PTR_(_DateTimeStamp)))    
+        strs, labs = _lib_call_frame_packed("TOSDB_GetTopicFrameStringsPacked",
+                                            self._name, item, size, data_str_max,
+                                            label_str_max, labels, 
+                                            dts if date_time else _PTR_(_DateTimeStamp)())
 
-        dat = list(_zip_cstr_dt(pstrs,dts) if date_time else _map_cstr(pstrs))        
+        dat = list(zip(strs, _map_dt(dts)) if date_time else strs)        
         if labels:      
-            nt = _gen_namedtuple(_str_clean(item)[0], _str_clean(*_map_cstr(plabs)))            
+            nt = _gen_namedtuple(_str_clean(item)[0], _str_clean(*labs))            
             return nt(*dat)                     
         else:
             return dat
@@ -1021,6 +1584,8 @@ class TOSDB_DataBlock(_TOSDB_DataBlock):
             raise TOSDB_TypeError("item must be str")
 
         item = self._handle_raw(item)                                  
+        if throw_if_not_in_block and item not in self._items and self._attached:
+            self._sync_items_topics()
         if throw_if_not_in_block and item not in self._items:
             raise TOSDB_ValueError("item '" + str(item) + "' not in block")
         
@@ -1037,6 +1602,8 @@ class TOSDB_DataBlock(_TOSDB_DataBlock):
         if topic not in TOPICS.val_dict:        
             raise TOSDB_ValueError("invalid topic: " + topic)
                                   
+        if throw_if_not_in_block and topic not in self._topics and self._attached:
+            self._sync_items_topics()
         if throw_if_not_in_block and topic not in self._topics:
             raise TOSDB_ValueError("topic '" + str(topic) + "' not in block")
         
@@ -1047,17 +1614,21 @@ class TOSDB_DataBlock(_TOSDB_DataBlock):
 class TOSDB_ThreadSafeDataBlock(TOSDB_DataBlock):
     """ The main object for storing TOS data (THREAD SAFE)  
 
-    __init__(self, size=1000, date_time=False, timeout=DEF_TIMEOUT)
+    __init__(self, size=1000, date_time=False, timeout=DEF_TIMEOUT, 
+             shared_name=None)
 
-    size      :: int  :: how much historical data can be inserted
-    date_time :: bool :: should block include date-time with each data-point?
-    timeout   :: int  :: how long to wait for responses from engine, TOS-DDE server,
-                         and/or internal IPC/Concurrency mechanisms (milliseconds)
+    size        :: int  :: how much historical data can be inserted
+    date_time   :: bool :: should block include date-time with each data-point?
+    timeout     :: int  :: how long to wait for responses from engine, TOS-DDE server,
+                           and/or internal IPC/Concurrency mechanisms (milliseconds)
+    shared_name :: str  :: keep the block in shared memory, under this name, for
+                           other processes to attach_shared_block() to
 
     throws TOSDB_CLibError
     """         
-    def __init__(self, size=1000, date_time=False, timeout=DEF_TIMEOUT):        
-        super().__init__(size, date_time, timeout)            
+    def __init__(self, size=1000, date_time=False, timeout=DEF_TIMEOUT, 
+                 shared_name=None):        
+        super().__init__(size, date_time, timeout, shared_name)            
     
 
 ### HOW WE ACCESS THE UNDERLYING C CALLS ###
@@ -1088,6 +1659,64 @@ def _lib_call(f, *fargs, ret_type=_int_, arg_types=None, error_check=True):
     return ret  
 
 
+def _lib_call_packed(f, pre_args, pre_types, n, guess, post_args=(), post_types=()):
+    # call a 'Packed' string function - f(*pre_args, dest, dest_len, offsets,
+    # n, dest_needed, *post_args) - into one buffer of 'guess' bytes, again
+    # with the size it asks for if that's too small; returns the n strings 
+    offs = (_uint32_ * max(n,1))()
+    need = _uint32_()
+    sz = max(guess, n, 1)
+    for _ in range(3): # the data can grow between calls
+        buf = _BUF_(sz)
+        ret = _lib_call(f, *(pre_args + (buf, sz, offs, n, _pointer(need)) + post_args),
+                        arg_types=pre_types + (_pchar_, _uint32_, _PTR_(_uint32_), _uint32_,
+                                               _PTR_(_uint32_)) + post_types,
+                        error_check=False)
+        if ret != ERROR_BAD_INPUT_BUFFER or need.value <= sz:
+            break
+        sz = need.value
+    if ret:
+        raise TOSDB_CLibError("library function [%s] returned error code [%i,%s]" \
+                              % (f, ret, _lookup_error_name(ret)))
+    return _unpack_strs(buf, need.value)
+
+
+def _lib_call_frame_packed(f, name, e, n, data_str_max, label_str_max, labels, dts):
+    # TOSDB_Get[Item|Topic]FrameStringsPacked; returns (strings, labels or None)
+    offs = (_uint32_ * max(n,1))()
+    loffs = (_uint32_ * max(n,1))()
+    need = _uint32_(max(n * (data_str_max + 1), 1))
+    lneed = _uint32_(max(n * (label_str_max + 1), 1))
+    for _ in range(3): # values can be longer than data_str_max (we cut them below)
+        buf = _BUF_(need.value)
+        lbuf = _BUF_(lneed.value)
+        ret = _lib_call(f, 
+                        name, 
+                        e.encode("ascii"), 
+                        buf, 
+                        len(buf), 
+                        offs, 
+                        n, 
+                        _pointer(need),
+                        lbuf if labels else _pchar_(), 
+                        len(lbuf), 
+                        loffs, 
+                        _pointer(lneed), 
+                        dts,
+                        arg_types=(_str_, _str_, _pchar_, _uint32_, _PTR_(_uint32_), 
+                                   _uint32_, _PTR_(_uint32_), _pchar_, _uint32_, 
+                                   _PTR_(_uint32_), _PTR_(_uint32_), _PTR_(_DateTimeStamp)),
+                        error_check=False)
+        if ret != ERROR_BAD_INPUT_BUFFER:
+            break
+    if ret:
+        raise TOSDB_CLibError("library function [%s] returned error code [%i,%s]" \
+                              % (f, ret, _lookup_error_name(ret)))
+    strs = [s[:data_str_max] for s in _unpack_strs(buf, need.value)]
+    labs = _unpack_strs(lbuf, lneed.value) if labels else None
+    return (strs, labs)
+
+
 def _lookup_error_name(e):    
     try:
         return ERROR_LOOKUP[e]        
@@ -0,0 +1,970 @@
+# Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+#
+#   This program is free software: you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#   See the GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License,
+#   'LICENSE.txt', along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+"""vnative.py: client for the native virtualization server (tos-databridge-vserver)
+
+Same block interface as VTOSDB_DataBlock but talks the binary protocol of the
+C++ server (include/vprotocol.hpp) instead of the pickled calls of the python
+hub (enable_virtualization). Pure python; works on any platform.
+
+VNativeConnection:
+    one TCP connection; requests can be pipelined (send/flush/wait) and the
+    admin calls (connected, get_block_limit etc.) live here.
+
+VNativeDataBlock:
+    a block on the server; owns its connection unless one is passed in.
+    get_many() pipelines a list of gets into a single round trip.
+
+VNativeMirror:
+    local copies of a block's streams, kept current by the ticks the server
+    pushes for them (no polling); call update() to apply what's arrived.
+
+VNativeMcastReceiver:
+    local copies of every stream a server multicasts (--mcast), recovering
+    lost datagrams from the server over TCP (see vmulticast.hpp).
+"""
+
+from ._common import *
+from ._common import _TOSDB_DataBlock
+from .doxtend import doxtend as _doxtend
+
+from collections import namedtuple as _namedtuple, deque as _deque
+from re import compile as _compile, sub as _sub
+from time import localtime as _localtime, monotonic as _monotonic
+from uuid import uuid4 as _uuid4
+
+import select as _select
+import socket as _socket
+import struct as _struct
+
+DEF_PORT = 55503
+DEF_MCAST_PORT = 55504
+
+# what the server does with ticks for a client that isn't keeping up
+PUSH_DROP = 0
+PUSH_CONFLATE = 1
+
+# must match vprotocol.hpp
+_VPROTO_VERSION = 1
+_HEAD = _struct.Struct('<IIHh')
+
+_VPROTO_PUSH_ID = 0
+_VARRAY_DTS = 0x01
+_VARRAY_PACKED = 0x02
+_VSTATUS_OK = 0
+_VSTATUS_EXCEPTION = 3
+
+_VOP_PING = 1
+_VOP_CONNECTED = 10
+_VOP_CONNECTION_STATE = 11
+_VOP_GET_BLOCK_LIMIT = 12
+_VOP_SET_BLOCK_LIMIT = 13
+_VOP_GET_BLOCK_COUNT = 14
+_VOP_TYPE_BITS = 15
+_VOP_CREATE_BLOCK = 20
+_VOP_CLOSE_BLOCK = 21
+_VOP_GET_BLOCK_SIZE = 22
+_VOP_SET_BLOCK_SIZE = 23
+_VOP_IS_USING_DATETIME = 24
+_VOP_ADD_ITEMS = 25
+_VOP_ADD_TOPICS = 26
+_VOP_REMOVE_ITEMS = 27
+_VOP_REMOVE_TOPICS = 28
+_VOP_GET_ITEMS = 29
+_VOP_GET_TOPICS = 30
+_VOP_GET_ITEMS_PRECACHED = 31
+_VOP_GET_TOPICS_PRECACHED = 32
+_VOP_STREAM_OCCUPANCY = 33
+_VOP_GET = 40
+_VOP_STREAM_SNAPSHOT = 41
+_VOP_STREAM_SNAPSHOT_FROM_MARKER = 42
+_VOP_ITEM_FRAME = 43
+_VOP_TOPIC_FRAME = 44
+_VOP_SUBSCRIBE = 50
+_VOP_UNSUBSCRIBE = 51
+_VOP_TICKS = 60
+_VOP_MCAST_RETRANSMIT = 70
+_VOP_MCAST_SNAPSHOT = 71
+
+# must match vmulticast.hpp
+_MCAST_HEAD = _struct.Struct('<HHIQ')
+_VMCAST_MAGIC = 0x4D54
+_VMCAST_MAX_RETRANSMIT = 1024
+_VMCAST_DEF_GAP_TIMEOUT = 20
+
+_MIN_MARGIN_OF_SAFETY = 10
+_REGEX_NON_ALNUM = _compile("[\W+]")
+
+
+class VNativeConnection:
+    """ A connection to tos-databridge-vserver
+
+    __init__(self, address, timeout=DEF_TIMEOUT)
+
+    address :: (str,int) :: (host/address of the server, port)
+    timeout :: int       :: socket timeout (milliseconds)
+
+    throws TOSDB_VirtualizationError
+    """
+    def __init__(self, address, timeout=DEF_TIMEOUT):
+        self._sock = _socket.create_connection(address, timeout / 1000)
+        self._sock.setsockopt(_socket.IPPROTO_TCP, _socket.TCP_NODELAY, 1)
+        self._next_id = 1
+        self._out = []
+        self._early = {}
+        self._pushed = _deque()
+        if self.ping() != _VPROTO_VERSION:
+            self.close()
+            raise TOSDB_VirtualizationError("vserver protocol version mismatch")
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def close(self):
+        if self._sock:
+            self._sock.close()
+            self._sock = None
+
+    def send(self, op, body=b''):
+        """ queue a request (NOT sent until flush/wait); returns its id """
+        rid = self._next_id
+        self._next_id = (self._next_id % 0xFFFFFFFF) + 1
+        self._out.append(_HEAD.pack(len(body), rid, op, 0) + body)
+        return rid
+
+    def flush(self):
+        if self._out:
+            self._sock.sendall(b''.join(self._out))
+            self._out = []
+
+    def wait(self, rid):
+        """ block until the reply for 'rid' arrives; returns (status, body) """
+        self.flush()
+        if rid in self._early:
+            return self._early.pop(rid)
+        while True:
+            rrid, op, status, body = self._read_frame()
+            if rrid == rid:
+                return (status, body)
+            self._stash(rrid, op, status, body)
+
+    def next_push(self, timeout=0):
+        """ the next frame the server pushed (op, body), or None
+
+        timeout :: int :: how long to wait for one (milliseconds, None = forever)
+        """
+        self.flush()
+        while not self._pushed:
+            r,_,_ = _select.select([self._sock], [], [],
+                                   None if timeout is None else timeout / 1000)
+            if not r:
+                return None
+            timeout = 0
+            self._stash(*self._read_frame())
+        return self._pushed.popleft()
+
+    def call(self, op, body=b''):
+        """ send, wait and check the status; returns the reply body """
+        return _check(*self.wait(self.send(op, body)))
+
+    def ping(self):
+        return _Reader(self.call(_VOP_PING)).get('I')
+
+    def connected(self):
+        return bool(_Reader(self.call(_VOP_CONNECTED)).get('B'))
+
+    def connection_state(self):
+        return _Reader(self.call(_VOP_CONNECTION_STATE)).get('I')
+
+    def get_block_limit(self):
+        return _Reader(self.call(_VOP_GET_BLOCK_LIMIT)).get('I')
+
+    def set_block_limit(self, new_limit):
+        return _Reader(self.call(_VOP_SET_BLOCK_LIMIT,
+                                 _struct.pack('<I', new_limit))).get('I')
+
+    def get_block_count(self):
+        return _Reader(self.call(_VOP_GET_BLOCK_COUNT)).get('I')
+
+    def type_bits(self, topic):
+        return _Reader(self.call(_VOP_TYPE_BITS, _pstr(topic.upper()))).get('B')
+
+    def _read_frame(self):
+        blen, rid, op, status = _HEAD.unpack(self._recvall(_HEAD.size))
+        return (rid, op, status, self._recvall(blen))
+
+    def _stash(self, rid, op, status, body):
+        if rid == _VPROTO_PUSH_ID:
+            self._pushed.append((op, body))
+        else:
+            self._early[rid] = (status, body)
+
+    def _recvall(self, n):
+        data = b''
+        while len(data) < n:
+            p = self._sock.recv(n - len(data))
+            if not p:
+                raise TOSDB_VirtualizationError("connection to vserver lost")
+            data += p
+        return data
+
+
+class VNativeDataBlock(_TOSDB_DataBlock):
+    """ The main object for storing TOS data (NATIVE VIRTUAL) (NOT THREAD SAFE)
+
+    __init__(self, address, size=1000, date_time=False, timeout=DEF_TIMEOUT,
+             packed=True)
+
+    address   :: (str,int) or VNativeConnection :: where the server is, or an
+                                                   open connection to share
+    size      :: int  :: how much historical data can be inserted
+    date_time :: bool :: should block include date-time with each data-point?
+    timeout   :: int  :: how long to wait for responses from engine,
+                         TOS-DDE server, internal IPC/Concurrency mechanisms,
+                         and network communication (milliseconds)
+    packed    :: bool :: have the server delta-pack integer and date-time
+                         columns (smaller, slightly more work to decode)
+
+    throws TOSDB_VirtualizationError, TOSDB_CLibError
+    """
+    def __init__(self, address, size=1000, date_time=False, timeout=DEF_TIMEOUT,
+                 packed=True):
+        self._valid = False
+        self._packed = packed
+        self._own_conn = not isinstance(address, VNativeConnection)
+        self._conn = VNativeConnection(address, timeout) if self._own_conn else address
+        self._name = _uuid4().hex
+        self._block_size = size
+        self._date_time = date_time
+        self._timeout = timeout
+        self._conn.call(_VOP_CREATE_BLOCK, _pstr(self._name) +
+                        _struct.pack('<IBI', size, 1 if date_time else 0, timeout))
+        self._valid = True
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def close(self):
+        if self._valid:
+            self._valid = False
+            self._conn.call(_VOP_CLOSE_BLOCK, _pstr(self._name))
+        if self._own_conn:
+            self._conn.close()
+
+
+    def __del__(self):
+        try:
+            self.close()
+        except:
+            pass
+
+
+    def __str__(self):
+        # one round trip for every item's topic frame
+        items = self.items()
+        rids = [self._conn.send(_VOP_TOPIC_FRAME, self._body(i, b'\x00')) for i in items]
+        s = ''
+        for i,rid in zip(items, rids):
+            r = _Reader(_check(*self._conn.wait(rid)))
+            labels = r.strings()
+            vals = r.array()[0]
+            s += i + ' ' + ' '.join(l + ':' + v for l,v in zip(labels, vals)) + '\n'
+        return s
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def info(self):
+        return {"Name": self._name,
+                "Items": self.items(),
+                "Topics": self.topics(),
+                "ItemsPreCached": self.items_precached(),
+                "TopicsPreCached": self.topics_precached(),
+                "Size": self._block_size,
+                "DateTime": "Enabled" if self._date_time else "Disabled",
+                "Timeout": self._timeout}
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def is_using_datetime(self):
+        return self._date_time
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def get_block_size(self):
+        self._block_size = _Reader(self._call(_VOP_GET_BLOCK_SIZE)).get('I')
+        return self._block_size
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def set_block_size(self, sz):
+        self._call(_VOP_SET_BLOCK_SIZE, _struct.pack('<I', sz))
+        self._block_size = sz
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def stream_occupancy(self, item, topic):
+        return _Reader(self._call(_VOP_STREAM_OCCUPANCY,
+                                  _pstr(item.upper()), _pstr(topic.upper()))).get('I')
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def items(self, str_max=MAX_STR_SZ):
+        return [s[:str_max] for s in _Reader(self._call(_VOP_GET_ITEMS)).strings()]
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def topics(self, str_max=MAX_STR_SZ):
+        return [s[:str_max] for s in _Reader(self._call(_VOP_GET_TOPICS)).strings()]
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def items_precached(self, str_max=MAX_STR_SZ):
+        return [s[:str_max] for s in
+                _Reader(self._call(_VOP_GET_ITEMS_PRECACHED)).strings()]
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def topics_precached(self, str_max=MAX_STR_SZ):
+        return [s[:str_max] for s in
+                _Reader(self._call(_VOP_GET_TOPICS_PRECACHED)).strings()]
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def add_items(self, *items):
+        self._call(_VOP_ADD_ITEMS, _pstrs(i.upper() for i in items))
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def add_topics(self, *topics):
+        self._call(_VOP_ADD_TOPICS, _pstrs(t.upper() for t in topics))
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def remove_items(self, *items):
+        self._call(_VOP_REMOVE_ITEMS, _pstrs(i.upper() for i in items))
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def remove_topics(self, *topics):
+        self._call(_VOP_REMOVE_TOPICS, _pstrs(t.upper() for t in topics))
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def get(self, item, topic, date_time=False, indx=0, check_indx=True,
+            data_str_max=STR_DATA_SZ):
+        return self.get_many(((item, topic),), date_time, indx, check_indx,
+                             data_str_max)[0]
+
+
+    def get_many(self, item_topics, date_time=False, indx=0, check_indx=True,
+                 data_str_max=STR_DATA_SZ):
+        """ get() for a number of streams in one round trip
+
+        get_many(self, item_topics, date_time=False, indx=0, check_indx=True,
+                 data_str_max=STR_DATA_SZ)
+
+        item_topics :: iterable of (str,str) :: (item, topic) pairs
+        (the rest as in get())
+
+        returns -> list of what get() returns, in the same order
+
+        throws TOSDB_DataTimeError, TOSDB_IndexError, TOSDB_DataError,
+               TOSDB_CLibError, TOSDB_VirtualizationError
+        """
+        if date_time and not self._date_time:
+            raise TOSDB_DateTimeError("date_time not available for this block")
+        if indx < 0:
+            indx += self._block_size
+        if indx < 0 or indx >= self._block_size:
+            raise TOSDB_IndexError("invalid index value passed to get()")
+
+        reqs = []
+        for item, topic in item_topics:
+            it = _pstr(item.upper()) + _pstr(topic.upper())
+            occ = self._conn.send(_VOP_STREAM_OCCUPANCY,
+                                  _pstr(self._name) + it) if check_indx else None
+            rid = self._conn.send(_VOP_GET, _pstr(self._name) + it +
+                                  _struct.pack('<iB', indx, 1 if date_time else 0))
+            reqs.append((occ, rid))
+
+        vals = []
+        for occ, rid in reqs:
+            if occ is not None and indx >= _Reader(_check(*self._conn.wait(occ))).get('I'):
+                self._conn.wait(rid) # drain it
+                raise TOSDB_DataError("data not available at this index yet " +
+                                      "(disable check_indx to avoid this error)")
+            v, dt = _Reader(_check(*self._conn.wait(rid))).value(date_time)
+            if isinstance(v, str):
+                v = v[:data_str_max]
+            vals.append((v, dt) if date_time else v)
+        return vals
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def stream_snapshot(self, item, topic, date_time=False, end=-1, beg=0,
+                        smart_size=True, data_str_max=STR_DATA_SZ):
+        if date_time and not self._date_time:
+            raise TOSDB_DateTimeError("date_time not available for this block")
+        body = self._call(_VOP_STREAM_SNAPSHOT, _pstr(item.upper()),
+                          _pstr(topic.upper()),
+                          _struct.pack('<iiBB', end, beg, 1 if smart_size else 0,
+                                       self._flags(date_time)))
+        return _zip_dt(*_Reader(body).array(data_str_max))
+
+
+    def stream_snapshot_ndarray(self, item, topic, date_time=False, end=-1, beg=0,
+                                smart_size=True):
+        """ stream_snapshot() as numpy arrays (requires numpy)
+
+        stream_snapshot_ndarray(self, item, topic, date_time=False, end=-1,
+                                beg=0, smart_size=True)
+
+        returns -> (values, micros); values is float32/float64/int32/int64 (object
+                   for strings), micros int64 micro-seconds since the epoch or
+                   None if not date_time. Unpacked numeric columns are
+                   read-only views of the received data (no copy).
+
+        throws TOSDB_DateTimeError, TOSDB_CLibError, TOSDB_VirtualizationError
+        """
+        if date_time and not self._date_time:
+            raise TOSDB_DateTimeError("date_time not available for this block")
+        body = self._call(_VOP_STREAM_SNAPSHOT, _pstr(item.upper()),
+                          _pstr(topic.upper()),
+                          _struct.pack('<iiBB', end, beg, 1 if smart_size else 0,
+                                       self._flags(date_time)))
+        return _Reader(body).ndarray()
+
+
+    def item_frame_ndarray(self, topic, date_time=False):
+        """ item_frame() as numpy arrays (requires numpy)
+
+        returns -> (labels, values, micros); see stream_snapshot_ndarray
+
+        throws TOSDB_DateTimeError, TOSDB_CLibError, TOSDB_VirtualizationError
+        """
+        if date_time and not self._date_time:
+            raise TOSDB_DateTimeError("date_time not available for this block")
+        r = _Reader(self._call(_VOP_ITEM_FRAME, _pstr(topic.upper()),
+                               _struct.pack('<B', self._flags(date_time))))
+        labs = r.strings()
+        return (labs,) + r.ndarray()
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def stream_snapshot_from_marker(self, item, topic, date_time=False, beg=0,
+                                    margin_of_safety=100, throw_if_data_lost=True,
+                                    data_str_max=STR_DATA_SZ):
+        if date_time and not self._date_time:
+            raise TOSDB_DateTimeError("date_time not available for this block")
+        if margin_of_safety < _MIN_MARGIN_OF_SAFETY:
+            raise TOSDB_ValueError("margin_of_safety < MIN_MARGIN_OF_SAFETY")
+        r = _Reader(self._call(_VOP_STREAM_SNAPSHOT_FROM_MARKER, _pstr(item.upper()),
+                               _pstr(topic.upper()),
+                               _struct.pack('<iIB', beg, margin_of_safety,
+                                            self._flags(date_time))))
+        dirty, g = r.get('B'), r.get('i')
+        if dirty and throw_if_data_lost:
+            raise TOSDB_DataError("marker is already dirty")
+        if g == 0:
+            return None
+        elif g < 0 and throw_if_data_lost:
+            raise TOSDB_DataError("data lost behind the 'marker'")
+        return _zip_dt(*r.array(data_str_max))
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def item_frame(self, topic, date_time=False, labels=True,
+                   data_str_max=STR_DATA_SZ, label_str_max=MAX_STR_SZ):
+        return self._frame(_VOP_ITEM_FRAME, topic.upper(), date_time, labels,
+                           data_str_max, label_str_max)
+
+
+    @_doxtend(_TOSDB_DataBlock) # __doc__ from ABC _TOSDB_DataBlock
+    def topic_frame(self, item, date_time=False, labels=True,
+                    data_str_max=STR_DATA_SZ, label_str_max=MAX_STR_SZ):
+        return self._frame(_VOP_TOPIC_FRAME, item.upper(), date_time, labels,
+                           data_str_max, label_str_max)
+
+
+    def _frame(self, op, name, date_time, labels, data_str_max, label_str_max):
+        if date_time and not self._date_time:
+            raise TOSDB_DateTimeError("date_time not available for this block")
+        r = _Reader(self._call(op, _pstr(name), _struct.pack('<B', self._flags(date_time))))
+        labs = [l[:label_str_max] for l in r.strings()]
+        dat = _zip_dt(*r.array(data_str_max))
+        if labels:
+            nt = _namedtuple(_str_clean(name), [_str_clean(l) for l in labs])
+            return nt(*dat)
+        return dat
+
+
+    def _flags(self, date_time):
+        return (_VARRAY_DTS if date_time else 0) | (_VARRAY_PACKED if self._packed else 0)
+
+
+    def _body(self, *parts):
+        return _pstr(self._name) + b''.join(parts)
+
+
+    def _call(self, op, *parts):
+        if not self._valid:
+            raise TOSDB_VirtualizationError("block is closed")
+        return self._conn.call(op, self._body(*parts))
+
+
+@make_block_thread_safe('__str__')
+class VNativeThreadSafeDataBlock(VNativeDataBlock):
+    """ The main object for storing TOS data (NATIVE VIRTUAL) (THREAD SAFE)
+
+    __init__(self, address, size=1000, date_time=False, timeout=DEF_TIMEOUT,
+             packed=True)
+
+    (see VNativeDataBlock; a shared VNativeConnection is NOT made thread-safe)
+    """
+    def __init__(self, address, size=1000, date_time=False, timeout=DEF_TIMEOUT,
+                 packed=True):
+        super().__init__(address, size, date_time, timeout, packed)
+
+
+class VNativeMirror:
+    """ Local copies of streams of VNativeDataBlocks, pushed by the server
+
+    __init__(self, conn)
+
+    conn :: VNativeConnection :: the connection the blocks were created on
+
+    Each subscribed stream is a deque, most recent first, of values (or
+    (value, TOSDB_DateTime) tuples if the block is using date-time). The
+    server reads new data from each stream's marker, so don't also call
+    stream_snapshot_from_marker on it. (NOT THREAD SAFE)
+    """
+    def __init__(self, conn):
+        self._conn = conn
+        self._blocks = {}
+
+    def subscribe(self, block, item_topics, policy=PUSH_CONFLATE, depth=1000):
+        """ start pushing (item, topic) pairs of 'block'; keep 'depth' of each
+
+        policy :: PUSH_DROP or PUSH_CONFLATE :: if we fall behind, should the
+                  server drop ticks or send just the latest of each stream
+
+        throws TOSDB_CLibError, TOSDB_VirtualizationError
+        """
+        its = [(i.upper(), t.upper()) for i,t in item_topics]
+        block._call(_VOP_SUBSCRIBE,
+                    _struct.pack('<BBI', policy, block._flags(block._date_time), len(its)),
+                    b''.join(_pstr(i) + _pstr(t) for i,t in its))
+        b = self._blocks.setdefault(block._name, {'depth':depth, 'dropped':0,
+                                                  'conflated':0, 'streams':{}})
+        b['depth'] = depth
+        for it in its:
+            b['streams'].setdefault(it, _deque(maxlen=depth))
+
+    def unsubscribe(self, block, item_topics=()):
+        """ stop pushing (item, topic) pairs of 'block' (all if none given) """
+        its = [(i.upper(), t.upper()) for i,t in item_topics]
+        block._call(_VOP_UNSUBSCRIBE, _struct.pack('<I', len(its)),
+                    b''.join(_pstr(i) + _pstr(t) for i,t in its))
+        b = self._blocks.get(block._name)
+        if b is None:
+            return
+        for it in its:
+            b['streams'].pop(it, None)
+        if not its or not b['streams']:
+            del self._blocks[block._name]
+
+    def update(self, timeout=0):
+        """ apply pushed ticks, waiting up to 'timeout' msec for the first
+
+        returns -> number of points added
+        """
+        n = 0
+        while True:
+            f = self._conn.next_push(timeout)
+            if f is None:
+                return n
+            timeout = 0
+            if f[0] == _VOP_TICKS:
+                n += self._apply(f[1])
+
+    def stream(self, block, item, topic):
+        """ the mirrored stream (deque, most recent first); throws KeyError """
+        return self._blocks[block._name]['streams'][(item.upper(), topic.upper())]
+
+    def dropped(self, block):
+        """ points the server dropped because we fell behind """
+        return self._blocks[block._name]['dropped']
+
+    def conflated(self, block):
+        """ points the server skipped, sending a later one instead """
+        return self._blocks[block._name]['conflated']
+
+    def _apply(self, body):
+        r = _Reader(body)
+        b = self._blocks.get(r.string())
+        if b is None:
+            return 0
+        b['dropped'] += r.get('I')
+        n = 0
+        for _ in range(r.get('I')):
+            it = (r.string(), r.string())
+            g = abs(r.get('i'))
+            vals = _zip_dt(*r.array())
+            strm = b['streams'].get(it)
+            if strm is None:
+                continue
+            b['conflated'] += g - len(vals)
+            strm.extendleft(reversed(vals)) # most recent ends up at [0]
+            n += len(vals)
+        return n
+
+
+class VNativeMcastReceiver:
+    """ Local copies of the streams a server multicasts
+
+    __init__(self, group, recovery_address=None, port=DEF_MCAST_PORT,
+             iface='0.0.0.0', depth=1000, gap_timeout=20)
+
+    group            :: str       :: multicast group (--mcast on the server)
+    recovery_address :: (str,int) :: the server's (TCP) address, to recover
+                                     lost datagrams from; None just skips them
+    port             :: int       :: multicast port
+    iface            :: str       :: address of the interface to join on
+    depth            :: int       :: points kept per stream
+    gap_timeout      :: int       :: msec a gap can stay open before we ask
+
+    Each stream is a deque, most recent first, of values or (value,
+    TOSDB_DateTime) tuples. When the server no longer has what we missed we
+    start over from its latest values (a 'snapshot'). (NOT THREAD SAFE)
+
+    throws TOSDB_VirtualizationError (recovery failed), OSError (socket)
+    """
+    def __init__(self, group, recovery_address=None, port=DEF_MCAST_PORT,
+                 iface='0.0.0.0', depth=1000, gap_timeout=_VMCAST_DEF_GAP_TIMEOUT):
+        self._sock = _socket.socket(_socket.AF_INET, _socket.SOCK_DGRAM)
+        self._sock.setsockopt(_socket.SOL_SOCKET, _socket.SO_REUSEADDR, 1)
+        self._sock.bind(('', port))
+        self._sock.setsockopt(_socket.IPPROTO_IP, _socket.IP_ADD_MEMBERSHIP,
+                              _socket.inet_aton(group) + _socket.inet_aton(iface))
+        self._sock.setblocking(False)
+        self._recovery_address = recovery_address
+        self._conn = None
+        self._depth = depth
+        self._gap_timeout = gap_timeout / 1000
+        self._synced = False
+        self._session = 0
+        self._next = 1 # seq we're waiting for
+        self._known = 0 # highest seq we know was sent
+        self._ahead = {} # arrived before _next
+        self._gap_since = 0
+        self._streams = {}
+        self._stats = dict.fromkeys(('datagrams', 'duplicates', 'gaps', 'retransmitted',
+                                     'lost', 'snapshots'), 0)
+
+    def close(self):
+        if self._sock:
+            self._sock.close()
+            self._sock = None
+        if self._conn:
+            self._conn.close()
+            self._conn = None
+
+    def update(self, timeout=0):
+        """ apply what's arrived, waiting up to 'timeout' msec for the first,
+        and recover any gap that's been open too long
+
+        returns -> number of points added
+        """
+        n = 0
+        if timeout:
+            _select.select([self._sock], [], [], timeout / 1000)
+        while True:
+            try:
+                d = self._sock.recv(65536)
+            except (BlockingIOError, InterruptedError):
+                break
+            n += self._on_datagram(d)
+        if self._synced and self._known >= self._next \
+                and _monotonic() - self._gap_since >= self._gap_timeout:
+            n += self._recover()
+        return n
+
+    def stream(self, item, topic):
+        """ the received stream (deque, most recent first); throws KeyError """
+        return self._streams[(item.upper(), topic.upper())]
+
+    def streams(self):
+        return list(self._streams.keys())
+
+    def seq(self):
+        """ highest datagram applied """
+        return self._next - 1
+
+    def stats(self):
+        return dict(self._stats)
+
+    def _on_datagram(self, d):
+        if len(d) < _MCAST_HEAD.size:
+            return 0
+        magic, count, session, seq = _MCAST_HEAD.unpack_from(d)
+        if magic != _VMCAST_MAGIC:
+            return 0
+        n = 0
+        if not self._synced or session != self._session:
+            if self._recovery_address:
+                n += self._snapshot()
+                if session != self._session:
+                    return n
+            else:
+                self._synced = True
+                self._session = session
+                self._next = seq if count else seq + 1
+                self._known = self._next - 1
+                self._ahead = {}
+        was_open = self._known >= self._next
+        self._known = max(self._known, seq)
+        if count == 0:
+            pass # heartbeat
+        elif seq < self._next or seq in self._ahead:
+            self._stats['duplicates'] += 1
+        elif seq == self._next:
+            n += self._apply(d)
+            self._next += 1
+            n += self._drain()
+        else:
+            self._ahead[seq] = d
+        if not was_open and self._known >= self._next:
+            self._gap_since = _monotonic()
+            self._stats['gaps'] += 1
+        return n
+
+    def _drain(self):
+        n = 0
+        while self._next in self._ahead:
+            n += self._apply(self._ahead.pop(self._next))
+            self._next += 1
+        for s in [s for s in self._ahead if s < self._next]:
+            del self._ahead[s]
+        return n
+
+    def _apply(self, d):
+        r = _Reader(d, _MCAST_HEAD.size)
+        n = 0
+        for _ in range(_MCAST_HEAD.unpack_from(d)[1]):
+            it = (r.string(), r.string())
+            vals = _zip_dt(*r.array())
+            strm = self._streams.get(it)
+            if strm is None:
+                strm = self._streams[it] = _deque(maxlen=self._depth)
+            strm.extendleft(reversed(vals)) # most recent ends up at [0]
+            n += len(vals)
+        self._stats['datagrams'] += 1
+        return n
+
+    def _recover(self):
+        if not self._recovery_address:
+            resume = min(self._ahead) if self._ahead else self._known + 1
+            self._stats['lost'] += resume - self._next
+            self._next = resume
+            return self._drain()
+        n = 0
+        while self._known >= self._next:
+            cnt = min(self._known - self._next + 1, _VMCAST_MAX_RETRANSMIT)
+            r = _Reader(self._call(_VOP_MCAST_RETRANSMIT,
+                                   _struct.pack('<IQI', self._session, self._next, cnt)))
+            session, first, cnt = r.get('IQI')
+            if session != self._session or cnt == 0 or first > self._next:
+                return n + self._snapshot() # too old; start over
+            for _ in range(cnt):
+                d = r.raw(r.get('H'))
+                if _MCAST_HEAD.unpack_from(d)[3] != self._next:
+                    continue # arrived (late) in the meantime
+                n += self._apply(d)
+                self._next += 1
+                self._stats['retransmitted'] += 1
+                n += self._drain()
+        return n
+
+    def _snapshot(self):
+        r = _Reader(self._call(_VOP_MCAST_SNAPSHOT))
+        session, seq, count = r.get('IQI')
+        if self._synced and session == self._session:
+            if seq >= self._next:
+                self._stats['lost'] += seq + 1 - self._next
+            self._known = max(self._known, seq)
+        else:
+            self._ahead = {} # an old session's
+            self._known = seq
+        # history with a hole in it isn't worth keeping; start over
+        self._streams = {}
+        n = 0
+        for _ in range(count):
+            it = (r.string(), r.string())
+            vals = _zip_dt(*r.array())
+            if vals:
+                self._streams[it] = _deque(vals[:1], maxlen=self._depth)
+                n += 1
+        self._synced = True
+        self._session = session
+        self._next = seq + 1
+        self._stats['snapshots'] += 1
+        return n + self._drain()
+
+    def _call(self, op, body=b''):
+        try:
+            if self._conn is None:
+                self._conn = VNativeConnection(self._recovery_address)
+            return self._conn.call(op, body)
+        except OSError as e:
+            if self._conn:
+                self._conn.close()
+            self._conn = None # reconnect next time
+            raise TOSDB_VirtualizationError("multicast recovery failed: " + str(e))
+
+
+class _Reader:
+    """ decodes a reply body (see vprotocol.hpp) """
+    _ARRAY_CODES = {INTGR_BIT | QUAD_BIT: 'q', INTGR_BIT: 'i', QUAD_BIT: 'd', 0: 'f'}
+    _DELTA_CODES = {1: 'b', 2: 'h', 4: 'i', 8: 'q'}
+    _NP_TYPES = {INTGR_BIT | QUAD_BIT: '<i8', INTGR_BIT: '<i4', QUAD_BIT: '<f8', 0: '<f4'}
+
+    def __init__(self, body, pos=0):
+        self._b = body
+        self._pos = pos
+
+    def get(self, fmt):
+        v = self.unpack(fmt)
+        return v[0] if len(v) == 1 else v
+
+    def unpack(self, fmt):
+        v = _struct.unpack_from('<' + fmt, self._b, self._pos)
+        self._pos += _struct.calcsize('<' + fmt)
+        return v
+
+    def raw(self, n):
+        b = self._b[self._pos:self._pos + n]
+        self._pos += n
+        return b
+
+    def string(self):
+        n = self.get('H')
+        s = self._b[self._pos:self._pos + n].decode()
+        self._pos += n
+        return s
+
+    def strings(self):
+        return [self.string() for _ in range(self.get('I'))]
+
+    def value(self, has_dts):
+        tbits = self.get('B')
+        v = self.string() if tbits & STRING_BIT else \
+            self.get(self._ARRAY_CODES[tbits])
+        return (v, _micro_to_dt(self.get('q')) if has_dts else None)
+
+    def array(self, str_max=None):
+        """ returns (list of values, list of TOSDB_DateTime or None) """
+        tbits, flags, n = self.get('BBI')
+        packed = flags & _VARRAY_PACKED
+        if tbits & STRING_BIT:
+            vals = [self.string()[:str_max] for _ in range(n)]
+        elif tbits & INTGR_BIT:
+            vals = self._int_column(n, packed, self._ARRAY_CODES[tbits])
+        else:
+            vals = list(self.unpack('%d%s' % (n, self._ARRAY_CODES[tbits])))
+        if not flags & _VARRAY_DTS:
+            return (vals, None)
+        return (vals, [_micro_to_dt(m) for m in self._int_column(n, packed, 'q')])
+
+    def ndarray(self):
+        """ returns (numpy array of values, numpy int64 array of micros or None)
+
+        numeric columns that aren't packed are read-only views of the body
+        """
+        import numpy as np
+        tbits, flags, n = self.get('BBI')
+        packed = flags & _VARRAY_PACKED
+        if tbits & STRING_BIT:
+            vals = np.array([self.string() for _ in range(n)], dtype=object)
+        elif packed and tbits & INTGR_BIT:
+            vals = self._np_packed(np, n)
+        else:
+            vals = np.frombuffer(self._b, self._NP_TYPES[tbits], n, self._pos)
+            self._pos += vals.nbytes
+        if not flags & _VARRAY_DTS:
+            return (vals, None)
+        if packed:
+            return (vals, self._np_packed(np, n))
+        micros = np.frombuffer(self._b, '<i8', n, self._pos)
+        self._pos += micros.nbytes
+        return (vals, micros)
+
+    def _int_column(self, n, packed, code):
+        if not packed:
+            return list(self.unpack('%d%s' % (n, code)))
+        if n == 0:
+            return []
+        w, first = self.get('Bq')
+        col = [first]
+        for d in self.unpack('%d%s' % (n - 1, self._DELTA_CODES[w])):
+            col.append((col[-1] + d + 2**63) % 2**64 - 2**63) # int64 wrap
+        return col
+
+    def _np_packed(self, np, n):
+        if n == 0:
+            return np.empty(0, np.int64)
+        w, first = self.get('Bq')
+        d = np.frombuffer(self._b, '<i%d' % w, n - 1, self._pos)
+        self._pos += d.nbytes
+        col = np.empty(n, np.int64)
+        col[0] = first
+        col[1:] = d
+        return np.cumsum(col, out=col) # wraps like the C++ side
+
+
+def _check(status, body):
+    if status == _VSTATUS_OK:
+        return body
+    if status < 0:
+        raise TOSDB_CLibError("vserver call returned error code [%i,%s]"
+                              % (status, ERROR_LOOKUP.get(status, '?')))
+    if status == _VSTATUS_EXCEPTION and body:
+        raise TOSDB_VirtualizationError("vserver exception: " + _Reader(body).string())
+    raise TOSDB_VirtualizationError("vserver returned status [%i]" % status)
+
+
+def _pstr(s):
+    b = s.encode() if isinstance(s, str) else s
+    return _struct.pack('<H', len(b)) + b
+
+
+def _pstrs(strs):
+    strs = list(strs)
+    return _struct.pack('<I', len(strs)) + b''.join(_pstr(s) for s in strs)
+
+
+def _micro_to_dt(micro):
+    return TOSDB_DateTime(_localtime(micro // 1000000), micro % 1000000)
+
+
+def _zip_dt(vals, dts):
+    return list(zip(vals, dts)) if dts is not None else vals
+
+
+def _str_clean(s):
+    s = _sub(_REGEX_NON_ALNUM, '', s)
+    return s if s[:1].isalpha() else 'X_' + s
@@ -27,8 +27,18 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #include "client.hpp"
 #include "raw_data_block.hpp"
 #include "ipc.hpp"
+#include "tick_record.hpp"
+#include "thread_sched.hpp"
+#include "shard_map.hpp"
+#include "buffer_ring.hpp"
+#include "failover.hpp"
+#include "string_dict.hpp"
+#include "shared_data_stream.hpp"
 
-std::recursive_mutex global_rmutex;
+LockProfile global_rmutex_site("global_rmutex");
+LockProfile buffers_mtx_site("buffers_mtx");
+
+ProfiledMutex<std::recursive_mutex> global_rmutex(global_rmutex_site);
 
 namespace { 
 
@@ -48,20 +58,77 @@ std::map<std::string,TOSDBlock*> dde_blocks;
 
 /* buffers in shared mem */
 buffers_ty buffers;
-std::mutex buffers_mtx;
+ProfiledMutex<std::mutex> buffers_mtx(buffers_mtx_site);
     
 /* !!! 'buffers_lock_guard_' is reserved inside this namespace !!! */
-#define LOCAL_BUFFERS_LOCK_GUARD std::lock_guard<std::mutex> buffers_lock_guard_(buffers_mtx)
+#define LOCAL_BUFFERS_LOCK_GUARD \
+    ApiStatLockGuard<ProfiledMutex<std::mutex>> \
+        buffers_lock_guard_(buffers_mtx, API_STAT_LOCK_BUFFERS)
+
+/* segment we're recording ticks to (if any); guarded by buffers_mtx */
+std::unique_ptr<TickRecorder> recorder;
+EpochMicroCache recorder_micro; /* its stamps; guarded by buffers_mtx too */
 
 /* for 'scheduling' buffer reads */
 steady_clock_type steady_clock;
 
 unsigned long  buffer_latency = TOSDB_DEF_LATENCY;
+
+/* TOSDB_SetPrefill; 0/0 is off (a new buffer is read from its start); 
+   guarded by global_rmutex */
+size_type prefill_ticks = 0;
+size_type prefill_secs = 0;
 HANDLE buffer_thread = NULL;
 DWORD buffer_thread_id = 0;   
 
-/* our IPC mechanism */
-IPCMaster master(TOSDB_COMM_CHANNEL);
+/* TOSDB_SetThreadSchedule for buffer_thread; applied again when it's created */
+std::atomic<unsigned long long> buffer_thread_cpu_mask(0);
+std::atomic<int> buffer_thread_priority(TOSDB_THREAD_PRI_UNCHANGED);
+
+/* our IPC mechanism; a master for every engine we could use - the primary 
+   and standby of each shard, at shard * 2 + slot (masters[0] is 
+   TOSDB_COMM_CHANNEL) - of which we use the first shard_count shards */
+std::vector<std::unique_ptr<IPCMaster>> masters = 
+    [](){
+        std::vector<std::unique_ptr<IPCMaster>> m;
+        for(unsigned int i = 0; i < TOSDB_MAX_SHARDS * 2; ++i){
+            m.push_back( std::unique_ptr<IPCMaster>(
+                new IPCMaster(CreateCommChannelName(i / 2, (i % 2) != 0))) );
+        }
+        return m;
+    }();
+
+/* each shard's control segment (see failover.hpp), mapped read-only once the
+   engines have created it; NULL if they haven't (no failover: slot 0) */
+std::atomic<EngineControl*> controls[TOSDB_MAX_SHARDS];
+
+/* the generation each shard's buffers were last checked against, and if 
+   any of them still has to be moved over; guarded by buffers_mtx */
+unsigned int control_gens[TOSDB_MAX_SHARDS];
+bool control_pending[TOSDB_MAX_SHARDS];
+
+/* which engine (slot) each buffer is mapped from; guarded by buffers_mtx */
+std::map<buffers_ty::key_type, unsigned int> buffer_slots;
+
+/* the values we've decoded from each string buffer's dictionary (see 
+   string_dict.hpp); guarded by buffers_mtx */
+std::map<buffers_ty::key_type, StringDictReader> buffer_dicts;
+
+/* the shared blocks (TOSDB_CreateSharedBlock/AttachSharedBlock) in dde_blocks,
+   their directory, if we own it, and the directory version a reader's block
+   was last brought up to; guarded by global_rmutex */
+typedef struct{
+    SharedBlockDir *dir;
+    bool owner;
+    unsigned int version;
+} shared_block_info_ty;
+
+std::map<std::string, shared_block_info_ty> shared_blocks;
+
+/* which shard a stream goes to (TOSDB_SetShardCount etc.); guarded by 
+   global_rmutex, and only changed while unconnected w/ no streams */
+ShardMap shard_map;
+std::atomic<unsigned int> shard_count(1); /* for _connected */
 
 /* atomic flag that supports IPC connectivity */
 std::atomic<bool> aware_of_connection(false);  
@@ -79,6 +146,71 @@ _getBlockPtr(std::string id)
 }
 
 
+EngineControl*
+_control(unsigned int shard)
+{
+    EngineControl *ctrl = controls[shard].load();
+    if(ctrl)
+        return ctrl;
+
+    HANDLE fm_hndl = OpenFileMapping(FILE_MAP_READ, 0, CreateControlName(shard).c_str());
+    if(!fm_hndl)
+        return NULL;
+
+    ctrl = (EngineControl*)MapViewOfFile(fm_hndl, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(fm_hndl);
+    if(!ctrl)
+        return NULL;
+
+    EngineControl *prev = NULL;
+    if( !controls[shard].compare_exchange_strong(prev, ctrl) ){
+        UnmapViewOfFile(ctrl); /* another thread beat us to it */
+        return prev;
+    }
+
+    TOSDB_Log("FAILOVER", ("mapped control segment, shard: " + std::to_string(shard)).c_str());
+    return ctrl;
+}
+
+
+/* the slot of the shard's active engine */
+unsigned int
+_activeSlot(unsigned int shard)
+{
+    EngineControl *ctrl = _control(shard);
+    return ctrl ? (ctrl->active.load() & 1) : 0;
+}
+
+
+IPCMaster*
+_master(unsigned int shard)
+{
+    return masters[shard * 2 + _activeSlot(shard)].get();
+}
+
+
+/* every shard's (active) engine is up; while a standby is taking over from 
+   an engine that's gone, the standby being up is enough */
+bool
+_shardsConnected(bool log_if_not_connected=false)
+{
+    unsigned int n = shard_count.load();
+    for(unsigned int i = 0; i < n; ++i){
+        unsigned int slot = _activeSlot(i);
+        if( !masters[i * 2 + slot]->connected(TOSDB_DEF_TIMEOUT)
+            && !(controls[i].load() && masters[i * 2 + (slot ^ 1)]->connected(TOSDB_DEF_TIMEOUT)) )
+        {
+            if(log_if_not_connected){        
+                TOSDB_LogH("IPC", ("not connected to slave (!master.connected), shard: " 
+                                   + std::to_string(i)).c_str());            
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+
 bool
 _connected(bool log_if_not_connected=false)
 {    
@@ -88,13 +220,7 @@ _connected(bool log_if_not_connected=false)
         return false;
     }
 
-    if(!master.connected(TOSDB_DEF_TIMEOUT)){
-        if(log_if_not_connected)        
-            TOSDB_LogH("IPC", "not connected to slave (!master.connected)");            
-        return false;
-    }
-
-    return true;
+    return _shardsConnected(log_if_not_connected);
 }
 
 
@@ -102,14 +228,19 @@ long
 _requestStreamOP(TOS_Topics::TOPICS topic_t, 
                 std::string item, 
                 unsigned long timeout, 
-                unsigned int opcode)
+                unsigned int opcode,
+                int shard = -1)
 { /* needs exclusivity but can't block; CALLING CODE MUST LOCK
-     returns 0 on sucess, TOSDB_ERROR... on error */
+     returns 0 on sucess, TOSDB_ERROR... on error; 
+     goes to the shard that owns the stream unless 'shard' says otherwise */
 
     /* build ipc msg early so we can log it on error */
     std::string msg = std::to_string(opcode) + ' ' + TOS_Topics::MAP()[topic_t] + ' '
                     + item + ' ' + std::to_string(timeout); 
 
+    if(shard < 0)
+        shard = (int)shard_map.route(TOS_Topics::MAP()[topic_t], item);
+
     switch(opcode){
     case TOSDB_SIG_ADD:
     case TOSDB_SIG_REMOVE:
@@ -125,7 +256,7 @@ _requestStreamOP(TOS_Topics::TOPICS topic_t,
         return TOSDB_ERROR_NOT_CONNECTED;
     }
 
-    if( !master.call(&msg,timeout) ){
+    if( !_master(shard)->call(&msg,timeout) ){
         TOSDB_LogRawH("IPC",("master.call failled in _requestStreamOP, msg:" + msg).c_str());
         return TOSDB_ERROR_IPC;
     }
@@ -142,13 +273,128 @@ _requestStreamOP(TOS_Topics::TOPICS topic_t,
 }
 
 
+/* TOSDB_SIG_TEST on every shard; 0 if they're all connected to TOS */
+long
+_testShards()
+{
+    unsigned int n = shard_count.load();
+    for(unsigned int i = 0; i < n; ++i){
+        long r = _requestStreamOP(TEST_TOPIC, TEST_ITEM, TOSDB_MIN_TIMEOUT, TOSDB_SIG_TEST, i);
+        if(r)
+            return r;
+    }
+    return 0;
+}
+
+
+/* send an admin msg to every shard; 0 if each replies 'good', otherwise the 
+   first bad reply (TOSDB_ERROR_IPC if 'good' is TOSDB_SIG_GOOD). A shard's 
+   standby gets it too, if it's up, but only the active engine's reply 
+   counts. CALLING CODE MUST LOCK */
+long
+_callShards(const std::string& msg, long good)
+{
+    long ret = 0;
+    unsigned int n = shard_count.load();
+
+    for(unsigned int i = 0; i < n; ++i){
+        std::string m(msg);
+        long r;
+
+        unsigned int slot = _activeSlot(i);
+        IPCMaster *standby = masters[i * 2 + (slot ^ 1)].get();
+        if( controls[i].load() && standby->connected(TOSDB_MIN_TIMEOUT) ){
+            std::string sm(msg);
+            if( !standby->call(&sm, TOSDB_DEF_TIMEOUT) )
+                TOSDB_LogH("IPC",("standby master.call failed, msg:" + msg 
+                                  + ", shard: " + std::to_string(i)).c_str());
+        }
+
+        if( !masters[i * 2 + slot]->call(&m, TOSDB_DEF_TIMEOUT) ){
+            TOSDB_LogH("IPC",("master.call failled, msg:" + msg 
+                              + ", shard: " + std::to_string(i)).c_str());
+            r = TOSDB_ERROR_IPC;
+        }else{
+            try{        
+                r = std::stol(m);
+                if(r == good)
+                    r = 0;
+                else if(good == TOSDB_SIG_GOOD)
+                    r = TOSDB_ERROR_IPC;
+            }catch(...){
+                TOSDB_LogH("IPC", "failed to convert return message to long");
+                r = TOSDB_ERROR_IPC;
+            }      
+        }
+
+        if(r && !ret)
+            ret = r;
+    }
+
+    return ret;
+}
+
+
+/* the shard config can't change under open streams or a live connection */
+bool
+_shardsCanChange()
+{
+    if(buffer_thread){
+        TOSDB_LogH("SHARD", "can't change shards while connected (TOSDB_Disconnect)");
+        return false;
+    }
+
+    LOCAL_BUFFERS_LOCK_GUARD;
+    /* --- CRITICAL SECTION --- */
+    if(!buffers.empty()){
+        TOSDB_LogH("SHARD", "can't change shards while streams are open");
+        return false;
+    }
+    return true;
+    /* --- CRITICAL SECTION --- */
+}
+
+
+/* map an engine's buffer and open its mutex; returns an error message 
+   (empty on success) */
+std::string
+_openBuffer(std::string buf_name, void **mem_addr, void **mtx_hndl)
+{
+    void *fm_hndl = OpenFileMapping(FILE_MAP_READ, 0, buf_name.c_str());
+
+    if( !fm_hndl || !(*mem_addr = MapViewOfFile(fm_hndl,FILE_MAP_READ,0,0,0)) )
+    {  
+        if(fm_hndl)
+            CloseHandle(fm_hndl);
+        return "failure to map shared memory: " + buf_name;
+    }
+    CloseHandle(fm_hndl); 
+
+    std::string mtx_name = std::string(buf_name).append("_mtx");
+    *mtx_hndl = OpenMutex(SYNCHRONIZE,FALSE,mtx_name.c_str());
+    if(!*mtx_hndl){ 
+        UnmapViewOfFile(*mem_addr);
+        return "failure to open MUTEX handle: " + buf_name;
+    }
+
+    return "";
+}
+
+
+void
+_prefillBlock(TOS_Topics::TOPICS topic_t, 
+              std::string item, 
+              buffer_info_ty& buf_info, 
+              const TOSDBlock* db,
+              bool is_new);
+
+
 void 
 _captureBuffer(TOS_Topics::TOPICS topic_t, 
               std::string item, 
               const TOSDBlock* db)
 {
     std::string buf_name;
-    void *fm_hndl;
     void *mem_addr;
     void *mtx_hndl;
     buffers_ty::key_type buf_key(topic_t, item); 
@@ -156,36 +402,30 @@ _captureBuffer(TOS_Topics::TOPICS topic_t,
     LOCAL_BUFFERS_LOCK_GUARD;
     /* --- CRITICAL SECTION --- */
 
+    bool is_new = false;
     buffers_ty::iterator b_iter = buffers.find(buf_key);
     if( b_iter != buffers.end() ){  
         std::get<2>(b_iter->second).insert(db);     
     }else{ 
-        buf_name = CreateBufferName(TOS_Topics::map[topic_t], item);
-        fm_hndl = OpenFileMapping(FILE_MAP_READ, 0, buf_name.c_str());
-
-        if( !fm_hndl || !(mem_addr = MapViewOfFile(fm_hndl,FILE_MAP_READ,0,0,0)) )
-        {  
-            if(fm_hndl)
-                CloseHandle(fm_hndl);
-            std::string e("failure to map shared memory: "); 
-            throw TOSDB_BufferError( e.append(buf_name) );
-        }
-        CloseHandle(fm_hndl); 
-
-        std::string mtx_name = std::string(buf_name).append("_mtx");
-        mtx_hndl = OpenMutex(SYNCHRONIZE,FALSE,mtx_name.c_str());
-        if(!mtx_hndl){ 
-            UnmapViewOfFile(mem_addr);
-            std::string e("failure to open MUTEX handle: ");
-            throw TOSDB_BufferError( e.append(buf_name) );
-        }
+        unsigned int shard = shard_map.route(TOS_Topics::map[topic_t], item);
+        unsigned int slot = _activeSlot(shard);
+
+        buf_name = CreateBufferName(TOS_Topics::map[topic_t], item, shard, slot != 0);
+        std::string e = _openBuffer(buf_name, &mem_addr, &mtx_hndl);
+        if( !e.empty() )
+            throw TOSDB_BufferError(e);
 
         std::set<const TOSDBlock*> db_set;
         db_set.insert(db);  
 
         auto binfo = std::make_tuple(0,0,std::move(db_set),mem_addr,mtx_hndl);
-        buffers.insert( buffers_ty::value_type(std::move(buf_key),std::move(binfo)) );        
+        buffer_slots[buf_key] = slot;
+        b_iter = buffers.insert( buffers_ty::value_type(buf_key,std::move(binfo)) ).first;
+        is_new = true;
     }     
+
+    if(prefill_ticks || prefill_secs)
+        _prefillBlock(topic_t, item, b_iter->second, db, is_new);
     /* --- CRITICAL SECTION --- */
 }  
 
@@ -206,6 +446,8 @@ _releaseBuffer(TOS_Topics::TOPICS topic_t,
         {
             UnmapViewOfFile(std::get<3>(b_iter->second));
             CloseHandle(std::get<4>(b_iter->second));
+            buffer_slots.erase(b_iter->first);
+            buffer_dicts.erase(b_iter->first);
             buffers.erase(b_iter);    
         }
     }  
@@ -213,18 +455,54 @@ _releaseBuffer(TOS_Topics::TOPICS topic_t,
 }  
 
 
+/* the value of the element at 'val'; false if it can't be had (a string 
+   code that's gone stale in the buffer's dictionary) */
 template<typename T> 
-inline T 
-_castToVal(char* val) 
+inline bool 
+_castToVal(pBufferHead head, char* val, StringDictReader* dict, T* out) 
 { 
-    return *(T*)val; 
+    *out = *(T*)val; 
+    return true;
 }
   
 template<> 
-inline std::string 
-_castToVal<std::string>(char* val)
+inline bool 
+_castToVal<std::string>(pBufferHead head, char* val, StringDictReader* dict, std::string* out)
+{ 
+    if(!head->dict_offset){
+        out->assign(val, strnlen_s(val, TOSDB_STR_DATA_SZ)); 
+        return true;
+    }
+
+    return StringDictLoad(val, (StringDict*)((char*)head + head->dict_offset), dict, out);
+}
+
+
+template<typename T> 
+inline const char* 
+_dataOfVal(const T& val) 
 { 
-    return std::string(val); 
+    return (const char*)&val; 
+}
+  
+inline const char* 
+_dataOfVal(const std::string& val) 
+{ 
+    return val.c_str(); 
+}
+
+
+template<typename T> 
+inline uint32_t 
+_sizeOfVal(const T& val) 
+{ 
+    return sizeof(T); 
+}
+  
+inline uint32_t 
+_sizeOfVal(const std::string& val)
+{ 
+    return (uint32_t)val.size(); 
 }
   
 
@@ -233,11 +511,12 @@ void
 _extractFromBuffer(TOS_Topics::TOPICS topic, 
                    std::string item, 
                    buffer_info_ty& buf_info)
-{  /* some unecessary comp in here; cache some of the buffer params */ 
-    long npos;
-    long long loop_diff, nelems;
-    unsigned int dlen;
+{
+    long long nelems;
     char* spot;
+    pDateTimeStamp pdts;
+    T val;
+    StringDictReader* dict = NULL;
 
     pBufferHead head = (pBufferHead)std::get<3>(buf_info);
         
@@ -250,19 +529,8 @@ _extractFromBuffer(TOS_Topics::TOPICS topic,
         return;   
     }
 
-    /* get the effective size of the buffer */
-    dlen = head->end_offset - head->beg_offset; 
-
-    /* relative position since last read (begin offset needs to be 0) */  
-    npos = head->next_offset - head->beg_offset - std::get<0>(buf_info); 
-        
-    if((loop_diff = (head->loop_seq - std::get<1>(buf_info))) < 0)
-    {/* how many times has the buffer looped around, if any */
-        loop_diff+=(((long long)UINT_MAX+1)); /* in case of num limit */
-    }
-
-    /* how many elems have been written, 'borrow' a dlen if necesary */
-    nelems = (npos + (loop_diff * dlen)) / head->elem_size;      
+    /* how many elems have been written since our last read (no more than fit) */
+    nelems = RingNewElements(head, std::get<0>(buf_info), std::get<1>(buf_info));
     if(!nelems){ /* if no new elems we're done */
         ReleaseMutex(std::get<4>(buf_info));
         return;
@@ -271,25 +539,27 @@ _extractFromBuffer(TOS_Topics::TOPICS topic,
         throw TOSDB_BufferError("numElems < 0");
     }else{ /* extract */  
 
-        if((unsigned long long)nelems >= (dlen / head->elem_size)){ 
-            /* make sure we don't insert more than the max elems */
-            nelems = dlen / head->elem_size;
-        }
+        if(head->dict_offset) /* string codes */
+            dict = &buffer_dicts[buffers_ty::key_type(topic, item)];
         
         do{ /* go through each elem, last first  */
-            spot = (char*)head + 
-                   (((head->next_offset - (nelems * head->elem_size)) + dlen) % dlen);  
+            spot = (char*)head + RingElementOffset(head, head->next_offset, 
+                                                   (unsigned int)nelems);
+            pdts = (pDateTimeStamp)(spot + ((head->elem_size) - sizeof(DateTimeStamp)));
+
+            if( !_castToVal<T>(head, spot, dict, &val) )
+                continue; /* fell too far behind the dictionary */
       
             for(const TOSDBlock* block : std::get<2>(buf_info)){ 
                 /* insert those elements into each block's raw data block */          
                 block->   
                 block->
-                    insert_data(
-                        topic, 
-                        item, 
-                        _castToVal<T>(spot), 
-                        *(pDateTimeStamp)(spot + ((head->elem_size) - sizeof(DateTimeStamp)))
-                    ); 
+                    insert_data(topic, item, val, *pdts); 
+            }
+
+            if(recorder){
+                recorder->append(topic, item, _dataOfVal(val), _sizeOfVal(val), 
+                                 recorder_micro(*pdts));
             }
         }while(--nelems);
     } 
@@ -301,6 +571,462 @@ _extractFromBuffer(TOS_Topics::TOPICS topic,
 }
 
 
+/* move a buffer over to the ring of the engine in 'slot' (the one that took 
+   over), starting right after the last element we read from the old one 
+   (by time stamp and value, see FailoverNewer). CALLING CODE MUST LOCK 
+   buffers_mtx */
+bool
+_remapBuffer(const buffers_ty::key_type& key, 
+             buffer_info_ty& buf_info, 
+             unsigned int shard, 
+             unsigned int slot)
+{
+    void *mem_addr;
+    void *mtx_hndl;
+    unsigned int cur_offset = 0;
+    unsigned int cur_loop_seq = 0;
+    long long last = 0;
+    char *last_elem = NULL;
+    std::string last_str;
+    StringDictReader dict; /* the new ring's codes are its own */
+    unsigned int nnew = 0;
+
+    std::string buf_name = CreateBufferName(TOS_Topics::map[key.first], key.second, 
+                                            shard, slot != 0);
+    std::string e = _openBuffer(buf_name, &mem_addr, &mtx_hndl);
+    if( !e.empty() ){
+        TOSDB_LogH("FAILOVER", e.c_str());
+        return false;
+    }
+
+    pBufferHead old_head = (pBufferHead)std::get<3>(buf_info);
+    pBufferHead head = (pBufferHead)mem_addr;
+    bool have_last = std::get<0>(buf_info) || std::get<1>(buf_info);
+
+    unsigned int val_sz = old_head->elem_size - sizeof(DateTimeStamp);
+    bool is_str = (TOS_Topics::TypeBits(key.first) == TOSDB_STRING_BIT);
+
+    auto stamp = [](pBufferHead h, unsigned int offset){
+        return DateTimeStampToEpochMicro( 
+            *(pDateTimeStamp)((char*)h + offset + h->elem_size - sizeof(DateTimeStamp)) );
+    };
+
+    auto same_value = [&](unsigned int offset){
+        char *v = (char*)head + offset;
+        std::string s;
+        return is_str ? (_castToVal(head, v, &dict, &s) && s == last_str)
+                      : (memcmp(v, last_elem, val_sz) == 0);
+    };
+
+    /* the old engine is gone (or stuck); no need for its mutex */
+    if(have_last){
+        unsigned int offset = RingElementOffset(old_head, old_head->beg_offset 
+                                                + std::get<0>(buf_info), 1);
+        last = stamp(old_head, offset);
+        last_elem = (char*)old_head + offset;
+        if(is_str)
+            _castToVal(old_head, last_elem, &buffer_dicts[key], &last_str);
+    }
+
+    if( WaitForSingleObject(mtx_hndl, TOSDB_DEF_TIMEOUT) ){
+        TOSDB_LogH("FAILOVER", ("failed to lock " + buf_name).c_str());
+        UnmapViewOfFile(mem_addr);
+        CloseHandle(mtx_hndl);
+        return false;
+    }
+
+    if(have_last){
+        nnew = RingResumeCursor(head, 
+                                [&](unsigned int offset){ 
+                                    return FailoverNewer(stamp(head, offset), last, same_value(offset));
+                                },
+                                &cur_offset, &cur_loop_seq);
+    }
+    ReleaseMutex(mtx_hndl);
+
+    UnmapViewOfFile(std::get<3>(buf_info));
+    CloseHandle(std::get<4>(buf_info));
+
+    std::get<0>(buf_info) = cur_offset;
+    std::get<1>(buf_info) = cur_loop_seq;
+    std::get<3>(buf_info) = mem_addr;
+    std::get<4>(buf_info) = mtx_hndl;
+    buffer_slots[key] = slot;
+    if(is_str)
+        buffer_dicts[key] = dict;
+
+    TOSDB_Log("FAILOVER", ("moved to " + buf_name + ", " + std::to_string(nnew) 
+                           + " new element(s)").c_str());
+    return true;
+}
+
+
+/* if a shard's standby has taken over (its generation changed) move its 
+   buffers over; the ones that fail are tried again next time. CALLING CODE 
+   MUST LOCK buffers_mtx */
+void
+_followFailover()
+{
+    unsigned int n = shard_count.load();
+    for(unsigned int i = 0; i < n; ++i){
+        EngineControl *ctrl = controls[i].load();
+        if(!ctrl)
+            continue;
+
+        unsigned int gen = ctrl->generation.load();
+        if(gen == control_gens[i] && !control_pending[i])
+            continue;
+
+        unsigned int slot = ctrl->active.load() & 1;
+        control_gens[i] = gen;
+        control_pending[i] = false;
+
+        for(buffers_ty::value_type & buf : buffers){
+            if(buffer_slots[buf.first] == slot
+               || shard_map.route(TOS_Topics::map[buf.first.first], buf.first.second) != i)
+            {
+                continue;
+            }
+            if( !_remapBuffer(buf.first, buf.second, i, slot) )
+                control_pending[i] = true;
+        }
+    }
+}
+
+
+/* load the ticks the engine kept before our cursor (what the blocks already 
+   using the buffer have seen) into a new block: the last prefill_ticks, those 
+   from the last prefill_secs (of the latest), whichever is fewer, and no more 
+   than the block holds. A new buffer's cursor moves to the end first, so the 
+   extract loop only picks up what comes after. CALLING CODE MUST LOCK 
+   buffers_mtx */
+template<typename T> 
+void 
+_prefillFromBuffer(TOS_Topics::TOPICS topic, 
+                   std::string item, 
+                   buffer_info_ty& buf_info,
+                   const TOSDBlock* db,
+                   bool is_new)
+{  
+    T val;
+    StringDictReader* dict = NULL;
+    pBufferHead head = (pBufferHead)std::get<3>(buf_info);
+
+    if(head->dict_offset) /* string codes */
+        dict = &buffer_dicts[buffers_ty::key_type(topic, item)];
+
+    if( WaitForSingleObject(std::get<4>(buf_info), TOSDB_DEF_TIMEOUT) ){
+        TOSDB_LogH("PREFILL", ("failed to lock buffer: " + TOS_Topics::map[topic] 
+                               + ' ' + item).c_str());
+        return;
+    }
+
+    if(is_new){
+        std::get<0>(buf_info) = head->next_offset - head->beg_offset;
+        std::get<1>(buf_info) = head->loop_seq; 
+    }
+
+    unsigned int elem = head->elem_size;
+    unsigned int dlen = head->end_offset - head->beg_offset;
+    unsigned int cur = head->beg_offset + std::get<0>(buf_info);
+
+    /* what's before the cursor, less what's been written over since */
+    long long written = RingNewElements(head, std::get<0>(buf_info), std::get<1>(buf_info));
+    long long avail = (std::get<1>(buf_info) ? dlen : std::get<0>(buf_info)) / elem - written;
+
+    long long n = std::min<long long>(avail, db->block->block_size());
+    if(prefill_ticks)
+        n = std::min<long long>(n, prefill_ticks);
+
+    auto stamp_at = [&](unsigned int offset){
+        return (pDateTimeStamp)((char*)head + offset + elem - sizeof(DateTimeStamp));
+    };
+
+    if(n > 0 && prefill_secs){
+        EpochMicroCache to_micro; /* newest back, mostly the same second */
+        long long cutoff = to_micro(*stamp_at(RingElementOffset(head, cur, 1)))
+                         - (long long)prefill_secs * 1000000;
+        long long k = 0;
+        while(k < n && to_micro(*stamp_at(RingElementOffset(head, cur, (unsigned int)k + 1))) >= cutoff)
+        {
+            ++k;
+        }
+        n = k;
+    }
+
+    for(long long k = n; k > 0; --k){ /* oldest first */
+        unsigned int offset = RingElementOffset(head, cur, (unsigned int)k);
+        if( _castToVal<T>(head, (char*)head + offset, dict, &val) ) /* skip stale codes */
+            db->block->insert_data(topic, item, val, *stamp_at(offset));
+    }
+
+    ReleaseMutex(std::get<4>(buf_info));
+
+    if(n > 0){
+        TOSDB_Log("PREFILL", ("prefilled " + std::to_string(n) + " tick(s): " 
+                              + TOS_Topics::map[topic] + ' ' + item).c_str());
+    }
+}
+
+
+void
+_prefillBlock(TOS_Topics::TOPICS topic_t, 
+              std::string item, 
+              buffer_info_ty& buf_info, 
+              const TOSDBlock* db,
+              bool is_new)
+{
+    switch(TOS_Topics::TypeBits(topic_t)){
+    case TOSDB_STRING_BIT :                  
+        _prefillFromBuffer<std::string>(topic_t, item, buf_info, db, is_new); 
+        break;
+    case TOSDB_INTGR_BIT :                  
+        _prefillFromBuffer<def_size_type>(topic_t, item, buf_info, db, is_new); 
+        break;                      
+    case TOSDB_QUAD_BIT :                   
+        _prefillFromBuffer<ext_price_type>(topic_t, item, buf_info, db, is_new); 
+        break;            
+    case TOSDB_INTGR_BIT | TOSDB_QUAD_BIT :                  
+        _prefillFromBuffer<ext_size_type>(topic_t, item, buf_info, db, is_new); 
+        break;              
+    default : 
+        _prefillFromBuffer<def_price_type>(topic_t, item, buf_info, db, is_new);                         
+    };        
+}
+
+
+/* copy the summary from the stream's buffer; ours if we have it mapped, 
+   otherwise the active engine's, mapped just for this */
+int
+_getStreamSummary(TOS_Topics::TOPICS topic_t, 
+                  std::string item, 
+                  pStreamSummary summary)
+{
+    void *mem_addr;
+    void *mtx_hndl;
+    int ret = 0;
+
+    LOCAL_BUFFERS_LOCK_GUARD;
+    /* --- CRITICAL SECTION --- */
+    buffers_ty::iterator b_iter = buffers.find( buffers_ty::key_type(topic_t, item) );
+    bool is_ours = (b_iter != buffers.end());
+
+    if(is_ours){
+        mem_addr = std::get<3>(b_iter->second);
+        mtx_hndl = std::get<4>(b_iter->second);
+    }else{
+        unsigned int shard = shard_map.route(TOS_Topics::map[topic_t], item);
+        std::string buf_name = CreateBufferName(TOS_Topics::map[topic_t], item, shard, 
+                                                _activeSlot(shard) != 0);
+        if( !_openBuffer(buf_name, &mem_addr, &mtx_hndl).empty() )
+            return TOSDB_ERROR_SHEM_BUFFER; /* the engine doesn't have it */
+    }
+
+    if( WaitForSingleObject(mtx_hndl, TOSDB_DEF_TIMEOUT) ){
+        TOSDB_LogH("SUMMARY", ("failed to lock buffer: " + TOS_Topics::map[topic_t] 
+                               + ' ' + item).c_str());
+        ret = TOSDB_ERROR_CONCURRENCY;
+    }else{
+        *summary = ((pBufferHead)mem_addr)->summary;
+        ReleaseMutex(mtx_hndl);
+    }
+
+    if(!is_ours){
+        UnmapViewOfFile(mem_addr);
+        CloseHandle(mtx_hndl);
+    }
+    return ret;
+    /* --- CRITICAL SECTION --- */
+}
+
+
+/* map a shared block's segment: make it (read/write, 'sz' bytes) or open 
+   another process's (read-only); NULL on failure */
+void*
+_mapShared(std::string name, size_t sz, bool create)
+{
+    void *fm_hndl;
+    void *mem_addr;
+
+    if(create){
+        fm_hndl = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 
+                                    (DWORD)((unsigned long long)sz >> 32), 
+                                    (DWORD)(sz & 0xFFFFFFFF), name.c_str());
+    }else{
+        fm_hndl = OpenFileMapping(FILE_MAP_READ, 0, name.c_str());
+    }
+
+    if(!fm_hndl){
+        TOSDB_LogH("SHARED", ("failure to map shared memory: " + name).c_str());
+        return NULL;
+    }
+
+    mem_addr = create ? MapViewOfFile(fm_hndl, FILE_MAP_ALL_ACCESS, 0, 0, sz)
+                      : MapViewOfFile(fm_hndl, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(fm_hndl); /* the view keeps it */
+    if(!mem_addr)
+        TOSDB_LogH("SHARED", ("failure to map view of shared memory: " + name).c_str());
+
+    return mem_addr;
+}
+
+
+/* SharedDataStream's release_type */
+void
+_unmapShared(void *mem_addr)
+{
+    UnmapViewOfFile(mem_addr);
+}
+
+
+/* is the process that owns a shared block still around? */
+bool
+_processAlive(unsigned int pid)
+{
+    DWORD code;
+    HANDLE proc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if(!proc)
+        return GetLastError() == ERROR_ACCESS_DENIED; /* it's there, just not ours */
+
+    BOOL ret = GetExitCodeProcess(proc, &code);
+    CloseHandle(proc);
+    return !ret || code == STILL_ACTIVE;
+}
+
+
+/* the streams of a shared block: the owner makes each one's segment, a
+   reader maps the owner's */
+class SharedBlockStreams
+        : public TOSDB_RawDataBlock::streams_type{
+    std::string _id;
+    bool _owner;
+
+    template<typename T>
+    DataStreamInterface<DateTimeStamp, generic_type>*
+    _create(std::string item, TOS_Topics::TOPICS topic, size_type sz, bool datetime)
+    {
+        std::string name = CreateSharedBlockName(_id, TOS_Topics::map[topic], item);
+        void *mem_addr = _mapShared(name, SharedRing<T,DateTimeStamp>::SegmentSize(sz), _owner);
+        if(!mem_addr)
+            throw TOSDB_BufferError("failure to map shared stream: " + name, "SharedBlock");
+
+        /* the stream unmaps it, even if it throws */
+        if(datetime){
+            return new SharedDataStream<T, DateTimeStamp, generic_type, true>(
+                mem_addr, sz, _owner, _unmapShared);
+        }
+        return new SharedDataStream<T, DateTimeStamp, generic_type, false>(
+            mem_addr, sz, _owner, _unmapShared);
+    }
+
+public:
+    SharedBlockStreams(std::string id, bool owner)
+        :
+            _id(id),
+            _owner(owner)
+        {
+        }
+
+    DataStreamInterface<DateTimeStamp, generic_type>*
+    create(std::string item, TOS_Topics::TOPICS topic, size_type sz, bool datetime)
+    {
+        switch(TOS_Topics::TypeBits(topic)){
+        case TOSDB_STRING_BIT :
+            return _create<std::string>(item, topic, sz, datetime);
+        case TOSDB_INTGR_BIT :
+            return _create<def_size_type>(item, topic, sz, datetime);
+        case TOSDB_QUAD_BIT :
+            return _create<ext_price_type>(item, topic, sz, datetime);
+        case TOSDB_INTGR_BIT | TOSDB_QUAD_BIT :
+            return _create<ext_size_type>(item, topic, sz, datetime);
+        default :
+            return _create<def_price_type>(item, topic, sz, datetime);
+        };
+    }
+};
+
+
+/* list an owned shared block's items and topics for its readers */
+void
+_publishSharedBlock(std::string id, const TOSDBlock *db)
+{
+    std::map<std::string, shared_block_info_ty>::iterator s_iter = shared_blocks.find(id);
+    if(s_iter == shared_blocks.end() || !s_iter->second.owner)
+        return;
+
+    str_set_type items = db->block->items();
+    topic_set_type topics = db->block->topics();
+    std::vector<std::string> item_v(items.begin(), items.end());
+    std::vector<unsigned int> topic_v;
+    for(auto t : topics)
+        topic_v.push_back((unsigned int)t);
+
+    if( !SharedBlockDirWrite(s_iter->second.dir, item_v, topic_v) )
+        TOSDB_LogH("SHARED", ("too many items/topics to list for block: " + id).c_str());
+}
+
+
+/* bring a reader's block up to the owner's directory; if the owner is in the
+   middle of changing it, or a stream can't be had yet, we try again on the 
+   next call */
+void
+_syncSharedBlock(std::string id)
+{
+    std::vector<std::string> items;
+    std::vector<unsigned int> topics_u;
+    unsigned int version;
+
+    GLOBAL_RLOCK_GUARD;
+    /* --- CRITICAL SECTION --- */
+    std::map<std::string, shared_block_info_ty>::iterator s_iter = shared_blocks.find(id);
+    if(s_iter == shared_blocks.end() || s_iter->second.owner)
+        return;
+
+    shared_block_info_ty& info = s_iter->second;
+    if( !SharedBlockDirRead(info.dir, &items, &topics_u, &version) 
+        || version == info.version )
+    {
+        return;
+    }
+
+    TOSDBlock *db = _getBlockPtr(id);
+    if(!db)
+        return;
+
+    str_set_type new_items;
+    topic_set_type new_topics;
+    for(auto & i : items)
+        new_items.insert(i);
+    for(auto t : topics_u)
+        new_topics.insert((TOS_Topics::TOPICS)t);
+
+    try{
+        for(auto & item : db->block->items()){
+            if(new_items.find(item) == new_items.end())
+                db->block->remove_item(item);
+        }
+        for(auto topic : db->block->topics()){
+            if(new_topics.find(topic) == new_topics.end())
+                db->block->remove_topic(topic);
+        }
+        for(auto topic : new_topics){
+            if( !db->block->has_topic(topic) )
+                db->block->add_topic(topic);
+        }
+        for(auto & item : new_items){
+            if( !db->block->has_item(item.c_str()) )
+                db->block->add_item(item);
+        }
+    }catch(const std::exception& e){
+        TOSDB_LogH("SHARED", ("failed to sync block (" + id + "): " + e.what()).c_str());
+        return;
+    }
+
+    info.version = version;
+    /* --- CRITICAL SECTION --- */
+}
+
+
 DWORD WINAPI 
 _cleanupBlock(LPVOID lParam)
 {
@@ -322,7 +1048,7 @@ _threadedExtractLoop(LPVOID lParam)
     long tdiff;  
     long probe_waiting;    
  
-    if( master.connected(TOSDB_DEF_TIMEOUT) )
+    if( _shardsConnected() )
         aware_of_connection.store(true);
 
     while( _connected() ){
@@ -355,6 +1081,8 @@ _threadedExtractLoop(LPVOID lParam)
                         _extractFromBuffer<def_price_type>(buf.first.first, buf.first.second, buf.second);                         
                     };        
                 }
+                /* after we've read what's left in the old engine's buffers */
+                _followFailover();
                 /* --- CRITICAL SECTION --- */
             } /* make sure we give up this lock each time through the buffers */
             tend = steady_clock.now();
@@ -371,13 +1099,17 @@ _threadedExtractLoop(LPVOID lParam)
 }
 
 
+/* 'streams' (the block takes it) for a block that doesn't keep its streams 
+   on the heap */
 int
 _createBlock(LPCSTR id,
              size_type sz,
              BOOL is_datetime,
-             size_type timeout)  
+             size_type timeout,
+             TOSDB_RawDataBlock::streams_type *streams = NULL)  
 {
     TOSDBlock* db;
+    std::unique_ptr<TOSDB_RawDataBlock::streams_type> streams_ptr(streams);
 
     if( !IsValidBlockSize(sz) )
         return TOSDB_ERROR_BLOCK_SIZE;  
@@ -395,7 +1127,7 @@ _createBlock(LPCSTR id,
     db->block = nullptr;
 
     try{
-        db->block = TOSDB_RawDataBlock::CreateBlock(sz, is_datetime); 
+        db->block = TOSDB_RawDataBlock::CreateBlock(sz, is_datetime, streams_ptr.release()); 
     }catch(const TOSDB_DataBlockLimitError){
         TOSDB_LogH("BLOCK", "attempt to exceed block limit");
     }catch(const std::exception& e){
@@ -413,6 +1145,73 @@ _createBlock(LPCSTR id,
     /* --- CRITICAL SECTION --- */
 }
 
+
+/* the owner makes the block's directory (and takes over one whose owner is 
+   gone); a reader opens it and gets the size and datetime from it */
+int
+_createSharedBlock(LPCSTR id,
+                   size_type sz,
+                   BOOL is_datetime,
+                   size_type timeout,
+                   bool owner)
+{
+    SharedBlockDir *dir;
+    int ret;
+
+    if(owner && !IsValidBlockSize(sz))
+        return TOSDB_ERROR_BLOCK_SIZE;
+
+    GLOBAL_RLOCK_GUARD;
+    /* --- CRITICAL SECTION --- */
+
+    if( GetBlockPtr(id,false) ){
+        TOSDB_LogH("BLOCK", ("block (" + std::string(id) + ") already exists").c_str());
+        return TOSDB_ERROR_BLOCK_ALREADY_EXISTS; 
+    }
+
+    dir = (SharedBlockDir*)_mapShared(CreateSharedBlockName(id), sizeof(SharedBlockDir), owner);
+    if(!dir)
+        return owner ? TOSDB_ERROR_BLOCK_CREATION : TOSDB_ERROR_BLOCK_DOESNT_EXIST;
+
+    if(owner){
+        unsigned int pid = dir->owner.load();
+        if( pid && pid != GetCurrentProcessId() && _processAlive(pid) ){
+            TOSDB_LogH("BLOCK", ("shared block (" + std::string(id) 
+                                 + ") already has an owner").c_str());
+            UnmapViewOfFile((void*)dir);
+            return TOSDB_ERROR_BLOCK_ALREADY_EXISTS;
+        }
+        dir->block_size = sz;
+        dir->datetime = is_datetime ? 1 : 0;
+        SharedBlockDirWrite(dir, std::vector<std::string>(), std::vector<unsigned int>());
+        dir->owner.store(GetCurrentProcessId());
+    }else{
+        if( !dir->owner.load() ){
+            TOSDB_LogH("BLOCK", ("shared block (" + std::string(id) + ") is closed").c_str());
+            UnmapViewOfFile((void*)dir);
+            return TOSDB_ERROR_BLOCK_DOESNT_EXIST;
+        }
+        sz = dir->block_size;
+        is_datetime = dir->datetime ? TRUE : FALSE;
+    }
+
+    ret = _createBlock(id, sz, is_datetime, timeout, new SharedBlockStreams(id, owner));
+    if(ret){
+        if(owner)
+            dir->owner.store(0);
+        UnmapViewOfFile((void*)dir);
+        return ret;
+    }
+
+    shared_block_info_ty info = {dir, owner, UINT_MAX};
+    shared_blocks[id] = info;
+    if(!owner)
+        _syncSharedBlock(id);
+
+    return 0;
+    /* --- CRITICAL SECTION --- */
+}
+
 }; /* namespace */
 
 
@@ -434,10 +1233,11 @@ DllMain(HANDLE mod, DWORD why, LPVOID res) /* ENTRY POINT */
     case DLL_THREAD_ATTACH: 
         break;
     case DLL_THREAD_DETACH: 
+        ApiStatThreadDetach();
         break;
     case DLL_PROCESS_DETACH:  
         {
-            if( master.connected(TOSDB_DEF_TIMEOUT) ){                        
+            if( _shardsConnected() ){                        
                 for(const auto & buffer : buffers)
                 {/* signal the service and close the handles */        
                     _requestStreamOP(buffer.first.first, buffer.first.second, 
@@ -448,6 +1248,13 @@ DllMain(HANDLE mod, DWORD why, LPVOID res) /* ENTRY POINT */
             }
             /* needs to come after close ops or _requestStreamOP will fail on _connected() */
             aware_of_connection.store(false);
+            /* let the readers of our shared blocks know we're gone */
+            for(auto & sb : shared_blocks){
+                if(sb.second.owner)
+                    sb.second.dir->owner.store(0);
+            }
+            /* close the segment so its index gets written */
+            recorder.reset();
             StopLogging();
         } 
         break;    
@@ -459,8 +1266,8 @@ DllMain(HANDLE mod, DWORD why, LPVOID res) /* ENTRY POINT */
 }
 
 
-int 
-TOSDB_Connect() 
+static int 
+TOSDB_Connect_() 
 {      
     /* We should be able to block in here as long as this is not called from DllMain  */
     if(_connected()) 
@@ -480,6 +1287,14 @@ TOSDB_Connect()
         TOSDB_Log("IPC", ("NOT connected to engine, client: " + mod_name_str).c_str());
         return TOSDB_ERROR_CONCURRENCY;  
     }
+
+    if(buffer_thread_cpu_mask.load() || buffer_thread_priority.load() != TOSDB_THREAD_PRI_UNCHANGED)
+    {
+        int e = SetThreadSchedule(buffer_thread, buffer_thread_cpu_mask.load(), 
+                                  buffer_thread_priority.load());
+        if(e)
+            TOSDB_LogEx("THREAD", "failed to set schedule of _threadedExtractLoop", e);
+    }
         
     for(int msec = TOSDB_DEF_PAUSE; msec <= TOSDB_DEF_TIMEOUT; msec += TOSDB_DEF_PAUSE){
         /* we need a timed wait on aware_of_connection to avoid situations 
@@ -496,14 +1311,26 @@ TOSDB_Connect()
     return TOSDB_ERROR_TIMEOUT;
 }
 
+int
+TOSDB_Connect() 
+{
+    return API_STAT_CALL(API_STAT_CONNECT, TOSDB_Connect_());
+}
 
-int 
-TOSDB_Disconnect()
+
+static int 
+TOSDB_Disconnect_()
 {  
     aware_of_connection.store(false);
     return 0;
 }
 
+int
+TOSDB_Disconnect()
+{
+    return API_STAT_CALL(API_STAT_DISCONNECT, TOSDB_Disconnect_());
+}
+
 
 /* DEPRECATED - Jan 10 2017 */
 unsigned int 
@@ -528,7 +1355,7 @@ TOSDB_IsConnectedToEngineAndTOS()
     if(!_connected())
         return 0;
 
-    return _requestStreamOP(TEST_TOPIC, TEST_ITEM, TOSDB_MIN_TIMEOUT, TOSDB_SIG_TEST) ? 0 : 1;    
+    return _testShards() ? 0 : 1;    
 }
 
 
@@ -539,7 +1366,7 @@ TOSDB_ConnectionState()
     if(!_connected())
         return TOSDB_CONN_NONE;
 
-    if( _requestStreamOP(TEST_TOPIC, TEST_ITEM, TOSDB_MIN_TIMEOUT, TOSDB_SIG_TEST) )
+    if( _testShards() )
         return TOSDB_CONN_ENGINE;
 
     /* TODO: develop a heuristic for inicating:
@@ -548,17 +1375,43 @@ TOSDB_ConnectionState()
     
     return TOSDB_CONN_ENGINE_TOS;
 
-}
+}
+
+
+/* note: if we want to do anything else with the Reserved Block(s) we'll 
+         need to introduce private versions of the API that don't call 
+         IsValidBlockID (i.e TOSDB_CreateBlock / _createBlock) */
+static int 
+TOSDB_CreateBlock_(LPCSTR id,
+                   size_type sz,
+                   BOOL is_datetime,
+                   size_type timeout)
+{   
+    if( !_connected(true) )
+        return TOSDB_ERROR_NOT_CONNECTED;
+
+    if( !IsValidBlockID(id) )    
+        return TOSDB_ERROR_BAD_INPUT;
 
+    return _createBlock(id,sz,is_datetime,timeout);
+}
 
-/* note: if we want to do anything else with the Reserved Block(s) we'll 
-         need to introduce private versions of the API that don't call 
-         IsValidBlockID (i.e TOSDB_CreateBlock / _createBlock) */
-int 
+int
 TOSDB_CreateBlock(LPCSTR id,
                   size_type sz,
                   BOOL is_datetime,
                   size_type timeout)
+{
+    return API_STAT_CALL(API_STAT_CREATE_BLOCK,
+        TOSDB_CreateBlock_(id, sz, is_datetime, timeout));
+}
+
+
+static int 
+TOSDB_CreateSharedBlock_(LPCSTR id,
+                         size_type sz,
+                         BOOL is_datetime,
+                         size_type timeout)
 {   
     if( !_connected(true) )
         return TOSDB_ERROR_NOT_CONNECTED;
@@ -566,12 +1419,38 @@ TOSDB_CreateBlock(LPCSTR id,
     if( !IsValidBlockID(id) )    
         return TOSDB_ERROR_BAD_INPUT;
 
-    return _createBlock(id,sz,is_datetime,timeout);
+    return _createSharedBlock(id, sz, is_datetime, timeout, true);
+}
+
+int
+TOSDB_CreateSharedBlock(LPCSTR id,
+                        size_type sz,
+                        BOOL is_datetime,
+                        size_type timeout)
+{
+    return API_STAT_CALL(API_STAT_CREATE_BLOCK,
+        TOSDB_CreateSharedBlock_(id, sz, is_datetime, timeout));
 }
 
 
-int 
-TOSDB_Add(std::string id, str_set_type items, topic_set_type topics_t)
+static int 
+TOSDB_AttachSharedBlock_(LPCSTR id)
+{   /* the owner's engine does the work; we don't need ours */
+    if( !IsValidBlockID(id) )    
+        return TOSDB_ERROR_BAD_INPUT;
+
+    return _createSharedBlock(id, 0, FALSE, TOSDB_DEF_TIMEOUT, false);
+}
+
+int
+TOSDB_AttachSharedBlock(LPCSTR id)
+{
+    return API_STAT_CALL(API_STAT_CREATE_BLOCK, TOSDB_AttachSharedBlock_(id));
+}
+
+
+static int 
+TOSDB_Add_(std::string id, str_set_type items, topic_set_type topics_t)
 /* adding sets of topics and strings, dealing with pre-cache; 
    all Add_ methods end up in here  */
 {
@@ -616,6 +1495,13 @@ TOSDB_Add(std::string id, str_set_type items, topic_set_type topics_t)
         return TOSDB_ERROR_BLOCK_DOESNT_EXIST;
     }
 
+    std::map<std::string, shared_block_info_ty>::iterator s_iter = shared_blocks.find(id);
+    bool is_shared = (s_iter != shared_blocks.end());
+    if(is_shared && !s_iter->second.owner){
+        TOSDB_LogH("BLOCK", ("can't add to an attached block (" + id + ")").c_str());
+        return TOSDB_ERROR_SET_STATE;
+    }
+
     old_topics = db->block->topics();
     old_items = db->block->items(); 
   
@@ -648,6 +1534,14 @@ TOSDB_Add(std::string id, str_set_type items, topic_set_type topics_t)
                         old_items.cbegin(), old_items.cend(),
                         std::insert_iterator<str_set_type>(idiff, idiff.begin()));
 
+    /* a shared block's directory only has room for so many */
+    if( is_shared 
+        && (old_items.size() + idiff.size() > SHARED_BLOCK_MAX_ITEMS
+            || old_topics.size() + tdiff.size() > SHARED_BLOCK_MAX_TOPICS) )
+    {
+        TOSDB_LogH("BLOCK", ("too many items/topics for shared block (" + id + ")").c_str());
+        return TOSDB_ERROR_BAD_INPUT;
+    }
 
     if( !tdiff.empty() ){
         /* if new topics, atleast one item, add them to the block
@@ -692,11 +1586,20 @@ TOSDB_Add(std::string id, str_set_type items, topic_set_type topics_t)
         }
     }
 
+    if(is_shared)
+        _publishSharedBlock(id, db);
+
     /* if we didn't decr err return success */
     return (err == TOSDB_ERROR_DECREMENT_BASE) ? 0 : err;
     /* --- CRITICAL SECTION --- */
 }
 
+int
+TOSDB_Add(std::string id, str_set_type items, topic_set_type topics_t)
+{
+    return API_STAT_CALL(API_STAT_ADD, TOSDB_Add_(id, items, topics_t));
+}
+
 
 int 
 TOSDB_AddTopic(std::string id, TOS_Topics::TOPICS topic_t)
@@ -814,8 +1717,8 @@ TOSDB_RemoveTopic(LPCSTR id, LPCSTR topic_str)
 }
 
 
-int 
-TOSDB_RemoveTopic(std::string id, TOS_Topics::TOPICS topic_t)
+static int 
+TOSDB_RemoveTopic_(std::string id, TOS_Topics::TOPICS topic_t)
 {  
     TOSDBlock* db;
     int err = TOSDB_ERROR_DECREMENT_BASE;
@@ -836,6 +1739,11 @@ TOSDB_RemoveTopic(std::string id, TOS_Topics::TOPICS topic_t)
         TOSDB_LogH("BLOCK", ("block (" + id + ") doesn't exist").c_str());
         return TOSDB_ERROR_BLOCK_DOESNT_EXIST;
     }   
+
+    if(shared_blocks.count(id) && !shared_blocks[id].owner){
+        TOSDB_LogH("BLOCK", ("can't remove from an attached block (" + id + ")").c_str());
+        return TOSDB_ERROR_SET_STATE;
+    }
         
     if( db->block->has_topic(topic_t) ){
         for(auto & item : db->block->items())
@@ -858,11 +1766,18 @@ TOSDB_RemoveTopic(std::string id, TOS_Topics::TOPICS topic_t)
     }
 
     db->topic_precache.erase(topic_t);
+    _publishSharedBlock(id, db);
     /* if we didn't decr err return success */
     return (err == TOSDB_ERROR_DECREMENT_BASE) ? 0 : err;
     /* --- CRITICAL SECTION --- */
 }
 
+int
+TOSDB_RemoveTopic(std::string id, TOS_Topics::TOPICS topic_t)
+{
+    return API_STAT_CALL(API_STAT_REMOVE, TOSDB_RemoveTopic_(id, topic_t));
+}
+
 
 int   
 TOSDB_RemoveItem(std::string id, std::string item)
@@ -871,8 +1786,8 @@ TOSDB_RemoveItem(std::string id, std::string item)
 }
 
 
-int 
-TOSDB_RemoveItem(LPCSTR id, LPCSTR item)
+static int 
+TOSDB_RemoveItem_(LPCSTR id, LPCSTR item)
 {  
     TOSDBlock* db;
     int err = TOSDB_ERROR_DECREMENT_BASE;
@@ -891,6 +1806,11 @@ TOSDB_RemoveItem(LPCSTR id, LPCSTR item)
         TOSDB_LogH("BLOCK", ("block (" + std::string(id) + ") doesn't exist").c_str());
         return TOSDB_ERROR_BLOCK_DOESNT_EXIST;
     }  
+
+    if(shared_blocks.count(id) && !shared_blocks[id].owner){
+        TOSDB_LogH("BLOCK", ("can't remove from an attached block (" + std::string(id) + ")").c_str());
+        return TOSDB_ERROR_SET_STATE;
+    }
         
     if( db->block->has_item(item) ){
         for(auto topic : db->block->topics())
@@ -913,14 +1833,21 @@ TOSDB_RemoveItem(LPCSTR id, LPCSTR item)
     }
 
     db->item_precache.erase(item);
+    _publishSharedBlock(id, db);
     /* if we didn't decr err return success */
     return (err == TOSDB_ERROR_DECREMENT_BASE) ? 0 : err;    
   /* --- CRITICAL SECTION --- */
 }
 
+int
+TOSDB_RemoveItem(LPCSTR id, LPCSTR item)
+{
+    return API_STAT_CALL(API_STAT_REMOVE, TOSDB_RemoveItem_(id, item));
+}
+
 
-int 
-TOSDB_CloseBlock(LPCSTR id)
+static int 
+TOSDB_CloseBlock_(LPCSTR id)
 {
     TOSDBlock* db;
     HANDLE del_thrd_hndl;
@@ -940,17 +1867,34 @@ TOSDB_CloseBlock(LPCSTR id)
         return TOSDB_ERROR_BLOCK_DOESNT_EXIST;
     }  
 
-    for(auto & item : db->block->items()){
-        for(auto topic : db->block->topics())
-        {
-            _releaseBuffer(topic, item, db);
-            if(_requestStreamOP(topic, item, db->timeout, TOSDB_SIG_REMOVE) != 0){
-                --err;
-                TOSDB_LogH("IPC", "_requestStreamOP(REMOVE) failed, stream leaked");
+    std::map<std::string, shared_block_info_ty>::iterator s_iter = shared_blocks.find(id);
+    if(s_iter != shared_blocks.end()){
+        if(s_iter->second.owner){ /* its readers keep what they've mapped */
+            SharedBlockDirWrite(s_iter->second.dir, std::vector<std::string>(), 
+                                std::vector<unsigned int>());
+            s_iter->second.dir->owner.store(0);
+        }
+    }
+
+    /* an attached block's streams are the owner's */
+    if(s_iter == shared_blocks.end() || s_iter->second.owner){
+        for(auto & item : db->block->items()){
+            for(auto topic : db->block->topics())
+            {
+                _releaseBuffer(topic, item, db);
+                if(_requestStreamOP(topic, item, db->timeout, TOSDB_SIG_REMOVE) != 0){
+                    --err;
+                    TOSDB_LogH("IPC", "_requestStreamOP(REMOVE) failed, stream leaked");
+                }
             }
         }
     }
 
+    if(s_iter != shared_blocks.end()){
+        UnmapViewOfFile((void*)s_iter->second.dir);
+        shared_blocks.erase(s_iter);
+    }
+
     dde_blocks.erase(id);       
 
     /* spin-off block destruction to its own thread so we don't block main */
@@ -967,8 +1911,14 @@ TOSDB_CloseBlock(LPCSTR id)
     /* --- CRITICAL SECTION --- */
 }
 
-int 
-TOSDB_CloseBlocks()
+int
+TOSDB_CloseBlock(LPCSTR id)
+{
+    return API_STAT_CALL(API_STAT_CLOSE_BLOCK, TOSDB_CloseBlock_(id));
+}
+
+static int 
+TOSDB_CloseBlocks_()
 {
     std::map<std::string, TOSDBlock*> bcopy;  
     int err = TOSDB_ERROR_DECREMENT_BASE;
@@ -993,6 +1943,13 @@ TOSDB_CloseBlocks()
 }
 
 
+int
+TOSDB_CloseBlocks()
+{
+    return API_STAT_CALL(API_STAT_CLOSE_BLOCKS, TOSDB_CloseBlocks_());
+}
+
+
 int
 TOSDB_DumpSharedBufferStatus()
 {
@@ -1002,19 +1959,7 @@ TOSDB_DumpSharedBufferStatus()
     GLOBAL_RLOCK_GUARD;
     /* --- CRITICAL SECTION --- */
 
-    std::string msg = std::to_string(TOSDB_SIG_DUMP);
-
-    if( !master.call(&msg, TOSDB_DEF_TIMEOUT) ){
-        TOSDB_LogH("IPC",("master.call failled, msg:" + msg).c_str());
-        return TOSDB_ERROR_IPC;
-    }
-
-    try{        
-        return (std::stol(msg) == TOSDB_SIG_GOOD) ? 0 : TOSDB_ERROR_IPC;
-    }catch(...){
-        TOSDB_LogH("IPC", "failed to convert return message to long");
-        return TOSDB_ERROR_IPC;
-    }      
+    return (int)_callShards(std::to_string(TOSDB_SIG_DUMP), TOSDB_SIG_GOOD);
     /* --- CRITICAL SECTION --- */
 }
 
@@ -1047,6 +1992,232 @@ TOSDB_RemoveOrphanedStream(LPCSTR item, LPCSTR topic_str)
 }
 
 
+int
+TOSDB_SetStreamPriority(LPCSTR item, LPCSTR topic_str, int priority)
+{
+    bool any_item = (!item || !item[0]);
+    bool any_topic = (!topic_str || !topic_str[0]);
+
+    if( (!any_item && !CheckStringLength(item)) 
+        || (!any_topic && !CheckStringLength(topic_str)) )
+    {
+        return TOSDB_ERROR_BAD_INPUT;
+    }
+
+    if(priority < TOSDB_PRIORITY_DEFAULT || priority > TOSDB_PRIORITY_LOW)
+        return TOSDB_ERROR_BAD_INPUT;
+
+    if( !any_topic && GetTopicEnum(topic_str) == TOS_Topics::TOPICS::NULL_TOPIC )
+        return TOSDB_ERROR_BAD_TOPIC; 
+
+    if( !_connected(true) )
+        return TOSDB_ERROR_NOT_CONNECTED;    
+
+    /* '*' for 'any'; the class goes where stream ops put the timeout */
+    std::string msg = std::to_string(TOSDB_SIG_PRIORITY) + ' ' 
+                    + (any_topic ? std::string("*") : std::string(topic_str)) + ' '
+                    + (any_item ? std::string("*") : std::string(item)) + ' '
+                    + std::to_string(priority);
+
+    GLOBAL_RLOCK_GUARD;
+    /* --- CRITICAL SECTION --- */
+    return (int)_callShards(msg, 0);
+    /* --- CRITICAL SECTION --- */
+}
+
+
+int
+TOSDB_SetThreadSchedule(int thread, unsigned long long cpu_mask, int priority)
+{
+    if( !ThreadPriorityIsValid(priority) )
+        return TOSDB_ERROR_BAD_INPUT;
+
+    switch(thread){
+    case TOSDB_THREAD_CLIENT_EXTRACT:
+        buffer_thread_cpu_mask.store(cpu_mask);
+        buffer_thread_priority.store(priority);
+        if(buffer_thread){
+            int e = SetThreadSchedule(buffer_thread, cpu_mask, priority);
+            if(e){
+                TOSDB_LogEx("THREAD", "failed to set schedule of _threadedExtractLoop", e);
+                return TOSDB_ERROR_CONCURRENCY;
+            }
+        }
+        return 0;
+    case TOSDB_THREAD_ENGINE_MSG:
+    case TOSDB_THREAD_ENGINE_IPC:
+    case TOSDB_THREAD_ENGINE_PROBE:
+        break;
+    default:
+        return TOSDB_ERROR_BAD_INPUT;
+    }
+
+    if( !_connected(true) )
+        return TOSDB_ERROR_NOT_CONNECTED;    
+
+    std::string msg = std::to_string(TOSDB_SIG_THREAD) + ' ' + std::to_string(thread) + ' '
+                    + std::to_string(cpu_mask) + ' ' + std::to_string(priority);
+
+    GLOBAL_RLOCK_GUARD;
+    /* --- CRITICAL SECTION --- */
+    return (int)_callShards(msg, 0);
+    /* --- CRITICAL SECTION --- */
+}
+
+
+int
+TOSDB_LoadThreadConfig(LPCSTR path)
+{
+    std::vector<ThreadSchedule> scheds;
+    std::string err;
+
+    if( !path || !path[0] )
+        return TOSDB_ERROR_BAD_INPUT;
+
+    if( !ReadThreadConfig(path, &scheds, &err) ){
+        TOSDB_LogH("THREAD", err.c_str());
+        return TOSDB_ERROR_BAD_INPUT;
+    }
+
+    /* check every line before we change anything */
+    for(const ThreadSchedule& s : scheds){
+        if(ParseThreadName(s.thread) < 0){
+            TOSDB_LogH("THREAD", ("unknown thread in config: " + s.thread).c_str());
+            return TOSDB_ERROR_BAD_INPUT;
+        }
+    }
+
+    for(const ThreadSchedule& s : scheds){
+        int ret = TOSDB_SetThreadSchedule(ParseThreadName(s.thread), s.cpu_mask, s.priority);
+        if(ret)
+            return ret;
+    }
+
+    return 0;
+}
+
+
+int
+TOSDB_SetShardCount(unsigned int n)
+{
+    if(n < 1 || n > TOSDB_MAX_SHARDS)
+        return TOSDB_ERROR_BAD_INPUT;
+
+    GLOBAL_RLOCK_GUARD;
+    /* --- CRITICAL SECTION --- */
+    if( !_shardsCanChange() )
+        return TOSDB_ERROR_SET_STATE;
+
+    shard_map.set_count(n);
+    shard_count.store(n);
+    return 0;
+    /* --- CRITICAL SECTION --- */
+}
+
+
+int
+TOSDB_AssignShard(LPCSTR item, LPCSTR topic_str, unsigned int shard)
+{
+    bool any_item = (!item || !item[0]);
+    bool any_topic = (!topic_str || !topic_str[0]);
+
+    if(any_item == any_topic) /* one or the other */
+        return TOSDB_ERROR_BAD_INPUT;
+
+    if( (!any_item && !CheckStringLength(item)) 
+        || (!any_topic && !CheckStringLength(topic_str)) )
+    {
+        return TOSDB_ERROR_BAD_INPUT;
+    }
+
+    if( !any_topic && GetTopicEnum(topic_str) == TOS_Topics::TOPICS::NULL_TOPIC )
+        return TOSDB_ERROR_BAD_TOPIC; 
+
+    GLOBAL_RLOCK_GUARD;
+    /* --- CRITICAL SECTION --- */
+    if( !_shardsCanChange() )
+        return TOSDB_ERROR_SET_STATE;
+
+    if(any_topic)
+        shard_map.assign_item(item, shard);
+    else
+        shard_map.assign_topic(TOS_Topics::MAP()[GetTopicEnum(topic_str)], shard);
+    return 0;
+    /* --- CRITICAL SECTION --- */
+}
+
+
+int
+TOSDB_LoadShardMap(LPCSTR path)
+{
+    ShardMap m;
+    std::string err;
+
+    if( !path || !path[0] )
+        return TOSDB_ERROR_BAD_INPUT;
+
+    if( !ReadShardMap(path, &m, &err) ){
+        TOSDB_LogH("SHARD", err.c_str());
+        return TOSDB_ERROR_BAD_INPUT;
+    }
+
+    GLOBAL_RLOCK_GUARD;
+    /* --- CRITICAL SECTION --- */
+    if( !_shardsCanChange() )
+        return TOSDB_ERROR_SET_STATE;
+
+    shard_map = m;
+    shard_count.store(m.count());
+    TOSDB_Log("SHARD", ("loaded shard map: " + std::string(path) + ", shards: " 
+                        + std::to_string(m.count())).c_str());
+    return 0;
+    /* --- CRITICAL SECTION --- */
+}
+
+
+int
+TOSDB_StartRecording(LPCSTR path)
+{
+    if( !CheckStringLength(path) )
+        return TOSDB_ERROR_BAD_INPUT;
+
+    try{
+        LOCAL_BUFFERS_LOCK_GUARD;
+        /* --- CRITICAL SECTION --- */
+        recorder.reset(); /* close (and index) the current segment first */
+        recorder.reset( new TickRecorder(path) );        
+        TOSDB_Log("TickRecord", ("recording to segment: " + std::string(path)).c_str());
+        return 0;
+        /* --- CRITICAL SECTION --- */
+    }catch(const TOSDB_Error& e){
+        TOSDB_LogH(e.tag().c_str(), e.info_and_what().c_str());
+        return TOSDB_ERROR_SET_STATE;
+    }catch(...){
+        return TOSDB_ERROR_UNKNOWN;
+    }
+}
+
+
+int
+TOSDB_StopRecording()
+{
+    try{
+        LOCAL_BUFFERS_LOCK_GUARD;
+        /* --- CRITICAL SECTION --- */
+        std::unique_ptr<TickRecorder> r( std::move(recorder) );
+        if(r)
+            r->close(); /* call explicitly so we can report a bad index */
+        return 0;
+        /* --- CRITICAL SECTION --- */
+    }catch(const TOSDB_Error& e){
+        TOSDB_LogH(e.tag().c_str(), e.info_and_what().c_str());
+        return TOSDB_ERROR_SET_STATE;
+    }catch(...){
+        return TOSDB_ERROR_UNKNOWN;
+    }
+}
+
+
 int 
 TOSDB_GetBlockIDs(LPSTR* dest, size_type array_len, size_type str_len)
 {  
@@ -1101,6 +2272,47 @@ TOSDB_GetClientLogPath(char* path, size_type sz)
 }
 
 
+int
+TOSDB_GetPrefill(size_type *max_ticks, size_type *max_secs)
+{
+    if(!max_ticks || !max_secs)
+        return TOSDB_ERROR_BAD_INPUT;
+
+    GLOBAL_RLOCK_GUARD;  
+    /* --- CRITICAL SECTION --- */
+    *max_ticks = prefill_ticks;
+    *max_secs = prefill_secs;
+    return 0;
+    /* --- CRITICAL SECTION --- */
+}
+
+
+int
+TOSDB_SetPrefill(size_type max_ticks, size_type max_secs)
+{
+    GLOBAL_RLOCK_GUARD;  
+    /* --- CRITICAL SECTION --- */
+    prefill_ticks = max_ticks;
+    prefill_secs = max_secs;
+    return 0;
+    /* --- CRITICAL SECTION --- */
+}
+
+
+int
+TOSDB_GetStreamSummary(LPCSTR item, LPCSTR topic_str, pStreamSummary summary)
+{
+    if( !CheckStringLength(item) || !CheckStringLength(topic_str) || !summary )
+        return TOSDB_ERROR_BAD_INPUT;
+
+    TOS_Topics::TOPICS t = GetTopicEnum(topic_str);
+    if(t == TOS_Topics::TOPICS::NULL_TOPIC)
+        return TOSDB_ERROR_BAD_TOPIC;
+
+    return API_STAT_CALL(API_STAT_STREAM_SUMMARY, _getStreamSummary(t, item, summary));
+}
+
+
 unsigned long 
 TOSDB_SetLatency(UpdateLatency latency) 
 {
@@ -1141,6 +2353,8 @@ GetTopicEnum(std::string topic_str, bool log_if_null)
 const TOSDBlock* 
 GetBlockPtr(const std::string id, bool log)
 {
+    _syncSharedBlock(id); /* an attached block follows its owner */
+
     try{      
         return dde_blocks.at(id);
     }catch(...){ 
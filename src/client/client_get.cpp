@@ -17,11 +17,202 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 
 #include "raw_data_block.hpp"
 #include "client.hpp"
+#include <algorithm>
 #include <ctime>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
 
+namespace {
+
+typedef TOSDB_RawDataBlock::stream_type::secondary_as epoch_micro_as;
+
+/* a stream's stamps straight into epoch micro-seconds as it copies them 
+   (copy(..., secondary_as)); like DateTimeStampsToEpochMicro, stamps that 
+   were never filled in come out 0 */
+class _EpochMicroConverter
+        : public TOSDB_RawDataBlock::stream_type::secondary_converter{
+    EpochMicroCache _to_micro;
+
+public:
+    long long
+    operator()(const DateTimeStamp& dts)
+    {
+        return dts.ctime_struct.tm_mday ? _to_micro(dts) : 0;
+    }
+
+    /* for a call's 'datetime': the n slots of 'dest' (NULL for none) start 
+       out 0, for any the stream doesn't reach */
+    epoch_micro_as
+    into(long long *dest, size_type n)
+    {
+        if(dest)
+            std::fill_n(dest, n, 0LL);
+
+        epoch_micro_as sec = {dest, this};
+        return sec;
+    }
+};
+
+/* where a call's stamps go: a DateTimeStamp array or, for the WithEpoch 
+   calls, epoch micro-seconds (the frames' come from the block's maps, not 
+   a stream copy) */
+inline bool
+_wantsStamps(pDateTimeStamp datetime)
+{
+    return datetime != nullptr;
+}
+
+inline bool
+_wantsStamps(const epoch_micro_as& sec)
+{
+    return sec.dest != nullptr;
+}
+
+inline void
+_putStamp(pDateTimeStamp datetime, size_type i, const DateTimeStamp& dts)
+{
+    datetime[i] = dts;
+}
+
+inline void
+_putStamp(const epoch_micro_as& sec, size_type i, const DateTimeStamp& dts)
+{
+    sec(i, dts);
+}
+
+
+/* the 'Packed' string calls (see tos_databridge.h) */
+
+size_type
+_packedSize(const std::vector<std::string>& strs, size_type array_len)
+{
+    size_type n = std::min<size_type>((size_type)strs.size(), array_len);
+    size_type sz = array_len - n; /* "" for the empty slots */
+
+    for(size_type i = 0; i < n; ++i)
+        sz += (size_type)strs[i].size() + 1;
+
+    return sz;
+}
+
+void
+_packStrings(const std::vector<std::string>& strs, 
+             size_type array_len, 
+             LPSTR dest, 
+             size_type* offsets)
+{
+    size_type n = std::min<size_type>((size_type)strs.size(), array_len);
+    size_type off = 0;
+
+    for(size_type i = 0; i < array_len; ++i){
+        offsets[i] = off;
+        if(i < n){
+            memcpy(dest + off, strs[i].c_str(), strs[i].size() + 1);
+            off += (size_type)strs[i].size() + 1;
+        }else{
+            dest[off++] = '\0';
+        }
+    }
+}
+
+int
+_packStringsOrSize(const std::vector<std::string>& strs,
+                   size_type array_len,
+                   LPSTR dest,
+                   size_type dest_len,
+                   size_type* offsets,
+                   size_type* dest_needed)
+{
+    size_type sz = _packedSize(strs, array_len);
+    if(dest_needed)
+        *dest_needed = sz;
+
+    if(!dest)
+        return 0;
+
+    if(!offsets || dest_len < sz)
+        return TOSDB_ERROR_BAD_INPUT_BUFFER;
+
+    _packStrings(strs, array_len, dest, offsets);
+    return 0;
+}
+
+template<typename SetTy, typename F>
+int
+_getNamesPacked(LPCSTR id,
+                const SetTy& (*get_set)(const TOSDBlock*, SetTy&),
+                F to_str,
+                LPSTR dest,
+                size_type dest_len,
+                size_type* offsets,
+                size_type array_len,
+                size_type* dest_needed)
+{
+    const TOSDBlock *db;
+    std::vector<std::string> strs;
+
+    if(!IsValidBlockID(id))
+        return TOSDB_ERROR_BAD_INPUT;
+
+    {
+        GLOBAL_RLOCK_GUARD;
+        /* --- CRITICAL SECTION --- */
+        db = GetBlockPtr(id);
+        if(!db) 
+            return TOSDB_ERROR_BLOCK_DOESNT_EXIST;
+
+        SetTy tmp;
+        const SetTy& names = get_set(db, tmp);
+        if(dest && array_len < names.size())
+            return TOSDB_ERROR_BAD_INPUT_BUFFER;   
+
+        for(auto & n : names)
+            strs.push_back(to_str(n));
+        /* --- CRITICAL SECTION --- */
+    }
+
+    return _packStringsOrSize(strs, array_len, dest, dest_len, offsets, dest_needed);
+}
+
+const topic_set_type&
+_blockTopics(const TOSDBlock* db, topic_set_type& tmp)
+{
+    return (tmp = db->block->topics());
+}
+
+const str_set_type&
+_blockItems(const TOSDBlock* db, str_set_type& tmp)
+{
+    return (tmp = db->block->items());
+}
+
+const topic_set_type&
+_blockPreCachedTopics(const TOSDBlock* db, topic_set_type& tmp)
+{
+    return db->topic_precache;
+}
+
+const str_set_type&
+_blockPreCachedItems(const TOSDBlock* db, str_set_type& tmp)
+{
+    return db->item_precache;
+}
+
+std::string
+_topicName(TOS_Topics::TOPICS t)
+{
+    return TOS_Topics::map[t];
+}
+
+std::string
+_itemName(const std::string& item)
+{
+    return item;
+}
+
+}; /* namespace */
+
 size_type 
 TOSDB_GetBlockLimit()
 {   
@@ -79,8 +270,8 @@ TOSDB_GetBlockSize(LPCSTR id, size_type* pSize)
     } 
 }
 
-int 
-TOSDB_SetBlockSize(LPCSTR id, size_type sz)
+static int 
+TOSDB_SetBlockSize_(LPCSTR id, size_type sz)
 {
     if(!IsValidBlockID(id))
         return TOSDB_ERROR_BAD_INPUT;
@@ -112,6 +303,12 @@ TOSDB_SetBlockSize(LPCSTR id, size_type sz)
     } 
 }
 
+int
+TOSDB_SetBlockSize(LPCSTR id, size_type sz)
+{
+    return API_STAT_CALL(API_STAT_SET_BLOCK_SIZE, TOSDB_SetBlockSize_(id, sz));
+}
+
 int 
 TOSDB_GetItemCount(LPCSTR id, size_type* count)
 {
@@ -234,6 +431,31 @@ TOSDB_GetItemNames(LPCSTR id, LPSTR* dest, size_type array_len, size_type str_le
 }
 
 
+int
+TOSDB_GetTopicNamesPacked(LPCSTR id, 
+                          LPSTR dest, 
+                          size_type dest_len, 
+                          size_type* offsets, 
+                          size_type array_len, 
+                          size_type* dest_needed)
+{
+    return _getNamesPacked(id, _blockTopics, _topicName, dest, dest_len, offsets, 
+                           array_len, dest_needed);
+}
+
+int
+TOSDB_GetItemNamesPacked(LPCSTR id, 
+                         LPSTR dest, 
+                         size_type dest_len, 
+                         size_type* offsets, 
+                         size_type array_len, 
+                         size_type* dest_needed)
+{
+    return _getNamesPacked(id, _blockItems, _itemName, dest, dest_len, offsets, 
+                           array_len, dest_needed);
+}
+
+
 int 
 TOSDB_GetPreCachedItemCount(LPCSTR id, size_type* count)
 {
@@ -352,6 +574,30 @@ TOSDB_GetPreCachedItemNames(LPCSTR id, LPSTR* dest, size_type array_len, size_ty
 }
 
 
+int
+TOSDB_GetPreCachedTopicNamesPacked(LPCSTR id, 
+                                   LPSTR dest, 
+                                   size_type dest_len, 
+                                   size_type* offsets, 
+                                   size_type array_len, 
+                                   size_type* dest_needed)
+{
+    return _getNamesPacked(id, _blockPreCachedTopics, _topicName, dest, dest_len, offsets, 
+                           array_len, dest_needed);
+}
+
+int
+TOSDB_GetPreCachedItemNamesPacked(LPCSTR id, 
+                                  LPSTR dest, 
+                                  size_type dest_len, 
+                                  size_type* offsets, 
+                                  size_type array_len, 
+                                  size_type* dest_needed)
+{
+    return _getNamesPacked(id, _blockPreCachedItems, _itemName, dest, dest_len, offsets, 
+                           array_len, dest_needed);
+}
+
 int 
 TOSDB_GetTypeBits(LPCSTR topic_str, type_bits_type* type_bits)
 {
@@ -586,8 +832,8 @@ TOSDB_IsUsingDateTime(std::string id)
     /* --- CRITICAL SECTION --- */
 }
 
-int 
-TOSDB_GetStreamOccupancy(LPCSTR id, LPCSTR item, LPCSTR topic_str, size_type* sz)
+static int 
+TOSDB_GetStreamOccupancy_(LPCSTR id, LPCSTR item, LPCSTR topic_str, size_type* sz)
 {
     const TOSDBlock *db;  
     TOSDB_RawDataBlock::stream_const_ptr_type dat;
@@ -630,6 +876,12 @@ TOSDB_GetStreamOccupancy(LPCSTR id, LPCSTR item, LPCSTR topic_str, size_type* sz
     }  
 }
 
+int
+TOSDB_GetStreamOccupancy(LPCSTR id, LPCSTR item, LPCSTR topic_str, size_type* sz)
+{
+    return API_STAT_CALL(API_STAT_STREAM_INFO, TOSDB_GetStreamOccupancy_(id, item, topic_str, sz));
+}
+
 size_type 
 TOSDB_GetStreamOccupancy(std::string id, 
                          std::string item, 
@@ -654,8 +906,8 @@ TOSDB_GetStreamOccupancy(std::string id,
     /* --- CRITICAL SECTION --- */
 }
 
-int 
-TOSDB_GetMarkerPosition(LPCSTR id, LPCSTR item, LPCSTR topic_str, long long* pos)
+static int 
+TOSDB_GetMarkerPosition_(LPCSTR id, LPCSTR item, LPCSTR topic_str, long long* pos)
 {
     const TOSDBlock *db;
     TOSDB_RawDataBlock::stream_const_ptr_type dat;
@@ -698,6 +950,12 @@ TOSDB_GetMarkerPosition(LPCSTR id, LPCSTR item, LPCSTR topic_str, long long* pos
     } 
 }
 
+int
+TOSDB_GetMarkerPosition(LPCSTR id, LPCSTR item, LPCSTR topic_str, long long* pos)
+{
+    return API_STAT_CALL(API_STAT_STREAM_INFO, TOSDB_GetMarkerPosition_(id, item, topic_str, pos));
+}
+
 long long 
 TOSDB_GetMarkerPosition(std::string id, 
                         std::string item, 
@@ -721,11 +979,11 @@ TOSDB_GetMarkerPosition(std::string id,
     /* --- CRITICAL SECTION --- */
 }
 
-int 
-TOSDB_IsMarkerDirty(LPCSTR id,
-                    LPCSTR item, 
-                    LPCSTR topic_str, 
-                    unsigned int* is_dirty)
+static int 
+TOSDB_IsMarkerDirty_(LPCSTR id,
+                     LPCSTR item, 
+                     LPCSTR topic_str, 
+                     unsigned int* is_dirty)
 {
     const TOSDBlock *db;
     TOSDB_RawDataBlock::stream_const_ptr_type dat;
@@ -768,6 +1026,15 @@ TOSDB_IsMarkerDirty(LPCSTR id,
     }  
 }
 
+int
+TOSDB_IsMarkerDirty(LPCSTR id,
+                    LPCSTR item, 
+                    LPCSTR topic_str, 
+                    unsigned int* is_dirty)
+{
+    return API_STAT_CALL(API_STAT_STREAM_INFO, TOSDB_IsMarkerDirty_(id, item, topic_str, is_dirty));
+}
+
 bool 
 TOSDB_IsMarkerDirty(std::string id, 
                     std::string item, 
@@ -882,14 +1149,14 @@ TOSDB_Get(std::string id,
     return GRetType<T,b>()(tmp, std::move(datetime));  
 }
 
-template<typename T> 
-int 
+template<typename T, typename SecOutTy> 
+static int 
 TOSDB_Get_(std::string id, 
            std::string item, 
            TOS_Topics::TOPICS topic_t, 
            long indx, 
            T* dest, 
-           pDateTimeStamp datetime)
+           SecOutTy datetime)
 {   
     const TOSDBlock *db;
     TOSDB_RawDataBlock::stream_const_ptr_type dat; 
@@ -920,14 +1187,14 @@ TOSDB_Get_(std::string id,
     }
 }
 
-template<typename T> 
-int 
+template<typename T, typename SecOutTy> 
+static int 
 TOSDB_Get_(LPCSTR id, 
            LPCSTR item, 
            LPCSTR topic_str, 
            long indx, 
            T* dest, 
-           pDateTimeStamp datetime)
+           SecOutTy datetime)
 { 
     if( !IsValidBlockID(id) 
         || !CheckStringLength(item)
@@ -951,7 +1218,7 @@ TOSDB_GetDouble(LPCSTR id,
                 ext_price_type* dest, 
                 pDateTimeStamp datetime)
 {  
-    return TOSDB_Get_(id, item, topic_str , indx, dest, datetime);
+    return API_STAT_CALL(API_STAT_GET, TOSDB_Get_(id, item, topic_str , indx, dest, datetime));
 }
 
 int 
@@ -962,7 +1229,7 @@ TOSDB_GetFloat(LPCSTR id,
                def_price_type* dest, 
                pDateTimeStamp datetime)
 {
-    return TOSDB_Get_(id, item, topic_str , indx, dest, datetime);
+    return API_STAT_CALL(API_STAT_GET, TOSDB_Get_(id, item, topic_str , indx, dest, datetime));
 }
 
 int 
@@ -973,7 +1240,7 @@ TOSDB_GetLongLong(LPCSTR id,
                   ext_size_type* dest, 
                   pDateTimeStamp datetime)
 {
-    return TOSDB_Get_(id, item, topic_str , indx, dest, datetime);
+    return API_STAT_CALL(API_STAT_GET, TOSDB_Get_(id, item, topic_str , indx, dest, datetime));
 }
 
 int 
@@ -984,17 +1251,18 @@ TOSDB_GetLong(LPCSTR id,
               def_size_type* dest, 
               pDateTimeStamp datetime)
 {
-    return TOSDB_Get_(id, item, topic_str , indx, dest, datetime);
-}
-
-int 
-TOSDB_GetString(LPCSTR id, 
-                LPCSTR item, 
-                LPCSTR topic_str, 
-                long indx, 
-                LPSTR dest, 
-                size_type str_len, 
-                pDateTimeStamp datetime)
+    return API_STAT_CALL(API_STAT_GET, TOSDB_Get_(id, item, topic_str , indx, dest, datetime));
+}
+
+template<typename SecOutTy>
+static int 
+TOSDB_GetString_(LPCSTR id, 
+                 LPCSTR item, 
+                 LPCSTR topic_str, 
+                 long indx, 
+                 LPSTR dest, 
+                 size_type str_len, 
+                 SecOutTy datetime)
 {  
     const TOSDBlock *db;
     TOSDB_RawDataBlock::stream_const_ptr_type dat;
@@ -1037,6 +1305,19 @@ TOSDB_GetString(LPCSTR id,
     } 
 }
 
+int
+TOSDB_GetString(LPCSTR id, 
+                LPCSTR item, 
+                LPCSTR topic_str, 
+                long indx, 
+                LPSTR dest, 
+                size_type str_len, 
+                pDateTimeStamp datetime)
+{
+    return API_STAT_CALL(API_STAT_GET,
+        TOSDB_GetString_(id, item, topic_str, indx, dest, str_len, datetime));
+}
+
 template<> 
 generic_vector_type 
 TOSDB_GetStreamSnapshot<generic_type, false>(std::string id, 
@@ -1184,14 +1465,17 @@ TOSDB_GetStreamSnapshot(std::string id,
     /* --- CRITICAL SECTION --- */
 }
 
-template<typename T> 
-int 
+/* 'datetime': a pDateTimeStamp, or an epoch_micro_as for stamps the stream
+   converts as it copies them (the WithEpoch calls); the same for the other 
+   SecOutTy's below */
+template<typename T, typename SecOutTy> 
+static int 
 TOSDB_GetStreamSnapshot_(LPCSTR id,
                          LPCSTR item, 
                          TOS_Topics::TOPICS topic_t, 
                          T* dest, 
                          size_type array_len, 
-                         pDateTimeStamp datetime, 
+                         SecOutTy datetime, 
                          long end, 
                          long beg)
 {
@@ -1229,14 +1513,14 @@ TOSDB_GetStreamSnapshot_(LPCSTR id,
     }
 }
 
-template<typename T> 
-int 
+template<typename T, typename SecOutTy> 
+static int 
 TOSDB_GetStreamSnapshot_(LPCSTR id,
                          LPCSTR item, 
                          LPCSTR topic_str, 
                          T* dest, 
                          size_type array_len, 
-                         pDateTimeStamp datetime, 
+                         SecOutTy datetime, 
                          long end, 
                          long beg)
 {  
@@ -1260,8 +1544,9 @@ TOSDB_GetStreamSnapshotDoubles(LPCSTR id,
                                long end, 
                                long beg)
 {
-    return TOSDB_GetStreamSnapshot_(id, item, topic_str, dest, array_len, 
-                                    datetime, end, beg);
+    return API_STAT_CALL(API_STAT_SNAPSHOT,
+        TOSDB_GetStreamSnapshot_(id, item, topic_str, dest, array_len, 
+                                 datetime, end, beg));
 }
 
 int 
@@ -1274,8 +1559,9 @@ TOSDB_GetStreamSnapshotFloats(LPCSTR id,
                               long end, 
                               long beg)
 {
-    return TOSDB_GetStreamSnapshot_(id, item, topic_str, dest, array_len, 
-                                    datetime, end, beg);
+    return API_STAT_CALL(API_STAT_SNAPSHOT,
+        TOSDB_GetStreamSnapshot_(id, item, topic_str, dest, array_len, 
+                                 datetime, end, beg));
 }
 
 int 
@@ -1288,8 +1574,9 @@ TOSDB_GetStreamSnapshotLongLongs(LPCSTR id,
                                  long end, 
                                  long beg)
 {
-    return TOSDB_GetStreamSnapshot_(id, item, topic_str, dest, array_len, 
-                                    datetime, end, beg);  
+    return API_STAT_CALL(API_STAT_SNAPSHOT,
+        TOSDB_GetStreamSnapshot_(id, item, topic_str, dest, array_len, 
+                                 datetime, end, beg));  
 }
 
 int 
@@ -1302,43 +1589,133 @@ TOSDB_GetStreamSnapshotLongs(LPCSTR id,
                              long end, 
                              long beg)
 { 
-    return TOSDB_GetStreamSnapshot_(id, item, topic_str, dest, array_len, 
-                                    datetime, end, beg);  
+    return API_STAT_CALL(API_STAT_SNAPSHOT,
+        TOSDB_GetStreamSnapshot_(id, item, topic_str, dest, array_len, 
+                                 datetime, end, beg));  
 }
 
-int 
-TOSDB_GetStreamSnapshotStrings(LPCSTR id, 
-                               LPCSTR item, 
-                               LPCSTR topic_str, 
-                               LPSTR* dest, 
-                               size_type array_len, 
-                               size_type str_len, 
-                               pDateTimeStamp datetime, 
-                               long end, 
-                               long beg)
+template<typename T> 
+static int 
+TOSDB_GetStreamSnapshotToBuffers_(LPCSTR id,
+                                  LPCSTR item, 
+                                  TOS_Topics::TOPICS topic_t, 
+                                  T* dest, 
+                                  size_type array_len, 
+                                  long long* epoch_micro, 
+                                  long end, 
+                                  long beg)
+{
+    if(!epoch_micro)
+        return TOSDB_GetStreamSnapshot_(id, item, topic_t, dest, array_len, nullptr, end, beg);
+
+    /* the stream converts each stamp as it copies it: no DateTimeStamp array */
+    _EpochMicroConverter to_micro;
+    return TOSDB_GetStreamSnapshot_(id, item, topic_t, dest, array_len, 
+                                    to_micro.into(epoch_micro, array_len), end, beg);
+}
+
+static int 
+TOSDB_GetStreamSnapshotToBuffers_(LPCSTR id, 
+                                  LPCSTR item, 
+                                  LPCSTR topic_str, 
+                                  void* dest, 
+                                  size_type array_len, 
+                                  long long* epoch_micro, 
+                                  long end, 
+                                  long beg)
+{
+    if(!dest || !CheckStringLength(topic_str))
+        return TOSDB_ERROR_BAD_INPUT;   
+   
+    TOS_Topics::TOPICS t = GetTopicEnum(topic_str);
+    if(t == TOS_Topics::TOPICS::NULL_TOPIC)
+        return TOSDB_ERROR_BAD_TOPIC;
+
+    switch( TOS_Topics::TypeBits(t) ){
+    case TOSDB_STRING_BIT:
+        return TOSDB_ERROR_BAD_INPUT; /* not fixed-size; use GetStreamSnapshotStrings */
+    case TOSDB_INTGR_BIT | TOSDB_QUAD_BIT:
+        return TOSDB_GetStreamSnapshotToBuffers_(id, item, t, (ext_size_type*)dest, array_len,
+                                                 epoch_micro, end, beg);
+    case TOSDB_INTGR_BIT:
+        return TOSDB_GetStreamSnapshotToBuffers_(id, item, t, (def_size_type*)dest, array_len,
+                                                 epoch_micro, end, beg);
+    case TOSDB_QUAD_BIT:
+        return TOSDB_GetStreamSnapshotToBuffers_(id, item, t, (ext_price_type*)dest, array_len,
+                                                 epoch_micro, end, beg);
+    default:
+        return TOSDB_GetStreamSnapshotToBuffers_(id, item, t, (def_price_type*)dest, array_len,
+                                                 epoch_micro, end, beg);
+    }
+}
+
+int
+TOSDB_GetStreamSnapshotToBuffers(LPCSTR id, 
+                                 LPCSTR item, 
+                                 LPCSTR topic_str, 
+                                 void* dest, 
+                                 size_type array_len, 
+                                 long long* epoch_micro, 
+                                 long end, 
+                                 long beg)
+{
+    return API_STAT_CALL(API_STAT_SNAPSHOT_TO_BUFFERS,
+        TOSDB_GetStreamSnapshotToBuffers_(id, item, topic_str, dest, array_len, epoch_micro, end,
+                                          beg));
+}
+
+template<typename T>
+static int
+TOSDB_GetStreamSnapshotsToBuffers_(LPCSTR id,
+                                   LPCSTR* items,
+                                   size_type nitems,
+                                   TOS_Topics::TOPICS topic_t,
+                                   T* dest,
+                                   size_type array_len,
+                                   long long* epoch_micro,
+                                   size_type* offsets,
+                                   long end,
+                                   long beg)
 {
     const TOSDBlock *db;
     TOSDB_RawDataBlock::stream_const_ptr_type dat;
-    TOS_Topics::TOPICS topic_t;
+    size_type off = 0;
 
-    if( !IsValidBlockID(id) 
-        || !CheckStringLength(item)
-        || !CheckStringLength(topic_str) )
-    {
+    if(!IsValidBlockID(id) || !items || !offsets)
         return TOSDB_ERROR_BAD_INPUT;
+
+    for(size_type i = 0; i < nitems; ++i){
+        if(!items[i] || !CheckStringLength(items[i]))
+            return TOSDB_ERROR_BAD_INPUT;
     }
 
-    topic_t = GetTopicEnum(topic_str);
-    if(topic_t == TOS_Topics::TOPICS::NULL_TOPIC)
-        return TOSDB_ERROR_BAD_TOPIC;
+    std::vector<DateTimeStamp> dts(epoch_micro ? array_len + 1 : 0);
+    pDateTimeStamp pdts = epoch_micro ? &dts[0] : nullptr;
 
     try{
         GLOBAL_RLOCK_GUARD;
         /* --- CRITICAL SECTION --- */
         db = GetBlockOrThrow(id);
-        dat = db->block->raw_stream_ptr(item, topic_t);
-        dat->copy(dest,array_len,str_len,end,beg,datetime);
-        return 0;
+
+        long bsz = (long)db->block->block_size();
+        if(end < 0)
+            end += bsz;
+        if(beg < 0)
+            beg += bsz;
+        if(beg < 0 || end < beg || end >= bsz)
+            return TOSDB_ERROR_BAD_INPUT;
+
+        /* room for every stream full, so no stream gets cut short */
+        if((unsigned long long)(end - beg + 1) * nitems > array_len)
+            return TOSDB_ERROR_BAD_INPUT_BUFFER;
+
+        for(size_type i = 0; i < nitems; ++i){
+            offsets[i] = off;
+            dat = db->block->raw_stream_ptr(items[i], topic_t);
+            off += (size_type)dat->copy(dest + off, array_len - off, end, beg,
+                                        pdts ? pdts + off : nullptr);
+        }
+        offsets[nitems] = off;
         /* --- CRITICAL SECTION --- */
 
     }catch(const TOSDB_DataBlockDoesntExist& e){
@@ -1350,41 +1727,119 @@ TOSDB_GetStreamSnapshotStrings(LPCSTR id,
         return TOSDB_ERROR_GET_DATA;
 
     }catch(const std::exception& e){
-        TOSDB_LogH("TOSDB_GetStreamSnapshotStrings", e.what());
+        TOSDB_LogH("GetStreamSnapshotsToBuffers<T>", e.what());
         return TOSDB_ERROR_GET_DATA;
 
-    }catch(...){ 
+    }catch(...){
         return TOSDB_ERROR_UNKNOWN;
     }
+
+    /* outside the lock */
+    if(epoch_micro)
+        DateTimeStampsToEpochMicro(pdts, off, epoch_micro);
+
+    return 0;
 }
 
-template<typename T> 
-int 
-TOSDB_GetStreamSnapshotFromMarker_(LPCSTR id,
-                                   LPCSTR item, 
-                                   TOS_Topics::TOPICS topic_t, 
-                                   T* dest, 
-                                   size_type array_len, 
-                                   pDateTimeStamp datetime,                     
-                                   long beg,
-                                   long *get_size)
+static int
+TOSDB_GetStreamSnapshotsToBuffers_(LPCSTR id,
+                                   LPCSTR* items,
+                                   size_type nitems,
+                                   LPCSTR topic_str,
+                                   void* dest,
+                                   size_type array_len,
+                                   long long* epoch_micro,
+                                   size_type* offsets,
+                                   long end,
+                                   long beg)
+{
+    if(!dest || !CheckStringLength(topic_str))
+        return TOSDB_ERROR_BAD_INPUT;
+
+    TOS_Topics::TOPICS t = GetTopicEnum(topic_str);
+    if(t == TOS_Topics::TOPICS::NULL_TOPIC)
+        return TOSDB_ERROR_BAD_TOPIC;
+
+    switch( TOS_Topics::TypeBits(t) ){
+    case TOSDB_STRING_BIT:
+        return TOSDB_ERROR_BAD_INPUT;
+    case TOSDB_INTGR_BIT | TOSDB_QUAD_BIT:
+        return TOSDB_GetStreamSnapshotsToBuffers_(id, items, nitems, t, (ext_size_type*)dest,
+                                                  array_len, epoch_micro, offsets, end, beg);
+    case TOSDB_INTGR_BIT:
+        return TOSDB_GetStreamSnapshotsToBuffers_(id, items, nitems, t, (def_size_type*)dest,
+                                                  array_len, epoch_micro, offsets, end, beg);
+    case TOSDB_QUAD_BIT:
+        return TOSDB_GetStreamSnapshotsToBuffers_(id, items, nitems, t, (ext_price_type*)dest,
+                                                  array_len, epoch_micro, offsets, end, beg);
+    default:
+        return TOSDB_GetStreamSnapshotsToBuffers_(id, items, nitems, t, (def_price_type*)dest,
+                                                  array_len, epoch_micro, offsets, end, beg);
+    }
+}
+
+int
+TOSDB_GetStreamSnapshotsToBuffers(LPCSTR id,
+                                  LPCSTR* items,
+                                  size_type nitems,
+                                  LPCSTR topic_str,
+                                  void* dest,
+                                  size_type array_len,
+                                  long long* epoch_micro,
+                                  size_type* offsets,
+                                  long end,
+                                  long beg)
+{
+    return API_STAT_CALL(API_STAT_SNAPSHOT_TO_BUFFERS,
+        TOSDB_GetStreamSnapshotsToBuffers_(id, items, nitems, topic_str, dest, array_len,
+                                           epoch_micro, offsets, end, beg));
+}
+
+static int
+TOSDB_GetStreamSnapshotSampled_(LPCSTR id,
+                                LPCSTR item,
+                                LPCSTR topic_str,
+                                double* dest,
+                                size_type array_len,
+                                long long* epoch_micro,
+                                size_type stride, /* 0: decimate */
+                                long end,
+                                long beg,
+                                size_type* get_size)
 {
     const TOSDBlock *db;
     TOSDB_RawDataBlock::stream_const_ptr_type dat;
+    size_t n;
 
-    if(!IsValidBlockID(id) || !CheckStringLength(item))
+    if( !dest 
+        || !get_size 
+        || !IsValidBlockID(id) 
+        || !CheckStringLength(item) 
+        || !CheckStringLength(topic_str) )
     {
         return TOSDB_ERROR_BAD_INPUT;
     }
 
+    TOS_Topics::TOPICS t = GetTopicEnum(topic_str);
+    if(t == TOS_Topics::TOPICS::NULL_TOPIC)
+        return TOSDB_ERROR_BAD_TOPIC;
+
+    if(TOS_Topics::TypeBits(t) == TOSDB_STRING_BIT)
+        return TOSDB_ERROR_BAD_INPUT;
+
+    if(!stride && array_len < 4)
+        return TOSDB_ERROR_BAD_INPUT_BUFFER;
+
+    std::vector<DateTimeStamp> dts(epoch_micro ? array_len + 1 : 0);
+    pDateTimeStamp pdts = epoch_micro ? &dts[0] : nullptr;
+
     try{
         GLOBAL_RLOCK_GUARD;
         /* --- CRITICAL SECTION --- */
         db = GetBlockOrThrow(id);
-        dat = db->block->raw_stream_ptr(item, topic_t);
-                   /* O.K. as long as data_stream::MAX_BOUND_SIZE == INT_MAX */
-        *get_size = (long)(dat->copy_from_marker(dest,array_len,beg,datetime));
-        return 0;
+        dat = db->block->raw_stream_ptr(item, t);
+        n = stride ? dat->copy_strided(dest, array_len, stride, end, beg, pdts)
+                   : dat->copy_decimated(dest, array_len, end, beg, pdts);
         /* --- CRITICAL SECTION --- */
 
     }catch(const TOSDB_DataBlockDoesntExist& e){
@@ -1396,22 +1851,254 @@ TOSDB_GetStreamSnapshotFromMarker_(LPCSTR id,
         return TOSDB_ERROR_GET_DATA;
 
     }catch(const std::exception& e){
-        TOSDB_LogH("GetStreamSnapshotFromMarker<T>", e.what());
+        TOSDB_LogH("GetStreamSnapshotSampled", e.what());
         return TOSDB_ERROR_GET_DATA;
 
-    }catch(...){ 
+    }catch(...){
         return TOSDB_ERROR_UNKNOWN;
     }
+
+    /* outside the lock */
+    if(epoch_micro)
+        DateTimeStampsToEpochMicro(pdts, (size_type)n, epoch_micro);
+
+    *get_size = (size_type)n;
+    return 0;
 }
 
-template<typename T> 
-int 
-TOSDB_GetStreamSnapshotFromMarker_(LPCSTR id,
-                                   LPCSTR item, 
-                                   LPCSTR topic_str, 
+int
+TOSDB_GetStreamSnapshotStrided(LPCSTR id,
+                               LPCSTR item,
+                               LPCSTR topic_str,
+                               double* dest,
+                               size_type array_len,
+                               long long* epoch_micro,
+                               size_type stride,
+                               long end,
+                               long beg,
+                               size_type* get_size)
+{
+    return API_STAT_CALL(API_STAT_SNAPSHOT_SAMPLED,
+        stride ? TOSDB_GetStreamSnapshotSampled_(id, item, topic_str, dest, array_len, epoch_micro,
+                                                 stride, end, beg, get_size)
+               : TOSDB_ERROR_BAD_INPUT);
+}
+
+int
+TOSDB_GetStreamSnapshotDecimated(LPCSTR id,
+                                 LPCSTR item,
+                                 LPCSTR topic_str,
+                                 double* dest,
+                                 size_type array_len,
+                                 long long* epoch_micro,
+                                 long end,
+                                 long beg,
+                                 size_type* get_size)
+{
+    return API_STAT_CALL(API_STAT_SNAPSHOT_SAMPLED,
+        TOSDB_GetStreamSnapshotSampled_(id, item, topic_str, dest, array_len, epoch_micro,
+                                        0, end, beg, get_size));
+}
+
+template<typename SecOutTy>
+static int 
+TOSDB_GetStreamSnapshotStrings_(LPCSTR id, 
+                                LPCSTR item, 
+                                LPCSTR topic_str, 
+                                LPSTR* dest, 
+                                size_type array_len, 
+                                size_type str_len, 
+                                SecOutTy datetime, 
+                                long end, 
+                                long beg)
+{
+    const TOSDBlock *db;
+    TOSDB_RawDataBlock::stream_const_ptr_type dat;
+    TOS_Topics::TOPICS topic_t;
+
+    if( !IsValidBlockID(id) 
+        || !CheckStringLength(item)
+        || !CheckStringLength(topic_str) )
+    {
+        return TOSDB_ERROR_BAD_INPUT;
+    }
+
+    topic_t = GetTopicEnum(topic_str);
+    if(topic_t == TOS_Topics::TOPICS::NULL_TOPIC)
+        return TOSDB_ERROR_BAD_TOPIC;
+
+    try{
+        GLOBAL_RLOCK_GUARD;
+        /* --- CRITICAL SECTION --- */
+        db = GetBlockOrThrow(id);
+        dat = db->block->raw_stream_ptr(item, topic_t);
+        dat->copy(dest,array_len,str_len,end,beg,datetime);
+        return 0;
+        /* --- CRITICAL SECTION --- */
+
+    }catch(const TOSDB_DataBlockDoesntExist& e){
+        TOSDB_LogH("BLOCK", e.what());
+        return TOSDB_ERROR_BLOCK_DOESNT_EXIST;
+
+    }catch(const TOSDB_Error& e){
+        TOSDB_LogH(e.tag().c_str(), e.info_and_what().c_str());
+        return TOSDB_ERROR_GET_DATA;
+
+    }catch(const std::exception& e){
+        TOSDB_LogH("TOSDB_GetStreamSnapshotStrings", e.what());
+        return TOSDB_ERROR_GET_DATA;
+
+    }catch(...){ 
+        return TOSDB_ERROR_UNKNOWN;
+    }
+}
+
+int
+TOSDB_GetStreamSnapshotStrings(LPCSTR id, 
+                               LPCSTR item, 
+                               LPCSTR topic_str, 
+                               LPSTR* dest, 
+                               size_type array_len, 
+                               size_type str_len, 
+                               pDateTimeStamp datetime, 
+                               long end, 
+                               long beg)
+{
+    return API_STAT_CALL(API_STAT_SNAPSHOT,
+        TOSDB_GetStreamSnapshotStrings_(id, item, topic_str, dest, array_len, str_len, datetime,
+                                        end, beg));
+}
+
+template<typename SecOutTy>
+static int
+TOSDB_GetStreamSnapshotStringsPacked_(LPCSTR id, 
+                                      LPCSTR item, 
+                                      LPCSTR topic_str, 
+                                      LPSTR dest, 
+                                      size_type dest_len, 
+                                      size_type* offsets, 
+                                      size_type array_len, 
+                                      size_type* dest_needed,
+                                      SecOutTy datetime, 
+                                      long end, 
+                                      long beg)
+{
+    const TOSDBlock *db;
+    TOSDB_RawDataBlock::stream_const_ptr_type dat;
+    TOS_Topics::TOPICS topic_t;
+
+    if( !IsValidBlockID(id) 
+        || !CheckStringLength(item)
+        || !CheckStringLength(topic_str) 
+        || array_len == 0 )
+    {
+        return TOSDB_ERROR_BAD_INPUT;
+    }
+
+    topic_t = GetTopicEnum(topic_str);
+    if(topic_t == TOS_Topics::TOPICS::NULL_TOPIC)
+        return TOSDB_ERROR_BAD_TOPIC;
+
+    std::vector<std::string> strs(array_len);
+    try{
+        GLOBAL_RLOCK_GUARD;
+        /* --- CRITICAL SECTION --- */
+        db = GetBlockOrThrow(id);
+        dat = db->block->raw_stream_ptr(item, topic_t);
+        strs.resize( dat->copy(&strs[0], array_len, end, beg, datetime) );
+        /* --- CRITICAL SECTION --- */
+
+    }catch(const TOSDB_DataBlockDoesntExist& e){
+        TOSDB_LogH("BLOCK", e.what());
+        return TOSDB_ERROR_BLOCK_DOESNT_EXIST;
+
+    }catch(const TOSDB_Error& e){
+        TOSDB_LogH(e.tag().c_str(), e.info_and_what().c_str());
+        return TOSDB_ERROR_GET_DATA;
+
+    }catch(const std::exception& e){
+        TOSDB_LogH("TOSDB_GetStreamSnapshotStringsPacked", e.what());
+        return TOSDB_ERROR_GET_DATA;
+
+    }catch(...){ 
+        return TOSDB_ERROR_UNKNOWN;
+    }
+
+    return _packStringsOrSize(strs, array_len, dest, dest_len, offsets, dest_needed);
+}
+
+int
+TOSDB_GetStreamSnapshotStringsPacked(LPCSTR id, 
+                                     LPCSTR item, 
+                                     LPCSTR topic_str, 
+                                     LPSTR dest, 
+                                     size_type dest_len, 
+                                     size_type* offsets, 
+                                     size_type array_len, 
+                                     size_type* dest_needed,
+                                     pDateTimeStamp datetime, 
+                                     long end, 
+                                     long beg)
+{
+    return API_STAT_CALL(API_STAT_SNAPSHOT,
+        TOSDB_GetStreamSnapshotStringsPacked_(id, item, topic_str, dest, dest_len, offsets,
+                                              array_len, dest_needed, datetime, end, beg));
+}
+
+template<typename T, typename SecOutTy> 
+static int 
+TOSDB_GetStreamSnapshotFromMarker_(LPCSTR id,
+                                   LPCSTR item, 
+                                   TOS_Topics::TOPICS topic_t, 
                                    T* dest, 
                                    size_type array_len, 
-                                   pDateTimeStamp datetime,               
+                                   SecOutTy datetime,                     
+                                   long beg,
+                                   long *get_size)
+{
+    const TOSDBlock *db;
+    TOSDB_RawDataBlock::stream_const_ptr_type dat;
+
+    if(!IsValidBlockID(id) || !CheckStringLength(item))
+    {
+        return TOSDB_ERROR_BAD_INPUT;
+    }
+
+    try{
+        GLOBAL_RLOCK_GUARD;
+        /* --- CRITICAL SECTION --- */
+        db = GetBlockOrThrow(id);
+        dat = db->block->raw_stream_ptr(item, topic_t);
+                   /* O.K. as long as data_stream::MAX_BOUND_SIZE == INT_MAX */
+        *get_size = (long)(dat->copy_from_marker(dest,array_len,beg,datetime));
+        return 0;
+        /* --- CRITICAL SECTION --- */
+
+    }catch(const TOSDB_DataBlockDoesntExist& e){
+        TOSDB_LogH("BLOCK", e.what());
+        return TOSDB_ERROR_BLOCK_DOESNT_EXIST;
+
+    }catch(const TOSDB_Error& e){
+        TOSDB_LogH(e.tag().c_str(), e.info_and_what().c_str());
+        return TOSDB_ERROR_GET_DATA;
+
+    }catch(const std::exception& e){
+        TOSDB_LogH("GetStreamSnapshotFromMarker<T>", e.what());
+        return TOSDB_ERROR_GET_DATA;
+
+    }catch(...){ 
+        return TOSDB_ERROR_UNKNOWN;
+    }
+}
+
+template<typename T, typename SecOutTy> 
+static int 
+TOSDB_GetStreamSnapshotFromMarker_(LPCSTR id,
+                                   LPCSTR item, 
+                                   LPCSTR topic_str, 
+                                   T* dest, 
+                                   size_type array_len, 
+                                   SecOutTy datetime,               
                                    long beg,
                                    long *get_size)
 {  
@@ -1435,8 +2122,9 @@ TOSDB_GetStreamSnapshotDoublesFromMarker(LPCSTR id,
                                          long beg,
                                          long *get_size)
 {
-    return TOSDB_GetStreamSnapshotFromMarker_(id, item, topic_str, dest, array_len, 
-                                              datetime, beg, get_size);
+    return API_STAT_CALL(API_STAT_SNAPSHOT_FROM_MARKER,
+        TOSDB_GetStreamSnapshotFromMarker_(id, item, topic_str, dest, array_len, 
+                                           datetime, beg, get_size));
 }
 
 int 
@@ -1449,8 +2137,9 @@ TOSDB_GetStreamSnapshotFloatsFromMarker(LPCSTR id,
                                         long beg,
                                         long *get_size)
 {
-    return TOSDB_GetStreamSnapshotFromMarker_(id, item, topic_str, dest, array_len, 
-                                              datetime, beg, get_size);
+    return API_STAT_CALL(API_STAT_SNAPSHOT_FROM_MARKER,
+        TOSDB_GetStreamSnapshotFromMarker_(id, item, topic_str, dest, array_len, 
+                                           datetime, beg, get_size));
 }
 
 int 
@@ -1463,8 +2152,9 @@ TOSDB_GetStreamSnapshotLongLongsFromMarker(LPCSTR id,
                                            long beg,
                                            long *get_size)
 {
-    return TOSDB_GetStreamSnapshotFromMarker_(id, item, topic_str, dest, array_len, 
-                                              datetime, beg, get_size);  
+    return API_STAT_CALL(API_STAT_SNAPSHOT_FROM_MARKER,
+        TOSDB_GetStreamSnapshotFromMarker_(id, item, topic_str, dest, array_len, 
+                                           datetime, beg, get_size));  
 }
 
 int 
@@ -1477,20 +2167,22 @@ TOSDB_GetStreamSnapshotLongsFromMarker(LPCSTR id,
                                        long beg,
                                        long *get_size)
 {
-    return TOSDB_GetStreamSnapshotFromMarker_(id, item, topic_str, dest, array_len, 
-                                              datetime, beg, get_size);  
-}
-
-int 
-TOSDB_GetStreamSnapshotStringsFromMarker(LPCSTR id, 
-                                         LPCSTR item, 
-                                         LPCSTR topic_str, 
-                                         LPSTR* dest, 
-                                         size_type array_len, 
-                                         size_type str_len, 
-                                         pDateTimeStamp datetime,                         
-                                         long beg,
-                                         long *get_size)
+    return API_STAT_CALL(API_STAT_SNAPSHOT_FROM_MARKER,
+        TOSDB_GetStreamSnapshotFromMarker_(id, item, topic_str, dest, array_len, 
+                                           datetime, beg, get_size));  
+}
+
+template<typename SecOutTy>
+static int 
+TOSDB_GetStreamSnapshotStringsFromMarker_(LPCSTR id, 
+                                          LPCSTR item, 
+                                          LPCSTR topic_str, 
+                                          LPSTR* dest, 
+                                          size_type array_len, 
+                                          size_type str_len, 
+                                          SecOutTy datetime,                         
+                                          long beg,
+                                          long *get_size)
 {
     const TOSDBlock *db;
     TOSDB_RawDataBlock::stream_const_ptr_type dat;
@@ -1534,6 +2226,22 @@ TOSDB_GetStreamSnapshotStringsFromMarker(LPCSTR id,
     }
 }
 
+int
+TOSDB_GetStreamSnapshotStringsFromMarker(LPCSTR id, 
+                                         LPCSTR item, 
+                                         LPCSTR topic_str, 
+                                         LPSTR* dest, 
+                                         size_type array_len, 
+                                         size_type str_len, 
+                                         pDateTimeStamp datetime,                         
+                                         long beg,
+                                         long *get_size)
+{
+    return API_STAT_CALL(API_STAT_SNAPSHOT_FROM_MARKER,
+        TOSDB_GetStreamSnapshotStringsFromMarker_(id, item, topic_str, dest, array_len, str_len,
+                                                  datetime, beg, get_size));
+}
+
 template<> 
 generic_map_type 
 TOSDB_GetItemFrame<false>(std::string id, TOS_Topics::TOPICS topic_t)
@@ -1566,15 +2274,15 @@ TOSDB_GetItemFrame<true>(std::string id, TOS_Topics::TOPICS topic_t)
     /* --- CRITICAL SECTION --- */
 }
 
-template<typename T> 
-int 
+template<typename T, typename SecOutTy> 
+static int 
 TOSDB_GetItemFrame_(LPCSTR id, 
                     TOS_Topics::TOPICS topic_t, 
                     T* dest, 
                     size_type array_len, 
                     LPSTR* dest2, 
                     size_type str_len2, 
-                    pDateTimeStamp datetime)
+                    SecOutTy datetime)
 {
     const TOSDBlock *db;
   
@@ -1591,7 +2299,7 @@ TOSDB_GetItemFrame_(LPCSTR id,
         /* --- CRITICAL SECTION --- */
         db = GetBlockOrThrow(id);
 
-        if(datetime){  
+        if(_wantsStamps(datetime)){  
             auto dtsm = db->block->pair_map_of_frame_items(topic_t);
             auto b_iter = dtsm.cbegin();
             auto e_iter = dtsm.cend();
@@ -1601,7 +2309,7 @@ TOSDB_GetItemFrame_(LPCSTR id,
                  ++b_iter, ++i )
             {
                 dest[i] = (T)b_iter->second.first;
-                datetime[i] = b_iter->second.second;
+                _putStamp(datetime, i, b_iter->second.second);
                 if(dest2){
                     if( strcpy_s(dest2[i], str_len2, (b_iter->first).c_str()) )
                         return TOSDB_ERROR_BAD_INPUT_BUFFER;
@@ -1644,15 +2352,15 @@ TOSDB_GetItemFrame_(LPCSTR id,
   return 0;
 }
 
-template<typename T> 
-int 
+template<typename T, typename SecOutTy> 
+static int 
 TOSDB_GetItemFrame_(LPCSTR id, 
                     LPCSTR topic_str, 
                     T* dest, 
                     size_type array_len, 
                     LPSTR* dest2, 
                     size_type str_len2, 
-                    pDateTimeStamp datetime)
+                    SecOutTy datetime)
 {  
     if(!CheckStringLength(topic_str))
         return TOSDB_ERROR_BAD_INPUT;   
@@ -1673,8 +2381,9 @@ TOSDB_GetItemFrameDoubles(LPCSTR id,
                           size_type label_str_len, 
                           pDateTimeStamp datetime)
 {
-    return TOSDB_GetItemFrame_(id, topic_str, dest, array_len, label_dest, 
-                               label_str_len, datetime);    
+    return API_STAT_CALL(API_STAT_ITEM_FRAME,
+        TOSDB_GetItemFrame_(id, topic_str, dest, array_len, label_dest, 
+                            label_str_len, datetime));    
 }
 
 int 
@@ -1686,8 +2395,9 @@ TOSDB_GetItemFrameFloats(LPCSTR id,
                          size_type label_str_len, 
                          pDateTimeStamp datetime)
 {
-    return TOSDB_GetItemFrame_(id, topic_str, dest, array_len, label_dest, 
-                               label_str_len, datetime);      
+    return API_STAT_CALL(API_STAT_ITEM_FRAME,
+        TOSDB_GetItemFrame_(id, topic_str, dest, array_len, label_dest, 
+                            label_str_len, datetime));      
 }
 
 int 
@@ -1699,8 +2409,9 @@ TOSDB_GetItemFrameLongLongs(LPCSTR id,
                             size_type label_str_len, 
                             pDateTimeStamp datetime)
 {
-    return TOSDB_GetItemFrame_(id, topic_str, dest, array_len, label_dest, 
-                               label_str_len, datetime);      
+    return API_STAT_CALL(API_STAT_ITEM_FRAME,
+        TOSDB_GetItemFrame_(id, topic_str, dest, array_len, label_dest, 
+                            label_str_len, datetime));      
 }
 
 int 
@@ -1712,19 +2423,21 @@ TOSDB_GetItemFrameLongs(LPCSTR id,
                         size_type label_str_len, 
                         pDateTimeStamp datetime)
 { 
-    return TOSDB_GetItemFrame_(id, topic_str, dest, array_len, label_dest, 
-                               label_str_len, datetime);      
+    return API_STAT_CALL(API_STAT_ITEM_FRAME,
+        TOSDB_GetItemFrame_(id, topic_str, dest, array_len, label_dest, 
+                            label_str_len, datetime));      
 }
 
-int 
-TOSDB_GetItemFrameStrings(LPCSTR id, 
-                          LPCSTR topic_str, 
-                          LPSTR* dest,  
-                          size_type array_len, 
-                          size_type str_len, 
-                          LPSTR* label_dest, 
-                          size_type label_str_len, 
-                          pDateTimeStamp datetime)
+template<typename SecOutTy>
+static int 
+TOSDB_GetItemFrameStrings_(LPCSTR id, 
+                           LPCSTR topic_str, 
+                           LPSTR* dest,  
+                           size_type array_len, 
+                           size_type str_len, 
+                           LPSTR* label_dest, 
+                           size_type label_str_len, 
+                           SecOutTy datetime)
 {  
     const TOSDBlock *db;
     TOS_Topics::TOPICS topic_t;
@@ -1743,7 +2456,7 @@ TOSDB_GetItemFrameStrings(LPCSTR id,
         /* --- CRITICAL SECTION --- */
         db = GetBlockOrThrow(id);
 
-        if(datetime){      
+        if(_wantsStamps(datetime)){      
             auto dtsm = db->block->pair_map_of_frame_items(topic_t);
             auto b_iter = dtsm.cbegin();
             auto e_iter = dtsm.cend();        
@@ -1752,7 +2465,7 @@ TOSDB_GetItemFrameStrings(LPCSTR id,
                  (i < array_len) && (b_iter != e_iter); 
                   ++b_iter, ++i)
             {
-                datetime[i] = b_iter->second.second;
+                _putStamp(datetime, i, b_iter->second.second);
 
                 if( strcpy_s(dest[i], str_len, (b_iter->second.first).as_string().c_str()) )
                     return TOSDB_ERROR_BAD_INPUT_BUFFER;
@@ -1801,6 +2514,144 @@ TOSDB_GetItemFrameStrings(LPCSTR id,
   return 0;    
 } 
 
+int
+TOSDB_GetItemFrameStrings(LPCSTR id, 
+                          LPCSTR topic_str, 
+                          LPSTR* dest,  
+                          size_type array_len, 
+                          size_type str_len, 
+                          LPSTR* label_dest, 
+                          size_type label_str_len, 
+                          pDateTimeStamp datetime)
+{
+    return API_STAT_CALL(API_STAT_ITEM_FRAME,
+        TOSDB_GetItemFrameStrings_(id, topic_str, dest, array_len, str_len, label_dest,
+                                   label_str_len, datetime));
+}
+
+namespace {
+
+/* item_frame: 'e' is the topic, else the item */
+template<typename SecOutTy>
+int
+_getFrameStringsPacked(LPCSTR id,
+                       LPCSTR e,
+                       bool item_frame,
+                       LPSTR dest, 
+                       size_type dest_len, 
+                       size_type* offsets, 
+                       size_type array_len, 
+                       size_type* dest_needed,
+                       LPSTR label_dest, 
+                       size_type label_dest_len, 
+                       size_type* label_offsets, 
+                       size_type* label_dest_needed,
+                       SecOutTy datetime)
+{
+    const TOSDBlock *db;
+    TOS_Topics::TOPICS topic_t = TOS_Topics::TOPICS::NULL_TOPIC;
+    std::vector<std::string> vals, labels;
+    std::vector<DateTimeStamp> dts;
+
+    if(!IsValidBlockID(id) || !CheckStringLength(e))
+        return TOSDB_ERROR_BAD_INPUT;
+
+    if(item_frame){
+        topic_t = GetTopicEnum(e);
+        if(topic_t == TOS_Topics::TOPICS::NULL_TOPIC)        
+            return TOSDB_ERROR_BAD_TOPIC;
+    }
+
+    try{
+        GLOBAL_RLOCK_GUARD;
+        /* --- CRITICAL SECTION --- */
+        db = GetBlockOrThrow(id);
+
+        if(_wantsStamps(datetime)){
+            auto m = item_frame ? db->block->pair_map_of_frame_items(topic_t)
+                                : db->block->pair_map_of_frame_topics(e);
+            for(auto & p : m){
+                vals.push_back( p.second.first.as_string() );
+                labels.push_back( p.first );
+                dts.push_back( p.second.second );
+            }
+        }else{
+            auto m = item_frame ? db->block->map_of_frame_items(topic_t)
+                                : db->block->map_of_frame_topics(e);
+            for(auto & p : m){
+                vals.push_back( p.second.as_string() );
+                labels.push_back( p.first );
+            }
+        }
+        /* --- CRITICAL SECTION --- */
+
+    }catch(const TOSDB_DataBlockDoesntExist& e){
+        TOSDB_LogH("BLOCK", e.what());
+        return TOSDB_ERROR_BLOCK_DOESNT_EXIST;
+
+    }catch(const TOSDB_Error& e){
+        TOSDB_LogH(e.tag().c_str(), e.info_and_what().c_str());
+        return TOSDB_ERROR_GET_DATA;
+
+    }catch(const std::exception& e){
+        TOSDB_LogH("TOSDB_GetFrameStringsPacked", e.what());
+        return TOSDB_ERROR_GET_DATA;
+
+    }catch(...){ 
+        return TOSDB_ERROR_UNKNOWN;
+    }
+
+    /* size both before writing either */
+    size_type sz = _packedSize(vals, array_len);
+    size_type label_sz = _packedSize(labels, array_len);
+    if(dest_needed)
+        *dest_needed = sz;
+    if(label_dest_needed)
+        *label_dest_needed = label_sz;
+
+    if(!dest)
+        return 0;
+
+    if( !offsets || dest_len < sz 
+        || (label_dest && (!label_offsets || label_dest_len < label_sz)) )
+    {
+        return TOSDB_ERROR_BAD_INPUT_BUFFER;
+    }
+
+    _packStrings(vals, array_len, dest, offsets);
+    if(label_dest)
+        _packStrings(labels, array_len, label_dest, label_offsets);
+    if(_wantsStamps(datetime)){
+        size_type n = std::min<size_type>((size_type)dts.size(), array_len);
+        for(size_type i = 0; i < n; ++i)
+            _putStamp(datetime, i, dts[i]);
+    }
+
+    return 0;
+}
+
+}; /* namespace */
+
+int
+TOSDB_GetItemFrameStringsPacked(LPCSTR id, 
+                                LPCSTR topic_str, 
+                                LPSTR dest, 
+                                size_type dest_len, 
+                                size_type* offsets, 
+                                size_type array_len, 
+                                size_type* dest_needed, 
+                                LPSTR label_dest, 
+                                size_type label_dest_len, 
+                                size_type* label_offsets, 
+                                size_type* label_dest_needed, 
+                                pDateTimeStamp datetime)
+{
+    return API_STAT_CALL(API_STAT_ITEM_FRAME,
+        _getFrameStringsPacked(id, topic_str, true, dest, dest_len, offsets, array_len,
+                               dest_needed, label_dest, label_dest_len, label_offsets,
+                               label_dest_needed, datetime));
+}
+
 template<> 
 generic_map_type 
 TOSDB_GetTopicFrame<false>(std::string id, std::string item)
@@ -1827,15 +2678,16 @@ TOSDB_GetTopicFrame<true>(std::string id,std::string item)
     /* --- CRITICAL SECTION --- */
 }
 
-int 
-TOSDB_GetTopicFrameStrings(LPCSTR id, 
-                           LPCSTR item, 
-                           LPSTR* dest, 
-                           size_type array_len, 
-                           size_type str_len, 
-                           LPSTR* label_dest, 
-                           size_type label_str_len, 
-                           pDateTimeStamp datetime)
+template<typename SecOutTy>
+static int 
+TOSDB_GetTopicFrameStrings_(LPCSTR id, 
+                            LPCSTR item, 
+                            LPSTR* dest, 
+                            size_type array_len, 
+                            size_type str_len, 
+                            LPSTR* label_dest, 
+                            size_type label_str_len, 
+                            SecOutTy datetime)
 {  
     const TOSDBlock *db;
     int err = 0;
@@ -1850,7 +2702,7 @@ TOSDB_GetTopicFrameStrings(LPCSTR id,
         /* --- CRITICAL SECTION --- */
         db = GetBlockOrThrow(id);
 
-        if(datetime){       
+        if(_wantsStamps(datetime)){       
             auto dtsm = db->block->pair_map_of_frame_topics(item);
             auto b_iter = dtsm.cbegin();
             auto e_iter = dtsm.cend(); 
@@ -1859,7 +2711,7 @@ TOSDB_GetTopicFrameStrings(LPCSTR id,
                  (i < array_len) && (b_iter != e_iter); 
                  ++b_iter, ++i)
             {
-                datetime[i] = b_iter->second.second;
+                _putStamp(datetime, i, b_iter->second.second);
 
                 if( strcpy_s(dest[i], str_len, (b_iter->second.first).as_string().c_str()) )
                     return TOSDB_ERROR_BAD_INPUT_BUFFER;
@@ -1907,6 +2759,41 @@ TOSDB_GetTopicFrameStrings(LPCSTR id,
   return 0;
 }
 
+int
+TOSDB_GetTopicFrameStrings(LPCSTR id, 
+                           LPCSTR item, 
+                           LPSTR* dest, 
+                           size_type array_len, 
+                           size_type str_len, 
+                           LPSTR* label_dest, 
+                           size_type label_str_len, 
+                           pDateTimeStamp datetime)
+{
+    return API_STAT_CALL(API_STAT_TOPIC_FRAME,
+        TOSDB_GetTopicFrameStrings_(id, item, dest, array_len, str_len, label_dest, label_str_len,
+                                    datetime));
+}
+
+int
+TOSDB_GetTopicFrameStringsPacked(LPCSTR id, 
+                                 LPCSTR item, 
+                                 LPSTR dest, 
+                                 size_type dest_len, 
+                                 size_type* offsets, 
+                                 size_type array_len, 
+                                 size_type* dest_needed, 
+                                 LPSTR label_dest, 
+                                 size_type label_dest_len, 
+                                 size_type* label_offsets, 
+                                 size_type* label_dest_needed, 
+                                 pDateTimeStamp datetime)
+{
+    return API_STAT_CALL(API_STAT_TOPIC_FRAME,
+        _getFrameStringsPacked(id, item, false, dest, dest_len, offsets, array_len,
+                               dest_needed, label_dest, label_dest_len, label_offsets,
+                               label_dest_needed, datetime));
+}
+
 template<> 
 generic_matrix_type 
 TOSDB_GetTotalFrame<false>(std::string id)
@@ -1933,6 +2820,399 @@ TOSDB_GetTotalFrame<true>(std::string id)
     /* --- CRITICAL SECTION --- */
 }
 
+/* the 'WithEpoch' calls (see tos_databridge.h): the same calls with each 
+   stamp converted to epoch micro-seconds as it's copied (_EpochMicroConverter),
+   rather than collected as DateTimeStamps and converted after */
+
+int 
+TOSDB_GetDoubleWithEpoch(LPCSTR id, 
+                         LPCSTR item, 
+                         LPCSTR topic_str, 
+                         long indx, 
+                         ext_price_type* dest, 
+                         long long* epoch_micro)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_GET,
+        TOSDB_Get_(id, item, topic_str, indx, dest, to_micro.into(epoch_micro, 1)));
+}
+
+int 
+TOSDB_GetFloatWithEpoch(LPCSTR id, 
+                        LPCSTR item, 
+                        LPCSTR topic_str, 
+                        long indx, 
+                        def_price_type* dest, 
+                        long long* epoch_micro)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_GET,
+        TOSDB_Get_(id, item, topic_str, indx, dest, to_micro.into(epoch_micro, 1)));
+}
+
+int 
+TOSDB_GetLongLongWithEpoch(LPCSTR id, 
+                           LPCSTR item, 
+                           LPCSTR topic_str, 
+                           long indx, 
+                           ext_size_type* dest, 
+                           long long* epoch_micro)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_GET,
+        TOSDB_Get_(id, item, topic_str, indx, dest, to_micro.into(epoch_micro, 1)));
+}
+
+int 
+TOSDB_GetLongWithEpoch(LPCSTR id, 
+                       LPCSTR item, 
+                       LPCSTR topic_str, 
+                       long indx, 
+                       def_size_type* dest, 
+                       long long* epoch_micro)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_GET,
+        TOSDB_Get_(id, item, topic_str, indx, dest, to_micro.into(epoch_micro, 1)));
+}
+
+int 
+TOSDB_GetStringWithEpoch(LPCSTR id, 
+                         LPCSTR item, 
+                         LPCSTR topic_str, 
+                         long indx, 
+                         LPSTR dest, 
+                         size_type str_len, 
+                         long long* epoch_micro)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_GET,
+        TOSDB_GetString_(id, item, topic_str, indx, dest, str_len, to_micro.into(epoch_micro,
+                         1)));
+}
+
+int 
+TOSDB_GetStreamSnapshotDoublesWithEpoch(LPCSTR id, 
+                                        LPCSTR item, 
+                                        LPCSTR topic_str, 
+                                        ext_price_type* dest, 
+                                        size_type array_len, 
+                                        long long* epoch_micro, 
+                                        long end, 
+                                        long beg)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_SNAPSHOT,
+        TOSDB_GetStreamSnapshot_(id, item, topic_str, dest, array_len,
+                                 to_micro.into(epoch_micro, array_len), end, beg));
+}
+
+int 
+TOSDB_GetStreamSnapshotFloatsWithEpoch(LPCSTR id, 
+                                       LPCSTR item, 
+                                       LPCSTR topic_str, 
+                                       def_price_type* dest, 
+                                       size_type array_len, 
+                                       long long* epoch_micro, 
+                                       long end, 
+                                       long beg)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_SNAPSHOT,
+        TOSDB_GetStreamSnapshot_(id, item, topic_str, dest, array_len,
+                                 to_micro.into(epoch_micro, array_len), end, beg));
+}
+
+int 
+TOSDB_GetStreamSnapshotLongLongsWithEpoch(LPCSTR id, 
+                                          LPCSTR item, 
+                                          LPCSTR topic_str, 
+                                          ext_size_type* dest, 
+                                          size_type array_len, 
+                                          long long* epoch_micro, 
+                                          long end, 
+                                          long beg)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_SNAPSHOT,
+        TOSDB_GetStreamSnapshot_(id, item, topic_str, dest, array_len,
+                                 to_micro.into(epoch_micro, array_len), end, beg));
+}
+
+int 
+TOSDB_GetStreamSnapshotLongsWithEpoch(LPCSTR id, 
+                                      LPCSTR item, 
+                                      LPCSTR topic_str, 
+                                      def_size_type* dest, 
+                                      size_type array_len, 
+                                      long long* epoch_micro, 
+                                      long end, 
+                                      long beg)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_SNAPSHOT,
+        TOSDB_GetStreamSnapshot_(id, item, topic_str, dest, array_len,
+                                 to_micro.into(epoch_micro, array_len), end, beg));
+}
+
+int 
+TOSDB_GetStreamSnapshotStringsWithEpoch(LPCSTR id, 
+                                        LPCSTR item, 
+                                        LPCSTR topic_str, 
+                                        LPSTR* dest, 
+                                        size_type array_len, 
+                                        size_type str_len, 
+                                        long long* epoch_micro, 
+                                        long end, 
+                                        long beg)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_SNAPSHOT,
+        TOSDB_GetStreamSnapshotStrings_(id, item, topic_str, dest, array_len, str_len,
+                                        to_micro.into(epoch_micro, array_len), end, beg));
+}
+
+int 
+TOSDB_GetStreamSnapshotStringsPackedWithEpoch(LPCSTR id, 
+                                              LPCSTR item, 
+                                              LPCSTR topic_str, 
+                                              LPSTR dest, 
+                                              size_type dest_len, 
+                                              size_type* offsets, 
+                                              size_type array_len, 
+                                              size_type* dest_needed, 
+                                              long long* epoch_micro, 
+                                              long end, 
+                                              long beg)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_SNAPSHOT,
+        TOSDB_GetStreamSnapshotStringsPacked_(id, item, topic_str, dest, dest_len, offsets,
+                                              array_len, dest_needed,
+                                              to_micro.into(epoch_micro, array_len), end, beg));
+}
+
+int 
+TOSDB_GetStreamSnapshotDoublesFromMarkerWithEpoch(LPCSTR id,
+                                                  LPCSTR item, 
+                                                  LPCSTR topic_str, 
+                                                  ext_price_type* dest,
+                                                  size_type array_len, 
+                                                  long long* epoch_micro, 
+                                                  long beg, 
+                                                  long *get_size)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_SNAPSHOT_FROM_MARKER,
+        TOSDB_GetStreamSnapshotFromMarker_(id, item, topic_str, dest, array_len,
+                                           to_micro.into(epoch_micro, array_len), beg,
+                                           get_size));
+}
+
+int 
+TOSDB_GetStreamSnapshotFloatsFromMarkerWithEpoch(LPCSTR id,
+                                                 LPCSTR item, 
+                                                 LPCSTR topic_str, 
+                                                 def_price_type* dest,
+                                                 size_type array_len, 
+                                                 long long* epoch_micro, 
+                                                 long beg, 
+                                                 long *get_size)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_SNAPSHOT_FROM_MARKER,
+        TOSDB_GetStreamSnapshotFromMarker_(id, item, topic_str, dest, array_len,
+                                           to_micro.into(epoch_micro, array_len), beg,
+                                           get_size));
+}
+
+int 
+TOSDB_GetStreamSnapshotLongLongsFromMarkerWithEpoch(LPCSTR id,
+                                                    LPCSTR item, 
+                                                    LPCSTR topic_str, 
+                                                    ext_size_type* dest,
+                                                    size_type array_len, 
+                                                    long long* epoch_micro, 
+                                                    long beg, 
+                                                    long *get_size)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_SNAPSHOT_FROM_MARKER,
+        TOSDB_GetStreamSnapshotFromMarker_(id, item, topic_str, dest, array_len,
+                                           to_micro.into(epoch_micro, array_len), beg,
+                                           get_size));
+}
+
+int 
+TOSDB_GetStreamSnapshotLongsFromMarkerWithEpoch(LPCSTR id,
+                                                LPCSTR item, 
+                                                LPCSTR topic_str, 
+                                                def_size_type* dest,
+                                                size_type array_len, 
+                                                long long* epoch_micro, 
+                                                long beg, 
+                                                long *get_size)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_SNAPSHOT_FROM_MARKER,
+        TOSDB_GetStreamSnapshotFromMarker_(id, item, topic_str, dest, array_len,
+                                           to_micro.into(epoch_micro, array_len), beg,
+                                           get_size));
+}
+
+int 
+TOSDB_GetStreamSnapshotStringsFromMarkerWithEpoch(LPCSTR id,
+                                                  LPCSTR item, 
+                                                  LPCSTR topic_str, 
+                                                  LPSTR* dest,
+                                                  size_type array_len, 
+                                                  size_type str_len, 
+                                                  long long* epoch_micro, 
+                                                  long beg, 
+                                                  long *get_size)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_SNAPSHOT_FROM_MARKER,
+        TOSDB_GetStreamSnapshotStringsFromMarker_(id, item, topic_str, dest, array_len,
+                                                  str_len, to_micro.into(epoch_micro,
+                                                  array_len), beg, get_size));
+}
+
+int 
+TOSDB_GetItemFrameDoublesWithEpoch(LPCSTR id, 
+                                   LPCSTR topic_str, 
+                                   ext_price_type* dest, 
+                                   size_type array_len, 
+                                   LPSTR* label_dest, 
+                                   size_type label_str_len, 
+                                   long long* epoch_micro)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_ITEM_FRAME,
+        TOSDB_GetItemFrame_(id, topic_str, dest, array_len, label_dest, label_str_len,
+                            to_micro.into(epoch_micro, array_len)));
+}
+
+int 
+TOSDB_GetItemFrameFloatsWithEpoch(LPCSTR id, 
+                                  LPCSTR topic_str, 
+                                  def_price_type* dest, 
+                                  size_type array_len, 
+                                  LPSTR* label_dest, 
+                                  size_type label_str_len, 
+                                  long long* epoch_micro)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_ITEM_FRAME,
+        TOSDB_GetItemFrame_(id, topic_str, dest, array_len, label_dest, label_str_len,
+                            to_micro.into(epoch_micro, array_len)));
+}
+
+int 
+TOSDB_GetItemFrameLongLongsWithEpoch(LPCSTR id, 
+                                     LPCSTR topic_str, 
+                                     ext_size_type* dest, 
+                                     size_type array_len, 
+                                     LPSTR* label_dest, 
+                                     size_type label_str_len, 
+                                     long long* epoch_micro)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_ITEM_FRAME,
+        TOSDB_GetItemFrame_(id, topic_str, dest, array_len, label_dest, label_str_len,
+                            to_micro.into(epoch_micro, array_len)));
+}
+
+int 
+TOSDB_GetItemFrameLongsWithEpoch(LPCSTR id, 
+                                 LPCSTR topic_str, 
+                                 def_size_type* dest, 
+                                 size_type array_len, 
+                                 LPSTR* label_dest, 
+                                 size_type label_str_len, 
+                                 long long* epoch_micro)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_ITEM_FRAME,
+        TOSDB_GetItemFrame_(id, topic_str, dest, array_len, label_dest, label_str_len,
+                            to_micro.into(epoch_micro, array_len)));
+}
+
+int 
+TOSDB_GetItemFrameStringsWithEpoch(LPCSTR id, 
+                                   LPCSTR topic_str, 
+                                   LPSTR* dest, 
+                                   size_type array_len, 
+                                   size_type str_len, 
+                                   LPSTR* label_dest, 
+                                   size_type label_str_len, 
+                                   long long* epoch_micro)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_ITEM_FRAME,
+        TOSDB_GetItemFrameStrings_(id, topic_str, dest, array_len, str_len, label_dest,
+                                   label_str_len, to_micro.into(epoch_micro, array_len)));
+}
+
+int 
+TOSDB_GetItemFrameStringsPackedWithEpoch(LPCSTR id, 
+                                         LPCSTR topic_str, 
+                                         LPSTR dest, 
+                                         size_type dest_len, 
+                                         size_type* offsets,
+                                         size_type array_len, 
+                                         size_type* dest_needed, 
+                                         LPSTR label_dest, 
+                                         size_type label_dest_len, 
+                                         size_type* label_offsets, 
+                                         size_type* label_dest_needed, 
+                                         long long* epoch_micro)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_ITEM_FRAME,
+        _getFrameStringsPacked(id, topic_str, true, dest, dest_len, offsets, array_len,
+                               dest_needed, label_dest, label_dest_len, label_offsets,
+                               label_dest_needed, to_micro.into(epoch_micro, array_len)));
+}
+
+int 
+TOSDB_GetTopicFrameStringsWithEpoch(LPCSTR id, 
+                                    LPCSTR item, 
+                                    LPSTR* dest, 
+                                    size_type array_len, 
+                                    size_type str_len, 
+                                    LPSTR* label_dest, 
+                                    size_type label_str_len, 
+                                    long long* epoch_micro)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_TOPIC_FRAME,
+        TOSDB_GetTopicFrameStrings_(id, item, dest, array_len, str_len, label_dest,
+                                    label_str_len, to_micro.into(epoch_micro, array_len)));
+}
+
+int 
+TOSDB_GetTopicFrameStringsPackedWithEpoch(LPCSTR id, 
+                                          LPCSTR item, 
+                                          LPSTR dest, 
+                                          size_type dest_len, 
+                                          size_type* offsets,
+                                          size_type array_len, 
+                                          size_type* dest_needed, 
+                                          LPSTR label_dest, 
+                                          size_type label_dest_len, 
+                                          size_type* label_offsets, 
+                                          size_type* label_dest_needed, 
+                                          long long* epoch_micro)
+{
+    _EpochMicroConverter to_micro;
+    return API_STAT_CALL(API_STAT_TOPIC_FRAME,
+        _getFrameStringsPacked(id, item, false, dest, dest_len, offsets, array_len,
+                               dest_needed, label_dest, label_dest_len, label_offsets,
+                               label_dest_needed, to_micro.into(epoch_micro, array_len)));
+}
+
+
 
 
 
@@ -0,0 +1,647 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include "tos_databridge.h"
+#include "client.hpp"
+#include "tick_record.hpp"
+#include <algorithm>
+#include <fstream>
+#include <ctime>
+
+namespace {
+
+/* how much of a segment we map at a time */
+const uint64_t SEGMENT_VIEW_SZ = 4 * 1024 * 1024;
+
+
+class SegmentView{
+/* read-only, windowed map of a recorded segment; a query only faults in the
+   pages of the records it actually visits */
+    HANDLE _file;
+    HANDLE _mapping;
+    char* _view;
+    uint64_t _view_beg;
+    uint64_t _view_len;
+    uint64_t _file_sz;
+    uint64_t _granularity;
+
+public:
+    explicit SegmentView(std::string path)
+        :
+            _file(INVALID_HANDLE_VALUE),
+            _mapping(NULL),
+            _view(nullptr),
+            _view_beg(0),
+            _view_len(0),
+            _file_sz(0)
+        {
+            SYSTEM_INFO sys_info;
+            LARGE_INTEGER fsz;
+
+            GetSystemInfo(&sys_info);
+            _granularity = sys_info.dwAllocationGranularity;
+
+            _file = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if(_file == INVALID_HANDLE_VALUE)
+                throw TOSDB_RecordError("failed to open segment: " + path);
+
+            if( !GetFileSizeEx(_file, &fsz) || (uint64_t)fsz.QuadPart < sizeof(TickSegmentHeader) ){
+                CloseHandle(_file);
+                throw TOSDB_RecordError("invalid segment: " + path);
+            }
+            _file_sz = fsz.QuadPart;
+
+            _mapping = CreateFileMapping(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if(!_mapping){
+                CloseHandle(_file);
+                throw TOSDB_RecordError("failed to map segment: " + path);
+            }
+        }
+
+    ~SegmentView()
+        {
+            if(_view)
+                UnmapViewOfFile(_view);
+            CloseHandle(_mapping);
+            CloseHandle(_file);
+        }
+
+    const char*
+    at(uint64_t offset, uint64_t len)
+    { /* pointer is only good until the next call */
+        uint64_t end = offset + len;
+
+        if(end > _file_sz)
+            throw TOSDB_RecordError("record extends past end of segment");
+
+        if(_view && offset >= _view_beg && end <= _view_beg + _view_len)
+            return _view + (offset - _view_beg);
+
+        if(_view)
+            UnmapViewOfFile(_view);
+
+        /* we walk backwards, so end the window just past the record */
+        _view_beg = (end > SEGMENT_VIEW_SZ) ? (end - SEGMENT_VIEW_SZ) : 0;
+        _view_beg = std::min(_view_beg, offset);
+        _view_beg -= (_view_beg % _granularity);
+        _view_len = std::max(end, std::min(_view_beg + SEGMENT_VIEW_SZ, _file_sz)) - _view_beg;
+
+        _view = (char*)MapViewOfFile(_mapping, FILE_MAP_READ, (DWORD)(_view_beg >> 32),
+                                     (DWORD)(_view_beg & 0xFFFFFFFF), (SIZE_T)_view_len);
+        if(!_view)
+            throw TOSDB_RecordError("failed to map view of segment");
+
+        return _view + (offset - _view_beg);
+    }
+};
+
+
+void
+_readIndex(std::string path,
+           std::string item,
+           TOS_Topics::TOPICS topic_t,
+           TickIndexStream* stream,
+           std::vector<TickIndexEntry>* entries)
+{
+    TickIndexHeader head;
+    TickIndexStream s;
+    uint64_t nskip = 0;
+    bool found = false;
+
+    std::ifstream file(path + TOSDB_TICK_IDX_EXT, std::ios::in | std::ios::binary);
+    if(!file.is_open())
+        throw TOSDB_RecordError("failed to open index for segment: " + path);
+
+    file.read((char*)&head, sizeof(head));
+    if( !file || memcmp(head.magic, TOSDB_TICK_IDX_MAGIC, sizeof(head.magic)) )
+        throw TOSDB_RecordError("invalid index for segment: " + path);
+
+    for(uint32_t i = 0; i < head.nstreams; ++i){
+        file.read((char*)&s, sizeof(s));
+        if(!file)
+            throw TOSDB_RecordError("truncated index for segment: " + path);
+
+        if( !found && item == s.item && TOS_Topics::MAP()[topic_t] == s.topic ){
+            *stream = s;
+            found = true;
+        }else if(!found){
+            nskip += s.nentries;
+        }
+    }
+
+    if(!found){
+        stream->count = 0;
+        return;
+    }
+
+    entries->resize((size_t)stream->nentries);
+    file.seekg(nskip * sizeof(TickIndexEntry), std::ios::cur);
+    file.read((char*)entries->data(), stream->nentries * sizeof(TickIndexEntry));
+    if(!file)
+        throw TOSDB_RecordError("truncated index for segment: " + path);
+}
+
+
+template<typename T>
+T
+_castRecorded(const char* val, uint32_t len)
+{
+    return *(T*)val;
+}
+
+template<>
+std::string
+_castRecorded<std::string>(const char* val, uint32_t len)
+{
+    return std::string(val, len);
+}
+
+
+template<typename T>
+void
+_visitGeneric(const char* val, uint32_t len, int64_t micro, void* arg)
+{
+    generic_dts_vectors_type* p = (generic_dts_vectors_type*)arg;
+    DateTimeStamp dts;
+
+    EpochMicroToDateTimeStamp(micro, &dts);
+    p->first.push_back( generic_type(_castRecorded<T>(val, len)) );
+    p->second.push_back(dts);
+}
+
+
+typedef struct{
+    ext_price_type* dest;
+    pDateTimeStamp datetime;
+    size_type array_len;
+    size_type n;
+} number_dest_ty;
+
+template<typename T>
+void
+_visitNumber(const char* val, uint32_t len, int64_t micro, void* arg)
+{ /* all numeric topics come out as doubles; only take the first array_len */
+    number_dest_ty* d = (number_dest_ty*)arg;
+
+    if(d->n == d->array_len)
+        return;
+
+    d->dest[d->n] = (ext_price_type)_castRecorded<T>(val, len);
+    if(d->datetime)
+        EpochMicroToDateTimeStamp(micro, d->datetime + d->n);
+    ++(d->n);
+}
+
+
+void
+_visitCount(const char* val, uint32_t len, int64_t micro, void* arg)
+{
+}
+
+}; /* namespace */
+
+
+TickRecorder::TickRecorder(std::string path)
+    :
+        _path(path),
+        _file(path, std::ios::out | std::ios::binary | std::ios::trunc),
+        _offset(0),
+        _closed(false),
+        _failed(false)
+    {
+        TickSegmentHeader head;
+
+        if(!_file.is_open())
+            throw TOSDB_RecordError("failed to open segment: " + path);
+
+        memset(&head, 0, sizeof(head));
+        memcpy(head.magic, TOSDB_TICK_SEG_MAGIC, sizeof(head.magic));
+        head.version = 1;
+
+        _file.write((const char*)&head, sizeof(head));
+        _offset = sizeof(head);
+    }
+
+
+TickRecorder::~TickRecorder()
+    {
+        try{
+            close();
+        }catch(const std::exception& e){
+            TOSDB_LogH("TickRecord", e.what());
+        }
+    }
+
+
+void
+TickRecorder::append(TOS_Topics::TOPICS topic_t,
+                     const std::string& item,
+                     const char* val,
+                     uint32_t len,
+                     int64_t micro)
+{
+    TickRecordHead head;
+
+    if(_closed)
+        throw TOSDB_RecordError("segment is closed: " + _path);
+
+    if(_failed)
+        return;
+
+    _streams_ty::iterator s_iter = _streams.find( _streams_ty::key_type(topic_t,item) );
+    if(s_iter == _streams.end()){
+        _stream_state ss = {(uint32_t)_streams.size(), 0, _offset, 0, micro, micro};
+        s_iter = _streams.insert( _streams_ty::value_type(_streams_ty::key_type(topic_t,item),
+                                                          std::move(ss)) ).first;
+    }
+
+    _stream_state& ss = s_iter->second;
+
+    head.stream_id = ss.id;
+    head.len = len;
+    head.micro = micro;
+    head.prev_offset = ss.count ? ss.last_offset : TOSDB_TICK_NULL_OFFSET;
+
+    _file.write((const char*)&head, sizeof(head));
+    _file.write(val, len);
+    if(_file.fail()){
+        /* only index what's in the segment; a new stream w/o ticks goes */
+        if(!ss.count)
+            _streams.erase(s_iter);
+        _failed = true;
+        TOSDB_LogH("TickRecord", ("failed to write segment, recording stopped: " + _path).c_str());
+        return;
+    }
+
+    if(ss.count % TOSDB_TICK_INDEX_INTERVAL == 0){
+        TickIndexEntry e = {micro, _offset};
+        ss.sparse.push_back(e);
+    }
+
+    ss.last_offset = _offset;
+    ss.last_micro = micro;
+    ++ss.count;
+
+    _offset += sizeof(head) + len;
+}
+
+
+void
+TickRecorder::close()
+{
+    if(_closed)
+        return;
+
+    _closed = true;
+    _file.close();
+    _write_index();
+}
+
+
+void
+TickRecorder::_write_index()
+{
+    TickIndexHeader head;
+    std::vector<const _stream_state*> by_id(_streams.size());
+    std::vector<TickIndexStream> entries(_streams.size());
+
+    std::ofstream file(_path + TOSDB_TICK_IDX_EXT,
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file.is_open())
+        throw TOSDB_RecordError("failed to open index for segment: " + _path);
+
+    memcpy(head.magic, TOSDB_TICK_IDX_MAGIC, sizeof(head.magic));
+    head.nstreams = (uint32_t)_streams.size();
+    head.interval = TOSDB_TICK_INDEX_INTERVAL;
+    file.write((const char*)&head, sizeof(head));
+
+    for(auto & s : _streams){
+        TickIndexStream& e = entries[s.second.id];
+        memset(&e, 0, sizeof(e));
+        strncpy_s(e.item, s.first.second.c_str(), TOSDB_MAX_STR_SZ);
+        strncpy_s(e.topic, TOS_Topics::MAP()[s.first.first].c_str(), TOSDB_MAX_STR_SZ);
+        e.stream_id = s.second.id;
+        e.count = s.second.count;
+        e.first_offset = s.second.first_offset;
+        e.last_offset = s.second.last_offset;
+        e.first_micro = s.second.first_micro;
+        e.last_micro = s.second.last_micro;
+        e.nentries = s.second.sparse.size();
+        by_id[s.second.id] = &s.second;
+    }
+
+    file.write((const char*)entries.data(), entries.size() * sizeof(TickIndexStream));
+
+    for(const _stream_state* s : by_id)
+        file.write((const char*)s->sparse.data(), s->sparse.size() * sizeof(TickIndexEntry));
+
+    if(!file)
+        throw TOSDB_RecordError("failed to write index for segment: " + _path);
+}
+
+
+uint64_t
+VisitRecordedTicks(std::string path,
+                   std::string item,
+                   TOS_Topics::TOPICS topic_t,
+                   int64_t beg_micro,
+                   int64_t end_micro,
+                   tick_visitor_ty visitor,
+                   void* arg)
+{
+    TickIndexStream stream;
+    TickRecordHead head;
+    std::vector<TickIndexEntry> entries;
+    std::vector<uint64_t> hits;
+
+    _readIndex(path, item, topic_t, &stream, &entries);
+
+    if( !stream.count
+        || beg_micro > end_micro
+        || end_micro < stream.first_micro
+        || beg_micro > stream.last_micro )
+    {
+        return 0;
+    }
+
+    /* start from the first sparse entry past the range (or the last tick) */
+    std::vector<TickIndexEntry>::const_iterator e_iter =
+        std::upper_bound(entries.cbegin(), entries.cend(), end_micro,
+                         [](int64_t m, const TickIndexEntry& e){ return m < e.micro; });
+
+    uint64_t offset = (e_iter == entries.cend()) ? stream.last_offset : e_iter->offset;
+
+    SegmentView view(path);
+
+    /* ticks of a stream are stamped on arrival so they're ordered by time;
+       walk back through the chain until we're before the range */
+    while(offset != TOSDB_TICK_NULL_OFFSET){
+        head = *(const TickRecordHead*)view.at(offset, sizeof(TickRecordHead));
+        if(head.stream_id != stream.stream_id)
+            throw TOSDB_RecordError("corrupt offset chain in segment: " + path);
+        if(head.micro < beg_micro)
+            break;
+        if(head.micro <= end_micro)
+            hits.push_back(offset);
+        offset = head.prev_offset;
+    }
+
+    for(auto h = hits.crbegin(); h != hits.crend(); ++h){
+        head = *(const TickRecordHead*)view.at(*h, sizeof(TickRecordHead));
+        visitor(view.at(*h + sizeof(TickRecordHead), head.len), head.len, head.micro, arg);
+    }
+
+    return hits.size();
+}
+
+
+long long
+DateTimeStampToEpochMicro(const DateTimeStamp& dts)
+{
+    struct tm t = dts.ctime_struct; /* mktime normalizes its arg */
+    return (long long)mktime(&t) * 1000000 + dts.micro_second;
+}
+
+
+long long
+EpochMicroCache::operator()(const DateTimeStamp& dts)
+{
+    const struct tm& t = dts.ctime_struct;
+
+    if( !_valid
+        || t.tm_sec != _last.tm_sec || t.tm_min != _last.tm_min
+        || t.tm_hour != _last.tm_hour || t.tm_mday != _last.tm_mday
+        || t.tm_mon != _last.tm_mon || t.tm_year != _last.tm_year )
+    {
+        _last = t;
+        struct tm tmp = t; /* mktime normalizes its arg */
+        _secs = (long long)mktime(&tmp);
+        _valid = true;
+    }
+
+    return _secs * 1000000 + dts.micro_second;
+}
+
+
+void
+DateTimeStampsToEpochMicro(const DateTimeStamp* dts, size_type n, long long* dest)
+{
+    EpochMicroCache to_micro;
+
+    for(size_type i = 0; i < n; ++i)
+        dest[i] = dts[i].ctime_struct.tm_mday ? to_micro(dts[i]) : 0;
+}
+
+
+void
+EpochMicroToDateTimeStamp(long long micro, pDateTimeStamp dts)
+{
+    time_t t = (time_t)(micro / 1000000);
+    dts->micro_second = (long)(micro % 1000000);
+    localtime_s(&dts->ctime_struct, &t);
+}
+
+
+int
+TOSDB_GetRecordedCount(LPCSTR path,
+                       LPCSTR item,
+                       LPCSTR topic_str,
+                       long long beg_micro,
+                       long long end_micro,
+                       size_type* count)
+{
+    TOS_Topics::TOPICS topic_t;
+
+    if( !CheckStringLength(path)
+        || !CheckStringLength(item)
+        || !CheckStringLength(topic_str) )
+    {
+        return TOSDB_ERROR_BAD_INPUT;
+    }
+
+    topic_t = GetTopicEnum(topic_str);
+    if(topic_t == TOS_Topics::TOPICS::NULL_TOPIC)
+        return TOSDB_ERROR_BAD_TOPIC;
+
+    try{
+        *count = (size_type)VisitRecordedTicks(path, item, topic_t, beg_micro, end_micro,
+                                               _visitCount, nullptr);
+        return 0;
+
+    }catch(const TOSDB_Error& e){
+        TOSDB_LogH(e.tag().c_str(), e.info_and_what().c_str());
+        return TOSDB_ERROR_GET_DATA;
+
+    }catch(const std::exception& e){
+        TOSDB_LogH("TOSDB_GetRecordedCount", e.what());
+        return TOSDB_ERROR_GET_DATA;
+
+    }catch(...){
+        return TOSDB_ERROR_UNKNOWN;
+    }
+}
+
+
+int
+TOSDB_GetRecordedDoubles(LPCSTR path,
+                         LPCSTR item,
+                         LPCSTR topic_str,
+                         long long beg_micro,
+                         long long end_micro,
+                         ext_price_type* dest,
+                         size_type array_len,
+                         pDateTimeStamp datetime,
+                         size_type* get_size)
+{
+    TOS_Topics::TOPICS topic_t;
+    number_dest_ty d = {dest, datetime, array_len, 0};
+
+    if( !CheckStringLength(path)
+        || !CheckStringLength(item)
+        || !CheckStringLength(topic_str) )
+    {
+        return TOSDB_ERROR_BAD_INPUT;
+    }
+
+    topic_t = GetTopicEnum(topic_str);
+    if(topic_t == TOS_Topics::TOPICS::NULL_TOPIC)
+        return TOSDB_ERROR_BAD_TOPIC;
+
+    try{
+        switch(TOS_Topics::TypeBits(topic_t)){
+        case TOSDB_STRING_BIT:
+            return TOSDB_ERROR_BAD_TOPIC;
+        case TOSDB_INTGR_BIT:
+            VisitRecordedTicks(path, item, topic_t, beg_micro, end_micro,
+                               _visitNumber<def_size_type>, &d);
+            break;
+        case TOSDB_QUAD_BIT:
+            VisitRecordedTicks(path, item, topic_t, beg_micro, end_micro,
+                               _visitNumber<ext_price_type>, &d);
+            break;
+        case TOSDB_INTGR_BIT | TOSDB_QUAD_BIT:
+            VisitRecordedTicks(path, item, topic_t, beg_micro, end_micro,
+                               _visitNumber<ext_size_type>, &d);
+            break;
+        default:
+            VisitRecordedTicks(path, item, topic_t, beg_micro, end_micro,
+                               _visitNumber<def_price_type>, &d);
+        };
+        *get_size = d.n;
+        return 0;
+
+    }catch(const TOSDB_Error& e){
+        TOSDB_LogH(e.tag().c_str(), e.info_and_what().c_str());
+        return TOSDB_ERROR_GET_DATA;
+
+    }catch(const std::exception& e){
+        TOSDB_LogH("TOSDB_GetRecordedDoubles", e.what());
+        return TOSDB_ERROR_GET_DATA;
+
+    }catch(...){
+        return TOSDB_ERROR_UNKNOWN;
+    }
+}
+
+
+int
+TOSDB_GetRecordedStrings(LPCSTR path,
+                         LPCSTR item,
+                         LPCSTR topic_str,
+                         long long beg_micro,
+                         long long end_micro,
+                         LPSTR* dest,
+                         size_type array_len,
+                         size_type str_len,
+                         pDateTimeStamp datetime,
+                         size_type* get_size)
+{
+    TOS_Topics::TOPICS topic_t;
+    generic_dts_vectors_type all;
+
+    if( !CheckStringLength(path)
+        || !CheckStringLength(item)
+        || !CheckStringLength(topic_str) 
+        || !str_len ) /* room for at least the null */
+    {
+        return TOSDB_ERROR_BAD_INPUT;
+    }
+
+    topic_t = GetTopicEnum(topic_str);
+    if(topic_t == TOS_Topics::TOPICS::NULL_TOPIC)
+        return TOSDB_ERROR_BAD_TOPIC;
+
+    try{
+        all = TOSDB_GetRecorded(path, item, topic_t, beg_micro, end_micro);
+
+        *get_size = std::min<size_type>((size_type)all.first.size(), array_len);
+        for(size_type i = 0; i < *get_size; ++i){
+            std::string s = all.first[i].as_string();
+            strncpy_s(dest[i], str_len, s.c_str(), std::min<size_t>(str_len-1, s.length()));
+            if(datetime)
+                datetime[i] = all.second[i];
+        }
+        return 0;
+
+    }catch(const TOSDB_Error& e){
+        TOSDB_LogH(e.tag().c_str(), e.info_and_what().c_str());
+        return TOSDB_ERROR_GET_DATA;
+
+    }catch(const std::exception& e){
+        TOSDB_LogH("TOSDB_GetRecordedStrings", e.what());
+        return TOSDB_ERROR_GET_DATA;
+
+    }catch(...){
+        return TOSDB_ERROR_UNKNOWN;
+    }
+}
+
+
+generic_dts_vectors_type
+TOSDB_GetRecorded(std::string path,
+                  std::string item,
+                  TOS_Topics::TOPICS topic_t,
+                  long long beg_micro,
+                  long long end_micro)
+{
+    generic_dts_vectors_type all;
+
+    switch(TOS_Topics::TypeBits(topic_t)){
+    case TOSDB_STRING_BIT:
+        VisitRecordedTicks(path, item, topic_t, beg_micro, end_micro,
+                           _visitGeneric<std::string>, &all);
+        break;
+    case TOSDB_INTGR_BIT:
+        VisitRecordedTicks(path, item, topic_t, beg_micro, end_micro,
+                           _visitGeneric<def_size_type>, &all);
+        break;
+    case TOSDB_QUAD_BIT:
+        VisitRecordedTicks(path, item, topic_t, beg_micro, end_micro,
+                           _visitGeneric<ext_price_type>, &all);
+        break;
+    case TOSDB_INTGR_BIT | TOSDB_QUAD_BIT:
+        VisitRecordedTicks(path, item, topic_t, beg_micro, end_micro,
+                           _visitGeneric<ext_size_type>, &all);
+        break;
+    default:
+        VisitRecordedTicks(path, item, topic_t, beg_micro, end_micro,
+                           _visitGeneric<def_price_type>, &all);
+    };
+
+    return all;
+}
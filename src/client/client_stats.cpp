@@ -0,0 +1,379 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include "tos_databridge.h"
+#include "client.hpp"
+#include "data_stream.hpp"
+
+/* per-API call stats (see client.hpp)
+
+   Every thread that makes an instrumented call gets a slab of counters (found
+   through a TLS slot) that only it writes to; the counters are atomics so
+   TOSDB_GetApiStats can read them from another thread, but the owner just
+   does relaxed load/store pairs - no locked instructions on the call path.
+
+   Reset bumps a generation number instead of touching the slabs: a slab from
+   an older generation is skipped when summing and zeroes itself (by its own
+   thread) on its next use.
+
+   The lock profile calls just read/reset the client's LockProfile sites
+   (lock_profile.hpp). */
+
+namespace {
+
+const char* NAMES[API_STAT_COUNT] = {
+    "Connect",
+    "Disconnect",
+    "CreateBlock",
+    "CloseBlock",
+    "CloseBlocks",
+    "Add",
+    "Remove",
+    "SetBlockSize",
+    "StreamInfo",
+    "Get",
+    "GetStreamSnapshot",
+    "GetStreamSnapshotFromMarker",
+    "GetStreamSnapshotToBuffers",
+    "GetStreamSnapshotSampled",
+    "GetItemFrame",
+    "GetTopicFrame",
+    "GetStreamSummary",
+    "lock:global_rmutex",
+    "lock:buffers_mtx"
+};
+
+typedef std::atomic<unsigned long long> counter_type;
+
+struct Counters{
+    counter_type calls;
+    counter_type errors;
+    counter_type ticks;
+    counter_type max_ticks;
+    counter_type waits;
+    counter_type wait_ticks;
+};
+
+struct Slab{
+    Counters counters[API_STAT_COUNT];
+    std::atomic<unsigned int> gen;
+    unsigned int depth; /* only touched by the owner */
+    ApiStatId current;
+};
+
+DWORD tls_index = TlsAlloc();
+
+long long qpc_freq = [](){
+    LARGE_INTEGER f;
+    QueryPerformanceFrequency(&f);
+    return f.QuadPart;
+}();
+
+std::atomic<unsigned int> generation(0);
+
+/* live slabs, and what threads that exited left behind; guarded by slabs_mtx */
+std::vector<Slab*> slabs;
+Slab retired;
+std::mutex slabs_mtx;
+
+
+inline void
+_bump(counter_type& c, unsigned long long v)
+{
+    c.store(c.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+inline void
+_raise(counter_type& c, unsigned long long v)
+{
+    if(v > c.load(std::memory_order_relaxed))
+        c.store(v, std::memory_order_relaxed);
+}
+
+void
+_zero(Slab* slab)
+{
+    for(Counters& c : slab->counters){
+        c.calls.store(0, std::memory_order_relaxed);
+        c.errors.store(0, std::memory_order_relaxed);
+        c.ticks.store(0, std::memory_order_relaxed);
+        c.max_ticks.store(0, std::memory_order_relaxed);
+        c.waits.store(0, std::memory_order_relaxed);
+        c.wait_ticks.store(0, std::memory_order_relaxed);
+    }
+}
+
+void
+_fold(Slab* dest, const Slab* src)
+{
+    for(int i = 0; i < API_STAT_COUNT; ++i){
+        const Counters& s = src->counters[i];
+        Counters& d = dest->counters[i];
+        _bump(d.calls, s.calls.load(std::memory_order_relaxed));
+        _bump(d.errors, s.errors.load(std::memory_order_relaxed));
+        _bump(d.ticks, s.ticks.load(std::memory_order_relaxed));
+        _raise(d.max_ticks, s.max_ticks.load(std::memory_order_relaxed));
+        _bump(d.waits, s.waits.load(std::memory_order_relaxed));
+        _bump(d.wait_ticks, s.wait_ticks.load(std::memory_order_relaxed));
+    }
+}
+
+Slab*
+_mySlab()
+{
+    Slab* slab = (Slab*)TlsGetValue(tls_index);
+    unsigned int g = generation.load(std::memory_order_relaxed);
+
+    if(!slab){
+        slab = new Slab;
+        _zero(slab);
+        slab->gen.store(g, std::memory_order_relaxed);
+        slab->depth = 0;
+        slab->current = API_STAT_COUNT;
+        {
+            std::lock_guard<std::mutex> lock(slabs_mtx);
+            slabs.push_back(slab);
+        }
+        TlsSetValue(tls_index, slab);
+    }else if(slab->gen.load(std::memory_order_relaxed) != g){
+        _zero(slab);
+        slab->gen.store(g, std::memory_order_release);
+    }
+
+    return slab;
+}
+
+inline unsigned long long
+_toMicro(unsigned long long ticks)
+{
+    if(!qpc_freq)
+        return 0;
+    /* split so cumulative totals don't overflow */
+    return (ticks / qpc_freq) * 1000000 + (ticks % qpc_freq) * 1000000 / qpc_freq;
+}
+
+/* the client's lock sites, in TOSDB_GetLockStats order */
+LockProfile*
+_lockSite(int i)
+{
+    switch(i){
+    case 0: return &global_rmutex_site;
+    case 1: return &buffers_mtx_site;
+    case 2: return &DataStreamLockSite::site;
+    default: return nullptr;
+    }
+}
+
+const size_type NLOCK_SITES = 3;
+
+}; /* namespace */
+
+
+long long
+ApiStatTicks()
+{
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+    return t.QuadPart;
+}
+
+
+bool
+ApiStatEnter(ApiStatId id)
+{
+    Slab* slab = _mySlab();
+    if(slab->depth)
+        return false;
+
+    slab->depth = 1;
+    slab->current = id;
+    return true;
+}
+
+
+void
+ApiStatLeave(ApiStatId id, long long ticks, bool error)
+{
+    Slab* slab = _mySlab();
+    Counters& c = slab->counters[id];
+
+    _bump(c.calls, 1);
+    if(error)
+        _bump(c.errors, 1);
+    _bump(c.ticks, ticks);
+    _raise(c.max_ticks, ticks);
+
+    slab->depth = 0;
+    slab->current = API_STAT_COUNT;
+}
+
+
+void
+ApiStatLockWait(ApiStatId lock_id, long long ticks)
+{
+    Slab* slab = _mySlab();
+    Counters& c = slab->counters[lock_id];
+
+    _bump(c.calls, 1);
+    if(!ticks)
+        return;
+
+    _bump(c.waits, 1);
+    _bump(c.wait_ticks, ticks);
+    _bump(c.ticks, ticks);
+    _raise(c.max_ticks, ticks);
+
+    /* charge it to the call we're in (ApiStatLockGuard checks we are) */
+    Counters& cc = slab->counters[slab->current];
+    _bump(cc.waits, 1);
+    _bump(cc.wait_ticks, ticks);
+}
+
+
+bool
+ApiStatInCall()
+{
+    /* no slab yet, no call yet; don't make one here */
+    Slab* slab = (Slab*)TlsGetValue(tls_index);
+    return slab && slab->current != API_STAT_COUNT;
+}
+
+
+void
+ApiStatThreadDetach()
+{
+    Slab* slab = (Slab*)TlsGetValue(tls_index);
+    if(!slab)
+        return;
+
+    TlsSetValue(tls_index, nullptr);
+
+    std::lock_guard<std::mutex> lock(slabs_mtx);
+    /* --- CRITICAL SECTION --- */
+    if(slab->gen.load(std::memory_order_acquire) == generation.load())
+        _fold(&retired, slab);
+
+    slabs.erase(std::remove(slabs.begin(), slabs.end(), slab), slabs.end());
+    delete slab;
+    /* --- CRITICAL SECTION --- */
+}
+
+
+int
+TOSDB_GetApiStats(pApiStats dest, size_type array_len, size_type* get_size)
+{
+    if(!dest && !get_size)
+        return TOSDB_ERROR_BAD_INPUT;
+
+    if(get_size)
+        *get_size = API_STAT_COUNT;
+
+    if(!dest)
+        return 0;
+
+    try{
+        Slab total;
+        _zero(&total);
+        {
+            std::lock_guard<std::mutex> lock(slabs_mtx);
+            /* --- CRITICAL SECTION --- */
+            unsigned int g = generation.load();
+            _fold(&total, &retired);
+            for(const Slab* s : slabs){
+                if(s->gen.load(std::memory_order_acquire) == g)
+                    _fold(&total, s);
+            }
+            /* --- CRITICAL SECTION --- */
+        }
+
+        for(size_type i = 0; i < std::min<size_type>(array_len, API_STAT_COUNT); ++i){
+            const Counters& c = total.counters[i];
+            strcpy_s(dest[i].name, TOSDB_API_STAT_NAME_SZ, NAMES[i]);
+            dest[i].calls = c.calls.load();
+            dest[i].errors = c.errors.load();
+            dest[i].total_micro = _toMicro(c.ticks.load());
+            dest[i].max_micro = _toMicro(c.max_ticks.load());
+            dest[i].lock_waits = c.waits.load();
+            dest[i].lock_wait_micro = _toMicro(c.wait_ticks.load());
+        }
+        return 0;
+
+    }catch(const std::exception& e){
+        TOSDB_LogH("ApiStats", e.what());
+        return TOSDB_ERROR_UNKNOWN;
+    }
+}
+
+
+int
+TOSDB_ResetApiStats()
+{
+    std::lock_guard<std::mutex> lock(slabs_mtx);
+    /* --- CRITICAL SECTION --- */
+    generation.fetch_add(1);
+    _zero(&retired);
+    return 0;
+    /* --- CRITICAL SECTION --- */
+}
+
+
+int
+TOSDB_SetLockProfiling(BOOL on)
+{
+    for(size_type i = 0; i < NLOCK_SITES; ++i)
+        _lockSite(i)->enabled.store(on ? true : false);
+    return 0;
+}
+
+
+int
+TOSDB_GetLockStats(pLockStats dest, size_type array_len, size_type* get_size)
+{
+    if(!dest && !get_size)
+        return TOSDB_ERROR_BAD_INPUT;
+
+    if(get_size)
+        *get_size = NLOCK_SITES;
+
+    if(!dest)
+        return 0;
+
+    for(size_type i = 0; i < std::min<size_type>(array_len, NLOCK_SITES); ++i){
+        const LockProfile* lp = _lockSite(i);
+        strcpy_s(dest[i].name, TOSDB_API_STAT_NAME_SZ, lp->name);
+        dest[i].acquisitions = lp->acquisitions.load();
+        dest[i].contentions = lp->contentions.load();
+        dest[i].wait_micro = _toMicro(lp->wait_ticks.load());
+        dest[i].max_wait_micro = _toMicro(lp->max_wait_ticks.load());
+        dest[i].hold_micro = _toMicro(lp->hold_ticks.load());
+        dest[i].max_hold_micro = _toMicro(lp->max_hold_ticks.load());
+    }
+    return 0;
+}
+
+
+int
+TOSDB_ResetLockStats()
+{
+    for(size_type i = 0; i < NLOCK_SITES; ++i)
+        _lockSite(i)->reset();
+    return 0;
+}
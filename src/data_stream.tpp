@@ -1,13 +1,16 @@
 #include "data_stream.hpp"
 
 DATASTREAM_INTERFACE_TEMPLATE
-template<typename InTy, typename OutTy>
+const size_t DATASTREAM_INTERFACE_CLASS::MAX_BOUND_SIZE;
+
+DATASTREAM_INTERFACE_TEMPLATE
+template<typename InTy, typename OutTy, typename SecOutTy>
 size_t 
 DATASTREAM_INTERFACE_CLASS::_copy(OutTy *dest, 
                                   size_t sz, 
                                   int end, 
                                   int beg, 
-                                  typename DATASTREAM_INTERFACE_CLASS::secondary_ty *sec) const
+                                  SecOutTy sec) const
 {  
     size_t ret;
 
@@ -24,12 +27,12 @@ DATASTREAM_INTERFACE_CLASS::_copy(OutTy *dest,
 }  
 
 DATASTREAM_INTERFACE_TEMPLATE
-template<typename InTy, typename OutTy>
+template<typename InTy, typename OutTy, typename SecOutTy>
 long long 
 DATASTREAM_INTERFACE_CLASS::_copy_using_atomic_marker(OutTy *dest, 
                                                       size_t sz,         
                                                       int beg, 
-                                                      typename DATASTREAM_INTERFACE_CLASS::secondary_ty *sec) const
+                                                      SecOutTy sec) const
 {  
     long long ret;
 
@@ -50,9 +53,22 @@ size_t
 DATASTREAM_INTERFACE_CLASS::copy(char **dest, 
                                  size_t dest_sz, 
                                  size_t str_sz, 
-                                 int end = -1, 
-                                 int beg = 0 , 
-                                 typename DATASTREAM_INTERFACE_CLASS::secondary_ty *sec = nullptr) const 
+                                 int end, 
+                                 int beg, 
+                                 typename DATASTREAM_INTERFACE_CLASS::secondary_ty *sec) const 
+{ 
+    BuildThrowTypeError<std::string*,false>("copy()");  
+    return 0;
+}
+
+DATASTREAM_INTERFACE_TEMPLATE
+size_t 
+DATASTREAM_INTERFACE_CLASS::copy(char **dest, 
+                                 size_t dest_sz, 
+                                 size_t str_sz, 
+                                 int end, 
+                                 int beg, 
+                                 typename DATASTREAM_INTERFACE_CLASS::secondary_as sec) const 
 { 
     BuildThrowTypeError<std::string*,false>("copy()");  
     return 0;
@@ -62,9 +78,32 @@ DATASTREAM_INTERFACE_TEMPLATE
 size_t 
 DATASTREAM_INTERFACE_CLASS::copy(std::string *dest, 
                                  size_t sz, 
-                                 int end = -1, 
-                                 int beg = 0, 
-                                 typename DATASTREAM_INTERFACE_CLASS::secondary_ty *sec = nullptr) const
+                                 int end, 
+                                 int beg, 
+                                 typename DATASTREAM_INTERFACE_CLASS::secondary_ty *sec) const
+{
+    return _copy_strings(dest, sz, end, beg, sec);
+}
+
+DATASTREAM_INTERFACE_TEMPLATE
+size_t 
+DATASTREAM_INTERFACE_CLASS::copy(std::string *dest, 
+                                 size_t sz, 
+                                 int end, 
+                                 int beg, 
+                                 typename DATASTREAM_INTERFACE_CLASS::secondary_as sec) const
+{
+    return _copy_strings(dest, sz, end, beg, sec);
+}
+
+DATASTREAM_INTERFACE_TEMPLATE
+template<typename SecOutTy>
+size_t 
+DATASTREAM_INTERFACE_CLASS::_copy_strings(std::string *dest, 
+                                          size_t sz, 
+                                          int end, 
+                                          int beg, 
+                                          SecOutTy sec) const
 {
     size_t ret;
 
@@ -85,8 +124,20 @@ long long
 DATASTREAM_INTERFACE_CLASS::copy_from_marker(char **dest, 
                                              size_t dest_sz, 
                                              size_t str_sz,             
-                                             int beg = 0, 
-                                             typename DATASTREAM_INTERFACE_CLASS::secondary_ty *sec = nullptr) const 
+                                             int beg, 
+                                             typename DATASTREAM_INTERFACE_CLASS::secondary_ty *sec) const 
+{ 
+    BuildThrowTypeError<std::string*,false>("copy_from_marker()");  
+    return 0;
+}
+
+DATASTREAM_INTERFACE_TEMPLATE
+long long 
+DATASTREAM_INTERFACE_CLASS::copy_from_marker(char **dest, 
+                                             size_t dest_sz, 
+                                             size_t str_sz,             
+                                             int beg, 
+                                             typename DATASTREAM_INTERFACE_CLASS::secondary_as sec) const 
 { 
     BuildThrowTypeError<std::string*,false>("copy_from_marker()");  
     return 0;
@@ -96,8 +147,8 @@ DATASTREAM_INTERFACE_TEMPLATE
 long long 
 DATASTREAM_INTERFACE_CLASS::copy_from_marker(std::string *dest, 
                                              size_t sz,                     
-                                             int beg = 0, 
-                                             typename DATASTREAM_INTERFACE_CLASS::secondary_ty *sec = nullptr) const
+                                             int beg, 
+                                             typename DATASTREAM_INTERFACE_CLASS::secondary_ty *sec) const
 {
     long long ret;
 
@@ -132,9 +183,9 @@ DATASTREAM_PRIMARY_CLASS::_push(const Ty v)
 } 
 
 DATASTREAM_PRIMARY_TEMPLATE
-template<typename T>
+template<typename DequeTy>
 bool
-DATASTREAM_PRIMARY_CLASS::_check_adj(int& end, int& beg, const std::deque<T,Allocator>& d) const
+DATASTREAM_PRIMARY_CLASS::_check_adj(int& end, int& beg, const DequeTy& d) const
 { 
     int sz = (int)d.size(); /* O.K. sz can't be > INT_MAX  */
     if(_qbound != sz)
@@ -191,6 +242,25 @@ DATASTREAM_PRIMARY_CLASS::_copy_to_ptr(DequeTy& d,
     return (b_iter < e_iter) ? (std::copy(b_iter, e_iter, dest) - dest) : 0;     
 }
 
+DATASTREAM_PRIMARY_TEMPLATE
+template<typename DequeTy> 
+size_t 
+DATASTREAM_PRIMARY_CLASS::_copy_to_ptr(DequeTy& d, 
+                                       typename DATASTREAM_PRIMARY_CLASS::secondary_as sec, 
+                                       size_t sz, 
+                                       unsigned int end, 
+                                       unsigned int beg) const
+{  
+    auto b_iter = d.cbegin() + beg;
+    auto e_iter = d.cbegin() + std::min<size_t>(sz+beg, std::min<size_t>(++end, _qcount));
+
+    size_t i = 0;
+    for( ; b_iter < e_iter; ++b_iter, ++i)
+        sec(i, *b_iter);
+
+    return i;
+}
+
 DATASTREAM_PRIMARY_TEMPLATE
 DATASTREAM_PRIMARY_CLASS::DataStream(size_t sz)
     : 
@@ -200,7 +270,7 @@ DATASTREAM_PRIMARY_CLASS::DataStream(size_t sz)
         _mark_count(new long long(-1)),
         _mark_is_dirty(new bool(false)),      
         _push_has_priority(true),
-        _mtx(new std::recursive_mutex)
+        _mtx(new _my_mutex_type(DataStreamLockSite::site))
     {      
     }
 
@@ -213,7 +283,7 @@ DATASTREAM_PRIMARY_CLASS::DataStream(const typename DATASTREAM_PRIMARY_CLASS::_m
         _mark_count(new long long(*(stream._mark_count))),
         _mark_is_dirty(new bool(*(stream._mark_is_dirty))),    
         _push_has_priority(true),
-        _mtx(new std::recursive_mutex)
+        _mtx(new _my_mutex_type(DataStreamLockSite::site))
     {      
     }
 
@@ -278,11 +348,9 @@ DATASTREAM_PRIMARY_CLASS::bound_size(size_t sz)
 
 
 DATASTREAM_PRIMARY_TEMPLATE
+template<typename F>
 long long
-DATASTREAM_PRIMARY_CLASS::copy_from_marker(Ty *dest, 
-                                           size_t sz,              
-                                           int beg = 0, 
-                                           typename DATASTREAM_PRIMARY_CLASS::secondary_ty *sec = nullptr) const 
+DATASTREAM_PRIMARY_CLASS::_copy_from_marker(int beg, F copy_to) const 
 {         
     /* 1) we need to cache mark vals before copy changes state
        2) adjust beg here; _check_adj requires a ref that we can't pass
@@ -305,7 +373,7 @@ DATASTREAM_PRIMARY_CLASS::copy_from_marker(Ty *dest,
         return 0;
 
     /* CAREFUL: we cant have a negative *_mark_count past this point */
-    copy_sz = (long long)copy(dest, sz, (int)(*_mark_count), beg, sec);          
+    copy_sz = (long long)copy_to((int)(*_mark_count), beg);          
 
     if(was_dirty || copy_sz < req_sz)
         /* IF mark is dirty (i.e hits back of stream) or we
@@ -315,54 +383,64 @@ DATASTREAM_PRIMARY_CLASS::copy_from_marker(Ty *dest,
     return copy_sz;
     /* --- CRITICAL SECTION --- */
 }
+
+DATASTREAM_PRIMARY_TEMPLATE
+long long
+DATASTREAM_PRIMARY_CLASS::copy_from_marker(Ty *dest, 
+                                           size_t sz,              
+                                           int beg, 
+                                           typename DATASTREAM_PRIMARY_CLASS::secondary_ty *sec) const 
+{         
+    return _copy_from_marker(beg, [&](int e, int b){ 
+        return copy(dest, sz, e, b, sec); 
+    });
+}
   
 DATASTREAM_PRIMARY_TEMPLATE
 long long
 DATASTREAM_PRIMARY_CLASS::copy_from_marker(char **dest, 
                                            size_t dest_sz, 
                                            size_t str_sz,                
-                                           int beg = 0, 
-                                           typename DATASTREAM_PRIMARY_CLASS::secondary_ty *sec = nullptr) const 
+                                           int beg, 
+                                           typename DATASTREAM_PRIMARY_CLASS::secondary_ty *sec) const 
 {  
-   /* 1) we need to cache mark vals before copy changes state
-      2) adjust beg here; _check_adj requires a ref that we can't pass
-      3) casts to long long O.K as long as MAX_BOUND_SIZE == INT_MAX */   
-
-    long long copy_sz, req_sz;    
-
-    _yld_to_push();
-    _my_lock_guard_type lock(*_mtx);
-    /* --- CRITICAL SECTION --- */
-    bool was_dirty = *_mark_is_dirty;
-          
-    if(beg < 0)       
-        beg += (int)size();
-
-    req_sz = *_mark_count - (long long)beg + 1;     
-    if(beg < 0 || req_sz < 1) 
-        /* if beg is still invalid or > marker ... CALLER'S PROBLEM
-           req_sz needs to account for inclusive range by adding 1 */
-        return 0;
-
-    /* CAREFUL: we cant have a negative *_mark_count past this point */
-    copy_sz = (long long)copy(dest, dest_sz, str_sz, (int)(*_mark_count), beg, sec);          
-
-    if(was_dirty || copy_sz < req_sz)
-        /* IF mark is dirty (i.e hits back of stream) or we
-           don't copy enough(sz is too small) return negative size */            
-        copy_sz *= -1;      
+    return _copy_from_marker(beg, [&](int e, int b){ 
+        return copy(dest, dest_sz, str_sz, e, b, sec); 
+    });
+}
 
-    return copy_sz;
-    /* --- CRITICAL SECTION --- */
+DATASTREAM_PRIMARY_TEMPLATE
+long long
+DATASTREAM_PRIMARY_CLASS::copy_from_marker(Ty *dest, 
+                                           size_t sz,              
+                                           int beg, 
+                                           typename DATASTREAM_PRIMARY_CLASS::secondary_as sec) const 
+{         
+    return _copy_from_marker(beg, [&](int e, int b){ 
+        return copy(dest, sz, e, b, sec); 
+    });
+}
+  
+DATASTREAM_PRIMARY_TEMPLATE
+long long
+DATASTREAM_PRIMARY_CLASS::copy_from_marker(char **dest, 
+                                           size_t dest_sz, 
+                                           size_t str_sz,                
+                                           int beg, 
+                                           typename DATASTREAM_PRIMARY_CLASS::secondary_as sec) const 
+{  
+    return _copy_from_marker(beg, [&](int e, int b){ 
+        return copy(dest, dest_sz, str_sz, e, b, sec); 
+    });
 }
     
 DATASTREAM_PRIMARY_TEMPLATE
 size_t
 DATASTREAM_PRIMARY_CLASS::copy(Ty *dest, 
                                size_t sz, 
-                               int end = -1, 
-                               int beg = 0, 
-                               typename DATASTREAM_PRIMARY_CLASS::secondary_ty *sec = nullptr) const 
+                               int end, 
+                               int beg, 
+                               typename DATASTREAM_PRIMARY_CLASS::secondary_ty *sec) const 
 {  
     size_t ret;
 
@@ -388,15 +466,30 @@ DATASTREAM_PRIMARY_CLASS::copy(Ty *dest,
     return ret;
     /* --- CRITICAL SECTION --- */
 }
+
+DATASTREAM_PRIMARY_TEMPLATE
+size_t
+DATASTREAM_PRIMARY_CLASS::copy(Ty *dest, 
+                               size_t sz, 
+                               int end, 
+                               int beg, 
+                               typename DATASTREAM_PRIMARY_CLASS::secondary_as sec) const 
+{  
+    size_t ret = copy(dest, sz, end, beg);
+    if(sec.dest) /* no secondaries to convert */
+        std::fill_n(sec.dest, ret, 0LL);
+
+    return ret;
+}
     
 DATASTREAM_PRIMARY_TEMPLATE
 size_t
 DATASTREAM_PRIMARY_CLASS::copy(char **dest, 
                                size_t dest_sz, 
                                size_t str_sz, 
-                               int end = -1, 
-                               int beg = 0, 
-                               typename DATASTREAM_PRIMARY_CLASS::secondary_ty *sec = nullptr) const 
+                               int end, 
+                               int beg, 
+                               typename DATASTREAM_PRIMARY_CLASS::secondary_ty *sec) const 
 {  /* 
     * slow(er), has to go thru generic_ty to get strings 
     * note: if sz <= gstr.length() the string is truncated 
@@ -429,6 +522,135 @@ DATASTREAM_PRIMARY_CLASS::copy(char **dest,
     /* --- CRITICAL SECTION --- */
 }
 
+DATASTREAM_PRIMARY_TEMPLATE
+size_t
+DATASTREAM_PRIMARY_CLASS::copy(char **dest, 
+                               size_t dest_sz, 
+                               size_t str_sz, 
+                               int end, 
+                               int beg, 
+                               typename DATASTREAM_PRIMARY_CLASS::secondary_as sec) const 
+{  
+    size_t ret = copy(dest, dest_sz, str_sz, end, beg);
+    if(sec.dest) /* no secondaries to convert */
+        std::fill_n(sec.dest, ret, 0LL);
+
+    return ret;
+}
+
+DATASTREAM_PRIMARY_TEMPLATE
+size_t
+DATASTREAM_PRIMARY_CLASS::_copy_strided(const typename DATASTREAM_PRIMARY_CLASS::_secondary_deque_type *dsec,
+                                        double *dest, 
+                                        size_t sz, 
+                                        size_t stride, 
+                                        int end, 
+                                        int beg, 
+                                        typename DATASTREAM_PRIMARY_CLASS::secondary_ty *sec) const
+{
+    size_t i, indx, last;
+
+    if(!dest)
+        throw DataStreamInvalidArgument("NULL dest argument");
+
+    if(!stride)
+        throw DataStreamInvalidArgument("stride of 0");
+
+    if(std::is_same<Ty,std::string>::value)
+        BuildThrowTypeError<double*,false>("copy_strided()");
+
+    _yld_to_push();
+    _my_lock_guard_type lock(*_mtx);
+    /* --- CRITICAL SECTION --- */
+    _check_adj(end, beg, _deque_primary);
+
+    last = std::min<size_t>(++end, _qcount); /* one past */
+    for( i = 0, indx = beg; 
+         (i < sz) && (indx < last); 
+         ++i, indx = (last - indx > stride) ? indx + stride : last )
+    {
+        dest[i] = _as_double(_deque_primary[indx]);
+        if(sec && dsec)
+            sec[i] = (*dsec)[indx];
+    }
+
+    *_mark_count = beg - 1;
+    *_mark_is_dirty = false;
+
+    return i;
+    /* --- CRITICAL SECTION --- */
+}
+
+DATASTREAM_PRIMARY_TEMPLATE
+size_t
+DATASTREAM_PRIMARY_CLASS::_copy_decimated(const typename DATASTREAM_PRIMARY_CLASS::_secondary_deque_type *dsec,
+                                          double *dest, 
+                                          size_t sz, 
+                                          int end, 
+                                          int beg, 
+                                          typename DATASTREAM_PRIMARY_CLASS::secondary_ty *sec) const
+{
+    size_t i, last, len, nbuckets;
+
+    if(!dest)
+        throw DataStreamInvalidArgument("NULL dest argument");
+
+    if(sz < 4)
+        throw DataStreamInvalidArgument("decimated copy needs room for >= 4 points");
+
+    if(std::is_same<Ty,std::string>::value)
+        BuildThrowTypeError<double*,false>("copy_decimated()");
+
+    _yld_to_push();
+    _my_lock_guard_type lock(*_mtx);
+    /* --- CRITICAL SECTION --- */
+    _check_adj(end, beg, _deque_primary);
+
+    last = std::min<size_t>(++end, _qcount); /* one past */
+    len = (last > (size_t)beg) ? last - beg : 0;  
+
+    *_mark_count = beg - 1;
+    *_mark_is_dirty = false;
+
+    if(len <= sz) /* nothing to drop */
+        return _copy_strided(dsec, dest, sz, 1, end - 1, beg, sec);
+
+    nbuckets = sz / 4;
+    i = 0;
+    for(size_t b = 0; b < nbuckets; ++b){
+        /* ull: len * nbuckets can overflow a 32-bit size_t */
+        size_t lo = beg + (size_t)((unsigned long long)len * b / nbuckets);
+        size_t hi = beg + (size_t)((unsigned long long)len * (b + 1) / nbuckets);
+        size_t imin = lo, imax = lo;
+
+        auto iter = _deque_primary.cbegin() + lo;
+        Ty vmin = *iter, vmax = *iter;
+        for(size_t indx = lo + 1; indx < hi; ++indx){
+            const Ty& v = *(++iter);
+            if(v < vmin){
+                vmin = v;
+                imin = indx;
+            }else if(vmax < v){
+                vmax = v;
+                imax = indx;
+            }
+        }
+
+        size_t picks[4] = {lo, std::min(imin, imax), std::max(imin, imax), hi - 1};
+        for(int p = 0; p < 4; ++p){
+            if(p && picks[p] == picks[p-1])
+                continue;
+            dest[i] = _as_double(_deque_primary[picks[p]]);
+            if(sec && dsec)
+                sec[i] = (*dsec)[picks[p]];
+            ++i;
+        }
+    }
+
+    return i;
+    /* --- CRITICAL SECTION --- */
+}
+
 DATASTREAM_PRIMARY_TEMPLATE
 typename DATASTREAM_PRIMARY_CLASS::generic_ty
 DATASTREAM_PRIMARY_CLASS::operator[](int indx) const
@@ -465,7 +687,7 @@ DATASTREAM_PRIMARY_CLASS::both(int indx) const
 
 DATASTREAM_PRIMARY_TEMPLATE
 typename DATASTREAM_PRIMARY_CLASS::generic_vector_ty
-DATASTREAM_PRIMARY_CLASS::vector(int end = -1, int beg = 0) const 
+DATASTREAM_PRIMARY_CLASS::vector(int end, int beg) const 
 {  
     generic_vector_ty tmp;  
     
@@ -497,7 +719,7 @@ DATASTREAM_PRIMARY_CLASS::vector(int end = -1, int beg = 0) const
 
 DATASTREAM_PRIMARY_TEMPLATE
 typename DATASTREAM_PRIMARY_CLASS::secondary_vector_ty
-DATASTREAM_PRIMARY_CLASS::secondary_vector(int end = -1, int beg = 0) const
+DATASTREAM_PRIMARY_CLASS::secondary_vector(int end, int beg) const
 {        
     _check_adj(end, beg, _deque_primary);                      
     return secondary_vector_ty(std::min< size_t >(++end - beg, _qcount));
@@ -566,9 +788,9 @@ DATASTREAM_SECONDARY_TEMPLATE
 size_t
 DATASTREAM_SECONDARY_CLASS::copy(Ty *dest, 
                                  size_t sz, 
-                                 int end = -1, 
-                                 int beg = 0, 
-                                 typename DATASTREAM_SECONDARY_CLASS::secondary_ty *sec = nullptr) const 
+                                 int end, 
+                                 int beg, 
+                                 typename DATASTREAM_SECONDARY_CLASS::secondary_ty *sec) const 
 {   
     size_t ret;
 
@@ -595,14 +817,46 @@ DATASTREAM_SECONDARY_CLASS::copy(Ty *dest,
     /* --- CRITICAL SECTION --- */
 }
 
+DATASTREAM_SECONDARY_TEMPLATE
+size_t
+DATASTREAM_SECONDARY_CLASS::copy(Ty *dest, 
+                                 size_t sz, 
+                                 int end, 
+                                 int beg, 
+                                 typename DATASTREAM_SECONDARY_CLASS::secondary_as sec) const 
+{   
+    size_t ret;
+
+    if(!dest)
+        throw DataStreamInvalidArgument("NULL dest argument");
+
+    _my_lock_guard_type lock(*_mtx); 
+    /* --- CRITICAL SECTION --- */
+    ret = _my_base_ty::copy(dest, sz, end, beg); /*_mark_count reset by _my_base_ty*/
+      
+    if(!sec.dest)
+        return ret;
+        
+    _check_adj(end, beg, _deque_secondary); /*repeat to update index vals */ 
+ 
+    if(end == beg){  
+        sec(0, beg ? _deque_secondary.at(beg) : _deque_secondary.front());
+        ret = 1;
+    }else  
+        ret = _copy_to_ptr(_deque_secondary, sec, sz, end, beg);  
+
+    return ret;
+    /* --- CRITICAL SECTION --- */
+}
+
 DATASTREAM_SECONDARY_TEMPLATE
 size_t
 DATASTREAM_SECONDARY_CLASS::copy(char **dest, 
                                  size_t dest_sz, 
                                  size_t str_sz, 
-                                 int end = -1, 
-                                 int beg = 0, 
-                                 typename DATASTREAM_SECONDARY_CLASS::secondary_ty *sec = nullptr) const 
+                                 int end, 
+                                 int beg, 
+                                 typename DATASTREAM_SECONDARY_CLASS::secondary_ty *sec) const 
 {    
     size_t ret;
 
@@ -628,6 +882,39 @@ DATASTREAM_SECONDARY_CLASS::copy(char **dest,
     /* --- CRITICAL SECTION --- */
     return ret;
 }
+
+DATASTREAM_SECONDARY_TEMPLATE
+size_t
+DATASTREAM_SECONDARY_CLASS::copy(char **dest, 
+                                 size_t dest_sz, 
+                                 size_t str_sz, 
+                                 int end, 
+                                 int beg, 
+                                 typename DATASTREAM_SECONDARY_CLASS::secondary_as sec) const 
+{    
+    size_t ret;
+
+    if(!dest)
+        throw DataStreamInvalidArgument("NULL dest argument");
+
+    _my_lock_guard_type lock(*_mtx);
+    /* --- CRITICAL SECTION --- */
+    ret = _my_base_ty::copy(dest, dest_sz, str_sz, end, beg);
+
+    if(!sec.dest)
+        return ret;
+    
+    _check_adj(end, beg, _deque_secondary); /*repeat to update index vals*/ 
+
+    if(end == beg){
+        sec(0, beg ? _deque_secondary.at(beg) : _deque_secondary.front());
+        ret = 1;
+    }else
+        ret = _copy_to_ptr(_deque_secondary, sec, dest_sz, end, beg);    
+
+    /* --- CRITICAL SECTION --- */
+    return ret;
+}
   
 DATASTREAM_SECONDARY_TEMPLATE
 typename DATASTREAM_SECONDARY_CLASS::both_ty
@@ -669,7 +956,7 @@ DATASTREAM_SECONDARY_CLASS::secondary(typename DATASTREAM_SECONDARY_CLASS::secon
 
 DATASTREAM_SECONDARY_TEMPLATE
 typename DATASTREAM_SECONDARY_CLASS::secondary_vector_ty
-DATASTREAM_SECONDARY_CLASS::secondary_vector(int end = -1, int beg = 0) const
+DATASTREAM_SECONDARY_CLASS::secondary_vector(int end, int beg) const
 {   
     secondary_vector_ty tmp; 
      
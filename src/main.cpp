@@ -67,12 +67,18 @@ DllMain(HINSTANCE mod, DWORD why, LPVOID res)
 /* IMPLEMENTATION ONLY */
 
 std::string 
-CreateBufferName(std::string topic_str, std::string item)
+CreateBufferName(std::string topic_str, std::string item, unsigned int shard, bool standby)
 {     /* 
       * name of mapping is of form: "TOSDB_[topic name]_[item_name]"  
+      * (or "TOSDB_S[shard]_[topic name]_[item_name]" for shards other than 0,
+      * w/ "B_" before the topic for standby engines)
       * only alpha-numeric characters (except under-score) 
       */
       std::string str("TOSDB_");
+      if(shard)
+          str.append("S" + std::to_string(shard) + "_");
+      if(standby)
+          str.append("B_");
       str.append( topic_str.append("_" + item) );
 
       auto f = [](char x){ return !isalnum(x) && x != '_'; };
@@ -85,6 +91,51 @@ CreateBufferName(std::string topic_str, std::string item)
 #endif
 }
 
+std::string
+CreateCommChannelName(unsigned int shard, bool standby)
+{
+    std::string str(TOSDB_COMM_CHANNEL);
+    if(shard)
+        str.append("_shard" + std::to_string(shard));
+    if(standby)
+        str.append("_standby");
+    return str;
+}
+
+
+std::string
+CreateControlName(unsigned int shard)
+{
+    std::string str("TOSDB_");
+    if(shard)
+        str.append("S" + std::to_string(shard) + "_");
+    str.append("control");
+
+#ifdef NO_KGBLNS
+    return str;
+#else
+    return std::string("Global\\").append(str);
+#endif
+}
+
+
+std::string
+CreateSharedBlockName(std::string id, std::string topic_str, std::string item)
+{   /* 
+     * made by client processes, which can't create in the global namespace;
+     * so only processes in the owner's session can attach 
+     */
+    std::string str("TOSDB_SB_" + id);
+    if( !topic_str.empty() )
+        str.append("_" + topic_str + "_" + item);
+
+    auto f = [](char x){ return !isalnum(x) && x != '_'; };
+    str.erase(std::remove_if(str.begin(), str.end(), f), str.end());
+
+    return std::string("Local\\").append(str);
+}
+
+
 std::string
 BuildLogPath(std::string name)
 {
@@ -24,12 +24,15 @@ RAW_DATA_BLOCK_CLASS::RawDataBlock(str_set_type items,
     }
 
 RAW_DATA_BLOCK_TEMPLATE
-RAW_DATA_BLOCK_CLASS::RawDataBlock(const size_type sz, bool datetime)
+RAW_DATA_BLOCK_CLASS::RawDataBlock(const size_type sz, 
+                                   bool datetime, 
+                                   typename RAW_DATA_BLOCK_CLASS::_my_streams_ty *streams)
     : 
         _item_names(),
         _topic_enums(),  
         _block_sz(sz),
         _datetime(datetime),
+        _streams(streams),
         _mtx(new std::recursive_mutex)
     {
         ++_block_count_;
@@ -42,7 +45,7 @@ RAW_DATA_BLOCK_CLASS::_init()
     std::lock_guard<std::recursive_mutex> lock(*_mtx);
     /* --- CRITICAL SECTION --- */
     for(auto & i : _item_names) {
-        auto tmp = _populate_tblock( std::unique_ptr<_my_row_ty>(new _my_row_ty) );
+        auto tmp = _populate_tblock( i, std::unique_ptr<_my_row_ty>(new _my_row_ty) );
         _block.insert( _my_block_ty::value_type(i, std::move(tmp)) );   
     }
     /* --- CRITICAL SECTION --- */
@@ -51,11 +54,14 @@ RAW_DATA_BLOCK_CLASS::_init()
 RAW_DATA_BLOCK_TEMPLATE 
 typename RAW_DATA_BLOCK_CLASS::_my_row_ty* 
 RAW_DATA_BLOCK_CLASS::_insert_topic( typename RAW_DATA_BLOCK_CLASS::_my_row_ty* row, 
+                                     std::string item,
                                      TOS_Topics::TOPICS topic )
 {    
     DataStreamInterface<DateTimeTy, GenericTy> *stream; 
 
-    switch(TOS_Topics::TypeBits(topic)){ 
+    if(_streams)
+        stream = _streams->create(item, topic, _block_sz, _datetime);
+    else switch(TOS_Topics::TypeBits(topic)){ 
     case TOSDB_STRING_BIT :
         stream = _datetime 
                ? new DataStream<std::string, datetime_type, generic_type, true>(_block_sz) 
@@ -101,10 +107,11 @@ RAW_DATA_BLOCK_CLASS::_insert_topic( typename RAW_DATA_BLOCK_CLASS::_my_row_ty*
 
 RAW_DATA_BLOCK_TEMPLATE
 std::unique_ptr<typename RAW_DATA_BLOCK_CLASS::_my_row_ty> 
-RAW_DATA_BLOCK_CLASS::_populate_tblock(std::unique_ptr<typename RAW_DATA_BLOCK_CLASS::_my_row_ty> tblock)
+RAW_DATA_BLOCK_CLASS::_populate_tblock(std::string item,
+                                       std::unique_ptr<typename RAW_DATA_BLOCK_CLASS::_my_row_ty> tblock)
 {    
     for(auto elem : _topic_enums)
-        _insert_topic(tblock.get(), elem);
+        _insert_topic(tblock.get(), item, elem);
 
     return tblock;
 }
@@ -130,12 +137,17 @@ RAW_DATA_BLOCK_CLASS::CreateBlock(const str_set_type items,
 
 RAW_DATA_BLOCK_TEMPLATE
 RAW_DATA_BLOCK_CLASS* const
-RAW_DATA_BLOCK_CLASS::CreateBlock(const size_type sz,const bool datetime) 
+RAW_DATA_BLOCK_CLASS::CreateBlock(const size_type sz,
+                                  const bool datetime,
+                                  typename RAW_DATA_BLOCK_CLASS::streams_type *streams) 
 {
-    if (_block_count_ >= _max_block_count_) 
+    if (_block_count_ >= _max_block_count_){ 
+        if(streams)
+            delete streams;
         throw TOSDB_DataBlockLimitError(_max_block_count_);
+    }
       
-    return new RawDataBlock(sz, datetime);             
+    return new RawDataBlock(sz, datetime, streams);             
 }
 
 RAW_DATA_BLOCK_TEMPLATE
@@ -147,6 +159,9 @@ RAW_DATA_BLOCK_CLASS::block_size(size_type b)
     if(b > TOSDB_MAX_BLOCK_SZ)
         b = TOSDB_MAX_BLOCK_SZ; 
 
+    if(_streams && b != _block_sz) /* the streams' segments are already made */
+        throw TOSDB_DataBlockError("can't change the size of a shared block");
+
     for(auto& col : _block){
         for(auto& row : *(col.second))
             row.second->bound_size(b);
@@ -208,7 +223,13 @@ RAW_DATA_BLOCK_CLASS::add_item(std::string item)
         
         _block.erase(item);
 
-        auto tmp = _populate_tblock( std::unique_ptr<_my_row_ty>(new _my_row_ty) );
+        std::unique_ptr<_my_row_ty> tmp;
+        try{
+            tmp = _populate_tblock( item, std::unique_ptr<_my_row_ty>(new _my_row_ty) );
+        }catch(...){ /* a stream we couldn't have */
+            _item_names.erase(item);
+            throw;
+        }
 
         _block.insert( _my_block_ty::value_type(item,std::move(tmp)) );           
         /* --- CRITICAL SECTION --- */
@@ -256,8 +277,15 @@ RAW_DATA_BLOCK_CLASS::add_topic(TOS_Topics::TOPICS topic)
         if( !(_topic_enums.insert(topic).second) )
             return;
         
-        for(auto & elem : _block)
-            _insert_topic(elem.second.get(), topic);         
+        try{
+            for(auto & elem : _block)
+                _insert_topic(elem.second.get(), elem.first, topic);         
+        }catch(...){ /* a stream we couldn't have; back out */
+            for(auto & elem : _block)
+                elem.second->erase(topic);
+            _topic_enums.erase(topic);
+            throw;
+        }
         /* --- CRITICAL SECTION --- */
     }catch(const std::exception & e){
         throw TOSDB_DataBlockError(e, "add_topic");
@@ -24,10 +24,18 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #include <fstream>
 #include <iomanip>
 #include <cctype>
+#include <mutex>
+#include <deque>
 
 #include "tos_databridge.h"
 #include "ipc.hpp"
 #include "concurrency.hpp"
+#include "lock_profile.hpp"
+#include "thread_sched.hpp"
+#include "advise_links.hpp"
+#include "buffer_ring.hpp"
+#include "failover.hpp"
+#include "string_dict.hpp"
 
 namespace { 
 
@@ -36,6 +44,7 @@ typedef struct{
     void*        raw_addr; /* physical location in our process space */
     unsigned int raw_sz;   /* physical size of the buffer */
     void*        hmtx;  
+    StringDictWriter* dict; /* string topics: codes in the ring (string_dict.hpp) */
 } StreamBuffer, *pStreamBuffer;
 
 typedef std::map<std::string, size_t>  item_refcounts_ty;
@@ -58,12 +67,39 @@ LPCSTR LOG_NAME = "engine-log.log";
 LPCSTR ERR_LOG_NAME = "engine-stderr.log";
 #endif
 
+/* read from the engine's directory at startup (see thread_sched.hpp) */
+LPCSTR THREAD_CONFIG_NAME = "tos-databridge-threads.cfg";
+
+/* '--shard N'; picks our IPC channel and buffer names (see shard_map.hpp) */
+unsigned int engine_shard = 0;
+
+/* '--standby'; slot 1 in the shard's control segment (see failover.hpp) */
+bool engine_standby = false;
+
+/* '--history N'; every stream buffer holds (at least) the last N ticks, for 
+   clients to prefill new blocks with (TOSDB_SetPrefill); 0 is the usual 
+   TOSDB_SHEM_BUF_SZ buffer */
+unsigned int history_depth = 0;
+HANDLE ctrl_hndl = NULL;
+EngineControl *ctrl = NULL;
+
+/* while we're the active engine every stream op that succeeds is replayed 
+   on the other one by MirrorLoop; mirror_streams is what the ref-counts 
+   look like to the IPC thread (what a resync replays). guarded by mirror_mtx */
+std::deque<std::string> mirror_queue;
+std::map<buffer_id_ty, size_t> mirror_streams;
+bool mirror_synced = false;
+HANDLE mirror_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+LightWeightMutex mirror_mtx;
+
 const system_clock_type  system_clock;
 
 const unsigned int ACL_SIZE = 96;
 const int NSECURABLE = 2;
 
-/* our 'private' messages; OK between 0x0400 and 0x7fff */
+/* our 'private' messages; OK between 0x0400 and 0x7fff; the ..._DDE_ITEM 
+   ones carry the item as a global atom (PostItemMsg) that the msg thread 
+   takes over */
 const unsigned int LINK_DDE_ITEM = 0x0500;
 const unsigned int REQUEST_DDE_ITEM = 0x0501;
 const unsigned int DELINK_DDE_ITEM = 0x0502;
@@ -89,20 +125,49 @@ std::map<TOS_Topics::TOPICS, item_refcounts_ty> topic_refcounts;
 
 convos_ty convos; 
 
-LightWeightMutex topic_mtx;
-LightWeightMutex buffer_mtx;
+/* always profiled; written out by DumpBufferStatus */
+LockProfile topic_mtx_site("topic_mtx", true);
+LockProfile buffer_mtx_site("buffer_mtx", true);
+
+ProfiledMutex<LightWeightMutex> topic_mtx(topic_mtx_site);
+ProfiledMutex<LightWeightMutex> buffer_mtx(buffer_mtx_site);
 SignalManager ack_signals;
 
 /* !!! 'buffer_lock_guard_' is reserved inside this namespace !!! */
-#define BUFFER_LOCK_GUARD WinLockGuard buffer_lock_guard_(buffer_mtx)
+#define BUFFER_LOCK_GUARD \
+    std::lock_guard<ProfiledMutex<LightWeightMutex>> buffer_lock_guard_(buffer_mtx)
+
+/* priority settings (TOSDB_SetStreamPriority); guarded by topic_mtx */
+std::map<TOS_Topics::TOPICS, int> topic_priorities;
+std::map<std::string, int> item_priorities;
+std::map<buffer_id_ty, int> stream_priorities;
+std::atomic<unsigned int> priority_gen(0); /* bumped on every change */
+
+/* !!! 'topic_lock_guard_' is reserved inside this namespace !!! */
+#define TOPIC_LOCK_GUARD \
+    std::lock_guard<ProfiledMutex<LightWeightMutex>> topic_lock_guard_(topic_mtx)
+
+/* most WM_DDE_DATA messages we pull off the queue before routing them */
+const int MAX_DATA_BATCH = 512;
+
+/* acks PostBulk is waiting on (0 = none yet, 1 = positive, -1 = negative), 
+   how many are still out, and the event set when that hits 0; guarded by 
+   bulk_mtx (WM_DDE_ACK checks here before ack_signals) */
+std::map<std::string, int> bulk_acks;
+size_t bulk_pending = 0;
+HANDLE bulk_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+LightWeightMutex bulk_mtx;
+
+/* the service's call times out at TOSDB_DEF_TIMEOUT; leave room to reply */
+const unsigned long BULK_LINK_TIMEOUT = TOSDB_DEF_TIMEOUT / 2;
 
 HANDLE init_event = NULL;
 HANDLE msg_thrd = NULL;
 HWND msg_window = NULL;
 DWORD msg_thrd_id = 0;
+HANDLE probe_thrd = NULL; /* IPCSlave's */
 LPCSTR msg_window_name = "TOSDB_ENGINE_MSG_WNDW";
   
-volatile bool pause_flag = false;
 volatile bool shutdown_flag = false;
 
 /* forward decl */
@@ -112,6 +177,27 @@ class DDE_Data;
 bool
 CheckExecType(LPSTR cmd);
 
+void
+ParseEngineArgs(LPSTR cmd);
+
+std::string
+InstanceName(std::string name);
+
+bool
+OpenControlSegment();
+
+DWORD WINAPI
+HeartbeatLoop(LPVOID lParam);
+
+DWORD WINAPI
+MirrorLoop(LPVOID lParam);
+
+void
+MirrorStreamOp(unsigned int op, TOS_Topics::TOPICS topic, std::string item, unsigned long timeout);
+
+int
+MirrorReset(unsigned long timeout);
+
 DWORD WINAPI     
 ThreadedWinInit(LPVOID lParam);
 
@@ -164,6 +250,21 @@ PostItem(std::string item,TOS_Topics::TOPICS topic_t, unsigned long timeout);
 bool 
 PostCloseItem(std::string item,TOS_Topics::TOPICS topic_t, unsigned long timeout);   
 
+std::vector<buffer_id_ty>
+PostBulk(unsigned int op, const std::vector<buffer_id_ty>& streams, unsigned long timeout);
+
+bool
+PostItemMsg(unsigned int msg, HWND convo, const std::string& item);
+
+bool
+BulkAck(const std::string& sid, bool pos);
+
+/* TOSDB_SIG_PAUSE unlinks every stream, TOSDB_SIG_CONTINUE links them again */
+AdviseLinks<buffer_id_ty> advise_links(
+    [](const std::vector<buffer_id_ty>& s){ return PostBulk(LINK_DDE_ITEM, s, BULK_LINK_TIMEOUT); },
+    [](const std::vector<buffer_id_ty>& s){ return PostBulk(DELINK_DDE_ITEM, s, BULK_LINK_TIMEOUT); }
+);
+
 bool 
 CreateBuffer(TOS_Topics::TOPICS topic_t, 
              std::string item, 
@@ -174,7 +275,7 @@ DestroyBuffer(TOS_Topics::TOPICS topic_t, std::string item);
 
 template<typename T> 
 void 
-RouteToBuffer(DDE_Data<T> data); 
+RouteToBuffer(std::vector<DDE_Data<T>>& data); 
 
 LRESULT CALLBACK 
 WndProc(HWND, UINT, WPARAM, LPARAM);  
@@ -182,6 +283,21 @@ WndProc(HWND, UINT, WPARAM, LPARAM);
 void 
 HandleData(UINT msg, WPARAM wparam, LPARAM lparam);
 
+void
+DrainData();
+
+int
+SetPriority(TOS_Topics::TOPICS topic_t, std::string item, int priority);
+
+int
+GetPriority(TOS_Topics::TOPICS topic_t, const std::string& item);
+
+int
+SetEngineThreadSchedule(int thread, unsigned long long cpu_mask, int priority);
+
+void
+LoadThreadConfig();
+
 void 
 DumpBufferStatus();
 
@@ -196,12 +312,19 @@ WinMain(HINSTANCE hInst, HINSTANCE hPrevInst, LPSTR lpCmdLn, int nShowCmd)
 {   
     std::string logpath(TOSDB_LOG_PATH); 
 
+    /* before logging starts: other shards/standbys log to their own files */
+    ParseEngineArgs(lpCmdLn);
+
 #ifdef REDIRECT_STDERR_TO_LOG
-    freopen( (logpath + ERR_LOG_NAME).c_str(), "a", stderr);
+    freopen( (logpath + InstanceName(ERR_LOG_NAME)).c_str(), "a", stderr);
 #endif
 
     /* start logging */
+#ifdef LOG_BACKEND_USE_SINGLE_FILE
     logpath.append(std::string(LOG_NAME));
+#else
+    logpath.append(InstanceName(LOG_NAME));
+#endif
     StartLogging( logpath.c_str() );
 
     /* check/log type of execution (service v. pure, spawned v. direct) */
@@ -210,7 +333,7 @@ WinMain(HINSTANCE hInst, HINSTANCE hPrevInst, LPSTR lpCmdLn, int nShowCmd)
     }
 
     /* the other side of our IPC channel (see client_admin.cpp) */
-    IPCSlave slave(TOSDB_COMM_CHANNEL);         
+    IPCSlave slave( CreateCommChannelName(engine_shard, engine_standby) );         
 
     /* initialize our security objects for IPC */
     if( !SetSecurityPolicy() ){
@@ -247,6 +370,18 @@ WinMain(HINSTANCE hInst, HINSTANCE hPrevInst, LPSTR lpCmdLn, int nShowCmd)
   
     GetSystemInfo(&sys_info);     
 
+    /* pin/prioritize our threads, if there's a config for them */
+    probe_thrd = slave.probe_thread();
+    LoadThreadConfig();
+
+    /* heartbeat/take-over and mirroring to the other engine (if there is one) */
+    if( OpenControlSegment() ){
+        CreateThread(NULL, 0, HeartbeatLoop, NULL, 0, NULL);
+        CreateThread(NULL, 0, MirrorLoop, NULL, 0, NULL);
+    }else if(engine_standby){
+        TOSDB_LogH("STARTUP", "standby engine without a control segment won't take over");
+    }
+
     /* Start the main communciation loop that client code and service will 
        use to communicate with the back-end; this will block until:
            1) the slave's wait_for_master call returns false(IPC ERROR), OR
@@ -320,11 +455,289 @@ CheckExecType(LPSTR cmd)
 
     TOSDB_Log("STARTUP", (is_service ? "is_service == true" : "is_service == false"));   
     TOSDB_Log("STARTUP", ss_args.str().c_str());
+    TOSDB_Log("STARTUP", ("shard: " + std::to_string(engine_shard) 
+                          + (engine_standby ? " (standby)" : "") + ", channel: "
+                          + CreateCommChannelName(engine_shard, engine_standby)
+                          + ", history: " + std::to_string(history_depth)).c_str());
 
     return true;
 }
 
 
+/* '--shard N', '--standby' and '--history N'; called before logging starts, 
+   a bad '--shard' is shard 0, a bad '--history' 0 (CheckExecType logs the 
+   args and what we ended up with) */
+void
+ParseEngineArgs(LPSTR cmd)
+{
+    std::vector<std::string> args;
+    ParseArgs(args, cmd);    
+
+    for(size_t i = 0; i < args.size(); ++i){
+        if(args[i] == "--standby"){
+            engine_standby = true;
+        }else if(args[i] == "--shard" && i + 1 < args.size()){
+            try{
+                unsigned long s = std::stoul(args[i+1]);
+                engine_shard = (s < TOSDB_MAX_SHARDS) ? (unsigned int)s : 0;
+            }catch(...){
+            }
+        }else if(args[i] == "--history" && i + 1 < args.size()){
+            try{
+                unsigned long h = std::stoul(args[i+1]);
+                history_depth = (h <= TOSDB_MAX_HISTORY) ? (unsigned int)h : 0;
+            }catch(...){
+            }
+        }
+    }
+}
+
+
+/* 'engine-log.log' -> 'engine-log-shard2-standby.log' etc. for anything but 
+   shard 0's primary */
+std::string
+InstanceName(std::string name)
+{
+    std::string sfx;
+    if(engine_shard)
+        sfx.append("-shard" + std::to_string(engine_shard));
+    if(engine_standby)
+        sfx.append("-standby");
+
+    size_t dot = name.find_last_of('.');
+    return (dot == std::string::npos) ? name + sfx : name.insert(dot, sfx);
+}
+
+
+/* create (or open, if the other engine got there first) the control segment */
+bool
+OpenControlSegment()
+{
+    std::string name = CreateControlName(engine_shard);
+
+    ctrl_hndl = CreateFileMapping(INVALID_HANDLE_VALUE, &sec_attr[SHEM1], PAGE_READWRITE,
+                                  0, sizeof(EngineControl), name.c_str());
+    if(!ctrl_hndl){
+        TOSDB_LogEx("FAILOVER", ("CreateFileMapping failed: " + name).c_str(), GetLastError());
+        return false;
+    }
+
+    ctrl = (EngineControl*)MapViewOfFile(ctrl_hndl, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if(!ctrl){
+        TOSDB_LogEx("FAILOVER", ("MapViewOfFile failed: " + name).c_str(), GetLastError());
+        CloseHandle(ctrl_hndl);
+        ctrl_hndl = NULL;
+        return false;
+    }
+
+    /* if we're a respawn and the segment still says we're active, that's our
+       previous instance: we have no streams yet, so hand it to the other 
+       engine (it has them) */
+    unsigned int slot = engine_standby ? 1 : 0;
+    if( ctrl->starts[slot].fetch_add(1) && ctrl->active.compare_exchange_strong(slot, slot ^ 1) ){
+        ctrl->generation.fetch_add(1);
+        TOSDB_LogH("FAILOVER", "previous instance was active, handed over to the other engine");
+    }
+
+    TOSDB_Log("FAILOVER", ("control segment: " + name + ", active slot: " 
+                           + std::to_string(ctrl->active.load())).c_str());
+    return true;
+}
+
+
+/* beat while the message loop answers; take over if the active engine stops */
+DWORD WINAPI
+HeartbeatLoop(LPVOID lParam)
+{
+    unsigned int slot = engine_standby ? 1 : 0;
+    FailoverMonitor monitor(ctrl, slot, GetTickCount64());
+
+    while(!shutdown_flag){
+        DWORD_PTR r;
+        bool healthy = SendMessageTimeout(msg_window, WM_NULL, 0, 0, SMTO_ABORTIFHUNG, 
+                                          FAILOVER_HEARTBEAT, &r) != 0;
+
+        switch( monitor.beat(GetTickCount64(), healthy) ){
+        case FailoverMonitor::PROMOTED:
+            TOSDB_LogH("FAILOVER", ("slot " + std::to_string(slot) + " is now active, generation "
+                                    + std::to_string(ctrl->generation.load())).c_str());
+            SetEvent(mirror_event);
+            break;
+        case FailoverMonitor::DEMOTED:
+            TOSDB_LogH("FAILOVER", ("slot " + std::to_string(slot) + " is now standby").c_str());
+            break;
+        }
+
+        Sleep(FAILOVER_HEARTBEAT);
+    }
+
+    return 0;
+}
+
+
+/* send a stream op to the other engine; false if IPC failed (a stream op 
+   the other engine rejects is only logged) */
+bool
+MirrorCall(IPCMaster *peer, std::string msg)
+{
+    std::string m(msg);
+
+    if( !peer->call(&m, TOSDB_DEF_TIMEOUT) ){
+        TOSDB_LogH("FAILOVER", ("failed to mirror: " + msg).c_str());
+        return false;
+    }
+
+    try{
+        long r = std::stol(m);
+        if(r && r != TOSDB_SIG_GOOD)
+            TOSDB_LogH("FAILOVER", ("other engine returned " + m + " for: " + msg).c_str());
+    }catch(...){
+        TOSDB_LogH("FAILOVER", ("bad reply from other engine for: " + msg).c_str());
+    }
+
+    return true;
+}
+
+
+/* while active: bring the other engine's streams in line with ours when it 
+   shows up (reset, then replay mirror_streams) and keep them there */
+DWORD WINAPI
+MirrorLoop(LPVOID lParam)
+{
+    unsigned int slot = engine_standby ? 1 : 0;
+    IPCMaster peer( CreateCommChannelName(engine_shard, !engine_standby) );
+
+    while(!shutdown_flag){
+        WaitForSingleObject(mirror_event, TOSDB_DEF_TIMEOUT);
+
+        if(ctrl->active.load() != slot){
+            std::lock_guard<LightWeightMutex> lock(mirror_mtx);
+            /* --- CRITICAL SECTION --- */
+            mirror_synced = false;
+            mirror_queue.clear();
+            continue;
+            /* --- CRITICAL SECTION --- */
+        }
+
+        bool synced;
+        {
+            std::lock_guard<LightWeightMutex> lock(mirror_mtx);
+            /* --- CRITICAL SECTION --- */
+            synced = mirror_synced;
+            /* --- CRITICAL SECTION --- */
+        }
+
+        if(!synced){
+            if( !peer.connected(TOSDB_MIN_TIMEOUT) )
+                continue;
+
+            if( !MirrorCall(&peer, std::to_string(TOSDB_SIG_MIRROR)) )
+                continue;
+
+            std::map<buffer_id_ty, size_t> streams;
+            {
+                std::lock_guard<LightWeightMutex> lock(mirror_mtx);
+                /* --- CRITICAL SECTION --- */
+                streams = mirror_streams;
+                mirror_queue.clear(); /* anything after this goes in the queue */
+                mirror_synced = true;
+                /* --- CRITICAL SECTION --- */
+            }
+
+            TOSDB_Log("FAILOVER", ("replaying " + std::to_string(streams.size()) 
+                                   + " stream(s) on the standby").c_str());
+
+            for(const auto& s : streams){
+                std::string msg = std::to_string(TOSDB_SIG_ADD) + ' ' 
+                                + TOS_Topics::map[s.first.second] + ' ' + s.first.first 
+                                + ' ' + std::to_string(TOSDB_DEF_TIMEOUT);
+                for(size_t i = 0; i < s.second && synced; ++i)
+                    synced = MirrorCall(&peer, msg);
+                if(!synced)
+                    break;
+            }
+        }
+
+        while(synced && !shutdown_flag){
+            std::string msg;
+            {
+                std::lock_guard<LightWeightMutex> lock(mirror_mtx);
+                /* --- CRITICAL SECTION --- */
+                if(mirror_queue.empty())
+                    break;
+                msg = mirror_queue.front();
+                mirror_queue.pop_front();
+                /* --- CRITICAL SECTION --- */
+            }
+            synced = MirrorCall(&peer, msg);
+        }
+
+        if(!synced){ /* start over (w/ a reset) next time */
+            std::lock_guard<LightWeightMutex> lock(mirror_mtx);
+            /* --- CRITICAL SECTION --- */
+            mirror_synced = false;
+            mirror_queue.clear();
+            /* --- CRITICAL SECTION --- */
+        }
+    }
+
+    return 0;
+}
+
+
+/* a client's ADD/REMOVE succeeded (IPC thread) */
+void
+MirrorStreamOp(unsigned int op, TOS_Topics::TOPICS topic, std::string item, unsigned long timeout)
+{
+    buffer_id_ty id(item, topic);
+
+    std::lock_guard<LightWeightMutex> lock(mirror_mtx);
+    /* --- CRITICAL SECTION --- */
+    if(op == TOSDB_SIG_ADD){
+        ++mirror_streams[id];
+    }else{
+        auto s = mirror_streams.find(id);
+        if(s != mirror_streams.end() && --(s->second) == 0)
+            mirror_streams.erase(s);
+    }
+
+    if(mirror_synced){
+        mirror_queue.push_back( std::to_string(op) + ' ' + TOS_Topics::map[topic] + ' ' 
+                                + item + ' ' + std::to_string(timeout) );
+        SetEvent(mirror_event);
+    }
+    /* --- CRITICAL SECTION --- */
+}
+
+
+/* TOSDB_SIG_MIRROR: the active engine is about to replay its streams on us; 
+   drop every stream we have (refused if we're the active one) */
+int
+MirrorReset(unsigned long timeout)
+{
+    if( !ctrl || ctrl->active.load() == (engine_standby ? 1u : 0u) ){
+        TOSDB_LogH("FAILOVER", "refusing to reset streams of the active engine");
+        return TOSDB_SIG_BAD;
+    }
+
+    std::map<TOS_Topics::TOPICS, item_refcounts_ty> t_copy(topic_refcounts);
+    for(const auto& topic : t_copy){
+        for(const auto& item : topic.second){
+            for(size_t i = 0; i < item.second; ++i)
+                RemoveStream(topic.first, item.first, timeout);
+        }
+    }
+
+    std::lock_guard<LightWeightMutex> lock(mirror_mtx);
+    /* --- CRITICAL SECTION --- */
+    mirror_streams.clear();
+    /* --- CRITICAL SECTION --- */
+
+    TOSDB_Log("FAILOVER", "streams reset by the active engine");
+    return TOSDB_SIG_GOOD;
+}
+
+
 DWORD WINAPI 
 ThreadedWinInit(LPVOID lParam)
 {
@@ -423,11 +836,15 @@ HandleGoodIPCMessage( unsigned int op,
     case TOSDB_SIG_ADD:                              
         ret = AddStream(topic, item, timeout);
         STREAM_CHECK_LOG_ERROR(ret, "AddStream", topic, item, timeout);                                                  
+        if(!ret)
+            MirrorStreamOp(op, topic, item, timeout);
         break;
                 
     case TOSDB_SIG_REMOVE:                
         ret = RemoveStream(topic, item, timeout);
         STREAM_CHECK_LOG_ERROR(ret, "RemoveStream", topic, item, timeout);                             
+        if(!ret)
+            MirrorStreamOp(op, topic, item, timeout);
         break;
                 
     case TOSDB_SIG_TEST:
@@ -436,13 +853,25 @@ HandleGoodIPCMessage( unsigned int op,
 
     case TOSDB_SIG_PAUSE:                                    
         TOSDB_Log("SERVICE-MSG", "TOSDB_SIG_PAUSE message received");                         
-        pause_flag = true;
+        {
+            size_t nfail = advise_links.pause();
+            if(nfail){
+                TOSDB_LogH("DDE", ("failed to unlink " + std::to_string(nfail) 
+                                    + " stream(s), they'll keep updating").c_str());
+            }
+        }
         ret = TOSDB_SIG_GOOD;                                              
         break;
                 
     case TOSDB_SIG_CONTINUE:                           
         TOSDB_Log("SERVICE-MSG", "TOSDB_SIG_CONTINUE message received");                              
-        pause_flag = false;              
+        {
+            size_t nfail = advise_links.resume();
+            if(nfail){
+                TOSDB_LogH("DDE", ("failed to re-link " + std::to_string(nfail) 
+                                    + " stream(s), will retry on next continue").c_str());
+            }
+        }
         ret = TOSDB_SIG_GOOD;                                
         break;
                 
@@ -457,6 +886,24 @@ HandleGoodIPCMessage( unsigned int op,
         DumpBufferStatus();
         ret = TOSDB_SIG_GOOD;
         break;
+
+    case TOSDB_SIG_MIRROR:
+        ret = MirrorReset(TOSDB_DEF_TIMEOUT);
+        break;
+
+    case TOSDB_SIG_PRIORITY: /* 'timeout' carries the class */
+        ret = SetPriority(topic, item, (int)(long)timeout);
+        STREAM_CHECK_LOG_ERROR(ret, "SetPriority", topic, item, timeout);
+        break;
+
+    case TOSDB_SIG_THREAD: /* 'timeout' carries the thread, 'item' the mask/priority */
+        {
+            unsigned long long cpu_mask = 0;
+            int priority = TOSDB_THREAD_PRI_UNCHANGED;
+            std::istringstream(item) >> cpu_mask >> priority;
+            ret = SetEngineThreadSchedule((int)timeout, cpu_mask, priority);
+        }
+        break;
               
     default:                
         TOSDB_LogH("IPC", ("invalid opcode: " + std::to_string(op)).c_str());
@@ -504,9 +951,39 @@ ParseIPCMessage( std::string msg,
     case TOSDB_SIG_CONTINUE: 
     case TOSDB_SIG_STOP: 
     case TOSDB_SIG_DUMP: 
+    case TOSDB_SIG_MIRROR: 
         return true;        
     };
         
+    if(*op == TOSDB_SIG_PRIORITY && nargs == 4){ 
+        /* '*' for any topic/item; the class goes in 'timeout' */
+        try{
+            *topic = (args[1] == "*") ? TOS_Topics::TOPICS::NULL_TOPIC 
+                                      : TOS_Topics::map[args[1]];
+            *item = (args[2] == "*") ? std::string() : args[2];
+            *timeout = (unsigned long)std::stol(args[3]);
+        }catch(...){
+            TOSDB_LogH("IPC", ("failed to parse priority msg: " + msg).c_str());
+            return false;
+        }
+        return true;
+    }
+
+    if(*op == TOSDB_SIG_THREAD && nargs == 4){ 
+        /* 'thread mask priority': the thread goes in 'timeout', the rest in 'item' */
+        try{
+            *timeout = std::stoul(args[1]);
+            std::stoull(args[2]);
+            std::stoi(args[3]);
+        }catch(...){
+            TOSDB_LogH("IPC", ("failed to parse thread msg: " + msg).c_str());
+            return false;
+        }
+        *topic = TOS_Topics::TOPICS::NULL_TOPIC;
+        *item = args[2] + ' ' + args[3];
+        return true;
+    }
+
     if(nargs != 4){ /* if we we have a stream op check we have 4 args */       
         TOSDB_LogH("IPC", ("ParseArgs didn't return 4 args (" 
                            + std::to_string(nargs) + "), msg: " + msg).c_str());
@@ -514,7 +991,7 @@ ParseIPCMessage( std::string msg,
     }    
     
     try{ /* second, get the topic */
-        *topic = TOS_Topics::MAP()[args[1]];
+        *topic = TOS_Topics::map[args[1]];
     }catch(...){
         TOSDB_LogH("IPC", ("failed to get 'topic' arg from msg, args[1]: " + args[1]).c_str());
         return false;
@@ -590,6 +1067,12 @@ AddStream( TOS_Topics::TOPICS topic_t,
         }
     }  
   
+    /* a new advise loop (parked right away if we're paused) */
+    if(!err && topic_refcounts[topic_t][item] == 1){
+        if( !advise_links.added(buffer_id_ty(item, topic_t)) )
+            TOSDB_LogH("DDE", ("failed to unlink " + item + " while paused").c_str());
+    }
+
     /* unwind if it fails during creation */
     switch(err){   
     case TOSDB_ERROR_SHEM_BUFFER:    
@@ -765,8 +1248,10 @@ CloseItem(TOS_Topics::TOPICS topic_t, std::string item, unsigned long timeout)
 {
     int err = 0;
 
-    /* if we return error, continue with remove but log it */
-    if( !PostCloseItem(item, topic_t, timeout) )
+    /* if we return error, continue with remove but log it (parked streams 
+       have no advise loop to end) */
+    if( advise_links.removed(buffer_id_ty(item, topic_t)) 
+        && !PostCloseItem(item, topic_t, timeout) )
     {   
         err = TOSDB_ERROR_DDE_POST;
         TOSDB_LogH("DDE", "PostCloseItem failed, continue with CloseItem");                
@@ -799,11 +1284,11 @@ PostItem(std::string item,
     std::string sid_id = std::to_string((size_t)convo) + item;
 
     ack_signals.set_signal_ID(sid_id);
-    PostMessage(msg_window, REQUEST_DDE_ITEM, (WPARAM)convo, (LPARAM)(item.c_str())); 
+    PostItemMsg(REQUEST_DDE_ITEM, convo, item); 
     /* for whatever reason a bad item gets a posive ack from an attempt 
        to link it, so that message must post second to give the request 
        a chance to preempt it */    
-    PostMessage(msg_window, LINK_DDE_ITEM, (WPARAM)convo, (LPARAM)(item.c_str()));    
+    PostItemMsg(LINK_DDE_ITEM, convo, item);    
 
     return ack_signals.wait_for(sid_id , timeout);
 }
@@ -818,12 +1303,94 @@ PostCloseItem(std::string item,
     std::string sid_id = std::to_string((size_t)convo) + item;
 
     ack_signals.set_signal_ID(sid_id);
-    PostMessage(msg_window, DELINK_DDE_ITEM, (WPARAM)convo, (LPARAM)(item.c_str()));  
+    PostItemMsg(DELINK_DDE_ITEM, convo, item);  
 
     return ack_signals.wait_for(sid_id, timeout);
 }
 
 
+std::vector<buffer_id_ty>
+PostBulk(unsigned int op, const std::vector<buffer_id_ty>& streams, unsigned long timeout)
+{ /* post LINK/DELINK for every stream then wait once for all the acks 
+     (PostItem/PostCloseItem wait for each one in turn) */
+    std::vector<std::string> sids;
+    std::vector<buffer_id_ty> failed;
+
+    for(const buffer_id_ty& s : streams)
+        sids.push_back( std::to_string((size_t)convos[s.second]) + s.first );
+
+    {
+        WinLockGuard lock(bulk_mtx);
+        /* --- CRITICAL SECTION --- */
+        bulk_acks.clear();
+        for(const std::string& sid : sids)
+            bulk_acks[sid] = 0;
+        bulk_pending = bulk_acks.size();
+        ResetEvent(bulk_event);
+        /* --- CRITICAL SECTION --- */
+    }
+
+    /* atoms, not 'streams' strings: what's still queued when we time out 
+       outlives them */
+    for(size_t i = 0; i < streams.size(); ++i){
+        if( !PostItemMsg(op, convos[streams[i].second], streams[i].first) )
+            BulkAck(sids[i], false);
+    }
+
+    WaitForSingleObject(bulk_event, timeout);
+
+    WinLockGuard lock(bulk_mtx);
+    /* --- CRITICAL SECTION --- */
+    for(size_t i = 0; i < streams.size(); ++i){
+        if(bulk_acks[sids[i]] != 1)
+            failed.push_back(streams[i]);
+    }
+    bulk_acks.clear();
+    bulk_pending = 0;
+
+    TOSDB_Log("DDE", ("bulk " + std::string(op == LINK_DDE_ITEM ? "link" : "unlink") 
+                      + ": " + std::to_string(streams.size() - failed.size()) + " of " 
+                      + std::to_string(streams.size())).c_str());
+    return failed;
+    /* --- CRITICAL SECTION --- */
+}
+
+
+/* post one of our ..._DDE_ITEM messages w/ its own atom for 'item'; the 
+   caller can return (time out) before the msg thread gets to it */
+bool
+PostItemMsg(unsigned int msg, HWND convo, const std::string& item)
+{
+    ATOM atom = GlobalAddAtom(item.c_str());
+    if(!atom)
+        return false;
+
+    if( !PostMessage(msg_window, msg, (WPARAM)convo, (LPARAM)atom) ){
+        GlobalDeleteAtom(atom);
+        return false;
+    }
+    return true;
+}
+
+
+bool
+BulkAck(const std::string& sid, bool pos)
+{
+    WinLockGuard lock(bulk_mtx);
+    /* --- CRITICAL SECTION --- */
+    auto a = bulk_acks.find(sid);
+    if(a == bulk_acks.end() || a->second != 0)
+        return false;
+
+    a->second = pos ? 1 : -1;
+    if(--bulk_pending == 0)
+        SetEvent(bulk_event);
+
+    return true;
+    /* --- CRITICAL SECTION --- */
+}
+
+
 bool 
 CreateBuffer(TOS_Topics::TOPICS topic_t, 
              std::string item, 
@@ -841,7 +1408,20 @@ CreateBuffer(TOS_Topics::TOPICS topic_t,
             return false;
     }
 
-    name = CreateBufferName(TOS_Topics::map[topic_t], item);
+    name = CreateBufferName(TOS_Topics::map[topic_t], item, engine_shard, engine_standby);
+
+    /* string values go in a dictionary ahead of the ring; the ring gets codes,
+       with room for the value itself when the dictionary is full */
+    bool is_str = (TOS_Topics::TypeBits(topic_t) == TOSDB_STRING_BIT);
+    unsigned int dict_sz = is_str ? sizeof(StringDict) : 0;
+    unsigned int val_sz = is_str ? STRING_DICT_ELEM_SZ : TOS_Topics::TypeSize(topic_t);
+
+    if(history_depth){
+        unsigned int hist_sz = sizeof(BufferHead) 
+            + history_depth * (val_sz + sizeof(DateTimeStamp));
+        buffer_sz = std::max(buffer_sz, hist_sz);
+    }
+    buffer_sz += dict_sz;
 
     buf.raw_sz = (buffer_sz < sys_info.dwPageSize) ? sys_info.dwPageSize : buffer_sz;
 
@@ -872,14 +1452,13 @@ CreateBuffer(TOS_Topics::TOPICS topic_t,
         return false;
     }
  
-    /* cast mem-map to our header and fill values */
+    /* cast mem-map to our header and fill values (buffer_ring.hpp) */
     pBufferHead ptmp = (pBufferHead)(buf.raw_addr); 
-    ptmp->loop_seq = 0;
-    ptmp->next_offset = ptmp->beg_offset = sizeof(BufferHead);
-    ptmp->elem_size = TOS_Topics::TypeSize(topic_t) + sizeof(DateTimeStamp);
-    ptmp->end_offset = ptmp->beg_offset 
-                     + ((buf.raw_sz - ptmp->beg_offset) / ptmp->elem_size) 
-                     * ptmp->elem_size ;
+    RingInit(ptmp, buf.raw_sz, dict_sz, val_sz + sizeof(DateTimeStamp));
+    memset(&ptmp->summary, 0, sizeof(StreamSummary));
+    buf.dict = is_str ? new StringDictWriter((StringDict*)((char*)ptmp + ptmp->dict_offset),
+                                             (ptmp->end_offset - ptmp->beg_offset) / ptmp->elem_size) 
+                      : NULL;
 
     /* Feb-15-2017 - protect the buffers map; write thread may try to access */
     BUFFER_LOCK_GUARD;
@@ -921,6 +1500,7 @@ DestroyBuffer(TOS_Topics::TOPICS topic_t, std::string item)
         b = false;
     }
 
+    delete buf_iter->second.dict;
     buffers.erase(buf_iter);
     return b; 
     /* ---CRITICAL SECTION --- */
@@ -941,16 +1521,78 @@ ValToBuf(void* pos, std::string val) /* copy the string, truncate if necessary *
     strncpy_s((char*)pos, TOSDB_STR_DATA_SZ, val.c_str(), TOSDB_STR_DATA_SZ-1);
 }
 
+/* the first tick, or the first of a new day, starts a new session */
+inline bool
+NewSession(const StreamSummary* s, const DateTimeStamp& dts)
+{
+    return !s->count 
+        || s->last_time.ctime_struct.tm_yday != dts.ctime_struct.tm_yday
+        || s->last_time.ctime_struct.tm_year != dts.ctime_struct.tm_year;
+}
+
+template<typename T> 
+inline void 
+UpdateSummary(StreamSummary* s, T val, const DateTimeStamp& dts) 
+{ 
+    double v = (double)val;
+    if(NewSession(s, dts)){
+        s->count = 0;
+        s->open = s->high = s->low = v;
+    }
+    s->high = std::max(s->high, v);
+    s->low = std::min(s->low, v);
+    s->last = v;
+    s->last_time = dts;
+    ++(s->count);
+}
+
+template<> 
+inline void 
+UpdateSummary(StreamSummary* s, std::string val, const DateTimeStamp& dts) 
+{ 
+    if(NewSession(s, dts))
+        s->count = 0;
+    strncpy_s(s->last_str, TOSDB_STR_DATA_SZ, val.c_str(), TOSDB_STR_DATA_SZ-1);
+    s->last_time = dts;
+    ++(s->count);
+}
+
+template<typename T> 
+inline void 
+ValToBuf(void* pos, T val, StringDictWriter* dict) 
+{ 
+    ValToBuf(pos, val); 
+}
+
+template<> 
+inline void 
+ValToBuf(void* pos, std::string val, StringDictWriter* dict) /* its code, if encoded */
+{ 
+    if(dict)
+        StringDictStore(pos, dict, val);
+    else
+        ValToBuf(pos, val);
+}
+
+/* write a stream's ticks (oldest first) as one span: one lock and one 
+   update of the header's cursor, so readers get them all at once */
 template<typename T>
 void
-RouteToBuffer(DDE_Data<T> data)
+RouteToBuffer(std::vector<DDE_Data<T>>& data)
 {  
     pBufferHead head;  
+    unsigned int next;
+    unsigned int loop_seq;
+    StringDictWriter* dict;
+    unsigned int inlined;
+
+    if(data.empty())
+        return;
 
     BUFFER_LOCK_GUARD;
     /* ---(INTRA-PROCESS) CRITICAL SECTION --- */
 
-    auto buf_iter = buffers.find(buffer_id_ty(data.item,data.topic));
+    auto buf_iter = buffers.find(buffer_id_ty(data.front().item, data.front().topic));
     if(buf_iter == buffers.end()){
         /* simply aborting avoids the need for sync between the thread that 
            creates/destroys buffers and the thread (this one) that writes to them */
@@ -958,23 +1600,38 @@ RouteToBuffer(DDE_Data<T> data)
     }
 
     head = (pBufferHead)(buf_iter->second.raw_addr);
+    dict = buf_iter->second.dict;
+    inlined = dict ? dict->inlined() : 0;
   
     WaitForSingleObject(buf_iter->second.hmtx, INFINITE);
     /* ---(INTER-PROCESS) CRITICAL SECTION --- */
-    ValToBuf((void*)((char*)head + head->next_offset), data.data);
+    next = head->next_offset;
+    loop_seq = head->loop_seq;
 
-    *(pDateTimeStamp)((char*)head + head->next_offset 
-                      + (head->elem_size - sizeof(DateTimeStamp))) = *data.time; 
+    for(DDE_Data<T>& d : data){
+        ValToBuf((void*)((char*)head + next), d.data, dict);
 
-    if((head->next_offset + head->elem_size) >= head->end_offset){
-        head->next_offset = head->beg_offset; 
-        ++(head->loop_seq);
-    }else{
-        head->next_offset += head->elem_size;
+        *(pDateTimeStamp)((char*)head + next 
+                          + (head->elem_size - sizeof(DateTimeStamp))) = *d.time; 
+
+        UpdateSummary(&head->summary, d.data, *d.time);
+
+        next = RingNextOffset(head, next, &loop_seq);
     }
 
+    /* publish the span */
+    head->loop_seq = loop_seq;
+    head->next_offset = next;
+
     /* ---(INTER-PROCESS) CRITICAL SECTION --- */
     ReleaseMutex(buf_iter->second.hmtx);
+
+    if(dict && !inlined && dict->inlined()){ /* just the first time */
+        TOSDB_LogH("BUFFER", ("more than " + std::to_string(TOSDB_DICT_CODES) 
+                              + " values in the ring for " + data.front().item + " " 
+                              + TOS_Topics::map[data.front().topic] 
+                              + ", storing the rest inline").c_str());
+    }
     /* ---(INTRA-PROCESS) CRITICAL SECTION --- */
 }
 
@@ -992,24 +1649,36 @@ WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 {  
     switch (message){
     case WM_DDE_DATA: 
-    { /* TODO:  de-link it all and store state, then re-init on continue */      
-        if(!pause_flag) 
-            HandleData(message, wParam, lParam);
+    { /* when paused the advise loops are down; anything still in flight is 
+         handled as usual (and freed) */
+        MSG next;
+        /* queue this and whatever data is already waiting behind it, then 
+           route it all in priority order (see DrainData) */
+        HandleData(message, wParam, lParam);
+        for(int i = 1; i < MAX_DATA_BATCH 
+            && PeekMessage(&next, hWnd, WM_DDE_DATA, WM_DDE_DATA, PM_REMOVE); ++i)
+        {
+            HandleData(next.message, next.wParam, next.lParam);
+        }
+        DrainData();
         break;     
     } 
     case LINK_DDE_ITEM:
     {      
         DDEADVISE FAR* lp_options;
         LPARAM lp;      
-        ATOM item;       
+        ATOM item = (ATOM)lParam; /* ours now (PostItemMsg) */
 
         HGLOBAL hoptions = GlobalAlloc(GMEM_MOVEABLE, sizeof(DDEADVISE));       
-        if (!hoptions)
+        if (!hoptions){
+            GlobalDeleteAtom(item);
             break;
+        }
 
         lp_options = (DDEADVISE FAR*)GlobalLock(hoptions);
         if (!lp_options){
             GlobalFree(hoptions);
+            GlobalDeleteAtom(item);
             break;
         }
         lp_options->cfFormat = CF_TEXT;
@@ -1018,10 +1687,6 @@ WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 
         GlobalUnlock(hoptions);
 
-        item = GlobalAddAtom((LPCSTR)lParam);
-        if(!item)
-            break;
-
         lp = PackDDElParam(WM_DDE_ADVISE, (UINT)hoptions, item);      
     
         if( !PostMessage((HWND)wParam, WM_DDE_ADVISE, (WPARAM)msg_window, lp) )
@@ -1034,9 +1699,7 @@ WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
     } 
     case REQUEST_DDE_ITEM:
     {      
-        ATOM item = GlobalAddAtom((LPCSTR)lParam);          
-        if(!item) 
-            break;
+        ATOM item = (ATOM)lParam; /* ours now (PostItemMsg) */
   
         if( !PostMessage((HWND)wParam, WM_DDE_REQUEST, (WPARAM)(msg_window), 
                          PackDDElParam(WM_DDE_REQUEST, CF_TEXT, item)) )
@@ -1048,11 +1711,8 @@ WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
     } 
     case DELINK_DDE_ITEM:
     {      
-        ATOM item = GlobalAddAtom((LPCSTR)lParam);      
+        ATOM item = (ATOM)lParam; /* ours now (PostItemMsg) */
         LPARAM lp = PackDDElParam(WM_DDE_UNADVISE, 0, item);
-      
-        if(!item) 
-            break;
 
         if( !PostMessage((HWND)wParam, WM_DDE_UNADVISE, (WPARAM)(msg_window), lp) )
         {
@@ -1112,13 +1772,14 @@ WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             UnpackDDElParam(message,lParam, (PUINT_PTR)&plo, (PUINT_PTR)&pho); 
             GlobalGetAtomName((ATOM)(pho), item_atom, (TOSDB_MAX_STR_SZ + 1)); 
 
+            std::string sid(std::to_string((size_t)(HWND)wParam) + std::string(item_atom));
             if(plo == 0x0000){
-                std::string sarg(std::to_string((size_t)(HWND)wParam)); 
-                ack_signals.signal(sarg + std::string(item_atom), false);                
+                if( !BulkAck(sid, false) )
+                    ack_signals.signal(sid, false);                
                 TOSDB_LogH("DDE", ("NEG ACK for item: " + std::string(item_atom)).c_str());
             }else if(plo == 0x8000){
-                std::string sarg(std::to_string((size_t)(HWND)wParam));
-                ack_signals.signal(sarg + std::string(item_atom), true);   
+                if( !BulkAck(sid, true) )
+                    ack_signals.signal(sid, true);   
             }       
         }   
         break;
@@ -1163,6 +1824,21 @@ public:
               _init_datetime();      
       }
 
+    /* takes 'time' (someone else's stamp) rather than allocating one */
+    DDE_Data(const TOS_Topics::TOPICS topic, 
+             std::string item, 
+             const T d, 
+             pDateTimeStamp time,
+             bool valid_datetime) 
+      :
+          topic(topic),
+          item(item),
+          data(d), 
+          time(time),
+          valid_datetime(valid_datetime)
+      {
+      }
+
     ~DDE_Data() 
         { 
             if(time) 
@@ -1187,8 +1863,7 @@ public:
         item = d.item;
         data = d.data;
         valid_datetime = d.valid_datetime;
-        time = d.time;
-        d.time = nullptr;
+        std::swap(time, d.time); /* d deletes ours */
 
         return *this;
     }
@@ -1223,6 +1898,50 @@ DDE_Data<T>::_init_datetime()
 }
 
 
+/* data waiting to be routed, one queue per TOSDB_PRIORITY_ class; only 
+   touched by the msg thread (the stats are read by DumpBufferStatus) */
+struct PriorityClass{
+    std::deque<std::pair<long long, DDE_Data<std::string>>> ticks; /* (queued at, tick) */
+    std::map<buffer_id_ty, size_t> waiting; /* LOW: stream -> its index in ticks */
+    std::map<buffer_id_ty, size_t> span_of; /* DrainData: stream -> its span */
+    std::vector<std::vector<size_t>> spans; /* DrainData: indices in ticks, by stream */
+    std::atomic<unsigned long long> routed;
+    std::atomic<unsigned long long> commits; /* spans written (RouteToBuffer) */
+    std::atomic<unsigned long long> conflated;
+    std::atomic<unsigned long long> max_depth;
+    std::atomic<unsigned long long> delay_ticks;
+    std::atomic<unsigned long long> max_delay_ticks;
+};
+
+PriorityClass priority_classes[TOSDB_PRIORITY_LOW + 1];
+
+/* QueueData's copy of each stream's class, so a tick doesn't take topic_mtx;
+   msg thread only, dropped when priority_gen moves */
+std::map<buffer_id_ty, int> priority_cache;
+unsigned int priority_cache_gen = 0;
+
+const char* PRIORITY_NAMES[TOSDB_PRIORITY_LOW + 1] = {"HIGH", "NORMAL", "LOW"};
+
+
+void
+QueueData(DDE_Data<std::string>&& raw);
+
+void
+RouteData(std::deque<std::pair<long long, DDE_Data<std::string>>>& ticks, 
+          const std::vector<size_t>& span);
+
+
+/* the raw string tick as a T; takes over its stamp */
+template<typename T>
+DDE_Data<T>
+_retype(DDE_Data<std::string>& raw, T val)
+{
+    DDE_Data<T> d(raw.topic, raw.item, val, raw.time, raw.valid_datetime);
+    raw.time = nullptr;
+    return d;
+}
+
+
 void 
 HandleData(UINT msg, WPARAM wparam, LPARAM lparam)
 {  
@@ -1278,62 +1997,340 @@ HandleData(UINT msg, WPARAM wparam, LPARAM lparam)
     /* extract the topic from wparam */
     TOS_Topics::TOPICS topic_t = convos[(HWND)(wparam)];
 
-    try{
-        std::string str(cp_data); 
+    /* stamp it now, not when it's routed */
+    QueueData( DDE_Data<std::string>(topic_t, item_atom, std::string(cp_data), true) );
+}
+
+
+void
+QueueData(DDE_Data<std::string>&& raw)
+{
+    buffer_id_ty id(raw.item, raw.topic);
+
+    unsigned int g = priority_gen.load(std::memory_order_acquire);
+    if(g != priority_cache_gen){
+        priority_cache.clear();
+        priority_cache_gen = g;
+    }
+
+    auto c = priority_cache.find(id);
+    if(c == priority_cache.end())
+        c = priority_cache.insert( std::make_pair(id, GetPriority(raw.topic, raw.item)) ).first;
+
+    PriorityClass& pc = priority_classes[c->second];
+
+    if(&pc == &priority_classes[TOSDB_PRIORITY_LOW]){ 
+        /* conflate: replace the stream's tick if it's still waiting; it keeps 
+           the time the first one was queued, so the wait reads as the stream's */
+        auto p = pc.waiting.find(id);
+        if(p != pc.waiting.end()){
+            pc.ticks[p->second].second = std::move(raw);
+            pc.conflated.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        pc.waiting[id] = pc.ticks.size();
+    }
+
+    pc.ticks.push_back( std::make_pair(LockProfileTicks(), std::move(raw)) );
+    if(pc.ticks.size() > pc.max_depth.load(std::memory_order_relaxed))
+        pc.max_depth.store(pc.ticks.size(), std::memory_order_relaxed);
+}
+
+
+/* route what's queued, class by class; within a class each stream's ticks 
+   are written together, as one span (RouteToBuffer), in the order the 
+   streams first show up */
+void
+DrainData()
+{
+    for(PriorityClass& pc : priority_classes){
+        if( pc.ticks.empty() )
+            continue;
+
+        long long now = LockProfileTicks();
+        for(size_t i = 0; i < pc.ticks.size(); ++i){
+            long long delay = now - pc.ticks[i].first;
+            pc.delay_ticks.fetch_add(delay, std::memory_order_relaxed);
+            if(delay > (long long)pc.max_delay_ticks.load(std::memory_order_relaxed))
+                pc.max_delay_ticks.store(delay, std::memory_order_relaxed);
+
+            const DDE_Data<std::string>& raw = pc.ticks[i].second;
+            auto s = pc.span_of.insert( std::make_pair(buffer_id_ty(raw.item, raw.topic), 
+                                                       pc.spans.size()) );
+            if(s.second)
+                pc.spans.push_back( std::vector<size_t>() );
+            pc.spans[s.first->second].push_back(i);
+        }
+        pc.routed.fetch_add(pc.ticks.size(), std::memory_order_relaxed);
+        pc.commits.fetch_add(pc.spans.size(), std::memory_order_relaxed);
+
+        for(const std::vector<size_t>& span : pc.spans){
+            try{
+                RouteData(pc.ticks, span);
+            }catch(const TOSDB_DDE_Error&){
+                /* logged by RouteData; drop just this span so the rest get
+                   routed and the class's state is still cleared below */
+            }
+        }
+
+        pc.ticks.clear();
+        pc.spans.clear();
+        pc.span_of.clear();
+        pc.waiting.clear();
+    }
+}
+
+
+/* a raw tick's value as the stream's type */
+template<typename T>
+T
+ParseVal(std::string str);
+
+template<>
+std::string
+ParseVal(std::string str)
+{
+    /* clean up problem chars */                     
+    auto r = std::remove_if(str.begin(), str.end(), [](char c){return c < 32;});
+    str.erase(r, str.end());
+    return str;
+}
+
+template<>
+def_size_type
+ParseVal(std::string str)
+{
+    /* remove commas */            
+    auto r = std::remove_if(str.begin(), str.end(), [](char c){return std::isdigit(c) == 0;});
+    str.erase(r,str.end());
+    return (def_size_type)std::stol(str);
+}
 
-        switch(TOS_Topics::TypeBits(topic_t)){
+template<>
+ext_price_type
+ParseVal(std::string str)
+{
+    return (ext_price_type)std::stod(str);
+}
+
+template<>
+ext_size_type
+ParseVal(std::string str)
+{
+    /* remove commas */           
+    auto r = std::remove_if(str.begin(), str.end(), [](char c){return std::isdigit(c) == 0;});
+    str.erase(r,str.end());
+    return (ext_size_type)std::stoll(str);
+}
+
+template<>
+def_price_type
+ParseVal(std::string str)
+{
+    return (def_price_type)std::stof(str);
+}
+
+
+/* one stream's ticks ('span' indexes 'ticks'); those that don't parse are 
+   dropped, the rest written together */
+template<typename T>
+void
+RouteSpan(std::deque<std::pair<long long, DDE_Data<std::string>>>& ticks, 
+          const std::vector<size_t>& span)
+{
+    std::vector<DDE_Data<T>> data;
+    data.reserve(span.size());
+
+    for(size_t i : span){
+        DDE_Data<std::string>& raw = ticks[i].second;
+        try{
+            data.push_back( _retype(raw, ParseVal<T>(raw.data)) );
+
+        }catch(const std::out_of_range& e){      
+            TOSDB_LogH("DDE", e.what());
+
+        }catch(const std::invalid_argument&){    
+            /* Dec 20 2016 - comment out, cluttering log file */
+            /*        
+            std::string serr(e.what());
+            TOSDB_Log("DDE", serr.append(" Value:: ").append(cp_data).c_str());       
+             */
+        }
+    }
+
+    RouteToBuffer(data);
+}
+
+
+void
+RouteData(std::deque<std::pair<long long, DDE_Data<std::string>>>& ticks, 
+          const std::vector<size_t>& span)
+{
+    try{
+        switch(TOS_Topics::TypeBits(ticks[span.front()].second.topic)){
         case TOSDB_STRING_BIT : /* STRING */   
-        {
-            /* clean up problem chars */                     
-            auto r = std::remove_if(str.begin(), str.end(), [](char c){return c < 32;});
-            str.erase(r, str.end());
-            RouteToBuffer( DDE_Data<std::string>(topic_t, item_atom, str, true) );  
+            RouteSpan<std::string>(ticks, span);  
             break;
-        }     
         case TOSDB_INTGR_BIT : /* LONG */   
-        {
-            /* remove commas */            
-            auto r = std::remove_if(str.begin(), str.end(), [](char c){return std::isdigit(c) == 0;});
-            str.erase(r,str.end());
-            RouteToBuffer( DDE_Data<def_size_type>(topic_t, item_atom, std::stol(str), true) );  
+            RouteSpan<def_size_type>(ticks, span);  
             break;
-        }               
         case TOSDB_QUAD_BIT : /* DOUBLE */
-        {
-            RouteToBuffer( DDE_Data<ext_price_type>(topic_t, item_atom, std::stod(str), true) ); 
+            RouteSpan<ext_price_type>(ticks, span); 
             break;
-        }     
         case TOSDB_INTGR_BIT | TOSDB_QUAD_BIT :/* LONG LONG */
-        {
-            /* remove commas */           
-            auto r = std::remove_if(str.begin(), str.end(), [](char c){return std::isdigit(c) == 0;});
-            str.erase(r,str.end());
-            RouteToBuffer( DDE_Data<ext_size_type>(topic_t, item_atom, std::stoll(str), true) );  
+            RouteSpan<ext_size_type>(ticks, span);  
             break;
-        }     
         case 0 : /* FLOAT */
-        {
-            RouteToBuffer( DDE_Data<def_price_type>(topic_t, item_atom, std::stof(str), true) ); 
+            RouteSpan<def_price_type>(ticks, span); 
             break;
-        }     
         };
 
-    }catch(const std::out_of_range& e){      
-        TOSDB_LogH("DDE", e.what());
-
-    }catch(const std::invalid_argument&){    
-        /* Dec 20 2016 - comment out, cluttering log file */
-        /*        
-        std::string serr(e.what());
-        TOSDB_Log("DDE", serr.append(" Value:: ").append(cp_data).c_str());       
-         */
-
     }catch(const std::exception& e){    
         TOSDB_LogH("DDE", e.what());
         throw TOSDB_DDE_Error(e, "error handling dde data");
     }  
 
-    return /* 0 */; 
+}
+
+
+int
+SetPriority(TOS_Topics::TOPICS topic_t, std::string item, int priority)
+{
+    bool any_topic = (topic_t == TOS_Topics::TOPICS::NULL_TOPIC);
+    bool any_item = item.empty();
+
+    if(priority < TOSDB_PRIORITY_DEFAULT || priority > TOSDB_PRIORITY_LOW)
+        return TOSDB_ERROR_BAD_INPUT;
+
+    TOPIC_LOCK_GUARD;
+    /* --- CRITICAL SECTION --- */
+    if(any_topic && any_item){
+        topic_priorities.clear();
+        item_priorities.clear();
+        stream_priorities.clear();
+    }else if(any_item){
+        if(priority == TOSDB_PRIORITY_DEFAULT)
+            topic_priorities.erase(topic_t);
+        else
+            topic_priorities[topic_t] = priority;
+    }else if(any_topic){
+        if(priority == TOSDB_PRIORITY_DEFAULT)
+            item_priorities.erase(item);
+        else
+            item_priorities[item] = priority;
+    }else{
+        if(priority == TOSDB_PRIORITY_DEFAULT)
+            stream_priorities.erase(buffer_id_ty(item,topic_t));
+        else
+            stream_priorities[buffer_id_ty(item,topic_t)] = priority;
+    }
+    priority_gen.fetch_add(1, std::memory_order_release);
+    return 0;
+    /* --- CRITICAL SECTION --- */
+}
+
+
+int
+GetPriority(TOS_Topics::TOPICS topic_t, const std::string& item)
+{
+    {
+        TOPIC_LOCK_GUARD;
+        /* --- CRITICAL SECTION --- */
+        if( !stream_priorities.empty() ){
+            auto s = stream_priorities.find(buffer_id_ty(item,topic_t));
+            if(s != stream_priorities.end())
+                return s->second;
+        }
+
+        auto i = item_priorities.find(item);
+        if(i != item_priorities.end())
+            return i->second;
+
+        auto t = topic_priorities.find(topic_t);
+        if(t != topic_priorities.end())
+            return t->second;
+        /* --- CRITICAL SECTION --- */
+    }
+
+    switch(topic_t){
+    case TOS_Topics::TOPICS::BID:
+    case TOS_Topics::TOPICS::ASK:
+    case TOS_Topics::TOPICS::LAST:
+    case TOS_Topics::TOPICS::BID_SIZE:
+    case TOS_Topics::TOPICS::ASK_SIZE:
+    case TOS_Topics::TOPICS::LAST_SIZE:
+        return TOSDB_PRIORITY_HIGH;
+    default:
+        return (TOS_Topics::TypeBits(topic_t) == TOSDB_STRING_BIT) 
+            ? TOSDB_PRIORITY_LOW 
+            : TOSDB_PRIORITY_NORMAL;
+    }
+}
+
+
+int
+SetEngineThreadSchedule(int thread, unsigned long long cpu_mask, int priority)
+{
+    HANDLE t = NULL;
+
+    switch(thread){
+    case TOSDB_THREAD_ENGINE_MSG:
+        t = msg_thrd;
+        break;
+    case TOSDB_THREAD_ENGINE_IPC: /* the caller: WinMain/RunMainCommLoop */
+        t = CurrentNativeThread();
+        break;
+    case TOSDB_THREAD_ENGINE_PROBE:
+        t = probe_thrd;
+        break;
+    }
+
+    if( !t || !ThreadPriorityIsValid(priority) )
+        return TOSDB_ERROR_BAD_INPUT;
+
+    std::stringstream s;
+    s << "thread: " << thread << " cpu mask: 0x" << std::hex << cpu_mask 
+      << std::dec << " priority: " << priority;
+
+    int e = SetThreadSchedule(t, cpu_mask, priority);
+    if(e){
+        TOSDB_LogEx("THREAD", ("failed to set schedule, " + s.str()).c_str(), e);
+        return TOSDB_ERROR_CONCURRENCY;
+    }
+
+    TOSDB_Log("THREAD", ("set schedule, " + s.str()).c_str());
+    return 0;
+}
+
+
+void
+LoadThreadConfig()
+{
+    std::vector<ThreadSchedule> scheds;
+    std::string err;
+
+    SmartBuffer<CHAR> module_buf(MAX_PATH);
+    GetModuleFileName(NULL, module_buf.get(), MAX_PATH); 
+
+    std::string path(module_buf.get());
+    path = path.substr(0, path.find_last_of("\\") + 1) + InstanceName(THREAD_CONFIG_NAME);
+
+    if( GetFileAttributes(path.c_str()) == INVALID_FILE_ATTRIBUTES )
+        return;
+
+    if( !ReadThreadConfig(path, &scheds, &err) ){
+        TOSDB_LogH("THREAD", err.c_str());
+        return;
+    }
+
+    /* client_ lines are for TOSDB_LoadThreadConfig */
+    for(const ThreadSchedule& s : scheds){
+        int thread = ParseThreadName(s.thread);
+        if(thread < 0)
+            TOSDB_LogH("THREAD", ("unknown thread in config: " + s.thread).c_str());
+        else if(thread != TOSDB_THREAD_CLIENT_EXTRACT)
+            SetEngineThreadSchedule(thread, s.cpu_mask, s.priority);
+    }
 }
 
 
@@ -1425,7 +2422,7 @@ void DumpBufferStatus()
    
     std::string time_now(SysTimeString());  
     std::string lpath(TOSDB_LOG_PATH);
-    std::string name("buffer-status-");
+    std::string name(InstanceName("buffer-status") + "-");
     std::ofstream lout;
     
     auto f = [](char x){ return std::isalnum(x) == 0; };
@@ -1459,13 +2456,90 @@ void DumpBufferStatus()
         /* --- CRITICAL SECTION --- */
         for(const auto & b : buffers){
             lout << std::setw(log_col_width[3]) << std::left 
-                 << CreateBufferName(TOS_Topics::map[b.first.second], b.first.first) 
+                 << CreateBufferName(TOS_Topics::map[b.first.second], b.first.first, 
+                                     engine_shard, engine_standby) 
                  << std::setw(log_col_width[4]) << std::left 
                  << (size_t)b.second.hfile << std::endl;
         }
         /* --- CRITICAL SECTION --- */
     }
 
+    lout <<" --- LOCK INFO --- " << std::endl;
+    lout << std::setw(log_col_width[4]) << std::left << "Lock"
+         << std::setw(log_col_width[4]) << std::left << "Acquisitions"
+         << std::setw(log_col_width[4]) << std::left << "Contentions"
+         << std::setw(log_col_width[4]) << std::left << "Wait(us)"
+         << std::setw(log_col_width[4]) << std::left << "MaxWait(us)"
+         << std::setw(log_col_width[4]) << std::left << "Hold(us)"
+         << std::setw(log_col_width[4]) << std::left << "MaxHold(us)"
+         << std::endl;
+
+    const LockProfile* sites[] = {&buffer_mtx_site, &topic_mtx_site};
+    double to_micro = 1000000.0 / LockProfileTicksPerSec();
+
+    for(const LockProfile* lp : sites){
+        lout << std::setw(log_col_width[4]) << std::left << lp->name
+             << std::setw(log_col_width[4]) << std::left << lp->acquisitions.load()
+             << std::setw(log_col_width[4]) << std::left << lp->contentions.load()
+             << std::setw(log_col_width[4]) << std::left 
+             << (unsigned long long)(lp->wait_ticks.load() * to_micro)
+             << std::setw(log_col_width[4]) << std::left 
+             << (unsigned long long)(lp->max_wait_ticks.load() * to_micro)
+             << std::setw(log_col_width[4]) << std::left 
+             << (unsigned long long)(lp->hold_ticks.load() * to_micro)
+             << std::setw(log_col_width[4]) << std::left 
+             << (unsigned long long)(lp->max_hold_ticks.load() * to_micro)
+             << std::endl;
+    }
+
+    lout <<" --- LINK INFO --- " << std::endl;
+    lout << "State: " << (advise_links.state() == AdviseLinks<buffer_id_ty>::PAUSED 
+                          ? "PAUSED" : "RUNNING")
+         << "  Live: " << advise_links.live() << "  Parked: " << advise_links.parked()
+         << "  Unconfirmed: " << advise_links.unconfirmed()
+         << std::endl << std::endl;
+
+    lout <<" --- PRIORITY INFO --- " << std::endl;
+    lout << std::setw(log_col_width[4]) << std::left << "Class"
+         << std::setw(log_col_width[4]) << std::left << "Routed"
+         << std::setw(log_col_width[4]) << std::left << "Commits"
+         << std::setw(log_col_width[4]) << std::left << "Conflated"
+         << std::setw(log_col_width[4]) << std::left << "MaxDepth"
+         << std::setw(log_col_width[4]) << std::left << "AvgDelay(us)"
+         << std::setw(log_col_width[4]) << std::left << "MaxDelay(us)"
+         << std::endl;
+
+    for(int i = 0; i <= TOSDB_PRIORITY_LOW; ++i){
+        const PriorityClass& pc = priority_classes[i];
+        unsigned long long routed = pc.routed.load();
+        lout << std::setw(log_col_width[4]) << std::left << PRIORITY_NAMES[i]
+             << std::setw(log_col_width[4]) << std::left << routed
+             << std::setw(log_col_width[4]) << std::left << pc.commits.load()
+             << std::setw(log_col_width[4]) << std::left << pc.conflated.load()
+             << std::setw(log_col_width[4]) << std::left << pc.max_depth.load()
+             << std::setw(log_col_width[4]) << std::left 
+             << (routed ? (unsigned long long)(pc.delay_ticks.load() * to_micro / routed) : 0)
+             << std::setw(log_col_width[4]) << std::left 
+             << (unsigned long long)(pc.max_delay_ticks.load() * to_micro)
+             << std::endl;
+    }
+
+    {
+        TOPIC_LOCK_GUARD;
+        /* --- CRITICAL SECTION --- */
+        for(const auto & t : topic_priorities){
+            lout << "  topic " << TOS_Topics::map[t.first] << " -> " 
+                 << PRIORITY_NAMES[t.second] << std::endl;
+        }
+        for(const auto & i : item_priorities)
+            lout << "  item " << i.first << " -> " << PRIORITY_NAMES[i.second] << std::endl;
+        for(const auto & st : stream_priorities){
+            lout << "  stream " << st.first.first << ',' << TOS_Topics::map[st.first.second] 
+                 << " -> " << PRIORITY_NAMES[st.second] << std::endl;
+        }
+        /* --- CRITICAL SECTION --- */
+    }
+
     lout<< " --- END END END --- "<<std::endl;  
 }
 
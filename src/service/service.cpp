@@ -60,9 +60,17 @@ LPCSTR ERR_LOG_NAME = "service-stderr.log";
 std::string engine_path;
 std::string integrity_level; 
 
-std::unique_ptr<IPCMaster> master;
-
-PROCESS_INFORMATION engine_pinfo;      
+/* one engine (and master) per shard; '--shards N' (see shard_map.hpp) and,
+   w/ '--standby', a standby engine for each (see failover.hpp) that we 
+   respawn, along w/ its primary, whenever it exits */
+unsigned int nshards = 1;
+bool standby = false;
+
+/* '--history N'; passed on to every engine (ticks each stream buffer keeps) */
+std::string history;
+std::vector<std::unique_ptr<IPCMaster>> masters;
+std::vector<PROCESS_INFORMATION> engine_pinfos;      
+std::vector<std::string> engine_cmds;
 SYSTEM_INFO sys_info;
 SERVICE_STATUS service_status;
 SERVICE_STATUS_HANDLE service_status_hndl;
@@ -113,7 +121,8 @@ UpdateStatus(int status, int check_point)
                 
         TOSDB_LogH("SHUTDOWN","UpdateStatus terminating engine");
         shutdown_flag = true;
-        TerminateProcess(engine_pinfo.hProcess, EXIT_FAILURE);                 
+        for(const PROCESS_INFORMATION& pinfo : engine_pinfos)
+            TerminateProcess(pinfo.hProcess, EXIT_FAILURE);                 
         UpdateStatus(SERVICE_STOPPED, -1);         
     }
 
@@ -122,15 +131,17 @@ UpdateStatus(int status, int check_point)
 
 
 bool 
-SendMsgWaitForResponse(long msg)
+SendMsgWaitForResponse(long msg, unsigned int shard)
 {
     long ret;
     
     std::string ipc_msg = std::to_string(msg);
+    IPCMaster *master = masters[shard].get();
 
     TOSDB_LogDebug("***IPC*** SERVICE - CHECK CONNECTED");
     if( !master->connected(TOSDB_DEF_TIMEOUT) ){
-        TOSDB_LogH("IPC", "Service's IPCMaster is not connected");
+        TOSDB_LogH("IPC", ("Service's IPCMaster is not connected, shard: " 
+                           + std::to_string(shard)).c_str());
         return false;
     }    
     
@@ -150,6 +161,21 @@ SendMsgWaitForResponse(long msg)
 }
 
 
+/* true if every shard returns TOSDB_SIG_GOOD (they all get the msg regardless) */
+bool 
+SendMsgWaitForResponse(long msg)
+{
+    bool good = true;
+
+    for(unsigned int i = 0; i < masters.size(); ++i){
+        if( !SendMsgWaitForResponse(msg, i) )
+            good = false;
+    }
+
+    return good;
+}
+
+
 VOID WINAPI 
 ServiceController(DWORD cntrl)
 {
@@ -166,10 +192,12 @@ ServiceController(DWORD cntrl)
                 TOSDB_Log("ADMIN", "error resuming paused service stop it");              
         }
                
-        if(!SendMsgWaitForResponse(TOSDB_SIG_STOP)){        
-            TOSDB_Log("ADMIN","failed to send stop signal to engine");                  
-            TerminateProcess(engine_pinfo.hProcess, EXIT_FAILURE);
-        }        
+        for(unsigned int i = 0; i < masters.size(); ++i){
+            if(!SendMsgWaitForResponse(TOSDB_SIG_STOP, i)){        
+                TOSDB_Log("ADMIN","failed to send stop signal to engine");                  
+                TerminateProcess(engine_pinfos[i].hProcess, EXIT_FAILURE);
+            }        
+        }
 
         break;
        
@@ -216,7 +244,7 @@ ServiceController(DWORD cntrl)
 }while(0)  
 
 bool 
-SpawnRestrictedProcess(std::string engine_cmd, int session = -1)
+SpawnRestrictedProcess(std::string engine_cmd, PROCESS_INFORMATION *pinfo, int session = -1)
 {            
     TOKEN_MANDATORY_LABEL tml;
     STARTUPINFO  startup_info;            
@@ -302,7 +330,7 @@ SpawnRestrictedProcess(std::string engine_cmd, int session = -1)
 
     /* try to create the process with the new token */
     ret = CreateProcessAsUser(ctkn_hndl, engine_path.c_str(), cmd_buf.get(), NULL, NULL, 
-                              FALSE, 0, NULL, NULL, &startup_info, &engine_pinfo);
+                              FALSE, 0, NULL, NULL, &startup_info, pinfo);
     SPAWN_ERROR_CHECK(ret,"(6) failed to create engine process with new token");
 
     success = true;  
@@ -318,6 +346,60 @@ SpawnRestrictedProcess(std::string engine_cmd, int session = -1)
 
 #undef SPAWN_ERROR_CHECK
 
+
+/* an engine per shard ('--shard N' added for all but shard 0), plus a
+   '--standby' one for each if 'standby', and a master to talk to each; 
+   false if any of them couldn't be spawned */
+bool 
+SpawnEngines(std::string engine_cmd, int session = -1)
+{
+    for(unsigned int i = 0; i < nshards; ++i){
+        for(unsigned int slot = 0; slot < (standby ? 2u : 1u); ++slot){
+            std::string cmd = engine_cmd;
+            if( !history.empty() )
+                cmd.append(" --history " + history);
+            if(i > 0)
+                cmd.append(" --shard " + std::to_string(i));
+            if(slot)
+                cmd.append(" --standby");
+
+            PROCESS_INFORMATION pinfo;
+            if( !SpawnRestrictedProcess(cmd, &pinfo, session) ){
+                TOSDB_LogH("STARTUP", ("failed to spawn " + engine_path + " " + cmd).c_str());
+                return false;
+            }
+
+            engine_pinfos.push_back(pinfo);
+            engine_cmds.push_back(cmd);
+            masters.push_back( std::unique_ptr<IPCMaster>(
+                new IPCMaster(CreateCommChannelName(i, slot != 0))) );
+        }
+    }
+
+    return true;
+}
+
+
+/* w/ standby engines: replace one that exited (the other engine of the 
+   shard has taken over, or will, and mirrors its streams to the new one) */
+bool
+RespawnEngine(unsigned int i, int session = -1)
+{
+    TOSDB_LogH("FAILOVER", ("engine exited, respawning: " + engine_cmds[i]).c_str());
+
+    CloseHandle(engine_pinfos[i].hProcess);
+    CloseHandle(engine_pinfos[i].hThread);
+
+    if( !SpawnRestrictedProcess(engine_cmds[i], &engine_pinfos[i], session) ){
+        TOSDB_LogH("FAILOVER", ("failed to respawn " + engine_path + " " + engine_cmds[i]).c_str());
+        engine_pinfos[i].hProcess = NULL; /* waits on it fail, i.e. it's not running */
+        engine_pinfos[i].hThread = NULL;
+        return false;
+    }
+
+    return true;
+}
+
 };
 
 
@@ -325,6 +407,7 @@ void WINAPI
 ServiceMain(DWORD argc, LPSTR argv[])
 {
     bool good_engine;
+    bool engine_closed = false;
 
     service_status.dwServiceType = SERVICE_WIN32_OWN_PROCESS;
     service_status.dwCurrentState = SERVICE_START_PENDING;
@@ -352,35 +435,52 @@ ServiceMain(DWORD argc, LPSTR argv[])
     UpdateStatus(-1, -1);
 
     TOSDB_Log("STARTUP", "start tos-databridge-engine.exe (AS A SERVICE)");    
-    good_engine = SpawnRestrictedProcess("--spawned --service", custom_session);
+    good_engine = SpawnEngines("--spawned --service", custom_session);
     if(!good_engine){                
         TOSDB_LogH("STARTUP", ("failed to spawn " + engine_path + " --spawned --service").c_str());         
+        for(const PROCESS_INFORMATION& pinfo : engine_pinfos)
+            TerminateProcess(pinfo.hProcess, EXIT_FAILURE);
         UpdateStatus(SERVICE_STOPPED, -1);
         return;
     }          
-
-    /* create 'master' to communicate with engine */
-    master = std::unique_ptr<IPCMaster>( new IPCMaster(TOSDB_COMM_CHANNEL) );
    
     UpdateStatus(SERVICE_RUNNING, -1);        
 
     /* MAIN UPDATE LOOP */           
     do{
-        /* first check if engine is running */
-        if( WaitForSingleObject(engine_pinfo.hProcess, 0) != WAIT_TIMEOUT){
-            TOSDB_LogH("SHUTDOWN", "service believes engine closed unexpectedly");
-            shutdown_flag = true;
-            break;
+        /* first check if engine(s) running; if one goes they all go, unless
+           it has a standby (we respawn it) */
+        for(unsigned int i = 0; i < engine_pinfos.size(); ++i){
+            if( WaitForSingleObject(engine_pinfos[i].hProcess, 0) != WAIT_TIMEOUT){
+                if(standby && !shutdown_flag && RespawnEngine(i, custom_session))
+                    continue;
+                TOSDB_LogH("SHUTDOWN", "service believes engine closed unexpectedly");
+                engine_closed = true;
+                shutdown_flag = true;
+                break;
+            }
         }
+        if(engine_closed)
+            break;
         Sleep(UPDATE_PERIOD);
         UpdateStatus(-1, -1);            
     }while(!shutdown_flag);
 
-    /* wait on engine process to exit (if necessary), or timeout and force exit */
-    if( WaitForSingleObject(engine_pinfo.hProcess, TOSDB_DEF_TIMEOUT * 2) == WAIT_TIMEOUT){                    
-        /* forcefully close the engine */
-        TOSDB_LogH("SHUTDOWN", "engine took too long to shutdown, terminated");
-        TerminateProcess(engine_pinfo.hProcess, EXIT_FAILURE);     
+    /* stop the other shards if one closed on its own */
+    if(engine_closed){
+        for(unsigned int i = 0; i < masters.size(); ++i){
+            if( WaitForSingleObject(engine_pinfos[i].hProcess, 0) == WAIT_TIMEOUT )
+                SendMsgWaitForResponse(TOSDB_SIG_STOP, i);
+        }
+    }
+
+    /* wait on engine processes to exit (if necessary), or timeout and force exit */
+    for(const PROCESS_INFORMATION& pinfo : engine_pinfos){
+        if( WaitForSingleObject(pinfo.hProcess, TOSDB_DEF_TIMEOUT * 2) == WAIT_TIMEOUT){                    
+            /* forcefully close the engine */
+            TOSDB_LogH("SHUTDOWN", "engine took too long to shutdown, terminated");
+            TerminateProcess(pinfo.hProcess, EXIT_FAILURE);     
+        }
     }
        
     TOSDB_LogH("SHUTDOWN", "service believes engine has shutdown");   
@@ -432,6 +532,44 @@ WinMain(HINSTANCE hInst, HINSTANCE hPrevInst, LPSTR lpCmdLn, int nShowCmd)
     GetSystemInfo(&sys_info);    
 
     ParseArgs(args,cmd_str);
+
+    /* pull out '--shards N' first so the positional args work as before */
+    auto shards_arg = std::find(args.begin(), args.end(), "--shards");
+    if(shards_arg != args.end()){
+        try{
+            nshards = (shards_arg + 1 == args.end()) ? 0 
+                                                     : (unsigned int)std::stoul(*(shards_arg + 1));
+        }catch(...){
+            nshards = 0;
+        }
+        if(nshards < 1 || nshards > TOSDB_MAX_SHARDS){
+            TOSDB_LogH("STARTUP", "--shards needs a value from 1 to TOSDB_MAX_SHARDS");
+            return 1;
+        }
+        args.erase(shards_arg, shards_arg + 2);
+    }
+
+    auto standby_arg = std::find(args.begin(), args.end(), "--standby");
+    if(standby_arg != args.end()){
+        standby = true;
+        args.erase(standby_arg);
+    }
+
+    auto history_arg = std::find(args.begin(), args.end(), "--history");
+    if(history_arg != args.end()){
+        unsigned long h = 0;
+        try{
+            if(history_arg + 1 != args.end())
+                h = std::stoul(*(history_arg + 1));
+        }catch(...){
+        }
+        if(h < 1 || h > TOSDB_MAX_HISTORY){
+            TOSDB_LogH("STARTUP", "--history needs a value from 1 to TOSDB_MAX_HISTORY");
+            return 1;
+        }
+        history = std::to_string(h);
+        args.erase(history_arg, history_arg + 2);
+    }
     
     size_t argc = args.size();
     int admin_pos = 0;
@@ -477,7 +615,10 @@ WinMain(HINSTANCE hInst, HINSTANCE hPrevInst, LPSTR lpCmdLn, int nShowCmd)
     ss_args << "argc: " << std::to_string(argc) 
             << " custom_session: " << std::to_string(custom_session) 
             << " admin_pos: " << std::to_string(admin_pos) 
-            << " no_service_pos: " << std::to_string(no_service_pos);
+            << " no_service_pos: " << std::to_string(no_service_pos)
+            << " nshards: " << std::to_string(nshards)
+            << " standby: " << std::to_string(standby)
+            << " history: " << (history.empty() ? "0" : history);
 		
     TOSDB_Log("STARTUP", std::string("lpCmdLn: ").append(cmd_str).c_str() );
     TOSDB_Log("STARTUP", ss_args.str().c_str() );
@@ -494,7 +635,7 @@ WinMain(HINSTANCE hInst, HINSTANCE hPrevInst, LPSTR lpCmdLn, int nShowCmd)
         TOSDB_Log("STARTUP", "starting tos-databridge-engine.exe directly(NOT A SERVICE)");
         /* prepend '--spawned' so engine knows *we* called it; 
            if someone else passes '--spawned' they deserve what they get */
-        good_engine = SpawnRestrictedProcess("--spawned --noservice", custom_session); 
+        good_engine = SpawnEngines("--spawned --noservice", custom_session); 
         if(good_engine){
             TOSDB_Log("STARTUP", ("SUCCESS spawning: " + engine_path + " --spawned --noservice").c_str());                  
         }else{
@@ -0,0 +1,604 @@
+#include "shared_data_stream.hpp"
+
+SHARED_DATASTREAM_TEMPLATE
+SHARED_DATASTREAM_CLASS::SharedDataStream(void *mem,
+                                          size_t sz,
+                                          bool owner,
+                                          typename SHARED_DATASTREAM_CLASS::release_type release)
+    :
+        _ring(mem),
+        _mem(mem),
+        _release(release),
+        _owner(owner),
+        _mark_base(-1),
+        _mark_at(0)
+    {
+        sz = std::max<size_t>(std::min<size_t>(sz,MAX_BOUND_SIZE),1);
+
+        if(owner)
+            _ring.create((unsigned int)sz);
+        else if( !_ring.matches((unsigned int)sz) ){
+            if(release)
+                release(mem);
+            throw DataStreamError("shared stream segment doesn't match its block");
+        }
+
+        /* what's already there counts as unread, like a prefill */
+        _mark_at = _ring.count();
+        _mark_base = (long long)size() - 1;
+    }
+
+SHARED_DATASTREAM_TEMPLATE
+SHARED_DATASTREAM_CLASS::~SharedDataStream()
+{
+    if(_release)
+        _release(_mem);
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+void
+SHARED_DATASTREAM_CLASS::_push(const Ty v,
+                               const typename SHARED_DATASTREAM_CLASS::secondary_ty& sec)
+{
+    if(!_owner)
+        throw DataStreamError("push to a shared stream this process doesn't own");
+
+    _ring.push(v, sec);
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+void
+SHARED_DATASTREAM_CLASS::_check_adj(int& end, int& beg) const
+{
+    int sz = (int)_ring.bound(); /* O.K. sz can't be > INT_MAX */
+
+    if(end < 0)
+        end += sz;
+
+    if(beg < 0)
+        beg += sz;
+
+    if(beg >= sz || end >= sz || beg < 0 || end < 0)
+        throw DataStreamOutOfRange("adj index value out of range", sz, beg, end);
+    else if(beg > end)
+        throw DataStreamInvalidArgument("adjusted beging index > end index");
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+long long
+SHARED_DATASTREAM_CLASS::_marker(unsigned long long count, bool *dirty) const
+{   /* what DataStream's _incr_internal_counts would have done w/ each push
+       since the marker was set: move it back until it hits the end, then
+       flag it */
+    long long penult = (long long)_ring.bound() - 1;
+
+    if(count < _mark_at){ /* the owner started the segment over */
+        *dirty = true;
+        return std::min<long long>((long long)count - 1, penult);
+    }
+
+    long long m = _mark_base + (long long)(count - _mark_at);
+    *dirty = (m > penult);
+    return std::min(m, penult);
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+size_t
+SHARED_DATASTREAM_CLASS::_read(Ty *dest,
+                               typename SHARED_DATASTREAM_CLASS::secondary_ty *sec,
+                               size_t sz,
+                               int end,
+                               int beg) const
+{
+    unsigned long long at;
+
+    if(!sz)
+        return 0;
+
+    end = (int)std::min<long long>(end, (long long)beg + sz - 1);
+    size_t n = _ring.read_latest(beg, end, dest, UseSecondary ? sec : nullptr, &at);
+
+    _set_marker(beg, at);
+    return n;
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+size_t
+SHARED_DATASTREAM_CLASS::_read(Ty *dest,
+                               typename SHARED_DATASTREAM_CLASS::secondary_as sec,
+                               size_t sz,
+                               int end,
+                               int beg) const
+{
+    unsigned long long at;
+
+    if(!sz)
+        return 0;
+
+    end = (int)std::min<long long>(end, (long long)beg + sz - 1);
+    size_t n = _ring.read_latest_into(beg, end, dest, sec, &at);
+
+    _set_marker(beg, at);
+    return n;
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+size_t
+SHARED_DATASTREAM_CLASS::bound_size(size_t sz)
+{
+    sz = std::max<size_t>(std::min<size_t>(sz,MAX_BOUND_SIZE),1);
+    if(sz != _ring.bound())
+        throw DataStreamInvalidArgument("a shared stream's size can't be changed");
+
+    return sz;
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+bool
+SHARED_DATASTREAM_CLASS::is_marker_dirty() const
+{
+    bool dirty;
+    _marker(_ring.count(), &dirty);
+    return dirty;
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+long long
+SHARED_DATASTREAM_CLASS::marker_position() const
+{
+    bool dirty;
+    return _marker(_ring.count(), &dirty);
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+template<typename F>
+long long
+SHARED_DATASTREAM_CLASS::_copy_from_marker(size_t sz, int beg, F read_at) const
+{
+    /* the marker and the copy have to be as of the same count */
+    long long copy_sz, req_sz, mark;
+    bool was_dirty;
+
+    unsigned long long at = _ring.count();
+    mark = _marker(at, &was_dirty);
+
+    if(beg < 0)
+        beg += (int)std::min<unsigned long long>(at, _ring.bound());
+
+    req_sz = mark - (long long)beg + 1;
+    if(beg < 0 || req_sz < 1)
+        /* if beg is still invalid or > marker ... CALLER'S PROBLEM */
+        return 0;
+
+    long long end = std::min<long long>(mark, (long long)beg + sz - 1);
+    copy_sz = (long long)read_at(at, (size_t)beg, (size_t)end);
+    _set_marker(beg, at);
+
+    if(was_dirty || copy_sz < req_sz)
+        /* IF mark is dirty (i.e hits back of stream), we don't copy enough
+           (sz is too small) or the owner overwrote some of it as we copied:
+           return negative size */
+        copy_sz *= -1;
+
+    return copy_sz;
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+long long
+SHARED_DATASTREAM_CLASS::copy_from_marker(Ty *dest,
+                                          size_t sz,
+                                          int beg,
+                                          typename SHARED_DATASTREAM_CLASS::secondary_ty *sec) const
+{
+    if(!dest)
+        throw DataStreamInvalidArgument("NULL dest argument");
+
+    return _copy_from_marker(sz, beg, [&](unsigned long long at, size_t b, size_t e){
+        return _ring.read(at, b, e, dest, UseSecondary ? sec : nullptr);
+    });
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+long long
+SHARED_DATASTREAM_CLASS::copy_from_marker(char **dest,
+                                          size_t dest_sz,
+                                          size_t str_sz,
+                                          int beg,
+                                          typename SHARED_DATASTREAM_CLASS::secondary_ty *sec) const
+{
+    if(!dest)
+        throw DataStreamInvalidArgument("NULL dest argument");
+
+    return _copy_from_marker(dest_sz, beg, [&](unsigned long long at, size_t b, size_t e){
+        std::vector<Ty> tmp(e - b + 1);
+        size_t n = _ring.read(at, b, e, &tmp[0], UseSecondary ? sec : nullptr);
+        for(size_t i = 0; i < n; ++i){
+            std::string gstr = generic_ty(tmp[i]).as_string();
+            strncpy_s(dest[i], str_sz, gstr.c_str(), std::min<size_t>(str_sz-1, gstr.length()));
+        }
+        return n;
+    });
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+long long
+SHARED_DATASTREAM_CLASS::copy_from_marker(Ty *dest,
+                                          size_t sz,
+                                          int beg,
+                                          typename SHARED_DATASTREAM_CLASS::secondary_as sec) const
+{
+    if(!UseSecondary || !sec.dest){
+        long long ret = copy_from_marker(dest, sz, beg);
+        if(sec.dest) /* no secondaries to convert */
+            std::fill_n(sec.dest, (size_t)std::abs(ret), 0LL);
+        return ret;
+    }
+
+    if(!dest)
+        throw DataStreamInvalidArgument("NULL dest argument");
+
+    return _copy_from_marker(sz, beg, [&](unsigned long long at, size_t b, size_t e){
+        return _ring.read_into(at, b, e, dest, sec);
+    });
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+long long
+SHARED_DATASTREAM_CLASS::copy_from_marker(char **dest,
+                                          size_t dest_sz,
+                                          size_t str_sz,
+                                          int beg,
+                                          typename SHARED_DATASTREAM_CLASS::secondary_as sec) const
+{
+    if(!UseSecondary || !sec.dest){
+        long long ret = copy_from_marker(dest, dest_sz, str_sz, beg);
+        if(sec.dest) /* no secondaries to convert */
+            std::fill_n(sec.dest, (size_t)std::abs(ret), 0LL);
+        return ret;
+    }
+
+    if(!dest)
+        throw DataStreamInvalidArgument("NULL dest argument");
+
+    return _copy_from_marker(dest_sz, beg, [&](unsigned long long at, size_t b, size_t e){
+        std::vector<Ty> tmp(e - b + 1);
+        size_t n = _ring.read_into(at, b, e, &tmp[0], sec);
+        for(size_t i = 0; i < n; ++i){
+            std::string gstr = generic_ty(tmp[i]).as_string();
+            strncpy_s(dest[i], str_sz, gstr.c_str(), std::min<size_t>(str_sz-1, gstr.length()));
+        }
+        return n;
+    });
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+size_t
+SHARED_DATASTREAM_CLASS::copy(Ty *dest,
+                              size_t sz,
+                              int end,
+                              int beg,
+                              typename SHARED_DATASTREAM_CLASS::secondary_ty *sec) const
+{
+    static_assert(!std::is_same<Ty,char>::value, "copy doesn't accept char*");
+
+    if(!dest)
+        throw DataStreamInvalidArgument("NULL dest argument");
+
+    _check_adj(end, beg);
+
+    size_t ret = _read(dest, sec, sz, end, beg);
+    if(end == beg && !ret && sz){
+        /* like DataStream, a single element that hasn't been pushed yet */
+        *dest = Ty();
+        if(UseSecondary && sec)
+            *sec = secondary_ty();
+        ret = 1;
+    }
+
+    return ret;
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+size_t
+SHARED_DATASTREAM_CLASS::copy(Ty *dest,
+                              size_t sz,
+                              int end,
+                              int beg,
+                              typename SHARED_DATASTREAM_CLASS::secondary_as sec) const
+{
+    size_t ret;
+
+    if(!UseSecondary || !sec.dest){
+        ret = copy(dest, sz, end, beg);
+        if(sec.dest) /* no secondaries to convert */
+            std::fill_n(sec.dest, ret, 0LL);
+        return ret;
+    }
+
+    if(!dest)
+        throw DataStreamInvalidArgument("NULL dest argument");
+
+    _check_adj(end, beg);
+
+    ret = _read(dest, sec, sz, end, beg);
+    if(end == beg && !ret && sz){
+        *dest = Ty();
+        sec(0, secondary_ty());
+        ret = 1;
+    }
+
+    return ret;
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+size_t
+SHARED_DATASTREAM_CLASS::copy(char **dest,
+                              size_t dest_sz,
+                              size_t str_sz,
+                              int end,
+                              int beg,
+                              typename SHARED_DATASTREAM_CLASS::secondary_ty *sec) const
+{
+    size_t i;
+
+    if(!dest)
+        throw DataStreamInvalidArgument("NULL dest argument");
+
+    _check_adj(end, beg);
+
+    std::vector<Ty> tmp(std::min<size_t>(dest_sz, end - beg + 1));
+    if(tmp.empty())
+        return 0;
+
+    size_t n = _read(&tmp[0], sec, tmp.size(), end, beg);
+    for(i = 0; i < n; ++i){
+        std::string gstr = generic_ty(tmp[i]).as_string();
+        strncpy_s(dest[i], str_sz, gstr.c_str(), std::min<size_t>(str_sz-1, gstr.length()));
+    }
+
+    return i;
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+size_t
+SHARED_DATASTREAM_CLASS::copy(char **dest,
+                              size_t dest_sz,
+                              size_t str_sz,
+                              int end,
+                              int beg,
+                              typename SHARED_DATASTREAM_CLASS::secondary_as sec) const
+{
+    size_t i;
+
+    if(!UseSecondary || !sec.dest){
+        size_t ret = copy(dest, dest_sz, str_sz, end, beg);
+        if(sec.dest) /* no secondaries to convert */
+            std::fill_n(sec.dest, ret, 0LL);
+        return ret;
+    }
+
+    if(!dest)
+        throw DataStreamInvalidArgument("NULL dest argument");
+
+    _check_adj(end, beg);
+
+    std::vector<Ty> tmp(std::min<size_t>(dest_sz, end - beg + 1));
+    if(tmp.empty())
+        return 0;
+
+    size_t n = _read(&tmp[0], sec, tmp.size(), end, beg);
+    for(i = 0; i < n; ++i){
+        std::string gstr = generic_ty(tmp[i]).as_string();
+        strncpy_s(dest[i], str_sz, gstr.c_str(), std::min<size_t>(str_sz-1, gstr.length()));
+    }
+
+    return i;
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+size_t
+SHARED_DATASTREAM_CLASS::copy_strided(double *dest,
+                                      size_t sz,
+                                      size_t stride,
+                                      int end,
+                                      int beg,
+                                      typename SHARED_DATASTREAM_CLASS::secondary_ty *sec) const
+{
+    size_t i, indx, last;
+
+    if(!dest)
+        throw DataStreamInvalidArgument("NULL dest argument");
+
+    if(!stride)
+        throw DataStreamInvalidArgument("stride of 0");
+
+    if(std::is_same<Ty,std::string>::value)
+        BuildThrowTypeError<double*,false>("copy_strided()");
+
+    _check_adj(end, beg);
+
+    /* copy the range out once, then pick from it */
+    std::vector<Ty> tmp(end - beg + 1);
+    std::vector<secondary_ty> stmp(UseSecondary && sec ? tmp.size() : 0);
+    last = _read(&tmp[0], stmp.empty() ? nullptr : &stmp[0], tmp.size(), end, beg);
+
+    for( i = 0, indx = 0;
+         (i < sz) && (indx < last);
+         ++i, indx = (last - indx > stride) ? indx + stride : last )
+    {
+        dest[i] = _as_double(tmp[indx]);
+        if(!stmp.empty())
+            sec[i] = stmp[indx];
+    }
+
+    return i;
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+size_t
+SHARED_DATASTREAM_CLASS::copy_decimated(double *dest,
+                                        size_t sz,
+                                        int end,
+                                        int beg,
+                                        typename SHARED_DATASTREAM_CLASS::secondary_ty *sec) const
+{
+    size_t i, len, nbuckets;
+
+    if(!dest)
+        throw DataStreamInvalidArgument("NULL dest argument");
+
+    if(sz < 4)
+        throw DataStreamInvalidArgument("decimated copy needs room for >= 4 points");
+
+    if(std::is_same<Ty,std::string>::value)
+        BuildThrowTypeError<double*,false>("copy_decimated()");
+
+    _check_adj(end, beg);
+
+    std::vector<Ty> tmp(end - beg + 1);
+    std::vector<secondary_ty> stmp(UseSecondary && sec ? tmp.size() : 0);
+    len = _read(&tmp[0], stmp.empty() ? nullptr : &stmp[0], tmp.size(), end, beg);
+
+    if(len <= sz){ /* nothing to drop */
+        for(i = 0; i < len; ++i){
+            dest[i] = _as_double(tmp[i]);
+            if(!stmp.empty())
+                sec[i] = stmp[i];
+        }
+        return len;
+    }
+
+    /* the same buckets as DataStream::_copy_decimated, relative to beg */
+    nbuckets = sz / 4;
+    i = 0;
+    for(size_t b = 0; b < nbuckets; ++b){
+        size_t lo = (size_t)((unsigned long long)len * b / nbuckets);
+        size_t hi = (size_t)((unsigned long long)len * (b + 1) / nbuckets);
+        size_t imin = lo, imax = lo;
+
+        for(size_t indx = lo + 1; indx < hi; ++indx){
+            if(tmp[indx] < tmp[imin])
+                imin = indx;
+            else if(tmp[imax] < tmp[indx])
+                imax = indx;
+        }
+
+        size_t picks[4] = {lo, std::min(imin, imax), std::max(imin, imax), hi - 1};
+        for(int p = 0; p < 4; ++p){
+            if(p && picks[p] == picks[p-1])
+                continue;
+            dest[i] = _as_double(tmp[picks[p]]);
+            if(!stmp.empty())
+                sec[i] = stmp[picks[p]];
+            ++i;
+        }
+    }
+
+    return i;
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+typename SHARED_DATASTREAM_CLASS::generic_ty
+SHARED_DATASTREAM_CLASS::operator[](int indx) const
+{
+    int dummy = 0;
+    Ty v = Ty();
+
+    _check_adj(indx, dummy);
+    _read(&v, nullptr, 1, indx, indx);
+
+    return generic_ty(v);
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+typename SHARED_DATASTREAM_CLASS::both_ty
+SHARED_DATASTREAM_CLASS::both(int indx) const
+{
+    int dummy = 0;
+    Ty v = Ty();
+    secondary_ty sec = secondary_ty();
+
+    _check_adj(indx, dummy);
+    _read(&v, &sec, 1, indx, indx);
+
+    return both_ty(generic_ty(v), sec);
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+void
+SHARED_DATASTREAM_CLASS::secondary(typename SHARED_DATASTREAM_CLASS::secondary_ty *dest,
+                                   int indx) const
+{
+    int dummy = 0;
+
+    if(!UseSecondary)
+        return;
+
+    _check_adj(indx, dummy);
+
+    unsigned long long at;
+    *dest = secondary_ty();
+    _ring.read_latest(indx, indx, nullptr, dest, &at);
+    _set_marker(indx, at);
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+typename SHARED_DATASTREAM_CLASS::generic_vector_ty
+SHARED_DATASTREAM_CLASS::vector(int end, int beg) const
+{
+    generic_vector_ty tmp;
+
+    _check_adj(end, beg);
+
+    std::vector<Ty> vals(end - beg + 1);
+    size_t n = _read(&vals[0], nullptr, vals.size(), end, beg);
+
+    /* generic_ty doesn't allow default construction */
+    tmp.reserve(n);
+    for(size_t i = 0; i < n; ++i)
+        tmp.push_back( generic_ty(vals[i]) );
+
+    return tmp;
+}
+
+
+SHARED_DATASTREAM_TEMPLATE
+typename SHARED_DATASTREAM_CLASS::secondary_vector_ty
+SHARED_DATASTREAM_CLASS::secondary_vector(int end, int beg) const
+{
+    _check_adj(end, beg);
+
+    if(!UseSecondary) /* like DataStream: default stamps, marker untouched */
+        return secondary_vector_ty(std::min<size_t>(end - beg + 1, size()));
+
+    secondary_vector_ty tmp(end - beg + 1);
+    unsigned long long at;
+    size_t n = _ring.read_latest(beg, end, nullptr, &tmp[0], &at);
+    _set_marker(beg, at);
+
+    tmp.resize(n);
+    return tmp;
+}
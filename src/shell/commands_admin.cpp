@@ -15,6 +15,7 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see http://www.gnu.org/licenses.
 */
 
+#include <iomanip>
 #include "shell.hpp"
   
 namespace{
@@ -26,6 +27,8 @@ void IsConnectedToEngine(CommandCtx *ctx);
 void IsConnectedToEngineAndTOS(CommandCtx *ctx);
 void ConnectionState(CommandCtx *ctx);
 void CreateBlock(CommandCtx *ctx); 
+void CreateSharedBlock(CommandCtx *ctx);
+void AttachSharedBlock(CommandCtx *ctx);
 void CloseBlock(CommandCtx *ctx); 
 void CloseBlocks(CommandCtx *ctx);
 void GetBlockLimit(CommandCtx *ctx);
@@ -36,6 +39,8 @@ void GetBlockSize(CommandCtx *ctx);
 void SetBlockSize(CommandCtx *ctx);
 void GetLatency(CommandCtx *ctx); 
 void SetLatency(CommandCtx *ctx);
+void GetPrefill(CommandCtx *ctx);
+void SetPrefill(CommandCtx *ctx);
 void Add(CommandCtx *ctx);
 void AddTopic(CommandCtx *ctx);
 void AddItem(CommandCtx *ctx);
@@ -59,8 +64,18 @@ void IsUsingDateTime(CommandCtx *ctx);
 void GetStreamOccupancy(CommandCtx *ctx);
 void GetMarkerPosition(CommandCtx *ctx);
 void IsMarkerDirty(CommandCtx *ctx);
+void GetStreamSummary(CommandCtx *ctx);
 void DumpBufferStatus(CommandCtx *ctx);
 void RemoveOrphanedStream(CommandCtx *ctx);
+void SetLockProfiling(CommandCtx *ctx);
+void GetLockStats(CommandCtx *ctx);
+void ResetLockStats(CommandCtx *ctx);
+void SetStreamPriority(CommandCtx *ctx);
+void SetThreadSchedule(CommandCtx *ctx);
+void LoadThreadConfig(CommandCtx *ctx);
+void SetShardCount(CommandCtx *ctx);
+void AssignShard(CommandCtx *ctx);
+void LoadShardMap(CommandCtx *ctx);
 
 }; /* namespace */
 
@@ -72,6 +87,8 @@ CommandsMap commands_admin(
                           ("IsConnectedToEngineAndTOS",IsConnectedToEngineAndTOS)
                           ("ConnectionState",ConnectionState)  
                           ("CreateBlock",CreateBlock)                              
+                          ("CreateSharedBlock",CreateSharedBlock)
+                          ("AttachSharedBlock",AttachSharedBlock)
                           ("CloseBlock",CloseBlock)                              
                           ("CloseBlocks",CloseBlocks)                              
                           ("GetBlockLimit",GetBlockLimit)                              
@@ -82,6 +99,8 @@ CommandsMap commands_admin(
                           ("SetBlockSize",SetBlockSize)                              
                           ("GetLatency",GetLatency)                              
                           ("SetLatency",SetLatency)                              
+                          ("GetPrefill",GetPrefill)
+                          ("SetPrefill",SetPrefill)
                           ("Add",Add)                              
                           ("AddTopic",AddTopic)                              
                           ("AddItem",AddItem)                              
@@ -104,9 +123,19 @@ CommandsMap commands_admin(
                           ("IsUsingDateTime",IsUsingDateTime)                              
                           ("GetStreamOccupancy",GetStreamOccupancy)                              
                           ("GetMarkerPosition",GetMarkerPosition)                              
-                          ("IsMarkerDirty",IsMarkerDirty)                              
+                          ("IsMarkerDirty",IsMarkerDirty)
+                          ("GetStreamSummary",GetStreamSummary)                              
                           ("DumpBufferStatus",DumpBufferStatus)
                           ("RemoveOrphanedStream", RemoveOrphanedStream)
+                          ("SetLockProfiling", SetLockProfiling)
+                          ("GetLockStats", GetLockStats)
+                          ("ResetLockStats", ResetLockStats)
+                          ("SetStreamPriority", SetStreamPriority)
+                          ("SetThreadSchedule", SetThreadSchedule)
+                          ("LoadThreadConfig", LoadThreadConfig)
+                          ("SetShardCount", SetShardCount)
+                          ("AssignShard", AssignShard)
+                          ("LoadShardMap", LoadShardMap)
 );
 
 
@@ -262,6 +291,40 @@ CreateBlock(CommandCtx *ctx)
 }
 
 
+void
+CreateSharedBlock(CommandCtx *ctx)
+{
+    std::string block;
+    std::string size;
+    std::string dts_y_or_n;
+    int ret;
+
+    prompt_for("block id", &block, ctx);
+    prompt_for("block size", &size, ctx);        
+    prompt_for("use datetime stamp?(y/n)", &dts_y_or_n, ctx);
+
+    if(dts_y_or_n != "y" && dts_y_or_n != "n")
+        std::cerr<< std::endl << "INVALID - default to 'n'" << std::endl << std::endl;
+
+    ret = TOSDB_CreateSharedBlock(block.c_str(), std::stoul(size), (dts_y_or_n == "y"), 
+                                  TOSDB_DEF_TIMEOUT);      
+    _check_display_ret(ret);            
+}
+
+
+void
+AttachSharedBlock(CommandCtx *ctx)
+{
+    int ret;
+    std::string block;
+
+    prompt_for("block id", &block, ctx);    
+
+    ret = TOSDB_AttachSharedBlock(block.c_str());
+    _check_display_ret(ret);
+}
+
+
 void
 CloseBlock(CommandCtx *ctx)
 {
@@ -387,6 +450,42 @@ SetLatency(CommandCtx *ctx)
 }
 
 
+void
+GetPrefill(CommandCtx *ctx)
+{
+    size_type ticks = 0;
+    size_type secs = 0;
+
+    int ret = TOSDB_GetPrefill(&ticks, &secs);
+    if(ret)
+        std::cout<< std::endl << "error: " << ret << std::endl << std::endl;
+    else
+        std::cout<< std::endl << "ticks: " << ticks << ", seconds: " << secs << std::endl << std::endl;
+}
+
+
+void
+SetPrefill(CommandCtx *ctx)
+{
+    std::string ticks;
+    std::string secs;
+
+    prompt_for("max ticks (0 for no limit)", &ticks, ctx);
+    prompt_for("max seconds (0 for no limit; 0 and 0 turns it off)", &secs, ctx);
+
+    unsigned long t, s;
+    try{
+        t = std::stoul(ticks);
+        s = std::stoul(secs);
+    }catch(...){
+        std::cerr<< std::endl << "INVALID INPUT" << std::endl << std::endl;
+        return;
+    }
+
+    _check_display_ret( TOSDB_SetPrefill((size_type)t, (size_type)s) );
+}
+
+
 void
 Add(CommandCtx *ctx)
 {
@@ -956,6 +1055,34 @@ GetMarkerPosition(CommandCtx *ctx)
 }
 
 
+void
+GetStreamSummary(CommandCtx *ctx)
+{
+    std::string item;
+    std::string topic;
+
+    StreamSummary s;
+
+    prompt_for_item_topic(&item, &topic, ctx);
+
+    int ret = TOSDB_GetStreamSummary(item.c_str(), topic.c_str(), &s);
+    if(ret){
+        std::cout<< std::endl << "error: " << ret << std::endl << std::endl;
+        return;
+    }
+
+    std::cout<< std::endl << "count: " << s.count << std::endl
+             << "last time: " << s.last_time << std::endl;
+    if(TOS_Topics::TypeBits(TOS_Topics::MAP()[topic]) == TOSDB_STRING_BIT){
+        std::cout<< "last: " << s.last_str << std::endl;
+    }else{
+        std::cout<< "open: " << s.open << ", high: " << s.high << ", low: " << s.low 
+                 << ", last: " << s.last << std::endl;
+    }
+    std::cout<< std::endl;
+}
+
+
 void
 IsMarkerDirty(CommandCtx *ctx)
 {
@@ -998,6 +1125,181 @@ RemoveOrphanedStream(CommandCtx *ctx)
 }
 
 
+void
+SetLockProfiling(CommandCtx *ctx)
+{
+    std::string on_y_or_n;
+
+    prompt_for("profile locks? (y/n)", &on_y_or_n, ctx);
+
+    _check_display_ret( TOSDB_SetLockProfiling(on_y_or_n == "y" ? TRUE : FALSE) );
+}
+
+
+void
+GetLockStats(CommandCtx *ctx)
+{
+    int ret;
+    size_type n = 0;
+ 
+    ret = TOSDB_GetLockStats(NULL, 0, &n);
+    if(ret){
+        _check_display_ret(ret);
+        return;
+    }
+
+    LockStats *stats = new LockStats[n];
+
+    ret = TOSDB_GetLockStats(stats, n, &n);
+    if(ret){
+        _check_display_ret(ret);
+    }else{
+        std::cout<< std::endl << std::left 
+                 << std::setw(16) << "Lock" << std::setw(14) << "Acquisitions" 
+                 << std::setw(13) << "Contentions" << std::setw(12) << "Wait(us)"
+                 << std::setw(13) << "MaxWait(us)" << std::setw(12) << "Hold(us)"
+                 << std::setw(13) << "MaxHold(us)" << std::endl;
+        for(size_type i = 0; i < n; ++i){
+            std::cout<< std::setw(16) << stats[i].name 
+                     << std::setw(14) << stats[i].acquisitions 
+                     << std::setw(13) << stats[i].contentions
+                     << std::setw(12) << stats[i].wait_micro
+                     << std::setw(13) << stats[i].max_wait_micro
+                     << std::setw(12) << stats[i].hold_micro
+                     << std::setw(13) << stats[i].max_hold_micro << std::endl;
+        }
+        std::cout<< std::right << std::endl 
+                 << "(engine locks: see the DumpBufferStatus file)" 
+                 << std::endl << std::endl;
+    }
+
+    delete[] stats;
+}
+
+
+void
+ResetLockStats(CommandCtx *ctx)
+{
+    _check_display_ret( TOSDB_ResetLockStats() );
+}
+
+void
+SetStreamPriority(CommandCtx *ctx)
+{
+    std::string item;
+    std::string topic;
+    std::string priority;
+
+    prompt_for("item ('*' for any)", &item, ctx);
+    prompt_for("topic ('*' for any)", &topic, ctx);
+    prompt_for("priority (-1=default, 0=high, 1=normal, 2=low)", &priority, ctx);
+
+    int p;
+    try{
+        p = std::stoi(priority);
+    }catch(...){
+        std::cerr<< std::endl << "INVALID INPUT" << std::endl << std::endl;
+        return;
+    }
+
+    _check_display_ret( TOSDB_SetStreamPriority(item == "*" ? NULL : item.c_str(), 
+                                                topic == "*" ? NULL : topic.c_str(), p) );
+}
+
+
+void
+SetThreadSchedule(CommandCtx *ctx)
+{
+    std::string thread;
+    std::string mask;
+    std::string priority;
+
+    prompt_for("thread (0=engine msg, 1=engine ipc, 2=engine probe, 3=client extract)", 
+               &thread, ctx);
+    prompt_for("cpu mask (e.g 0x4; 0 = leave alone)", &mask, ctx);
+    prompt_for("priority (-2=lowest ... 2=highest, 3=realtime, 99=unchanged)", &priority, ctx);
+
+    int t, p;
+    unsigned long long m;
+    try{
+        t = std::stoi(thread);
+        m = std::stoull(mask, nullptr, 0);
+        p = std::stoi(priority);
+    }catch(...){
+        std::cerr<< std::endl << "INVALID INPUT" << std::endl << std::endl;
+        return;
+    }
+
+    _check_display_ret( TOSDB_SetThreadSchedule(t, m, p) );
+}
+
+
+void
+LoadThreadConfig(CommandCtx *ctx)
+{
+    std::string path;
+
+    prompt_for("path", &path, ctx);
+
+    _check_display_ret( TOSDB_LoadThreadConfig(path.c_str()) );
+}
+
+
+void
+SetShardCount(CommandCtx *ctx)
+{
+    std::string n;
+
+    prompt_for("number of engine shards", &n, ctx);
+
+    unsigned long l;
+    try{
+        l = std::stoul(n);
+    }catch(...){
+        std::cerr<< std::endl << "INVALID INPUT" << std::endl << std::endl;
+        return;
+    }
+
+    _check_display_ret( TOSDB_SetShardCount((unsigned int)l) );
+}
+
+
+void
+AssignShard(CommandCtx *ctx)
+{
+    std::string item;
+    std::string topic;
+    std::string shard;
+
+    prompt_for("item ('*' if assigning a topic)", &item, ctx);
+    prompt_for("topic ('*' if assigning an item)", &topic, ctx);
+    prompt_for("shard", &shard, ctx);
+
+    unsigned long s;
+    try{
+        s = std::stoul(shard);
+    }catch(...){
+        std::cerr<< std::endl << "INVALID INPUT" << std::endl << std::endl;
+        return;
+    }
+
+    _check_display_ret( TOSDB_AssignShard(item == "*" ? NULL : item.c_str(), 
+                                          topic == "*" ? NULL : topic.c_str(), 
+                                          (unsigned int)s) );
+}
+
+
+void
+LoadShardMap(CommandCtx *ctx)
+{
+    std::string path;
+
+    prompt_for("path", &path, ctx);
+
+    _check_display_ret( TOSDB_LoadShardMap(path.c_str()) );
+}
+
+
 template<typename T>
 void 
 _check_display_ret(int r, T v)
@@ -0,0 +1,293 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <iomanip>
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include <conio.h>
+
+#include "shell.hpp"
+
+namespace{
+
+void Watch(CommandCtx *ctx);
+
+}; /* namespace */
+
+CommandsMap commands_watch(
+    CommandsMap::InitChain("Watch",Watch,"live view of a block's streams (any key to stop)")
+);
+
+
+namespace{
+
+/* room for what's new since the last pull, plus what arrives during it */
+const size_type PULL_SLACK = 64;
+
+struct WatchedStream{
+    std::string item;
+    std::string topic;
+    bool is_string;
+    std::string last;
+    unsigned long long ticks; /* total since the watch started */
+    double rate;              /* ticks/sec over the last refresh */
+    double extract_micro;     /* time spent in the from-marker call */
+    double ring_pct;          /* occupancy / block size */
+    bool dropped;             /* marker hit the back of the stream (ever) */
+    std::vector<double> nums; /* pull buffers, reused */
+    std::vector<char> strs;
+    std::vector<char*> pstrs;
+};
+
+void
+_pull(std::string block, size_type block_sz, WatchedStream *ws, double secs);
+
+void
+_render(std::string block, size_type ms, unsigned long long frame,
+        const std::vector<WatchedStream>& streams, COORD *top);
+
+long long
+_qpc_micro();
+
+
+void
+Watch(CommandCtx *ctx)
+{
+    std::string block;
+    std::string nstreams_s;
+    std::string ms_s;
+    std::vector<WatchedStream> streams;
+    size_type block_sz = 0;
+    size_type ms = 0;
+    unsigned long nstreams = 0;
+
+    prompt_for("block", &block, ctx);
+    prompt_for("# of streams (0 = every item/topic in block)", &nstreams_s, ctx);
+    prompt_for("refresh interval (milliseconds)", &ms_s, ctx);
+
+    try{
+        nstreams = std::stoul(nstreams_s);
+        ms = std::stoul(ms_s);
+    }catch(...){
+        std::cerr<< std::endl << "INVALID INPUT" << std::endl << std::endl;
+        return;
+    }
+
+    int ret = TOSDB_GetBlockSize(block.c_str(), &block_sz);
+    if(ret){
+        std::cout<< std::endl << "error: "<< ret << std::endl << std::endl;
+        return;
+    }
+
+    WatchedStream blank = WatchedStream();
+    if(nstreams == 0){
+        for(const std::string& i : TOSDB_GetItemNames(block)){
+            for(const std::string& t : TOSDB_GetTopicNames(block)){
+                streams.push_back(blank);
+                streams.back().item = i;
+                streams.back().topic = t;
+            }
+        }
+    }else{
+        for(unsigned long i = 0; i < nstreams; ++i){
+            streams.push_back(blank);
+            prompt_for_item_topic(&streams.back().item, &streams.back().topic, ctx);
+        }
+    }
+
+    for(WatchedStream& ws : streams){
+        type_bits_type tbits = 0;
+        TOSDB_GetTypeBits(ws.topic.c_str(), &tbits);
+        ws.is_string = (tbits & TOSDB_STRING_BIT) != 0;
+    }
+
+    if(streams.empty()){
+        std::cout<< std::endl << "NO STREAMS" << std::endl << std::endl;
+        return;
+    }
+
+    /* first pull just moves the markers; only what comes in after counts */
+    for(WatchedStream& ws : streams){
+        _pull(block, block_sz, &ws, 0);
+        ws.ticks = 0;
+        ws.dropped = false;
+        ws.rate = 0;
+    }
+
+    std::cout<< std::endl;
+
+    COORD top = {0, -1};
+    long long last = _qpc_micro();
+    for(unsigned long long frame = 1; !_kbhit(); ++frame){
+        Sleep((DWORD)ms);
+
+        long long now = _qpc_micro();
+        double secs = (now - last) / 1000000.0;
+        last = now;
+
+        for(WatchedStream& ws : streams)
+            _pull(block, block_sz, &ws, secs);
+
+        _render(block, ms, frame, streams, &top);
+    }
+
+    _getch(); /* eat the key */
+    std::cout<< std::endl;
+}
+
+
+void
+_pull(std::string block, size_type block_sz, WatchedStream *ws, double secs)
+{
+    long long pos = -1;
+    long get_sz = 0;
+    size_type occ = 0;
+    unsigned int dirty = 0;
+    int ret;
+
+    if( TOSDB_GetMarkerPosition(block.c_str(), ws->item.c_str(), ws->topic.c_str(), &pos) )
+        return;
+
+    if( !TOSDB_IsMarkerDirty(block.c_str(), ws->item.c_str(), ws->topic.c_str(), &dirty) 
+        && dirty )
+        ws->dropped = true;
+
+    size_type n = (size_type)std::min<long long>(pos + 1 + PULL_SLACK, block_sz);
+
+    long long beg = _qpc_micro();
+    if(ws->is_string){
+        if(ws->pstrs.size() < n){
+            ws->strs.resize(n * (TOSDB_STR_DATA_SZ + 1));
+            ws->pstrs.resize(n);
+            for(size_type i = 0; i < n; ++i)
+                ws->pstrs[i] = &ws->strs[i * (TOSDB_STR_DATA_SZ + 1)];
+        }
+        ret = TOSDB_GetStreamSnapshotStringsFromMarker(block.c_str(), ws->item.c_str(),
+                                                       ws->topic.c_str(), &ws->pstrs[0], n,
+                                                       TOSDB_STR_DATA_SZ + 1, nullptr, 0,
+                                                       &get_sz);
+    }else{
+        if(ws->nums.size() < n)
+            ws->nums.resize(n);
+        ret = TOSDB_GetStreamSnapshotDoublesFromMarker(block.c_str(), ws->item.c_str(),
+                                                       ws->topic.c_str(), &ws->nums[0], n,
+                                                       nullptr, 0, &get_sz);
+    }
+    ws->extract_micro = (double)(_qpc_micro() - beg);
+
+    if(ret)
+        return;
+
+    /* negative: dirty (see above) or more came in than we had room for */
+    if(get_sz < 0)
+        get_sz = -get_sz;
+
+    if(get_sz > 0){
+        if(ws->is_string){
+            ws->last = ws->pstrs[0];
+        }else{
+            std::ostringstream s;
+            s<< ws->nums[0];
+            ws->last = s.str();
+        }
+    }
+
+    ws->ticks += get_sz;
+    ws->rate = (secs > 0) ? get_sz / secs : 0;
+
+    if( !TOSDB_GetStreamOccupancy(block.c_str(), ws->item.c_str(), ws->topic.c_str(), &occ) )
+        ws->ring_pct = block_sz ? (100.0 * occ / block_sz) : 0;
+}
+
+
+void
+_render(std::string block, size_type ms, unsigned long long frame,
+        const std::vector<WatchedStream>& streams, COORD *top)
+{
+    HANDLE hout = GetStdHandle(STD_OUTPUT_HANDLE);
+    std::ostringstream out;
+
+    /* pad every line so it overwrites what was there */
+    auto line = [&](const std::ostringstream& s){
+        std::string l = s.str().substr(0, MAX_DISPLAY_WIDTH - 1);
+        out<< l << std::string(MAX_DISPLAY_WIDTH - 1 - l.size(), ' ') << std::endl;
+    };
+
+    std::ostringstream hdr;
+    hdr<< "block: " << block << "  refresh: " << ms << "ms  frame: " << frame
+       << "  (any key to stop)";
+    line(hdr);
+
+    std::ostringstream cols;
+    cols<< std::left << std::setw(10) << "Item" << std::setw(14) << "Topic"
+        << std::setw(16) << "Last" << std::right << std::setw(10) << "Ticks/s"
+        << std::setw(10) << "Ticks" << std::setw(12) << "Extract(us)"
+        << std::setw(7) << "Ring%";
+    line(cols);
+
+    for(const WatchedStream& ws : streams){
+        std::ostringstream s;
+        s<< std::left << std::setw(10) << ws.item.substr(0, 9)
+         << std::setw(14) << ws.topic.substr(0, 13)
+         << std::setw(16) << ws.last.substr(0, 15)
+         << std::right << std::fixed << std::setprecision(1)
+         << std::setw(10) << ws.rate
+         << std::setw(10) << ws.ticks
+         << std::setw(12) << ws.extract_micro
+         << std::setw(6) << ws.ring_pct << (ws.dropped ? "*" : " ");
+        line(s);
+    }
+
+    std::ostringstream ftr;
+    ftr<< "(* = marker hit the back of the stream, data was dropped)";
+    line(ftr);
+
+    /* first frame: print where we are and work out where that was, after any
+       scrolling; after that, go back there and draw over it */
+    if(top->Y >= 0)
+        SetConsoleCursorPosition(hout, *top);
+
+    std::cout<< out.str() << std::flush;
+
+    if(top->Y < 0){
+        CONSOLE_SCREEN_BUFFER_INFO info;
+        if( GetConsoleScreenBufferInfo(hout, &info) ){
+            top->X = 0;
+            top->Y = info.dwCursorPosition.Y - (SHORT)(streams.size() + 3);
+        }
+    }
+}
+
+
+long long
+_qpc_micro()
+{
+    static long long freq = 0;
+    LARGE_INTEGER t;
+
+    if(!freq){
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        freq = f.QuadPart;
+    }
+
+    QueryPerformanceCounter(&t);
+    return (t.QuadPart / freq) * 1000000 + (t.QuadPart % freq) * 1000000 / freq;
+}
+
+}; /* namespace */
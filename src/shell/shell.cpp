@@ -31,6 +31,7 @@ commands = InitializerChain<commands_map_of_maps_ty>
     ( "get", "GET", CommandsMapRef(commands_get) )
     ( "stream", "STREAM-SNAPSHOT", CommandsMapRef(commands_stream) )
     ( "frame", "FRAME", CommandsMapRef(commands_frame) )
+    ( "watch", "WATCH", CommandsMapRef(commands_watch) )
     ( "local", "LOCAL", CommandsMapRef(commands_local) );
 
 language_strings_ty 
@@ -0,0 +1,207 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include "vhandler.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+/* tos-databridge-vserver [--addr <address>] [--port <port>]
+                          [--push-interval <msec>] [--verbose]
+                          [--mcast <group>[:<port>] --mcast-items <i1,i2...>
+                           --mcast-topics <t1,t2...> [--mcast-iface <address>]
+                           [--mcast-ttl <n>] [--mcast-size <n>] [--mcast-dts]]
+
+   Exposes the block API of the local tos-databridge client library over TCP
+   (see vprotocol.hpp); a native replacement for the python virtualization
+   hub (tosdb.enable_virtualization). With --mcast it also publishes every
+   new point of items x topics to a multicast group (see vmulticast.hpp),
+   recovery requests coming in on the TCP port. Ctrl-C to stop.              */
+
+namespace{
+
+VServer* volatile the_server = nullptr;
+
+BOOL WINAPI
+_ctrlHandler(DWORD ctrl_type)
+{
+    VServer* srv = the_server;
+    if(srv)
+        srv->stop();
+    return TRUE;
+}
+
+void
+_usage(const char* prog)
+{
+    std::cerr<< "usage: " << prog << " [--addr <address>] [--port <port>]"
+             << " [--push-interval <msec>] [--verbose]"
+             << " [--mcast <group>[:<port>] --mcast-items <i1,i2...>"
+             << " --mcast-topics <t1,t2...> [--mcast-iface <address>]"
+             << " [--mcast-ttl <n>] [--mcast-size <n>] [--mcast-dts]]" << std::endl;
+}
+
+
+std::vector<std::string>
+_splitUpper(std::string s)
+{
+    std::vector<std::string> strs;
+    std::transform(s.begin(), s.end(), s.begin(), ::toupper);
+
+    size_t beg = 0;
+    while(beg <= s.size()){
+        size_t end = s.find(',', beg);
+        if(end == std::string::npos)
+            end = s.size();
+        if(end > beg)
+            strs.push_back( s.substr(beg, end - beg) );
+        beg = end + 1;
+    }
+    return strs;
+}
+
+}; /* namespace */
+
+
+int
+main(int argc, char* argv[])
+{
+    std::string addr = "0.0.0.0";
+    unsigned short port = VPROTO_DEF_PORT;
+    unsigned int push_interval = VHANDLER_DEF_PUSH_INTERVAL;
+    bool verbose = false;
+    std::string mcast_group;
+    unsigned short mcast_port = VMCAST_DEF_PORT;
+    std::string mcast_iface;
+    int mcast_ttl = 1;
+    size_type mcast_size = 1000;
+    bool mcast_dts = false;
+    std::vector<std::string> mcast_items;
+    std::vector<std::string> mcast_topics;
+
+    for(int i = 1; i < argc; ++i){
+        std::string arg(argv[i]);
+        if(arg == "--addr" && i + 1 < argc){
+            addr = argv[++i];
+        }else if(arg == "--port" && i + 1 < argc){
+            try{
+                port = (unsigned short)std::stoi(argv[++i]);
+            }catch(...){
+                _usage(argv[0]);
+                return 1;
+            }
+        }else if(arg == "--push-interval" && i + 1 < argc){
+            try{
+                push_interval = (unsigned int)std::stoul(argv[++i]);
+            }catch(...){
+                _usage(argv[0]);
+                return 1;
+            }
+        }else if(arg == "--verbose"){
+            verbose = true;
+        }else if(arg == "--mcast" && i + 1 < argc){
+            mcast_group = argv[++i];
+            size_t colon = mcast_group.find(':');
+            if(colon != std::string::npos){
+                try{
+                    mcast_port = (unsigned short)std::stoi(mcast_group.substr(colon + 1));
+                }catch(...){
+                    _usage(argv[0]);
+                    return 1;
+                }
+                mcast_group.erase(colon);
+            }
+        }else if(arg == "--mcast-items" && i + 1 < argc){
+            mcast_items = _splitUpper(argv[++i]);
+        }else if(arg == "--mcast-topics" && i + 1 < argc){
+            mcast_topics = _splitUpper(argv[++i]);
+        }else if(arg == "--mcast-iface" && i + 1 < argc){
+            mcast_iface = argv[++i];
+        }else if(arg == "--mcast-ttl" && i + 1 < argc){
+            try{
+                mcast_ttl = std::stoi(argv[++i]);
+            }catch(...){
+                _usage(argv[0]);
+                return 1;
+            }
+        }else if(arg == "--mcast-size" && i + 1 < argc){
+            try{
+                mcast_size = (size_type)std::stoul(argv[++i]);
+            }catch(...){
+                _usage(argv[0]);
+                return 1;
+            }
+        }else if(arg == "--mcast-dts"){
+            mcast_dts = true;
+        }else{
+            _usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if( !mcast_group.empty() && (mcast_items.empty() || mcast_topics.empty()) ){
+        _usage(argv[0]);
+        return 1;
+    }
+
+    if( !NetStartup() ){
+        std::cerr<< "failed to initialize winsock" << std::endl;
+        return 1;
+    }
+
+    if( TOSDB_Connect() )
+        std::cerr<< "warning: failed to connect to the engine (is it running?)" << std::endl;
+
+    int ret = 0;
+    {
+        std::unique_ptr<VMcastPublisher> publisher;
+        TOSDB_VHandler handler(verbose, push_interval);
+        try{
+            if( !mcast_group.empty() ){
+                publisher.reset( new VMcastPublisher(mcast_group, mcast_port, mcast_iface,
+                                                     mcast_ttl) );
+                int err = handler.multicast(*publisher, mcast_items, mcast_topics,
+                                            mcast_size, mcast_dts);
+                if(err)
+                    throw VProtocolError("failed to create multicast block, error "
+                                         + std::to_string(err));
+
+                std::cout<< "tos-databridge-vserver multicasting to " << mcast_group
+                         << ':' << mcast_port << std::endl;
+            }
+
+            VServer server(addr, port, handler);
+            the_server = &server;
+            SetConsoleCtrlHandler(_ctrlHandler, TRUE);
+
+            std::cout<< "tos-databridge-vserver listening on " << addr << ':'
+                     << server.port() << std::endl;
+
+            /* wake at least as often as we push */
+            server.run( std::min<int>(VSERVER_POLL_TIMEOUT, push_interval) );
+
+            the_server = nullptr;
+        }catch(const std::exception& e){
+            std::cerr<< "vserver error: " << e.what() << std::endl;
+            ret = 1;
+        }
+    } /* handler closes its blocks */
+
+    TOSDB_Disconnect();
+    NetCleanup();
+    return ret;
+}
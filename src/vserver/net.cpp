@@ -0,0 +1,498 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include "net.hpp"
+
+#include <sstream>
+#include <string.h>
+
+#ifdef _WIN32
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+namespace{
+
+bool
+_resolve(std::string addr, unsigned short port, sockaddr_in* sa)
+{
+    memset(sa, 0, sizeof(sockaddr_in));
+    sa->sin_family = AF_INET;
+    sa->sin_port = htons(port);
+
+    if(addr.empty() || addr == "*"){
+        sa->sin_addr.s_addr = htonl(INADDR_ANY);
+        return true;
+    }
+
+    if(inet_pton(AF_INET, addr.c_str(), &sa->sin_addr) == 1)
+        return true;
+
+    addrinfo hints;
+    addrinfo *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if(getaddrinfo(addr.c_str(), nullptr, &hints, &res) || !res)
+        return false;
+
+    sa->sin_addr = ((sockaddr_in*)res->ai_addr)->sin_addr;
+    freeaddrinfo(res);
+    return true;
+}
+
+#ifndef _WIN32
+uint32_t
+_toEpoll(unsigned int events)
+{
+    return ((events & NET_EVENT_READ) ? (uint32_t)EPOLLIN : 0)
+           | ((events & NET_EVENT_WRITE) ? (uint32_t)EPOLLOUT : 0);
+}
+#endif
+
+}; /* namespace */
+
+
+bool
+NetStartup()
+{
+#ifdef _WIN32
+    WSADATA wsa;
+    return (WSAStartup(MAKEWORD(2,2), &wsa) == 0);
+#else
+    return true;
+#endif
+}
+
+
+void
+NetCleanup()
+{
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+
+int
+NetLastError()
+{
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+
+bool
+NetWouldBlock(int err)
+{
+#ifdef _WIN32
+    return (err == WSAEWOULDBLOCK);
+#else
+    return (err == EWOULDBLOCK || err == EAGAIN);
+#endif
+}
+
+
+void
+NetClose(net_socket_type sock)
+{
+    if(sock == NET_INVALID_SOCKET)
+        return;
+#ifdef _WIN32
+    closesocket(sock);
+#else
+    close(sock);
+#endif
+}
+
+
+bool
+NetSetNonBlocking(net_socket_type sock)
+{
+#ifdef _WIN32
+    u_long on = 1;
+    return (ioctlsocket(sock, FIONBIO, &on) == 0);
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    return (flags != -1) && (fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0);
+#endif
+}
+
+
+bool
+NetSetNoDelay(net_socket_type sock)
+{
+    int on = 1;
+    return (setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on)) == 0);
+}
+
+
+net_socket_type
+NetListen(std::string addr, unsigned short port, int backlog)
+{
+    sockaddr_in sa;
+    if( !_resolve(addr, port, &sa) )
+        return NET_INVALID_SOCKET;
+
+    net_socket_type sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if(sock == NET_INVALID_SOCKET)
+        return NET_INVALID_SOCKET;
+
+    int on = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+
+    if( bind(sock, (sockaddr*)&sa, sizeof(sa))
+        || listen(sock, backlog)
+        || !NetSetNonBlocking(sock) )
+    {
+        NetClose(sock);
+        return NET_INVALID_SOCKET;
+    }
+
+    return sock;
+}
+
+
+net_socket_type
+NetConnect(std::string addr, unsigned short port)
+{
+    sockaddr_in sa;
+    if( !_resolve(addr, port, &sa) )
+        return NET_INVALID_SOCKET;
+
+    net_socket_type sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if(sock == NET_INVALID_SOCKET)
+        return NET_INVALID_SOCKET;
+
+    if( connect(sock, (sockaddr*)&sa, sizeof(sa)) ){
+        NetClose(sock);
+        return NET_INVALID_SOCKET;
+    }
+
+    NetSetNoDelay(sock);
+    return sock;
+}
+
+
+unsigned short
+NetLocalPort(net_socket_type sock)
+{
+    sockaddr_in sa;
+    socklen_t len = sizeof(sa);
+
+    if( getsockname(sock, (sockaddr*)&sa, &len) )
+        return 0;
+
+    return ntohs(sa.sin_port);
+}
+
+
+std::string
+NetPeerName(net_socket_type sock)
+{
+    sockaddr_in sa;
+    socklen_t len = sizeof(sa);
+    char buf[INET_ADDRSTRLEN] = {0};
+
+    if( getpeername(sock, (sockaddr*)&sa, &len)
+        || !inet_ntop(AF_INET, &sa.sin_addr, buf, sizeof(buf)) )
+    {
+        return "?";
+    }
+
+    std::stringstream s;
+    s<< buf << ':' << ntohs(sa.sin_port);
+    return s.str();
+}
+
+
+bool
+NetSendAll(net_socket_type sock, const char* buf, size_t len)
+{
+    while(len > 0){
+        int r = send(sock, buf, (int)len, 0);
+        if(r <= 0)
+            return false;
+        buf += r;
+        len -= r;
+    }
+    return true;
+}
+
+
+bool
+NetRecvAll(net_socket_type sock, char* buf, size_t len)
+{
+    while(len > 0){
+        int r = recv(sock, buf, (int)len, 0);
+        if(r <= 0)
+            return false;
+        buf += r;
+        len -= r;
+    }
+    return true;
+}
+
+
+bool
+NetWaitReadable(net_socket_type sock, int timeout)
+{
+#ifdef _WIN32
+    WSAPOLLFD p;
+    p.fd = sock;
+    p.events = POLLRDNORM;
+    p.revents = 0;
+    return (WSAPoll(&p, 1, timeout) > 0);
+#else
+    pollfd p;
+    p.fd = sock;
+    p.events = POLLIN;
+    p.revents = 0;
+    return (poll(&p, 1, timeout) > 0);
+#endif
+}
+
+
+net_socket_type
+NetMcastSender(std::string group, unsigned short port, std::string iface, int ttl)
+{
+    sockaddr_in sa, ifa;
+    if( !_resolve(group, port, &sa) || !_resolve(iface, 0, &ifa) )
+        return NET_INVALID_SOCKET;
+
+    net_socket_type sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if(sock == NET_INVALID_SOCKET)
+        return NET_INVALID_SOCKET;
+
+    unsigned char loop = 1; /* int on windows; the first byte is enough */
+    int ttl_opt = ttl;
+    if( setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&ttl_opt, sizeof(ttl_opt))
+        || setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, (const char*)&ifa.sin_addr,
+                      sizeof(ifa.sin_addr))
+        || connect(sock, (sockaddr*)&sa, sizeof(sa)) )
+    {
+        NetClose(sock);
+        return NET_INVALID_SOCKET;
+    }
+
+#ifdef _WIN32
+    DWORD loop_opt = loop;
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, (const char*)&loop_opt, sizeof(loop_opt));
+#else
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+#endif
+
+    return sock;
+}
+
+
+net_socket_type
+NetMcastReceiver(std::string group, unsigned short port, std::string iface)
+{
+    sockaddr_in sa, ga, ifa;
+    if( !_resolve("", port, &sa)
+        || !_resolve(group, port, &ga)
+        || !_resolve(iface, 0, &ifa) )
+    {
+        return NET_INVALID_SOCKET;
+    }
+
+    net_socket_type sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if(sock == NET_INVALID_SOCKET)
+        return NET_INVALID_SOCKET;
+
+    int on = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+
+    ip_mreq mreq;
+    mreq.imr_multiaddr = ga.sin_addr;
+    mreq.imr_interface = ifa.sin_addr;
+
+    if( bind(sock, (sockaddr*)&sa, sizeof(sa))
+        || setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&mreq, sizeof(mreq))
+        || !NetSetNonBlocking(sock) )
+    {
+        NetClose(sock);
+        return NET_INVALID_SOCKET;
+    }
+
+    return sock;
+}
+
+
+NetReactor::NetReactor()
+#ifndef _WIN32
+    :
+        _epfd( epoll_create1(0) )
+#endif
+    {
+    }
+
+
+NetReactor::~NetReactor()
+{
+#ifndef _WIN32
+    if(_epfd != -1)
+        close(_epfd);
+#endif
+}
+
+
+bool
+NetReactor::add(net_socket_type sock, unsigned int events, callback_type callback)
+{
+    if( _handlers.find(sock) != _handlers.end() )
+        return false;
+
+#ifndef _WIN32
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = _toEpoll(events);
+    ev.data.fd = sock;
+    if( epoll_ctl(_epfd, EPOLL_CTL_ADD, sock, &ev) )
+        return false;
+#endif
+
+    _handlers[sock] = _handler_type(events, callback);
+    return true;
+}
+
+
+bool
+NetReactor::modify(net_socket_type sock, unsigned int events)
+{
+    auto iter = _handlers.find(sock);
+    if(iter == _handlers.end())
+        return false;
+
+    if(iter->second.first == events)
+        return true;
+
+#ifndef _WIN32
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = _toEpoll(events);
+    ev.data.fd = sock;
+    if( epoll_ctl(_epfd, EPOLL_CTL_MOD, sock, &ev) )
+        return false;
+#endif
+
+    iter->second.first = events;
+    return true;
+}
+
+
+void
+NetReactor::remove(net_socket_type sock)
+{
+    if( !_handlers.erase(sock) )
+        return;
+
+#ifndef _WIN32
+    epoll_event ev; /* non-null for older kernels */
+    epoll_ctl(_epfd, EPOLL_CTL_DEL, sock, &ev);
+#endif
+}
+
+
+int
+NetReactor::poll(int timeout)
+{
+    /* collect first, dispatch after; callbacks are free to change _handlers */
+    std::vector<std::pair<net_socket_type, unsigned int>> ready;
+
+#ifdef _WIN32
+    /* WSAPoll, not IOCP: we want readiness (the handler does its own
+       non-blocking reads/writes) and the socket counts here are small */
+    std::vector<WSAPOLLFD> fds;
+    fds.reserve(_handlers.size());
+    for(auto& h : _handlers){
+        WSAPOLLFD p;
+        p.fd = h.first;
+        p.events = ((h.second.first & NET_EVENT_READ) ? POLLRDNORM : 0)
+                   | ((h.second.first & NET_EVENT_WRITE) ? POLLWRNORM : 0);
+        p.revents = 0;
+        fds.push_back(p);
+    }
+
+    if(fds.empty()){
+        Sleep(timeout < 0 ? 0 : timeout);
+        return 0;
+    }
+
+    int n = WSAPoll(&fds[0], (ULONG)fds.size(), timeout);
+    if(n == SOCKET_ERROR)
+        return -1;
+
+    for(auto& p : fds){
+        unsigned int e = 0;
+        if(p.revents & (POLLRDNORM | POLLHUP))
+            e |= NET_EVENT_READ;
+        if(p.revents & POLLWRNORM)
+            e |= NET_EVENT_WRITE;
+        if(p.revents & (POLLERR | POLLNVAL))
+            e |= NET_EVENT_ERROR;
+        if(e)
+            ready.push_back(std::make_pair(p.fd, e));
+    }
+#else
+    epoll_event evs[64];
+
+    int n = epoll_wait(_epfd, evs, 64, timeout);
+    if(n < 0)
+        return (errno == EINTR) ? 0 : -1;
+
+    for(int i = 0; i < n; ++i){
+        unsigned int e = 0;
+        if(evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP))
+            e |= NET_EVENT_READ;
+        if(evs[i].events & EPOLLOUT)
+            e |= NET_EVENT_WRITE;
+        if(evs[i].events & EPOLLERR)
+            e |= NET_EVENT_ERROR;
+        net_socket_type fd = evs[i].data.fd; /* packed on some archs */
+        if(e)
+            ready.push_back(std::make_pair(fd, e));
+    }
+#endif
+
+    int ndispatched = 0;
+    for(auto& r : ready){
+        auto iter = _handlers.find(r.first);
+        if(iter == _handlers.end())
+            continue; /* removed by an earlier callback */
+
+        callback_type cb = iter->second.second; /* copy; callback may remove */
+        cb(r.first, r.second);
+        ++ndispatched;
+    }
+
+    return ndispatched;
+}
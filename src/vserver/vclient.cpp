@@ -0,0 +1,607 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include "vclient.hpp"
+
+#include <sstream>
+
+namespace{
+
+void
+_checkStatus(const VClient::reply_type& reply)
+{
+    if(reply.head.status == VSTATUS_OK)
+        return;
+
+    std::stringstream s;
+    s<< "vserver request (op " << reply.head.op << ") failed, status "
+     << reply.head.status;
+
+    if(reply.head.status == VSTATUS_EXCEPTION && !reply.body.empty()){
+        try{
+            VReader rdr(reply.body.data(), reply.body.size());
+            s<< ": " << rdr.get_string();
+        }catch(...){
+        }
+    }
+
+    throw VStatusError(s.str(), reply.head.status);
+}
+
+
+inline VReader
+_reader(const VClient::reply_type& reply)
+{
+    return VReader(reply.body.data(), reply.body.size());
+}
+
+}; /* namespace */
+
+
+VClient::VClient(std::string addr, unsigned short port)
+    :
+        _sock( NetConnect(addr, port) ),
+        _next_id(1)
+    {
+        if(_sock == NET_INVALID_SOCKET){
+            std::stringstream s;
+            s<< "failed to connect to " << addr << ':' << port
+             << " (error " << NetLastError() << ')';
+            throw VProtocolError(s.str());
+        }
+    }
+
+
+VClient::~VClient()
+{
+    NetClose(_sock);
+}
+
+
+uint32_t
+VClient::send(uint16_t op, const std::vector<char>& body)
+{
+    uint32_t id = _next_id++;
+    if(id == 0) /* reserved for unsolicited frames */
+        id = _next_id++;
+
+    size_t off = VBeginFrame(_out, id, op);
+    _out.insert(_out.end(), body.begin(), body.end());
+    VEndFrame(_out, off, VSTATUS_OK);
+
+    return id;
+}
+
+
+void
+VClient::flush()
+{
+    if(_out.empty())
+        return;
+
+    bool ok = NetSendAll(_sock, _out.data(), _out.size());
+    _out.clear();
+    if(!ok)
+        throw VProtocolError("failed to send to vserver");
+}
+
+
+VClient::reply_type
+VClient::wait(uint32_t id)
+{
+    flush();
+
+    auto iter = _early.find(id);
+    if(iter != _early.end()){
+        reply_type reply = std::move(iter->second);
+        _early.erase(iter);
+        return reply;
+    }
+
+    for( ; ; ){
+        reply_type reply = _read_reply();
+        if(reply.head.id == id)
+            return reply;
+        if(reply.head.id == VPROTO_PUSH_ID)
+            _pushed.push_back( std::move(reply) );
+        else
+            _early[reply.head.id] = std::move(reply);
+    }
+}
+
+
+bool
+VClient::next_push(reply_type* frame, int timeout)
+{
+    flush();
+
+    while( _pushed.empty() ){
+        if( !NetWaitReadable(_sock, timeout) )
+            return false;
+        timeout = 0; /* only wait for the first */
+
+        reply_type reply = _read_reply();
+        if(reply.head.id == VPROTO_PUSH_ID)
+            _pushed.push_back( std::move(reply) );
+        else
+            _early[reply.head.id] = std::move(reply);
+    }
+
+    *frame = std::move(_pushed.front());
+    _pushed.pop_front();
+    return true;
+}
+
+
+VClient::reply_type
+VClient::call_checked(uint16_t op, const std::vector<char>& body)
+{
+    reply_type reply = call(op, body);
+    _checkStatus(reply);
+    return reply;
+}
+
+
+VClient::reply_type
+VClient::_read_reply()
+{
+    char hbuf[VPROTO_HEADER_SZ];
+    reply_type reply;
+
+    if( !NetRecvAll(_sock, hbuf, VPROTO_HEADER_SZ) )
+        throw VProtocolError("connection to vserver lost");
+
+    VPeekHeader(hbuf, VPROTO_HEADER_SZ, &reply.head);
+
+    reply.body.resize(reply.head.length);
+    if( reply.head.length
+        && !NetRecvAll(_sock, reply.body.data(), reply.head.length) )
+    {
+        throw VProtocolError("connection to vserver lost");
+    }
+
+    return reply;
+}
+
+
+uint32_t
+VClient::ping()
+{
+    reply_type reply = call_checked(VOP_PING, std::vector<char>());
+    return _reader(reply).get<uint32_t>();
+}
+
+
+bool
+VClient::connected()
+{
+    reply_type reply = call_checked(VOP_CONNECTED, std::vector<char>());
+    return _reader(reply).get<uint8_t>() != 0;
+}
+
+
+uint32_t
+VClient::connection_state()
+{
+    reply_type reply = call_checked(VOP_CONNECTION_STATE, std::vector<char>());
+    return _reader(reply).get<uint32_t>();
+}
+
+
+uint32_t
+VClient::get_block_limit()
+{
+    reply_type reply = call_checked(VOP_GET_BLOCK_LIMIT, std::vector<char>());
+    return _reader(reply).get<uint32_t>();
+}
+
+
+uint32_t
+VClient::set_block_limit(uint32_t limit)
+{
+    std::vector<char> body;
+    VWriter(body).put<uint32_t>(limit);
+
+    reply_type reply = call_checked(VOP_SET_BLOCK_LIMIT, body);
+    return _reader(reply).get<uint32_t>();
+}
+
+
+uint32_t
+VClient::get_block_count()
+{
+    reply_type reply = call_checked(VOP_GET_BLOCK_COUNT, std::vector<char>());
+    return _reader(reply).get<uint32_t>();
+}
+
+
+uint8_t
+VClient::type_bits(std::string topic)
+{
+    std::vector<char> body;
+    VWriter(body).put_string(topic);
+
+    reply_type reply = call_checked(VOP_TYPE_BITS, body);
+    return _reader(reply).get<uint8_t>();
+}
+
+
+VRemoteBlock::VRemoteBlock(VClient& client,
+                           std::string id,
+                           uint32_t size,
+                           bool datetime,
+                           uint32_t timeout)
+    :
+        _client(client),
+        _id(id),
+        _datetime(datetime),
+        _packed(true),
+        _closed(false)
+    {
+        std::vector<char> body = _body();
+        VWriter w(body);
+        w.put<uint32_t>(size);
+        w.put<uint8_t>(datetime ? 1 : 0);
+        w.put<uint32_t>(timeout);
+
+        _client.call_checked(VOP_CREATE_BLOCK, body);
+    }
+
+
+VRemoteBlock::~VRemoteBlock()
+{
+    try{
+        close();
+    }catch(...){
+    }
+}
+
+
+void
+VRemoteBlock::close()
+{
+    if(_closed)
+        return;
+
+    _closed = true;
+    _client.call_checked(VOP_CLOSE_BLOCK, _body());
+}
+
+
+std::vector<char>
+VRemoteBlock::_body() const
+{
+    std::vector<char> body;
+    VWriter(body).put_string(_id);
+    return body;
+}
+
+
+std::vector<std::string>
+VRemoteBlock::_names(uint16_t op)
+{
+    VClient::reply_type reply = _client.call_checked(op, _body());
+    return _reader(reply).get_strings();
+}
+
+
+void
+VRemoteBlock::_change(uint16_t op, const std::vector<std::string>& strs)
+{
+    std::vector<char> body = _body();
+    VWriter(body).put_strings(strs);
+
+    _client.call_checked(op, body);
+}
+
+
+uint32_t
+VRemoteBlock::get_block_size()
+{
+    VClient::reply_type reply = _client.call_checked(VOP_GET_BLOCK_SIZE, _body());
+    return _reader(reply).get<uint32_t>();
+}
+
+
+void
+VRemoteBlock::set_block_size(uint32_t size)
+{
+    std::vector<char> body = _body();
+    VWriter(body).put<uint32_t>(size);
+
+    _client.call_checked(VOP_SET_BLOCK_SIZE, body);
+}
+
+
+uint32_t
+VRemoteBlock::stream_occupancy(std::string item, std::string topic)
+{
+    std::vector<char> body = _body();
+    VWriter w(body);
+    w.put_string(item);
+    w.put_string(topic);
+
+    VClient::reply_type reply = _client.call_checked(VOP_STREAM_OCCUPANCY, body);
+    return _reader(reply).get<uint32_t>();
+}
+
+
+VValue
+VRemoteBlock::get(std::string item, std::string topic, long indx, bool datetime)
+{
+    return get_result(get_async(item, topic, indx, datetime), datetime);
+}
+
+
+uint32_t
+VRemoteBlock::get_async(std::string item, std::string topic, long indx, bool datetime)
+{
+    std::vector<char> body = _body();
+    VWriter w(body);
+    w.put_string(item);
+    w.put_string(topic);
+    w.put<int32_t>((int32_t)indx);
+    w.put<uint8_t>(datetime ? VARRAY_DTS : 0);
+
+    return _client.send(VOP_GET, body);
+}
+
+
+VValue
+VRemoteBlock::get_result(uint32_t req_id, bool datetime)
+{
+    VClient::reply_type reply = _client.wait(req_id);
+    _checkStatus(reply);
+
+    VReader rdr = _reader(reply);
+    return VGetValue(rdr, datetime);
+}
+
+
+VArray
+VRemoteBlock::stream_snapshot(std::string item,
+                              std::string topic,
+                              long end,
+                              long beg,
+                              bool smart_size,
+                              bool datetime)
+{
+    std::vector<char> body = _body();
+    VWriter w(body);
+    w.put_string(item);
+    w.put_string(topic);
+    w.put<int32_t>((int32_t)end);
+    w.put<int32_t>((int32_t)beg);
+    w.put<uint8_t>(smart_size ? 1 : 0);
+    w.put<uint8_t>( _flags(datetime) );
+
+    VClient::reply_type reply = _client.call_checked(VOP_STREAM_SNAPSHOT, body);
+    VReader rdr = _reader(reply);
+    return VGetArray(rdr);
+}
+
+
+VArray
+VRemoteBlock::stream_snapshot_from_marker(std::string item,
+                                          std::string topic,
+                                          long beg,
+                                          uint32_t margin_of_safety,
+                                          bool datetime,
+                                          long* get_size,
+                                          bool* dirty)
+{
+    std::vector<char> body = _body();
+    VWriter w(body);
+    w.put_string(item);
+    w.put_string(topic);
+    w.put<int32_t>((int32_t)beg);
+    w.put<uint32_t>(margin_of_safety);
+    w.put<uint8_t>( _flags(datetime) );
+
+    VClient::reply_type reply =
+        _client.call_checked(VOP_STREAM_SNAPSHOT_FROM_MARKER, body);
+
+    VReader rdr = _reader(reply);
+    bool d = rdr.get<uint8_t>() != 0;
+    if(dirty)
+        *dirty = d;
+
+    long g = rdr.get<int32_t>();
+    if(get_size)
+        *get_size = g;
+
+    return VGetArray(rdr);
+}
+
+
+VArray
+VRemoteBlock::item_frame(std::string topic, bool datetime, std::vector<std::string>* labels)
+{
+    std::vector<char> body = _body();
+    VWriter w(body);
+    w.put_string(topic);
+    w.put<uint8_t>( _flags(datetime) );
+
+    VClient::reply_type reply = _client.call_checked(VOP_ITEM_FRAME, body);
+    VReader rdr = _reader(reply);
+
+    std::vector<std::string> labs = rdr.get_strings();
+    if(labels)
+        labels->swap(labs);
+
+    return VGetArray(rdr);
+}
+
+
+VArray
+VRemoteBlock::topic_frame(std::string item, bool datetime, std::vector<std::string>* labels)
+{
+    std::vector<char> body = _body();
+    VWriter w(body);
+    w.put_string(item);
+    w.put<uint8_t>( _flags(datetime) );
+
+    VClient::reply_type reply = _client.call_checked(VOP_TOPIC_FRAME, body);
+    VReader rdr = _reader(reply);
+
+    std::vector<std::string> labs = rdr.get_strings();
+    if(labels)
+        labels->swap(labs);
+
+    return VGetArray(rdr);
+}
+
+
+void
+VMirror::subscribe(VRemoteBlock& block,
+                   const std::vector<stream_key_type>& streams,
+                   uint8_t policy,
+                   size_t depth)
+{
+    std::vector<char> body;
+    VWriter w(body);
+    w.put_string(block.id());
+    w.put<uint8_t>(policy);
+    w.put<uint8_t>( (block.is_using_datetime() ? VARRAY_DTS : 0) | VARRAY_PACKED );
+    w.put<uint32_t>((uint32_t)streams.size());
+    for(auto& s : streams){
+        w.put_string(s.first);
+        w.put_string(s.second);
+    }
+
+    _client.call_checked(VOP_SUBSCRIBE, body);
+
+    auto iter = _blocks.find(block.id());
+    if(iter == _blocks.end()){
+        _block_type& b = _blocks[block.id()];
+        b.dropped = 0;
+        b.conflated = 0;
+        iter = _blocks.find(block.id());
+    }
+
+    iter->second.depth = depth;
+    for(auto& s : streams)
+        iter->second.streams[s]; /* insert */
+}
+
+
+void
+VMirror::unsubscribe(VRemoteBlock& block, const std::vector<stream_key_type>& streams)
+{
+    std::vector<char> body;
+    VWriter w(body);
+    w.put_string(block.id());
+    w.put<uint32_t>((uint32_t)streams.size());
+    for(auto& s : streams){
+        w.put_string(s.first);
+        w.put_string(s.second);
+    }
+
+    _client.call_checked(VOP_UNSUBSCRIBE, body);
+
+    auto iter = _blocks.find(block.id());
+    if(iter == _blocks.end())
+        return;
+
+    for(auto& s : streams)
+        iter->second.streams.erase(s);
+    if(streams.empty() || iter->second.streams.empty())
+        _blocks.erase(iter);
+}
+
+
+size_t
+VMirror::update(int timeout)
+{
+    VClient::reply_type frame;
+    size_t n = 0;
+
+    while( _client.next_push(&frame, timeout) ){
+        timeout = 0;
+        if(frame.head.op == VOP_TICKS)
+            n += _apply(frame);
+    }
+
+    return n;
+}
+
+
+size_t
+VMirror::_apply(const VClient::reply_type& frame)
+{
+    VReader rdr(frame.body.data(), frame.body.size());
+
+    auto biter = _blocks.find( rdr.get_string() );
+    if(biter == _blocks.end())
+        return 0; /* unsubscribed since */
+
+    _block_type& b = biter->second;
+    b.dropped += rdr.get<uint32_t>();
+
+    size_t napplied = 0;
+    uint32_t count = rdr.get<uint32_t>();
+    while(count--){
+        std::string item = rdr.get_string();
+        std::string topic = rdr.get_string();
+        int32_t g = rdr.get<int32_t>();
+        VArray arr = VGetArray(rdr);
+
+        auto siter = b.streams.find( stream_key_type(item, topic) );
+        if(siter == b.streams.end())
+            continue;
+
+        size_t n = arr.size();
+        size_t ng = (size_t)((g < 0) ? -g : g);
+        if(ng > n)
+            b.conflated += ng - n;
+
+        /* oldest first so the most recent ends up at the front */
+        stream_type& strm = siter->second;
+        for(size_t i = n; i > 0; --i)
+            strm.push_front( arr.value(i - 1) );
+        while(strm.size() > b.depth)
+            strm.pop_back();
+
+        napplied += n;
+    }
+
+    return napplied;
+}
+
+
+const VMirror::_block_type&
+VMirror::_block(const std::string& block_id) const
+{
+    auto iter = _blocks.find(block_id);
+    if(iter == _blocks.end())
+        throw std::out_of_range("block not mirrored: " + block_id);
+
+    return iter->second;
+}
+
+
+const VMirror::stream_type&
+VMirror::stream(const std::string& block_id, std::string item, std::string topic) const
+{
+    const _block_type& b = _block(block_id);
+
+    auto iter = b.streams.find( stream_key_type(item, topic) );
+    if(iter == b.streams.end())
+        throw std::out_of_range("stream not mirrored: " + item + " " + topic);
+
+    return iter->second;
+}
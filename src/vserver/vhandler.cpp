@@ -0,0 +1,996 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include "vhandler.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <time.h>
+
+namespace{
+
+/* the typed C calls we need, so the data ops can be written once */
+template<typename T>
+struct _c_calls{
+    int (*get)(LPCSTR, LPCSTR, LPCSTR, long, T*, pDateTimeStamp);
+    int (*snapshot)(LPCSTR, LPCSTR, LPCSTR, T*, size_type, pDateTimeStamp, long, long);
+    int (*from_marker)(LPCSTR, LPCSTR, LPCSTR, T*, size_type, pDateTimeStamp, long, long*);
+    int (*item_frame)(LPCSTR, LPCSTR, T*, size_type, LPSTR*, size_type, pDateTimeStamp);
+};
+
+const _c_calls<ext_price_type> double_calls = {
+    TOSDB_GetDouble,
+    TOSDB_GetStreamSnapshotDoubles,
+    TOSDB_GetStreamSnapshotDoublesFromMarker,
+    TOSDB_GetItemFrameDoubles
+};
+
+const _c_calls<def_price_type> float_calls = {
+    TOSDB_GetFloat,
+    TOSDB_GetStreamSnapshotFloats,
+    TOSDB_GetStreamSnapshotFloatsFromMarker,
+    TOSDB_GetItemFrameFloats
+};
+
+const _c_calls<ext_size_type> longlong_calls = {
+    TOSDB_GetLongLong,
+    TOSDB_GetStreamSnapshotLongLongs,
+    TOSDB_GetStreamSnapshotLongLongsFromMarker,
+    TOSDB_GetItemFrameLongLongs
+};
+
+const _c_calls<def_size_type> long_calls = {
+    TOSDB_GetLong,
+    TOSDB_GetStreamSnapshotLongs,
+    TOSDB_GetStreamSnapshotLongsFromMarker,
+    TOSDB_GetItemFrameLongs
+};
+
+
+class _str_buffers{
+/* contiguous storage + the LPSTR array the C calls want */
+    std::vector<char> _raw;
+    std::vector<char*> _ptrs;
+
+public:
+    _str_buffers(size_type n, size_type len)
+        :
+            _raw(n * len + 1), /* +1 so &_raw[0] is valid for n == 0 */
+            _ptrs(n + 1)
+        {
+            for(size_type i = 0; i < n; ++i)
+                _ptrs[i] = &_raw[i * len];
+        }
+
+    inline char**
+    ptrs()
+    {
+        return &_ptrs[0];
+    }
+
+    inline const char*
+    operator[](size_type i) const
+    {
+        return _ptrs[i];
+    }
+};
+
+
+/* normalize +/- indices against the block size like the python wrapper */
+bool
+_normalizeIndex(long* indx, size_type block_sz)
+{
+    if(*indx < 0)
+        *indx += block_sz;
+    return (*indx >= 0) && ((size_type)*indx < block_sz);
+}
+
+
+long long
+_toEpochMicro(const DateTimeStamp& dts)
+{
+    struct tm t = dts.ctime_struct; /* mktime can modify its arg */
+    return (long long)mktime(&t) * 1000000 + dts.micro_second;
+}
+
+
+inline void
+_putVal(VWriter& w, ext_price_type v)
+{
+    w.put<double>(v);
+}
+
+inline void
+_putVal(VWriter& w, def_price_type v)
+{
+    w.put<float>(v);
+}
+
+inline void
+_putVal(VWriter& w, ext_size_type v)
+{
+    w.put<int64_t>(v);
+}
+
+inline void
+_putVal(VWriter& w, def_size_type v)
+{
+    w.put<int32_t>((int32_t)v);
+}
+
+
+/* +1 so &[0] is valid for n == 0; empty if there are no stamps */
+std::vector<int64_t>
+_toMicros(const DateTimeStamp* dts, size_type n)
+{
+    std::vector<int64_t> col(dts ? n + 1 : 0);
+    for(size_type i = 0; dts && i < n; ++i)
+        col[i] = _toEpochMicro(dts[i]);
+    return col;
+}
+
+
+/* the wire layout itself is VPutArray's (vprotocol.hpp) */
+template<typename T>
+void
+_putArray(VWriter& w, type_bits_type tbits, const T* vals, const DateTimeStamp* dts, size_type n)
+{
+    std::vector<int64_t> micros = _toMicros(dts, n);
+    VPutArray(w, (uint8_t)tbits, vals, dts ? &micros[0] : nullptr, n);
+}
+
+
+void
+_putStringArray(VWriter& w, const _str_buffers& strs, const DateTimeStamp* dts, size_type n)
+{
+    w.put_array_head(TOSDB_STRING_BIT, dts != nullptr, n);
+    for(size_type i = 0; i < n; ++i)
+        w.put_string(strs[i], strnlen(strs[i], TOSDB_MAX_STR_SZ));
+    if(dts){
+        std::vector<int64_t> micros = _toMicros(dts, n);
+        w.put_int_column(&micros[0], n, sizeof(int64_t));
+    }
+}
+
+
+int
+_getNames(LPCSTR id,
+          int(*count_call)(LPCSTR, size_type*),
+          int(*names_call)(LPCSTR, LPSTR*, size_type, size_type),
+          VWriter& out)
+{
+    size_type n = 0;
+    int err = count_call(id, &n);
+    if(err)
+        return err;
+
+    _str_buffers names(n, TOSDB_MAX_STR_SZ + 1);
+    if(n){
+        err = names_call(id, names.ptrs(), n, TOSDB_MAX_STR_SZ + 1);
+        if(err)
+            return err;
+    }
+
+    out.put<uint32_t>(n);
+    for(size_type i = 0; i < n; ++i)
+        out.put_string(names[i], strnlen(names[i], TOSDB_MAX_STR_SZ));
+
+    return 0;
+}
+
+
+template<typename T>
+int
+_get(const _c_calls<T>& calls, type_bits_type tbits, LPCSTR id, LPCSTR item,
+     LPCSTR topic, long indx, bool use_dts, VWriter& out)
+{
+    T val;
+    DateTimeStamp dts;
+
+    int err = calls.get(id, item, topic, indx, &val, use_dts ? &dts : nullptr);
+    if(err)
+        return err;
+
+    out.put<uint8_t>(tbits);
+    _putVal(out, val);
+    if(use_dts)
+        out.put<int64_t>(_toEpochMicro(dts));
+
+    return 0;
+}
+
+
+int
+_getString(LPCSTR id, LPCSTR item, LPCSTR topic, long indx, bool use_dts, VWriter& out)
+{
+    char val[TOSDB_STR_DATA_SZ + 1];
+    DateTimeStamp dts;
+
+    int err = TOSDB_GetString(id, item, topic, indx, val, TOSDB_STR_DATA_SZ + 1,
+                              use_dts ? &dts : nullptr);
+    if(err)
+        return err;
+
+    out.put<uint8_t>(TOSDB_STRING_BIT);
+    out.put_string(val, strnlen(val, TOSDB_STR_DATA_SZ));
+    if(use_dts)
+        out.put<int64_t>(_toEpochMicro(dts));
+
+    return 0;
+}
+
+
+template<typename T>
+int
+_snapshot(const _c_calls<T>& calls, type_bits_type tbits, LPCSTR id, LPCSTR item,
+          LPCSTR topic, size_type n, long end, long beg, bool use_dts, VWriter& out)
+{
+    std::vector<T> vals(n + 1);
+    std::vector<DateTimeStamp> dts(use_dts ? n + 1 : 0);
+
+    if(n){
+        int err = calls.snapshot(id, item, topic, &vals[0], n,
+                                 use_dts ? &dts[0] : nullptr, end, beg);
+        if(err)
+            return err;
+    }
+
+    _putArray(out, tbits, &vals[0], use_dts ? &dts[0] : nullptr, n);
+    return 0;
+}
+
+
+int
+_snapshotStrings(LPCSTR id, LPCSTR item, LPCSTR topic, size_type n, long end,
+                 long beg, bool use_dts, VWriter& out)
+{
+    _str_buffers vals(n, TOSDB_STR_DATA_SZ + 1);
+    std::vector<DateTimeStamp> dts(use_dts ? n + 1 : 0);
+
+    if(n){
+        int err = TOSDB_GetStreamSnapshotStrings(id, item, topic, vals.ptrs(), n,
+                                                 TOSDB_STR_DATA_SZ + 1,
+                                                 use_dts ? &dts[0] : nullptr, end, beg);
+        if(err)
+            return err;
+    }
+
+    _putStringArray(out, vals, use_dts ? &dts[0] : nullptr, n);
+    return 0;
+}
+
+
+/* 'limit' caps how many of the (most recent) points go in the array */
+template<typename T>
+int
+_fromMarker(const _c_calls<T>& calls, type_bits_type tbits, LPCSTR id, LPCSTR item,
+            LPCSTR topic, size_type n, long beg, bool use_dts, size_type limit,
+            long* get_size, VWriter& out)
+{
+    std::vector<T> vals(n + 1);
+    std::vector<DateTimeStamp> dts(use_dts ? n + 1 : 0);
+    long g = 0;
+
+    if(n){
+        int err = calls.from_marker(id, item, topic, &vals[0], n,
+                                    use_dts ? &dts[0] : nullptr, beg, &g);
+        if(err)
+            return err;
+    }
+
+    *get_size = g;
+    out.put<int32_t>((int32_t)g);
+    _putArray(out, tbits, &vals[0], use_dts ? &dts[0] : nullptr,
+              std::min<size_type>((g < 0) ? -g : g, limit));
+    return 0;
+}
+
+
+int
+_fromMarkerStrings(LPCSTR id, LPCSTR item, LPCSTR topic, size_type n, long beg,
+                   bool use_dts, size_type limit, long* get_size, VWriter& out)
+{
+    _str_buffers vals(n, TOSDB_STR_DATA_SZ + 1);
+    std::vector<DateTimeStamp> dts(use_dts ? n + 1 : 0);
+    long g = 0;
+
+    if(n){
+        int err = TOSDB_GetStreamSnapshotStringsFromMarker(id, item, topic, vals.ptrs(), n,
+                                                           TOSDB_STR_DATA_SZ + 1,
+                                                           use_dts ? &dts[0] : nullptr,
+                                                           beg, &g);
+        if(err)
+            return err;
+    }
+
+    *get_size = g;
+    out.put<int32_t>((int32_t)g);
+    _putStringArray(out, vals, use_dts ? &dts[0] : nullptr,
+                    std::min<size_type>((g < 0) ? -g : g, limit));
+    return 0;
+}
+
+
+/* everything from 'beg' to the marker: i32 get_size, array */
+int
+_pullFromMarker(LPCSTR id, LPCSTR item, LPCSTR topic, long beg, size_type margin,
+                bool use_dts, size_type limit, long* get_size, VWriter& out)
+{
+    type_bits_type tbits = 0;
+    size_type block_sz = 0;
+    long long mpos = 0;
+
+    int err = TOSDB_GetTypeBits(topic, &tbits);
+    if(!err)
+        err = TOSDB_GetBlockSize(id, &block_sz);
+    if(!err)
+        err = TOSDB_GetMarkerPosition(id, item, topic, &mpos);
+    if(err)
+        return err;
+
+    if( !_normalizeIndex(&beg, block_sz) )
+        return TOSDB_ERROR_BAD_INPUT;
+
+    long long cur_sz = mpos - beg + 1;
+    if(cur_sz < 0){ /* beg is past the marker */
+        *get_size = 0;
+        out.put<int32_t>(0);
+        out.put_array_head(tbits, use_dts, 0);
+        return 0;
+    }
+
+    size_type n = (size_type)cur_sz + margin;
+    switch(tbits){
+    case TOSDB_STRING_BIT:
+        return _fromMarkerStrings(id, item, topic, n, beg, use_dts, limit, get_size, out);
+    case TOSDB_INTGR_BIT | TOSDB_QUAD_BIT:
+        return _fromMarker(longlong_calls, tbits, id, item, topic, n, beg, use_dts,
+                           limit, get_size, out);
+    case TOSDB_INTGR_BIT:
+        return _fromMarker(long_calls, tbits, id, item, topic, n, beg, use_dts,
+                           limit, get_size, out);
+    case TOSDB_QUAD_BIT:
+        return _fromMarker(double_calls, tbits, id, item, topic, n, beg, use_dts,
+                           limit, get_size, out);
+    default:
+        return _fromMarker(float_calls, tbits, id, item, topic, n, beg, use_dts,
+                           limit, get_size, out);
+    }
+}
+
+
+template<typename T>
+int
+_itemFrame(const _c_calls<T>& calls, type_bits_type tbits, LPCSTR id, LPCSTR topic,
+           size_type n, bool use_dts, VWriter& out)
+{
+    std::vector<T> vals(n + 1);
+    std::vector<DateTimeStamp> dts(use_dts ? n + 1 : 0);
+    _str_buffers labels(n, TOSDB_MAX_STR_SZ + 1);
+
+    if(n){
+        int err = calls.item_frame(id, topic, &vals[0], n, labels.ptrs(),
+                                   TOSDB_MAX_STR_SZ + 1, use_dts ? &dts[0] : nullptr);
+        if(err)
+            return err;
+    }
+
+    out.put<uint32_t>(n);
+    for(size_type i = 0; i < n; ++i)
+        out.put_string(labels[i], strnlen(labels[i], TOSDB_MAX_STR_SZ));
+
+    _putArray(out, tbits, &vals[0], use_dts ? &dts[0] : nullptr, n);
+    return 0;
+}
+
+
+int
+_itemFrameStrings(LPCSTR id, LPCSTR topic, size_type n, bool use_dts, VWriter& out)
+{
+    _str_buffers vals(n, TOSDB_STR_DATA_SZ + 1);
+    std::vector<DateTimeStamp> dts(use_dts ? n + 1 : 0);
+    _str_buffers labels(n, TOSDB_MAX_STR_SZ + 1);
+
+    if(n){
+        int err = TOSDB_GetItemFrameStrings(id, topic, vals.ptrs(), n, TOSDB_STR_DATA_SZ + 1,
+                                            labels.ptrs(), TOSDB_MAX_STR_SZ + 1,
+                                            use_dts ? &dts[0] : nullptr);
+        if(err)
+            return err;
+    }
+
+    out.put<uint32_t>(n);
+    for(size_type i = 0; i < n; ++i)
+        out.put_string(labels[i], strnlen(labels[i], TOSDB_MAX_STR_SZ));
+
+    _putStringArray(out, vals, use_dts ? &dts[0] : nullptr, n);
+    return 0;
+}
+
+
+int
+_topicFrame(LPCSTR id, LPCSTR item, bool use_dts, VWriter& out)
+{
+    size_type n = 0;
+    int err = TOSDB_GetTopicCount(id, &n);
+    if(err)
+        return err;
+
+    _str_buffers vals(n, TOSDB_STR_DATA_SZ + 1);
+    std::vector<DateTimeStamp> dts(use_dts ? n + 1 : 0);
+    _str_buffers labels(n, TOSDB_MAX_STR_SZ + 1);
+
+    if(n){
+        err = TOSDB_GetTopicFrameStrings(id, item, vals.ptrs(), n, TOSDB_STR_DATA_SZ + 1,
+                                         labels.ptrs(), TOSDB_MAX_STR_SZ + 1,
+                                         use_dts ? &dts[0] : nullptr);
+        if(err)
+            return err;
+    }
+
+    out.put<uint32_t>(n);
+    for(size_type i = 0; i < n; ++i)
+        out.put_string(labels[i], strnlen(labels[i], TOSDB_MAX_STR_SZ));
+
+    _putStringArray(out, vals, use_dts ? &dts[0] : nullptr, n);
+    return 0;
+}
+
+}; /* namespace */
+
+
+TOSDB_VHandler::~TOSDB_VHandler()
+{
+    for(auto& b : _blocks){
+        for(auto& id : b.second)
+            TOSDB_CloseBlock(id.c_str());
+    }
+
+    if(_mcast)
+        TOSDB_CloseBlock(VHANDLER_MCAST_BLOCK);
+}
+
+
+int
+TOSDB_VHandler::multicast(VMcastPublisher& publisher,
+                          const std::vector<std::string>& items,
+                          const std::vector<std::string>& topics,
+                          size_type block_size,
+                          bool use_dts)
+{
+    if(_mcast || items.empty() || topics.empty())
+        return TOSDB_ERROR_BAD_INPUT;
+
+    std::vector<LPCSTR> citems, ctopics;
+    for(auto& i : items)
+        citems.push_back(i.c_str());
+    for(auto& t : topics)
+        ctopics.push_back(t.c_str());
+
+    int err = TOSDB_CreateBlock(VHANDLER_MCAST_BLOCK, block_size, use_dts ? TRUE : FALSE,
+                                TOSDB_DEF_TIMEOUT);
+    if(err)
+        return err;
+
+    err = TOSDB_Add(VHANDLER_MCAST_BLOCK, &citems[0], (size_type)citems.size(),
+                    &ctopics[0], (size_type)ctopics.size());
+    if(err){
+        TOSDB_CloseBlock(VHANDLER_MCAST_BLOCK);
+        return err;
+    }
+
+    _mcast_streams.clear();
+    for(auto& i : items){
+        for(auto& t : topics)
+            _mcast_streams.push_back( _stream_type(i, t) );
+    }
+    _mcast_dts = use_dts;
+    _mcast = &publisher;
+    return 0;
+}
+
+
+void
+TOSDB_VHandler::on_connect(vconn_id_type conn, const std::string& peer)
+{
+    _blocks[conn]; /* insert */
+    if(_verbose)
+        std::cout<< "+ connection #" << conn << " from " << peer << std::endl;
+}
+
+
+void
+TOSDB_VHandler::on_disconnect(vconn_id_type conn)
+{
+    auto iter = _blocks.find(conn);
+    if(iter == _blocks.end())
+        return;
+
+    for(auto& id : iter->second)
+        TOSDB_CloseBlock(id.c_str());
+
+    if(_verbose){
+        std::cout<< "- connection #" << conn << " closed (" << iter->second.size()
+                 << " blocks)" << std::endl;
+    }
+
+    _blocks.erase(iter);
+    _subs.erase(conn);
+}
+
+
+void
+TOSDB_VHandler::on_idle(VServer& server)
+{
+    auto now = std::chrono::steady_clock::now();
+    if(now - _last_push < _push_interval)
+        return;
+    _last_push = now;
+
+    for(auto& c : _subs){
+        for(auto& b : c.second)
+            _push(server, c.first, b.first, b.second);
+    }
+
+    if(_mcast)
+        _publish();
+}
+
+
+void
+TOSDB_VHandler::_publish()
+{
+    std::vector<char> body;
+    for(auto& s : _mcast_streams){
+        long g = 0;
+        body.clear();
+        VWriter out(body);
+        int err = _pullFromMarker(VHANDLER_MCAST_BLOCK, s.first.c_str(), s.second.c_str(),
+                                  0, VHANDLER_PUSH_MARGIN, _mcast_dts, TOSDB_MAX_BLOCK_SZ,
+                                  &g, out);
+        if(err || g == 0)
+            continue;
+
+        VReader in(body.data(), body.size());
+        in.get<int32_t>();
+        _mcast->publish(s.first, s.second, VGetArray(in));
+    }
+
+    _mcast->flush();
+    _mcast->heartbeat();
+}
+
+
+void
+TOSDB_VHandler::_push(VServer& server, vconn_id_type conn, const std::string& id,
+                      _sub_type& sub)
+{
+    /* slow consumer: still drain the markers so what we skip now doesn't
+       show up (stale) later */
+    bool backed_up = server.pending(conn) >= VSERVER_PUSH_HIGH_WATER;
+    bool conflate = backed_up && (sub.policy == VPUSH_CONFLATE);
+    bool drop = backed_up && !conflate;
+
+    std::vector<char> body;
+    VWriter out(body, sub.packed);
+    out.put_string(id);
+    size_t dropped_pos = out.size();
+    out.put<uint32_t>(0);
+    size_t count_pos = out.size();
+    out.put<uint32_t>(0);
+
+    uint32_t count = 0;
+    uint32_t ndropped = 0;
+    for(auto& s : sub.streams){
+        size_t rec_pos = out.size();
+        long g = 0;
+
+        out.put_string(s.first);
+        out.put_string(s.second);
+        int err = _pullFromMarker(id.c_str(), s.first.c_str(), s.second.c_str(), 0,
+                                  VHANDLER_PUSH_MARGIN, sub.use_dts,
+                                  conflate ? 1 : TOSDB_MAX_BLOCK_SZ, &g, out);
+        if(err || g == 0 || drop){
+            ndropped += drop ? ((g < 0) ? -g : g) : 0;
+            body.resize(rec_pos);
+            continue;
+        }
+        ++count;
+    }
+
+    sub.dropped += ndropped;
+    if(count == 0)
+        return;
+
+    memcpy(&body[dropped_pos], &sub.dropped, sizeof(uint32_t));
+    memcpy(&body[count_pos], &count, sizeof(uint32_t));
+    if( server.push(conn, VOP_TICKS, body) )
+        sub.dropped = 0;
+    else
+        sub.dropped += count; /* count streams we couldn't get out */
+}
+
+
+bool
+TOSDB_VHandler::_owns(vconn_id_type conn, const std::string& id) const
+{
+    auto iter = _blocks.find(conn);
+    return (iter != _blocks.end()) && iter->second.count(id);
+}
+
+
+int16_t
+TOSDB_VHandler::handle(vconn_id_type conn, uint16_t op, VReader& in, VWriter& out)
+{
+    if(op < VOP_CREATE_BLOCK)
+        return _admin(op, in, out);
+
+    if(op == VOP_MCAST_RETRANSMIT || op == VOP_MCAST_SNAPSHOT)
+        return _mcast ? _mcast->handle(op, in, out) : (int16_t)VSTATUS_BAD_OP;
+
+    return _block(conn, op, in, out);
+}
+
+
+int16_t
+TOSDB_VHandler::_admin(uint16_t op, VReader& in, VWriter& out)
+{
+    switch(op){
+    case VOP_PING:
+        out.put<uint32_t>(VPROTO_VERSION);
+        return VSTATUS_OK;
+    case VOP_CONNECTED:
+        out.put<uint8_t>(TOSDB_IsConnectedToEngineAndTOS() ? 1 : 0);
+        return VSTATUS_OK;
+    case VOP_CONNECTION_STATE:
+        out.put<uint32_t>(TOSDB_ConnectionState());
+        return VSTATUS_OK;
+    case VOP_GET_BLOCK_LIMIT:
+        out.put<uint32_t>(TOSDB_GetBlockLimit());
+        return VSTATUS_OK;
+    case VOP_SET_BLOCK_LIMIT:
+        out.put<uint32_t>(TOSDB_SetBlockLimit(in.get<uint32_t>()));
+        return VSTATUS_OK;
+    case VOP_GET_BLOCK_COUNT:
+        out.put<uint32_t>(TOSDB_GetBlockCount());
+        return VSTATUS_OK;
+    case VOP_TYPE_BITS:
+    {
+        std::string topic = in.get_string();
+        type_bits_type tbits = 0;
+        int err = TOSDB_GetTypeBits(topic.c_str(), &tbits);
+        if(!err)
+            out.put<uint8_t>(tbits);
+        return (int16_t)err;
+    }
+    default:
+        return VSTATUS_BAD_OP;
+    }
+}
+
+
+int16_t
+TOSDB_VHandler::_block(vconn_id_type conn, uint16_t op, VReader& in, VWriter& out)
+{
+    std::string id = in.get_string();
+    LPCSTR cid = id.c_str();
+
+    if(op == VOP_CREATE_BLOCK){
+        size_type sz = in.get<uint32_t>();
+        BOOL is_datetime = in.get<uint8_t>() ? TRUE : FALSE;
+        size_type timeout = in.get<uint32_t>();
+
+        int err = TOSDB_CreateBlock(cid, sz, is_datetime, timeout);
+        if(!err)
+            _blocks[conn].insert(id);
+        return (int16_t)err;
+    }
+
+    if( !_owns(conn, id) )
+        return TOSDB_ERROR_BLOCK_DOESNT_EXIST;
+
+    switch(op){
+    case VOP_CLOSE_BLOCK:
+    {
+        _blocks[conn].erase(id);
+        _subs[conn].erase(id);
+        return (int16_t)TOSDB_CloseBlock(cid);
+    }
+    case VOP_GET_BLOCK_SIZE:
+    {
+        size_type sz = 0;
+        int err = TOSDB_GetBlockSize(cid, &sz);
+        if(!err)
+            out.put<uint32_t>(sz);
+        return (int16_t)err;
+    }
+    case VOP_SET_BLOCK_SIZE:
+        return (int16_t)TOSDB_SetBlockSize(cid, in.get<uint32_t>());
+    case VOP_IS_USING_DATETIME:
+    {
+        unsigned int is_datetime = 0;
+        int err = TOSDB_IsUsingDateTime(cid, &is_datetime);
+        if(!err)
+            out.put<uint8_t>(is_datetime ? 1 : 0);
+        return (int16_t)err;
+    }
+    case VOP_ADD_ITEMS:
+    case VOP_ADD_TOPICS:
+    {
+        std::vector<std::string> strs = in.get_strings();
+        std::vector<LPCSTR> cstrs;
+        for(auto& s : strs)
+            cstrs.push_back(s.c_str());
+        if(cstrs.empty())
+            return VSTATUS_OK;
+
+        return (int16_t)( (op == VOP_ADD_ITEMS)
+                          ? TOSDB_AddItems(cid, &cstrs[0], (size_type)cstrs.size())
+                          : TOSDB_AddTopics(cid, &cstrs[0], (size_type)cstrs.size()) );
+    }
+    case VOP_REMOVE_ITEMS:
+    case VOP_REMOVE_TOPICS:
+    {
+        std::vector<std::string> strs = in.get_strings();
+        for(auto& s : strs){
+            int err = (op == VOP_REMOVE_ITEMS)
+                    ? TOSDB_RemoveItem(cid, s.c_str())
+                    : TOSDB_RemoveTopic(cid, s.c_str());
+            if(err)
+                return (int16_t)err;
+        }
+        return VSTATUS_OK;
+    }
+    case VOP_GET_ITEMS:
+        return (int16_t)_getNames(cid, TOSDB_GetItemCount, TOSDB_GetItemNames, out);
+    case VOP_GET_TOPICS:
+        return (int16_t)_getNames(cid, TOSDB_GetTopicCount, TOSDB_GetTopicNames, out);
+    case VOP_GET_ITEMS_PRECACHED:
+        return (int16_t)_getNames(cid, TOSDB_GetPreCachedItemCount,
+                                  TOSDB_GetPreCachedItemNames, out);
+    case VOP_GET_TOPICS_PRECACHED:
+        return (int16_t)_getNames(cid, TOSDB_GetPreCachedTopicCount,
+                                  TOSDB_GetPreCachedTopicNames, out);
+    case VOP_STREAM_OCCUPANCY:
+    {
+        std::string item = in.get_string();
+        std::string topic = in.get_string();
+        size_type occ = 0;
+        int err = TOSDB_GetStreamOccupancy(cid, item.c_str(), topic.c_str(), &occ);
+        if(!err)
+            out.put<uint32_t>(occ);
+        return (int16_t)err;
+    }
+    case VOP_SUBSCRIBE:
+    case VOP_UNSUBSCRIBE:
+        return _subscribe(conn, op, id, in);
+    default:
+        return _data(op, id, in, out);
+    }
+}
+
+
+int16_t
+TOSDB_VHandler::_subscribe(vconn_id_type conn, uint16_t op, const std::string& id,
+                           VReader& in)
+{
+    _subs_type& subs = _subs[conn];
+    LPCSTR cid = id.c_str();
+
+    if(op == VOP_UNSUBSCRIBE){
+        uint32_t n = in.get<uint32_t>();
+        auto iter = subs.find(id);
+        if(n == 0 || iter == subs.end()){
+            subs.erase(id);
+            return VSTATUS_OK;
+        }
+        while(n--){
+            std::string item = in.get_string();
+            iter->second.streams.erase( _stream_type(item, in.get_string()) );
+        }
+        if(iter->second.streams.empty())
+            subs.erase(iter);
+        return VSTATUS_OK;
+    }
+
+    uint8_t policy = in.get<uint8_t>();
+    uint8_t flags = in.get<uint8_t>();
+    bool use_dts = (flags & VARRAY_DTS) != 0;
+    uint32_t n = in.get<uint32_t>();
+
+    if(policy != VPUSH_DROP && policy != VPUSH_CONFLATE)
+        return VSTATUS_BAD_REQUEST;
+
+    if(use_dts){
+        unsigned int is_datetime = 0;
+        int err = TOSDB_IsUsingDateTime(cid, &is_datetime);
+        if(err)
+            return (int16_t)err;
+        if(!is_datetime)
+            return TOSDB_ERROR_BAD_INPUT;
+    }
+
+    /* all or nothing: check every stream before we take any */
+    std::set<_stream_type> streams;
+    while(n--){
+        std::string item = in.get_string();
+        std::string topic = in.get_string();
+        size_type occ = 0;
+        int err = TOSDB_GetStreamOccupancy(cid, item.c_str(), topic.c_str(), &occ);
+        if(err)
+            return (int16_t)err;
+        streams.insert( _stream_type(item, topic) );
+    }
+
+    _sub_type& sub = subs[id];
+    if(sub.streams.empty())
+        sub.dropped = 0;
+    sub.streams.insert(streams.begin(), streams.end());
+    sub.policy = policy;
+    sub.use_dts = use_dts;
+    sub.packed = (flags & VARRAY_PACKED) != 0;
+    return VSTATUS_OK;
+}
+
+
+int16_t
+TOSDB_VHandler::_data(uint16_t op, const std::string& id, VReader& in, VWriter& out)
+{
+    LPCSTR cid = id.c_str();
+    type_bits_type tbits = 0;
+    size_type block_sz = 0;
+    int err;
+
+    switch(op){
+    case VOP_GET:
+    {
+        std::string item = in.get_string();
+        std::string topic = in.get_string();
+        long indx = in.get<int32_t>();
+        bool use_dts = (in.get<uint8_t>() & VARRAY_DTS) != 0;
+
+        err = TOSDB_GetTypeBits(topic.c_str(), &tbits);
+        if(err)
+            return (int16_t)err;
+
+        LPCSTR ci = item.c_str();
+        LPCSTR ct = topic.c_str();
+        switch(tbits){
+        case TOSDB_STRING_BIT:
+            return (int16_t)_getString(cid, ci, ct, indx, use_dts, out);
+        case TOSDB_INTGR_BIT | TOSDB_QUAD_BIT:
+            return (int16_t)_get(longlong_calls, tbits, cid, ci, ct, indx, use_dts, out);
+        case TOSDB_INTGR_BIT:
+            return (int16_t)_get(long_calls, tbits, cid, ci, ct, indx, use_dts, out);
+        case TOSDB_QUAD_BIT:
+            return (int16_t)_get(double_calls, tbits, cid, ci, ct, indx, use_dts, out);
+        default:
+            return (int16_t)_get(float_calls, tbits, cid, ci, ct, indx, use_dts, out);
+        }
+    }
+    case VOP_STREAM_SNAPSHOT:
+    {
+        std::string item = in.get_string();
+        std::string topic = in.get_string();
+        long end = in.get<int32_t>();
+        long beg = in.get<int32_t>();
+        bool smart_size = in.get<uint8_t>() != 0;
+        uint8_t flags = in.get<uint8_t>();
+        bool use_dts = (flags & VARRAY_DTS) != 0;
+        out.set_packed( (flags & VARRAY_PACKED) != 0 );
+
+        err = TOSDB_GetTypeBits(topic.c_str(), &tbits);
+        if(!err)
+            err = TOSDB_GetBlockSize(cid, &block_sz);
+        if(err)
+            return (int16_t)err;
+
+        if( !_normalizeIndex(&end, block_sz)
+            || !_normalizeIndex(&beg, block_sz)
+            || beg > end )
+        {
+            return TOSDB_ERROR_BAD_INPUT;
+        }
+
+        LPCSTR ci = item.c_str();
+        LPCSTR ct = topic.c_str();
+        if(smart_size){
+            size_type occ = 0;
+            err = TOSDB_GetStreamOccupancy(cid, ci, ct, &occ);
+            if(err)
+                return (int16_t)err;
+            if(occ == 0 || occ <= (size_type)beg){
+                out.put_array_head(tbits, use_dts, 0);
+                return VSTATUS_OK;
+            }
+            end = std::min<long>(end, occ - 1);
+        }
+
+        size_type n = end - beg + 1;
+        switch(tbits){
+        case TOSDB_STRING_BIT:
+            return (int16_t)_snapshotStrings(cid, ci, ct, n, end, beg, use_dts, out);
+        case TOSDB_INTGR_BIT | TOSDB_QUAD_BIT:
+            return (int16_t)_snapshot(longlong_calls, tbits, cid, ci, ct, n, end, beg, use_dts, out);
+        case TOSDB_INTGR_BIT:
+            return (int16_t)_snapshot(long_calls, tbits, cid, ci, ct, n, end, beg, use_dts, out);
+        case TOSDB_QUAD_BIT:
+            return (int16_t)_snapshot(double_calls, tbits, cid, ci, ct, n, end, beg, use_dts, out);
+        default:
+            return (int16_t)_snapshot(float_calls, tbits, cid, ci, ct, n, end, beg, use_dts, out);
+        }
+    }
+    case VOP_STREAM_SNAPSHOT_FROM_MARKER:
+    {
+        std::string item = in.get_string();
+        std::string topic = in.get_string();
+        long beg = in.get<int32_t>();
+        size_type margin = in.get<uint32_t>();
+        uint8_t flags = in.get<uint8_t>();
+        bool use_dts = (flags & VARRAY_DTS) != 0;
+        out.set_packed( (flags & VARRAY_PACKED) != 0 );
+        unsigned int dirty = 0;
+        long g = 0;
+
+        err = TOSDB_IsMarkerDirty(cid, item.c_str(), topic.c_str(), &dirty);
+        if(err)
+            return (int16_t)err;
+
+        out.put<uint8_t>(dirty ? 1 : 0);
+        return (int16_t)_pullFromMarker(cid, item.c_str(), topic.c_str(), beg, margin,
+                                        use_dts, TOSDB_MAX_BLOCK_SZ, &g, out);
+    }
+    case VOP_ITEM_FRAME:
+    {
+        std::string topic = in.get_string();
+        uint8_t flags = in.get<uint8_t>();
+        bool use_dts = (flags & VARRAY_DTS) != 0;
+        out.set_packed( (flags & VARRAY_PACKED) != 0 );
+        LPCSTR ct = topic.c_str();
+        size_type n = 0;
+
+        err = TOSDB_GetTypeBits(ct, &tbits);
+        if(!err)
+            err = TOSDB_GetItemCount(cid, &n);
+        if(err)
+            return (int16_t)err;
+
+        switch(tbits){
+        case TOSDB_STRING_BIT:
+            return (int16_t)_itemFrameStrings(cid, ct, n, use_dts, out);
+        case TOSDB_INTGR_BIT | TOSDB_QUAD_BIT:
+            return (int16_t)_itemFrame(longlong_calls, tbits, cid, ct, n, use_dts, out);
+        case TOSDB_INTGR_BIT:
+            return (int16_t)_itemFrame(long_calls, tbits, cid, ct, n, use_dts, out);
+        case TOSDB_QUAD_BIT:
+            return (int16_t)_itemFrame(double_calls, tbits, cid, ct, n, use_dts, out);
+        default:
+            return (int16_t)_itemFrame(float_calls, tbits, cid, ct, n, use_dts, out);
+        }
+    }
+    case VOP_TOPIC_FRAME:
+    {
+        std::string item = in.get_string();
+        uint8_t flags = in.get<uint8_t>();
+        bool use_dts = (flags & VARRAY_DTS) != 0;
+        out.set_packed( (flags & VARRAY_PACKED) != 0 );
+        return (int16_t)_topicFrame(cid, item.c_str(), use_dts, out);
+    }
+    default:
+        return VSTATUS_BAD_OP;
+    }
+}
@@ -0,0 +1,528 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include "vmulticast.hpp"
+#include "vclient.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace{
+
+const size_t RECORD_OVERHEAD = 2 + 2 + 6 + 2 * 9; /* item/topic lens, array head,
+                                                     two packed column heads */
+
+/* the most an element can take on the wire (packed deltas can be 8 bytes) */
+inline size_t
+_elemBound(const VArray& arr, size_t i)
+{
+    size_t sz = (arr.type & VTYPE_STRING_BIT)
+              ? 2 + std::min<size_t>(arr.strs[i].size(), UINT16_MAX)
+              : ((arr.type & VTYPE_INTGR_BIT) ? 8 : VTypeWireSize(arr.type));
+
+    return arr.micros.empty() ? sz : sz + 8;
+}
+
+
+VArray
+_front(const VArray& arr)
+{
+    VArray one;
+    one.type = arr.type;
+    if(arr.type & VTYPE_STRING_BIT)
+        one.strs.push_back(arr.strs[0]);
+    else if(arr.type & VTYPE_INTGR_BIT)
+        one.ints.push_back(arr.ints[0]);
+    else
+        one.reals.push_back(arr.reals[0]);
+    if(!arr.micros.empty())
+        one.micros.push_back(arr.micros[0]);
+    return one;
+}
+
+
+inline bool
+_header(const char* p, size_t len, VMcastHeader* head)
+{
+    if(len < sizeof(VMcastHeader))
+        return false;
+    memcpy(head, p, sizeof(VMcastHeader));
+    return (head->magic == VMCAST_MAGIC);
+}
+
+}; /* namespace */
+
+
+VMcastPublisher::VMcastPublisher(std::string group,
+                                 unsigned short port,
+                                 std::string iface,
+                                 int ttl,
+                                 size_t history)
+    :
+        _sock( NetMcastSender(group, port, iface, ttl) ),
+        _session( (uint32_t)std::chrono::system_clock::now().time_since_epoch().count() ),
+        _seq(0),
+        _history_max( std::max<size_t>(history, 1) ),
+        _cur_count(0)
+    {
+        if(_sock == NET_INVALID_SOCKET){
+            std::stringstream s;
+            s<< "failed to open multicast socket for " << group << ':' << port
+             << " (error " << NetLastError() << ')';
+            throw VProtocolError(s.str());
+        }
+
+        _begin();
+    }
+
+
+VMcastPublisher::~VMcastPublisher()
+{
+    NetClose(_sock);
+}
+
+
+void
+VMcastPublisher::publish(const std::string& item,
+                         const std::string& topic,
+                         const VArray& ticks)
+{
+    size_t n = ticks.size();
+    if(n == 0)
+        return;
+
+    _latest[stream_key_type(item, topic)] = _front(ticks);
+
+    /* oldest chunk first so a receiver can apply records in order */
+    size_t head = RECORD_OVERHEAD + item.size() + topic.size();
+    size_t end = n;
+    while(end > 0){
+        size_t room = VMCAST_MAX_DATAGRAM - _cur.size();
+        size_t need = head;
+        size_t beg = end;
+        for( ; beg > 0; --beg){
+            size_t sz = _elemBound(ticks, beg - 1);
+            if(need + sz > room)
+                break;
+            need += sz;
+        }
+
+        if(beg == end){
+            if(_cur_count == 0)
+                throw VProtocolError("stream record too big for a datagram: " + item);
+            _send();
+            continue;
+        }
+
+        VWriter w(_cur, true);
+        w.put_string(item);
+        w.put_string(topic);
+        VPutArray(w, ticks, beg, end);
+        end = beg;
+
+        if(++_cur_count == UINT16_MAX)
+            _send();
+    }
+}
+
+
+void
+VMcastPublisher::flush()
+{
+    _send();
+}
+
+
+void
+VMcastPublisher::heartbeat()
+{
+    auto now = std::chrono::steady_clock::now();
+    if(now - _last_send < std::chrono::milliseconds(VMCAST_HEARTBEAT_INTERVAL))
+        return;
+
+    if(_cur_count){
+        _send();
+        return;
+    }
+
+    VMcastHeader head = {VMCAST_MAGIC, 0, _session, _seq};
+    send(_sock, (const char*)&head, sizeof(head), 0);
+    _last_send = now;
+}
+
+
+int16_t
+VMcastPublisher::handle(uint16_t op, VReader& in, VWriter& out)
+{
+    switch(op){
+    case VOP_MCAST_RETRANSMIT:
+    {
+        uint32_t session = in.get<uint32_t>();
+        uint64_t first = in.get<uint64_t>();
+        uint32_t count = std::min<uint32_t>(in.get<uint32_t>(), VMCAST_MAX_RETRANSMIT);
+
+        uint64_t oldest = _seq - _history.size() + 1;
+        uint64_t end = std::min<uint64_t>(first + count, _seq + 1);
+        first = std::max(first, oldest);
+        if(session != _session || first >= end){
+            first = _seq + 1;
+            end = first;
+        }
+
+        out.put<uint32_t>(_session);
+        out.put<uint64_t>(first);
+        out.put<uint32_t>((uint32_t)(end - first));
+        for(uint64_t s = first; s < end; ++s){
+            const std::vector<char>& d = _history[(size_t)(s - oldest)];
+            out.put_string(d.data(), d.size());
+        }
+        return VSTATUS_OK;
+    }
+    case VOP_MCAST_SNAPSHOT:
+    {
+        _send(); /* so 'seq' covers everything in _latest */
+        out.put<uint32_t>(_session);
+        out.put<uint64_t>(_seq);
+        out.put<uint32_t>((uint32_t)_latest.size());
+        for(auto& l : _latest){
+            out.put_string(l.first.first);
+            out.put_string(l.first.second);
+            VPutArray(out, l.second);
+        }
+        return VSTATUS_OK;
+    }
+    default:
+        return VSTATUS_BAD_OP;
+    }
+}
+
+
+void
+VMcastPublisher::_begin()
+{
+    _cur.clear();
+    _cur.resize(sizeof(VMcastHeader)); /* filled in by _send */
+    _cur_count = 0;
+}
+
+
+void
+VMcastPublisher::_send()
+{
+    if(_cur_count == 0)
+        return;
+
+    VMcastHeader head = {VMCAST_MAGIC, _cur_count, _session, ++_seq};
+    memcpy(&_cur[0], &head, sizeof(head));
+
+    /* best effort; a receiver that misses it asks for a retransmit */
+    if( !_drop || !_drop(_seq) )
+        send(_sock, _cur.data(), (int)_cur.size(), 0);
+
+    _history.push_back( std::move(_cur) );
+    while(_history.size() > _history_max)
+        _history.pop_front();
+
+    _last_send = std::chrono::steady_clock::now();
+    _begin();
+}
+
+
+VMcastReceiver::VMcastReceiver(std::string group,
+                               unsigned short port,
+                               std::string recovery_addr,
+                               unsigned short recovery_port,
+                               std::string iface,
+                               size_t depth,
+                               unsigned int gap_timeout)
+    :
+        _sock( NetMcastReceiver(group, port, iface) ),
+        _recovery_addr(recovery_addr),
+        _recovery_port(recovery_port),
+        _depth(depth),
+        _gap_timeout(gap_timeout),
+        _synced(false),
+        _session(0),
+        _next(1),
+        _known(0),
+        _buf(64 * 1024)
+    {
+        if(_sock == NET_INVALID_SOCKET){
+            std::stringstream s;
+            s<< "failed to join multicast group " << group << ':' << port
+             << " (error " << NetLastError() << ')';
+            throw VProtocolError(s.str());
+        }
+
+        memset(&_stats, 0, sizeof(_stats));
+    }
+
+
+VMcastReceiver::~VMcastReceiver()
+{
+    NetClose(_sock);
+}
+
+
+size_t
+VMcastReceiver::update(int timeout)
+{
+    size_t n = 0;
+
+    if(timeout)
+        NetWaitReadable(_sock, timeout);
+
+    for( ; ; ){
+        int r = recv(_sock, &_buf[0], (int)_buf.size(), 0);
+        if(r <= 0)
+            break; /* nothing left (or an error we'll see again next time) */
+        n += _on_datagram(&_buf[0], (size_t)r);
+    }
+
+    if( _synced && _known >= _next
+        && std::chrono::steady_clock::now() - _gap_since >= _gap_timeout )
+    {
+        n += _recover();
+    }
+
+    return n;
+}
+
+
+const VMcastReceiver::stream_type&
+VMcastReceiver::stream(std::string item, std::string topic) const
+{
+    auto iter = _streams.find( stream_key_type(item, topic) );
+    if(iter == _streams.end())
+        throw std::out_of_range("stream not received: " + item + " " + topic);
+
+    return iter->second;
+}
+
+
+std::vector<VMcastReceiver::stream_key_type>
+VMcastReceiver::streams() const
+{
+    std::vector<stream_key_type> keys;
+    for(auto& s : _streams)
+        keys.push_back(s.first);
+    return keys;
+}
+
+
+size_t
+VMcastReceiver::_on_datagram(const char* p, size_t len)
+{
+    VMcastHeader head;
+    if( !_header(p, len, &head) )
+        return 0;
+
+    size_t n = 0;
+    if(!_synced || head.session != _session){
+        if( !_recovery_addr.empty() ){
+            n += _snapshot();
+            if(head.session != _session)
+                return n; /* publisher restarted again in between? */
+        }else{
+            _synced = true;
+            _session = head.session;
+            _next = head.count ? head.seq : head.seq + 1;
+            _known = _next - 1;
+            _ahead.clear();
+        }
+    }
+
+    bool was_open = (_known >= _next);
+    _known = std::max(_known, head.seq);
+
+    if(head.count == 0){
+        /* heartbeat; only tells us how far the publisher has gotten */
+    }else if(head.seq < _next || _ahead.count(head.seq)){
+        ++_stats.duplicates;
+    }else if(head.seq == _next){
+        n += _apply(p, len);
+        ++_next;
+        n += _drain();
+    }else{
+        _ahead[head.seq].assign(p, p + len);
+    }
+
+    if(!was_open && _known >= _next){
+        _gap_since = std::chrono::steady_clock::now();
+        ++_stats.gaps;
+    }
+
+    return n;
+}
+
+
+size_t
+VMcastReceiver::_drain()
+{
+    size_t n = 0;
+    while( !_ahead.empty() && _ahead.begin()->first <= _next ){
+        auto iter = _ahead.begin();
+        if(iter->first == _next){
+            n += _apply(iter->second.data(), iter->second.size());
+            ++_next;
+        }
+        _ahead.erase(iter);
+    }
+    return n;
+}
+
+
+size_t
+VMcastReceiver::_apply(const char* p, size_t len)
+{
+    VMcastHeader head;
+    memcpy(&head, p, sizeof(head));
+    VReader rdr(p + sizeof(head), len - sizeof(head));
+
+    size_t napplied = 0;
+    for(uint16_t i = 0; i < head.count; ++i){
+        std::string item = rdr.get_string();
+        std::string topic = rdr.get_string();
+        VArray arr = VGetArray(rdr);
+
+        /* oldest first so the most recent ends up at the front */
+        stream_type& strm = _streams[stream_key_type(item, topic)];
+        size_t n = arr.size();
+        for(size_t j = n; j > 0; --j)
+            strm.push_front( arr.value(j - 1) );
+        while(strm.size() > _depth)
+            strm.pop_back();
+
+        napplied += n;
+    }
+
+    ++_stats.datagrams;
+    return napplied;
+}
+
+
+size_t
+VMcastReceiver::_recover()
+{
+    if( _recovery_addr.empty() ){
+        /* nobody to ask; skip to what we have */
+        uint64_t resume = _ahead.empty() ? _known + 1 : _ahead.begin()->first;
+        _stats.lost += resume - _next;
+        _next = resume;
+        return _drain();
+    }
+
+    size_t n = 0;
+    try{
+        while(_known >= _next){
+            std::vector<char> body;
+            VWriter w(body);
+            w.put<uint32_t>(_session);
+            w.put<uint64_t>(_next);
+            w.put<uint32_t>( (uint32_t)std::min<uint64_t>(_known - _next + 1,
+                                                          VMCAST_MAX_RETRANSMIT) );
+
+            VClient::reply_type reply = _recovery().call_checked(VOP_MCAST_RETRANSMIT, body);
+            VReader rdr(reply.body.data(), reply.body.size());
+            uint32_t session = rdr.get<uint32_t>();
+            uint64_t first = rdr.get<uint64_t>();
+            uint32_t count = rdr.get<uint32_t>();
+
+            if(session != _session || count == 0 || first > _next)
+                return n + _snapshot(); /* too old; start over */
+
+            while(count--){
+                uint16_t len = rdr.get<uint16_t>();
+                const char* p = rdr.get_bytes(len);
+                VMcastHeader head;
+                if( !_header(p, len, &head) )
+                    throw VProtocolError("bad retransmitted datagram");
+                if(head.seq != _next)
+                    continue; /* arrived (late) in the meantime */
+                n += _apply(p, len);
+                ++_next;
+                ++_stats.retransmitted;
+                n += _drain();
+            }
+        }
+    }catch(...){
+        _client.reset(); /* reconnect next time */
+        throw;
+    }
+
+    return n;
+}
+
+
+size_t
+VMcastReceiver::_snapshot()
+{
+    VClient::reply_type reply;
+    try{
+        reply = _recovery().call_checked(VOP_MCAST_SNAPSHOT, std::vector<char>());
+    }catch(...){
+        _client.reset();
+        throw;
+    }
+
+    VReader rdr(reply.body.data(), reply.body.size());
+    uint32_t session = rdr.get<uint32_t>();
+    uint64_t seq = rdr.get<uint64_t>();
+    uint32_t count = rdr.get<uint32_t>();
+
+    if(_synced && session == _session){
+        if(seq >= _next)
+            _stats.lost += seq + 1 - _next;
+        _known = std::max(_known, seq);
+    }else{
+        _ahead.clear(); /* an old session's */
+        _known = seq;
+    }
+
+    /* history with a hole in it isn't worth keeping; start each stream over
+       from its latest point */
+    _streams.clear();
+    size_t n = 0;
+    while(count--){
+        std::string item = rdr.get_string();
+        std::string topic = rdr.get_string();
+        VArray arr = VGetArray(rdr);
+        if(arr.size()){
+            _streams[stream_key_type(item, topic)].push_front( arr.value(0) );
+            ++n;
+        }
+    }
+
+    _synced = true;
+    _session = session;
+    _next = seq + 1;
+    ++_stats.snapshots;
+
+    while( !_ahead.empty() && _ahead.begin()->first < _next )
+        _ahead.erase(_ahead.begin());
+
+    return n + _drain();
+}
+
+
+VClient&
+VMcastReceiver::_recovery()
+{
+    if(!_client)
+        _client.reset( new VClient(_recovery_addr, _recovery_port) );
+    return *_client;
+}
@@ -0,0 +1,293 @@
+/*
+Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include "vserver.hpp"
+
+#include <sstream>
+
+using namespace std::placeholders;
+
+
+VServer::VServer(std::string addr, unsigned short port, VRequestHandler& handler)
+    :
+        _handler(handler),
+        _listener( NetListen(addr, port) ),
+        _next_id(1),
+        _running(true)
+    {
+        if(_listener == NET_INVALID_SOCKET){
+            std::stringstream s;
+            s<< "failed to listen on " << addr << ':' << port
+             << " (error " << NetLastError() << ')';
+            throw VProtocolError(s.str());
+        }
+
+        _reactor.add(_listener, NET_EVENT_READ,
+                     std::bind(&VServer::_on_accept, this, _1, _2));
+    }
+
+
+VServer::~VServer()
+{
+    while( !_conns.empty() )
+        _close(_conns.begin()->first);
+
+    _reactor.remove(_listener);
+    NetClose(_listener);
+}
+
+
+void
+VServer::run(int timeout)
+{
+    while( _running.load() )
+        run_once(timeout);
+}
+
+
+void
+VServer::run_once(int timeout)
+{
+    _reactor.poll(timeout);
+    _handler.on_idle(*this);
+}
+
+
+bool
+VServer::push(vconn_id_type conn, uint16_t op, const std::vector<char>& body)
+{
+    auto iter = _socks.find(conn);
+    if(iter == _socks.end())
+        return false;
+
+    net_socket_type sock = iter->second;
+    _conn_type& c = _conns[sock];
+    if(c.out.size() - c.out_pos >= VSERVER_MAX_PENDING_OUT)
+        return false;
+
+    size_t off = VBeginFrame(c.out, VPROTO_PUSH_ID, op);
+    c.out.insert(c.out.end(), body.begin(), body.end());
+    VEndFrame(c.out, off, VSTATUS_OK);
+
+    /* try now; on a hard error leave it to the next poll to close (we may
+       be inside the handler, which on_disconnect would pull out from under) */
+    _write(sock, c);
+    _update_interest(sock, c);
+    return true;
+}
+
+
+size_t
+VServer::pending(vconn_id_type conn) const
+{
+    auto iter = _socks.find(conn);
+    if(iter == _socks.end())
+        return 0;
+
+    const _conn_type& c = _conns.find(iter->second)->second;
+    return c.out.size() - c.out_pos;
+}
+
+
+unsigned short
+VServer::port() const
+{
+    return NetLocalPort(_listener);
+}
+
+
+void
+VServer::_on_accept(net_socket_type sock, unsigned int events)
+{
+    /* drain the backlog; listener is non-blocking */
+    for( ; ; ){
+        net_socket_type csock = accept(sock, nullptr, nullptr);
+        if(csock == NET_INVALID_SOCKET)
+            return;
+
+        if( !NetSetNonBlocking(csock) ){
+            NetClose(csock);
+            continue;
+        }
+        NetSetNoDelay(csock);
+
+        _conn_type& conn = _conns[csock];
+        conn.id = _next_id++;
+        conn.peer = NetPeerName(csock);
+        conn.out_pos = 0;
+
+        if( !_reactor.add(csock, NET_EVENT_READ,
+                          std::bind(&VServer::_on_conn, this, _1, _2)) )
+        {
+            _conns.erase(csock);
+            NetClose(csock);
+            continue;
+        }
+        _socks[conn.id] = csock;
+
+        _handler.on_connect(conn.id, conn.peer);
+    }
+}
+
+
+void
+VServer::_on_conn(net_socket_type sock, unsigned int events)
+{
+    auto iter = _conns.find(sock);
+    if(iter == _conns.end())
+        return;
+
+    _conn_type& conn = iter->second;
+
+    if(events & NET_EVENT_ERROR){
+        _close(sock);
+        return;
+    }
+
+    if( (events & NET_EVENT_WRITE) && !_write(sock, conn) ){
+        _close(sock);
+        return;
+    }
+
+    if(events & NET_EVENT_READ){
+        if( !_read(sock, conn) ){
+            _close(sock);
+            return;
+        }
+        try{
+            _dispatch(conn);
+        }catch(const VProtocolError&){
+            _close(sock); /* bad framing, we can't resync */
+            return;
+        }
+        /* try to get the replies out now rather than next time around */
+        if( !_write(sock, conn) ){
+            _close(sock);
+            return;
+        }
+    }
+
+    _update_interest(sock, conn);
+}
+
+
+bool
+VServer::_read(net_socket_type sock, _conn_type& conn)
+{
+    if(conn.out.size() - conn.out_pos >= VSERVER_MAX_PENDING_OUT)
+        return true; /* back-pressure; see _update_interest */
+
+    size_t off = conn.in.size();
+    conn.in.resize(off + VSERVER_READ_CHUNK);
+
+    int r = recv(sock, &conn.in[off], VSERVER_READ_CHUNK, 0);
+    if(r > 0){
+        conn.in.resize(off + r);
+        return true;
+    }
+
+    conn.in.resize(off);
+    return (r < 0) && NetWouldBlock(NetLastError()); /* 0 == orderly close */
+}
+
+
+bool
+VServer::_write(net_socket_type sock, _conn_type& conn)
+{
+    while(conn.out_pos < conn.out.size()){
+        int r = send(sock, conn.out.data() + conn.out_pos,
+                     (int)(conn.out.size() - conn.out_pos), 0);
+        if(r < 0)
+            return NetWouldBlock(NetLastError());
+        conn.out_pos += r;
+    }
+
+    conn.out.clear();
+    conn.out_pos = 0;
+    return true;
+}
+
+
+void
+VServer::_dispatch(_conn_type& conn)
+{
+    VFrameHeader head;
+    size_t pos = 0;
+
+    /* every complete frame we have, in order */
+    while( VPeekHeader(conn.in.data() + pos, conn.in.size() - pos, &head) ){
+        if(conn.in.size() - pos - VPROTO_HEADER_SZ < head.length)
+            break;
+
+        VReader in(conn.in.data() + pos + VPROTO_HEADER_SZ, head.length);
+        size_t off = VBeginFrame(conn.out, head.id, head.op);
+        VWriter out(conn.out);
+        int16_t status;
+
+        try{
+            status = _handler.handle(conn.id, head.op, in, out);
+        }catch(const VProtocolError&){
+            conn.out.resize(off + VPROTO_HEADER_SZ);
+            status = VSTATUS_BAD_REQUEST;
+        }catch(const std::exception& e){
+            conn.out.resize(off + VPROTO_HEADER_SZ);
+            out.put_string(e.what());
+            status = VSTATUS_EXCEPTION;
+        }
+
+        if(status < 0) /* TOSDB_ERROR_[]; drop any partial reply */
+            conn.out.resize(off + VPROTO_HEADER_SZ);
+
+        VEndFrame(conn.out, off, status);
+        pos += VPROTO_HEADER_SZ + head.length;
+    }
+
+    if(pos)
+        conn.in.erase(conn.in.begin(), conn.in.begin() + pos);
+}
+
+
+void
+VServer::_update_interest(net_socket_type sock, _conn_type& conn)
+{
+    size_t pending = conn.out.size() - conn.out_pos;
+    unsigned int events = 0;
+
+    if(pending < VSERVER_MAX_PENDING_OUT)
+        events |= NET_EVENT_READ;
+    if(pending)
+        events |= NET_EVENT_WRITE;
+
+    _reactor.modify(sock, events);
+}
+
+
+void
+VServer::_close(net_socket_type sock)
+{
+    auto iter = _conns.find(sock);
+    if(iter == _conns.end())
+        return;
+
+    vconn_id_type id = iter->second.id;
+    _reactor.remove(sock);
+    _conns.erase(iter);
+    _socks.erase(id);
+    NetClose(sock);
+
+    _handler.on_disconnect(id);
+}
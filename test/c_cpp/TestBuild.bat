@@ -8,6 +8,9 @@ set "INCLdir=..\..\include"
 set "BINbase=TestBuild"
 set "THISbin=%0%"
 
+rem unit tests of the header-only parts (see test_checks.hpp); no DLL or engine needed
+set "UNITtests=advise_links_test shard_map_test failover_test string_dict_test shared_block_test buffer_ring_test"
+
 set "VERSION=0.8"
 
 IF [%3] == [] (
@@ -105,6 +108,22 @@ echo.
 echo Clearing Files...
 del *.exe *.obj *.dll *.lib *.pdb *.suo 2>NUL
 
+echo.
+echo Running unit tests...
+for %%T in (%UNITtests%) do (
+    "%VSINSTALLDIR%\VC\%CMDpath%\CL.exe" /nologo /EHsc /O2 /MD /TP /I%INCLdir% ^
+/Fe%%T.exe %%T.cpp
+    IF ERRORLEVEL 1 (
+        echo fatal: compilation error: %%T
+        EXIT /B 1
+    )
+    %%T.exe
+    IF ERRORLEVEL 1 (
+        echo fatal: %%T failed
+        EXIT /B 1
+    )
+)
+
 echo.
 echo Compiling...
 @echo on
@@ -0,0 +1,203 @@
+/* AdviseLinks (advise_links.hpp), the engine's pause/resume of DDE advise
+   loops, against a synthetic feed.
+
+   FakeServer stands in for TOS: it keeps the set of streams it has an advise
+   loop for, pushes one 'tick' to each of them per feed() and can be told to
+   refuse (not ack) the link/unlink of particular streams, or to do it but
+   ack too late (PostBulk has given up by then). The engine's side
+   is AdviseLinks with bulk callbacks that talk to the FakeServer - what
+   PostBulk does with LINK_DDE_ITEM/DELINK_DDE_ITEM. Walks through pausing,
+   adding/removing while paused, failed and late links/unlinks and retries. */
+
+#include <stdio.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "advise_links.hpp"
+#include "test_checks.hpp"
+
+typedef std::string stream_type;
+typedef AdviseLinks<stream_type> links_type;
+
+
+struct FakeServer{
+    std::set<stream_type> advised;
+    std::set<stream_type> refuse;  /* don't ack these */
+    std::set<stream_type> late;    /* do these, but ack after the timeout */
+    std::map<stream_type, int> ticks;
+    int link_calls;
+    int unlink_calls;
+
+    FakeServer() : link_calls(0), unlink_calls(0) {}
+
+    links_type::streams_type
+    link(const links_type::streams_type& streams)
+    {
+        links_type::streams_type failed;
+        ++link_calls;
+        for(const stream_type& s : streams){
+            if(!refuse.count(s))
+                advised.insert(s);
+            if(refuse.count(s) || late.count(s))
+                failed.push_back(s);
+        }
+        return failed;
+    }
+
+    links_type::streams_type
+    unlink(const links_type::streams_type& streams)
+    {
+        links_type::streams_type failed;
+        ++unlink_calls;
+        for(const stream_type& s : streams){
+            if(!refuse.count(s))
+                advised.erase(s);
+            if(refuse.count(s) || late.count(s))
+                failed.push_back(s);
+        }
+        return failed;
+    }
+
+    /* one WM_DDE_DATA per advise loop */
+    void
+    feed()
+    {
+        for(const stream_type& s : advised)
+            ++ticks[s];
+    }
+
+    int
+    total() const
+    {
+        int n = 0;
+        for(const auto& t : ticks)
+            n += t.second;
+        return n;
+    }
+};
+
+
+/* what AddStream does: link it (PostItem), then tell AdviseLinks */
+void
+add(FakeServer& srv, links_type& links, const stream_type& s)
+{
+    srv.advised.insert(s);
+    links.added(s);
+}
+
+
+/* what CloseItem does: only unlink (PostCloseItem) if it's live */
+void
+remove(FakeServer& srv, links_type& links, const stream_type& s)
+{
+    if(links.removed(s))
+        srv.advised.erase(s);
+}
+
+
+int
+main()
+{
+    FakeServer srv;
+    links_type links(
+        [&](const links_type::streams_type& s){ return srv.link(s); },
+        [&](const links_type::streams_type& s){ return srv.unlink(s); }
+    );
+
+    printf("-- running\n");
+    add(srv, links, "SPY:LAST");
+    add(srv, links, "SPY:BID");
+    add(srv, links, "QQQ:LAST");
+    srv.feed();
+    CHECK(links.state() == links_type::RUNNING);
+    CHECK(links.live() == 3 && links.parked() == 0);
+    CHECK(srv.total() == 3);
+
+    printf("-- pause: one bulk unlink, subscriptions kept\n");
+    CHECK(links.pause() == 0);
+    CHECK(srv.unlink_calls == 1);
+    CHECK(links.state() == links_type::PAUSED);
+    CHECK(links.live() == 0 && links.parked() == 3);
+    srv.ticks.clear();
+    srv.feed();
+    CHECK(srv.total() == 0);
+
+    printf("-- add/remove while paused\n");
+    add(srv, links, "IWM:LAST");
+    CHECK(links.is_parked("IWM:LAST"));
+    CHECK(srv.advised.empty());
+    remove(srv, links, "SPY:BID");
+    CHECK(links.parked() == 3);
+    CHECK(srv.unlink_calls == 2); /* the add; the remove needed none */
+
+    printf("-- resume with a link that fails\n");
+    srv.refuse.insert("QQQ:LAST");
+    CHECK(links.resume() == 1);
+    CHECK(srv.link_calls == 1);
+    CHECK(links.state() == links_type::RUNNING);
+    CHECK(links.live() == 2 && links.is_parked("QQQ:LAST"));
+    srv.feed();
+    CHECK(srv.total() == 2 && srv.ticks["QQQ:LAST"] == 0);
+    CHECK(srv.ticks["SPY:BID"] == 0);
+
+    printf("-- resume again retries it\n");
+    srv.refuse.clear();
+    CHECK(links.resume() == 0);
+    CHECK(links.live() == 3 && links.parked() == 0);
+    srv.ticks.clear();
+    srv.feed();
+    CHECK(srv.total() == 3);
+
+    printf("-- pause with an unlink that fails\n");
+    srv.refuse.insert("SPY:LAST");
+    CHECK(links.pause() == 1);
+    CHECK(links.live() == 1 && links.parked() == 2);
+    srv.ticks.clear();
+    srv.feed();
+    CHECK(srv.total() == 1 && srv.ticks["SPY:LAST"] == 1);
+    remove(srv, links, "SPY:LAST"); /* live: caller unlinks it */
+    CHECK(links.live() == 0);
+
+    printf("-- resume/pause with nothing to do doesn't call out\n");
+    srv.refuse.clear();
+    CHECK(links.resume() == 0);
+    int calls = srv.link_calls + srv.unlink_calls;
+    remove(srv, links, "QQQ:LAST");
+    remove(srv, links, "IWM:LAST");
+    CHECK(links.pause() == 0 && links.resume() == 0);
+    CHECK(srv.link_calls + srv.unlink_calls == calls);
+    CHECK(srv.advised.empty());
+
+    printf("-- an unlink acked late is linked again on resume\n");
+    add(srv, links, "SPY:LAST");
+    add(srv, links, "SPY:ASK");
+    srv.late.insert("SPY:ASK");
+    CHECK(links.pause() == 1);
+    CHECK(links.live() == 1 && links.unconfirmed() == 1);
+    CHECK(srv.advised.empty()); /* it went down anyway */
+    srv.late.clear();
+    CHECK(links.resume() == 0);
+    CHECK(links.live() == 2 && links.parked() == 0 && links.unconfirmed() == 0);
+    srv.ticks.clear();
+    srv.feed();
+    CHECK(srv.ticks["SPY:LAST"] == 1 && srv.ticks["SPY:ASK"] == 1);
+
+    printf("-- a link acked late is unlinked on pause, and on remove\n");
+    CHECK(links.pause() == 0);
+    srv.late.insert("SPY:ASK");
+    srv.late.insert("SPY:LAST");
+    CHECK(links.resume() == 2);
+    CHECK(links.parked() == 2 && links.unconfirmed() == 2);
+    CHECK(srv.advised.size() == 2); /* both went up anyway */
+    srv.late.erase("SPY:LAST");
+    CHECK(links.pause() == 1);
+    CHECK(!srv.advised.count("SPY:LAST") && links.unconfirmed() == 1);
+    remove(srv, links, "SPY:ASK"); /* parked, but unconfirmed: unlinked */
+    CHECK(srv.advised.empty() && links.unconfirmed() == 0);
+    remove(srv, links, "SPY:LAST");
+    CHECK(links.live() == 0 && links.parked() == 0);
+
+    return CHECKS_RESULT();
+}
@@ -0,0 +1,289 @@
+/* the engine's stream buffers (buffer_ring.hpp) w/ a real BufferHead.
+
+   A buffer is laid out the way CreateBuffer does it - a page, the header,
+   then the ring - and written to the way RouteToBuffer does, in batches of
+   every size up to more than the ring holds. After each batch a reader
+   does what _extractFromBuffer does with its cursor. It has to get every
+   tick that wasn't written over, oldest first, and never an offset inside
+   the header. The header is bigger than an element, so offsets taken from
+   the start of the mapping instead of beg_offset would land in it.
+
+   String streams are laid out header, dictionary (string_dict.hpp), ring;
+   their ticks go through StringDictStore/Load the way the engine and the
+   client's extract loop do, with more distinct values than the dictionary
+   holds. */
+
+#define THIS_IMPORTS_IMPLEMENTATION /* for BufferHead; nothing's linked */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "tos_databridge.h"
+#include "buffer_ring.hpp"
+#include "string_dict.hpp"
+#include "test_checks.hpp"
+
+#define PAGE_SZ 4096 /* CreateBuffer's smallest */
+
+
+/* one stream's buffer; elements are a T and its DateTimeStamp */
+template<typename T>
+struct Buffer{
+    std::vector<char> mem;
+    int seq;
+
+    Buffer(unsigned int dict_sz = 0)
+        : mem(PAGE_SZ + dict_sz), seq(0)
+    {
+        RingInit(head(), (unsigned int)mem.size(), dict_sz, sizeof(T) + sizeof(DateTimeStamp));
+    }
+
+    pBufferHead
+    head()
+    {
+        return (pBufferHead)&mem[0];
+    }
+
+    pDateTimeStamp
+    stamp(unsigned int offset)
+    {
+        return (pDateTimeStamp)(&mem[offset] + head()->elem_size - sizeof(DateTimeStamp));
+    }
+
+    unsigned int
+    nslots()
+    {
+        return (head()->end_offset - head()->beg_offset) / head()->elem_size;
+    }
+
+    /* RouteToBuffer: values, then the cursor, once for the batch */
+    void
+    write(int n)
+    {
+        pBufferHead h = head();
+        unsigned int next = h->next_offset;
+        unsigned int loop_seq = h->loop_seq;
+        for(int i = 0; i < n; ++i, ++seq){
+            *(T*)&mem[next] = (T)seq;
+            memset(stamp(next), 0, sizeof(DateTimeStamp));
+            stamp(next)->micro_second = seq;
+            next = RingNextOffset(h, next, &loop_seq);
+        }
+        h->loop_seq = loop_seq;
+        h->next_offset = next;
+    }
+};
+
+
+/* _extractFromBuffer's side */
+template<typename T>
+struct Reader{
+    Buffer<T> *buf;
+    unsigned int cur_offset;
+    unsigned int cur_loop_seq;
+    std::vector<int> got;
+    int in_header;
+
+    Reader(Buffer<T> *b) : buf(b), cur_offset(0), cur_loop_seq(0), in_header(0) {}
+
+    void
+    read()
+    {
+        pBufferHead h = buf->head();
+        long long nelems = RingNewElements(h, cur_offset, cur_loop_seq);
+        for( ; nelems > 0; --nelems){ /* oldest first */
+            unsigned int offset = RingElementOffset(h, h->next_offset, (unsigned int)nelems);
+            if(offset < h->beg_offset || offset + h->elem_size > h->end_offset){
+                ++in_header;
+                continue;
+            }
+            int v = (int)*(T*)&buf->mem[offset];
+            if(v != buf->stamp(offset)->micro_second)
+                ++in_header; /* value and stamp from different ticks */
+            got.push_back(v);
+        }
+        cur_offset = h->next_offset - h->beg_offset;
+        cur_loop_seq = h->loop_seq;
+    }
+};
+
+
+/* write batches of 1 to a bit more than the ring holds, reading after each;
+   true if the reader got every tick it could have, in order */
+template<typename T>
+bool
+batches(const char *name)
+{
+    Buffer<T> buf;
+    Reader<T> rd(&buf);
+    unsigned int nslots = buf.nslots();
+    int expect = 0;
+    bool in_order = true;
+
+    printf("-- %s: elem %u, header %u, %u slots\n", name, buf.head()->elem_size,
+           (unsigned int)sizeof(BufferHead), nslots);
+
+    for(unsigned int n = 1; n <= nslots + 5; ++n){
+        size_t before = rd.got.size();
+        buf.write(n);
+        rd.read();
+        if(n > nslots)
+            expect += n - nslots; /* written over before we got to them */
+        for(size_t i = before; i < rd.got.size(); ++i, ++expect){
+            if(rd.got[i] != expect)
+                in_order = false;
+        }
+    }
+
+    CHECK(buf.head()->loop_seq > 1);
+    CHECK(rd.in_header == 0);
+    CHECK(in_order && expect == buf.seq);
+    return in_order;
+}
+
+
+/* a string stream: values are codes (or inline strings) w/ the dictionary
+   between the header and the ring, as CreateBuffer lays it out for a
+   history of 'depth' ticks */
+struct StrBuffer{
+    std::vector<char> mem;
+    StringDictWriter *writer;
+    std::vector<std::string> sent;
+
+    StrBuffer(unsigned int depth)
+        : mem(std::max<size_t>(PAGE_SZ, sizeof(BufferHead) 
+                               + depth * (STRING_DICT_ELEM_SZ + sizeof(DateTimeStamp)))
+              + sizeof(StringDict))
+    {
+        pBufferHead h = head();
+        RingInit(h, (unsigned int)mem.size(), sizeof(StringDict), 
+                 STRING_DICT_ELEM_SZ + sizeof(DateTimeStamp));
+        writer = new StringDictWriter(dict(), (h->end_offset - h->beg_offset) / h->elem_size);
+    }
+
+    ~StrBuffer()
+    {
+        delete writer;
+    }
+
+    pBufferHead
+    head()
+    {
+        return (pBufferHead)&mem[0];
+    }
+
+    StringDict*
+    dict()
+    {
+        return (StringDict*)(&mem[0] + head()->dict_offset);
+    }
+
+    void
+    write(const std::string& val)
+    {
+        pBufferHead h = head();
+        unsigned int next = h->next_offset;
+        unsigned int loop_seq = h->loop_seq;
+        StringDictStore(&mem[next], writer, val);
+        pDateTimeStamp stamp = (pDateTimeStamp)(&mem[next] + STRING_DICT_ELEM_SZ);
+        memset(stamp, 0, sizeof(DateTimeStamp));
+        stamp->micro_second = (long)sent.size();
+        sent.push_back(val);
+        h->next_offset = RingNextOffset(h, next, &loop_seq);
+        h->loop_seq = loop_seq;
+    }
+};
+
+
+int
+main()
+{
+    CHECK(sizeof(BufferHead) > sizeof(ext_price_type) + sizeof(DateTimeStamp));
+
+    printf("-- layout\n");
+    {
+        Buffer<ext_price_type> buf;
+        pBufferHead h = buf.head();
+        CHECK(h->dict_offset == 0 && h->beg_offset == sizeof(BufferHead));
+        CHECK(h->end_offset <= PAGE_SZ && PAGE_SZ - h->end_offset < h->elem_size);
+        CHECK((h->end_offset - h->beg_offset) % h->elem_size == 0);
+
+        /* the first write wraps right after the last slot */
+        unsigned int loop_seq = 0;
+        unsigned int last = h->end_offset - h->elem_size;
+        CHECK(RingNextOffset(h, last, &loop_seq) == h->beg_offset && loop_seq == 1);
+        CHECK(RingNextOffset(h, h->beg_offset, &loop_seq) == h->beg_offset + h->elem_size);
+    }
+
+    batches<ext_price_type>("ext_price_type (double)");
+    batches<def_price_type>("def_price_type (float)");
+    batches<def_size_type>("def_size_type (long)");
+    batches<ext_size_type>("ext_size_type (long long)");
+
+    printf("-- a reader that falls a ring behind gets the latest it holds\n");
+    {
+        Buffer<def_size_type> buf;
+        Reader<def_size_type> rd(&buf);
+        unsigned int nslots = buf.nslots();
+        buf.write(3 * nslots + 7);
+        rd.read();
+        CHECK(rd.got.size() == nslots);
+        CHECK(rd.got.front() == (int)(2 * nslots + 7) && rd.got.back() == buf.seq - 1);
+        CHECK(RingNewElements(buf.head(), rd.cur_offset, rd.cur_loop_seq) == 0);
+    }
+
+    printf("-- string ticks through the dictionary, coded and inline\n");
+    {
+        StrBuffer buf(4 * TOSDB_DICT_CODES); /* room for more values than codes */
+        pBufferHead h = buf.head();
+        StringDictReader dict;
+        unsigned int cur_offset = 0;
+        unsigned int cur_loop_seq = 0;
+        unsigned int nslots = (h->end_offset - h->beg_offset) / h->elem_size;
+        bool all = true;
+        bool outside_ring = false;
+        size_t got = 0;
+
+        CHECK(h->dict_offset == sizeof(BufferHead));
+        CHECK(h->beg_offset == h->dict_offset + sizeof(StringDict));
+        CHECK(h->end_offset <= buf.mem.size() && nslots >= 4 * TOSDB_DICT_CODES);
+
+        /* a few values over and over, then more distinct ones than the
+           dictionary holds, then back; read every half a ring, so what's
+           read is well over 64 values old */
+        for(int i = 0; i < 6 * (int)nslots; ++i){
+            int phase = i / (2 * (int)nslots);
+            std::string v = (phase == 1) ? "D" + std::to_string(i % (2 * TOSDB_DICT_CODES)) 
+                                         : std::string(1, "QNPZ"[i % 4]);
+            buf.write(v);
+            if(i % (nslots / 2))
+                continue;
+
+            long long nelems = RingNewElements(h, cur_offset, cur_loop_seq);
+            for( ; nelems > 0; --nelems){
+                unsigned int offset = RingElementOffset(h, h->next_offset, (unsigned int)nelems);
+                if(offset < h->beg_offset || offset + h->elem_size > h->end_offset){
+                    outside_ring = true;
+                    continue;
+                }
+                std::string s;
+                long seq = ((pDateTimeStamp)(&buf.mem[offset] + STRING_DICT_ELEM_SZ))->micro_second;
+                all = all && StringDictLoad(&buf.mem[offset], buf.dict(), &dict, &s) 
+                          && s == buf.sent[seq];
+                ++got;
+            }
+            cur_offset = h->next_offset - h->beg_offset;
+            cur_loop_seq = h->loop_seq;
+        }
+
+        CHECK(!outside_ring);
+        CHECK(all && got > 5 * nslots);
+        CHECK(buf.dict()->inline_count > 0); /* the 'D' phase didn't fit */
+        CHECK(buf.writer->size() <= TOSDB_DICT_CODES);
+    }
+
+    return CHECKS_RESULT();
+}
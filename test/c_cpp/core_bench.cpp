@@ -0,0 +1,366 @@
+/*
+   micro-benchmarks for the header-only core (no engine, TOS or windows needed)
+
+   DataStream push/copy/copy_from_marker/vector for each stream type and a few
+   block sizes (with and without the date-time deque), TOSDB_Generic
+   construct/copy/convert and TwoWayHashMap lookups. One JSON object per line:
+
+     {"bench":"DataStream.copy","type":"double","block":10000,"dt":1,
+      "ns_op":1234.5,"allocs_op":0.00,"iters":4096}
+
+   so runs can be diffed/plotted across commits. allocs_op counts calls to the
+   global operator new. Optional args: a substring to filter bench names on
+   and the minimum time per bench in milliseconds (default 200).
+
+   RawDataBlock isn't covered: it needs TOS_Topics and the rest of
+   tos_databridge.h, which still assume windows.
+
+   (THIS_DOESNT_IMPORT_INTERFACE: build TOSDB_Generic in, don't import it)
+
+   linux:   g++ -std=c++11 -O2 -DTHIS_DOESNT_IMPORT_INTERFACE -I../../include core_bench.cpp
+                ../../src/generic.cpp -pthread -o core_bench
+   windows: cl /EHsc /O2 /DTHIS_DOESNT_IMPORT_INTERFACE /I..\..\include core_bench.cpp
+                ..\..\src\generic.cpp
+*/
+
+#define STR_DATA_SZ 40 /* data_stream.hpp: don't pull in tos_databridge.h */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+inline int
+strncpy_s(char* dest, size_t dest_sz, const char* src, size_t count)
+{
+    size_t n = (count < dest_sz) ? count : dest_sz - 1;
+    memcpy(dest, src, n);
+    dest[n] = 0;
+    return 0;
+}
+#endif
+
+/* normally from tos_databridge.h/main.cpp */
+char**
+NewStrings(size_t num_strs, size_t strs_len)
+{
+    char** strs = new char*[num_strs];
+
+    for(size_t i = 0; i < num_strs; ++i)
+        strs[i] = new char[strs_len + 1];
+
+    return strs;
+}
+
+void
+DeleteStrings(char** str_array, size_t num_strs)
+{
+    if(!str_array)
+        return;
+
+    while(num_strs--)
+        delete[] str_array[num_strs];
+
+    delete[] str_array;
+}
+
+typedef struct{ /* same layout as DateTimeStamp */
+    struct tm  ctime_struct;
+    long       micro_second;
+} BenchStamp;
+
+#include "generic.hpp"
+#include "containers.hpp"
+#include "data_stream.hpp"
+
+
+static unsigned long long alloc_count = 0;
+
+void*
+operator new(size_t sz)
+{
+    ++alloc_count;
+    void* p = malloc(sz ? sz : 1);
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void*
+operator new[](size_t sz)
+{
+    return operator new(sz);
+}
+
+void
+operator delete(void* p) throw()
+{
+    free(p);
+}
+
+void
+operator delete[](void* p) throw()
+{
+    free(p);
+}
+
+void
+operator delete(void* p, size_t) throw()
+{
+    free(p);
+}
+
+void
+operator delete[](void* p, size_t) throw()
+{
+    free(p);
+}
+
+
+static const char* filter = nullptr;
+static double min_ms = 200;
+static volatile double sink = 0; /* keep results live */
+
+/* op(n) does n operations; grow n until a batch takes min_ms */
+template<typename Op>
+void
+run(const char* name, const char* type, long long block, int dt, Op op)
+{
+    if(filter && !strstr(name, filter))
+        return;
+
+    op(1); /* warm-up */
+
+    unsigned long long n = 1;
+    for( ; ; n *= 2){
+        unsigned long long allocs = alloc_count;
+        auto t = std::chrono::steady_clock::now();
+        op(n);
+        double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - t).count();
+        allocs = alloc_count - allocs;
+
+        if(ns >= min_ms * 1e6 || n >= (1ULL << 40)){
+            printf("{\"bench\":\"%s\",\"type\":\"%s\",\"block\":%lld,\"dt\":%d,"
+                   "\"ns_op\":%.1f,\"allocs_op\":%.2f,\"iters\":%llu}\n",
+                   name, type, block, dt, ns / n, (double)allocs / n, n);
+            fflush(stdout);
+            return;
+        }
+    }
+}
+
+
+template<typename T>
+T
+bench_val(long long i)
+{
+    return (T)(i % 1000) + (T)0.25;
+}
+
+template<>
+std::string
+bench_val<std::string>(long long i)
+{
+    return std::to_string(i % 1000) + ".25"; /* so Generic can convert it */
+}
+
+template<typename T>
+size_t
+bench_copy(const DataStreamInterface<BenchStamp, TOSDB_Generic>* s, std::vector<T>& dest,
+           std::vector<char*>&, BenchStamp* sec)
+{
+    return s->copy(&dest[0], dest.size(), -1, 0, sec);
+}
+
+template<>
+size_t
+bench_copy<std::string>(const DataStreamInterface<BenchStamp, TOSDB_Generic>* s,
+                        std::vector<std::string>& dest, std::vector<char*>& strs,
+                        BenchStamp* sec)
+{
+    /* what the C API does: fixed-size char buffers */
+    return s->copy(&strs[0], strs.size(), STR_DATA_SZ, -1, 0, sec);
+}
+
+template<typename T>
+long long
+bench_copy_from_marker(const DataStreamInterface<BenchStamp, TOSDB_Generic>* s,
+                       std::vector<T>& dest, std::vector<char*>&, BenchStamp* sec)
+{
+    return s->copy_from_marker(&dest[0], dest.size(), 0, sec);
+}
+
+template<>
+long long
+bench_copy_from_marker<std::string>(const DataStreamInterface<BenchStamp, TOSDB_Generic>* s,
+                                    std::vector<std::string>& dest, std::vector<char*>& strs,
+                                    BenchStamp* sec)
+{
+    return s->copy_from_marker(&strs[0], strs.size(), STR_DATA_SZ, 0, sec);
+}
+
+
+template<typename T, bool DT>
+void
+bench_stream(const char* type, size_t block)
+{
+    typedef DataStreamInterface<BenchStamp, TOSDB_Generic> iface_type;
+
+    std::unique_ptr<iface_type> s(new DataStream<T, BenchStamp, TOSDB_Generic, DT>(block));
+    BenchStamp stamp = BenchStamp();
+    long long i = 0;
+
+    std::vector<T> vals(1000); /* pre-built so push doesn't time construction */
+    for(size_t j = 0; j < vals.size(); ++j)
+        vals[j] = bench_val<T>(j);
+
+    for(size_t j = 0; j < block; ++j) /* fill */
+        s->push(TOSDB_Generic(vals[j % vals.size()]), stamp);
+
+    std::vector<T> dest(block);
+    std::vector<BenchStamp> dts(DT ? block : 1);
+    std::vector<char*> strs;
+    std::vector<std::vector<char>> str_bufs(std::is_same<T,std::string>::value ? block : 0,
+                                            std::vector<char>(STR_DATA_SZ));
+    for(auto& b : str_bufs)
+        strs.push_back(&b[0]);
+    if(strs.empty())
+        strs.push_back(nullptr);
+
+    BenchStamp* sec = DT ? &dts[0] : nullptr;
+
+    run("DataStream.push", type, block, DT, [&](unsigned long long n){
+        while(n--){
+            stamp.micro_second = (long)(++i);
+            s->push(TOSDB_Generic(vals[i % vals.size()]), stamp);
+        }
+    });
+
+    run("DataStream.copy", type, block, DT, [&](unsigned long long n){
+        while(n--)
+            sink += (double)bench_copy<T>(s.get(), dest, strs, sec);
+    });
+
+    /* the polling pattern: a new value, then everything since the last read */
+    run("DataStream.push+copy_from_marker", type, block, DT, [&](unsigned long long n){
+        while(n--){
+            s->push(TOSDB_Generic(vals[++i % vals.size()]), stamp);
+            sink += (double)bench_copy_from_marker<T>(s.get(), dest, strs, sec);
+        }
+    });
+
+    run("DataStream.vector", type, block, DT, [&](unsigned long long n){
+        while(n--)
+            sink += (double)s->vector().size();
+    });
+}
+
+template<typename T>
+void
+bench_stream_type(const char* type, const std::vector<size_t>& blocks)
+{
+    for(size_t b : blocks){
+        bench_stream<T, false>(type, b);
+        bench_stream<T, true>(type, b);
+    }
+}
+
+
+template<typename T>
+void
+bench_generic(const char* type)
+{
+    T v = bench_val<T>(42);
+    TOSDB_Generic g(v);
+
+    run("Generic.construct", type, 0, 0, [&](unsigned long long n){
+        while(n--){
+            TOSDB_Generic x(v);
+            sink += x.size();
+        }
+    });
+
+    run("Generic.copy", type, 0, 0, [&](unsigned long long n){
+        while(n--){
+            TOSDB_Generic x(g);
+            sink += x.size();
+        }
+    });
+
+    run("Generic.as_double", type, 0, 0, [&](unsigned long long n){
+        while(n--)
+            sink += g.as_double();
+    });
+
+    run("Generic.as_long_long", type, 0, 0, [&](unsigned long long n){
+        while(n--)
+            sink += (double)g.as_long_long();
+    });
+
+    run("Generic.as_string", type, 0, 0, [&](unsigned long long n){
+        while(n--)
+            sink += (double)g.as_string().size();
+    });
+}
+
+
+template<bool ThreadSafe>
+void
+bench_two_way(const char* type, size_t n_elems)
+{
+    TwoWayHashMap<std::string, int, ThreadSafe> m;
+    std::vector<std::string> keys;
+
+    for(size_t j = 0; j < n_elems; ++j){
+        keys.push_back("TOPIC_" + std::to_string(j));
+        m.insert(keys.back(), (int)j);
+    }
+
+    run("TwoWayHashMap.find_key", type, (long long)n_elems, 0, [&](unsigned long long n){
+        for(size_t j = 0; n--; j = (j + 1 == n_elems) ? 0 : j + 1)
+            sink += m[keys[j]];
+    });
+
+    run("TwoWayHashMap.find_value", type, (long long)n_elems, 0, [&](unsigned long long n){
+        for(size_t j = 0; n--; j = (j + 1 == n_elems) ? 0 : j + 1)
+            sink += (double)m[(int)j].size();
+    });
+}
+
+
+int
+main(int argc, char* argv[])
+{
+    if(argc > 1 && argv[1][0])
+        filter = argv[1];
+    if(argc > 2)
+        min_ms = atof(argv[2]);
+
+    std::vector<size_t> blocks;
+    blocks.push_back(100);
+    blocks.push_back(10000);
+    blocks.push_back(1000000);
+
+    bench_stream_type<long>("long", blocks);
+    bench_stream_type<long long>("long long", blocks);
+    bench_stream_type<float>("float", blocks);
+    bench_stream_type<double>("double", blocks);
+    bench_stream_type<std::string>("string", blocks);
+
+    bench_generic<long>("long");
+    bench_generic<long long>("long long");
+    bench_generic<float>("float");
+    bench_generic<double>("double");
+    bench_generic<std::string>("string");
+
+    bench_two_way<false>("string<->int", 100);
+    bench_two_way<true>("string<->int (thread-safe)", 100);
+
+    return 0;
+}
@@ -0,0 +1,530 @@
+/*
+   end-to-end throughput/latency benchmark with a simulated engine (no TOS needed)
+
+   stands in for tos-databridge-engine: answers the client library's IPC stream
+   requests on TOSDB_COMM_CHANNEL and creates the same shared-memory rings
+   (BufferHead + elements, named by CreateBufferName, guarded by the '_mtx'
+   mutex) that the real engine does, then one writer thread - like the engine's
+   single DDE thread - writes VOLUME ticks into them at a fixed rate per
+   stream. Each tick's value is its sequence number in the stream and its
+   DateTimeStamp is the time it was written. Ticks that are due together
+   (up to 'burst' per stream) are written like the engine's RouteToBuffer
+   does: as one span, under one lock, with one update of the header. The
+   writer's time per tick is reported so burst sizes can be compared.
+
+   The real client (tos-databridge-[].dll) is driven as usual: blocks are
+   created, items added, and _threadedExtractLoop moves the ticks into the
+   RawDataBlocks. Reader threads split the (block,item) streams between them
+   and poll TOSDB_GetStreamSnapshotLongLongsFromMarkerWithEpoch; a gap in the
+   sequence numbers is a dropped tick (the ring or the stream got lapped) and
+   'now - stamp' is the delivery latency. Prints a summary and one JSON line:
+
+     {"streams":10,"blocks":1,"rate":1000,"readers":2,"latency_ms":30,
+      "ring_sz":4096,"block_sz":100000,"burst":1,"secs":10,"written":100000,
+      "delivered":100000,"dropped":0,"dirty":0,"ticks_per_sec":10000.0,
+      "writer_ns_tick":250.0,
+      "lat_us":{"p50":..,"p90":..,"p99":..,"p999":..,"max":..}}
+
+   args (all optional, in order):
+     streams   - items per block (SIM0, SIM1, ...)           default 10
+     blocks    - blocks, each with all the items              default 1
+     rate      - ticks/sec written to each stream             default 1000
+     secs      - how long to write                            default 10
+     readers   - reader threads                               default 2
+     latency   - TOSDB_SetLatency value (ms)                  default 30 (Fast)
+     ring_sz   - bytes per shared-memory ring                 default TOSDB_SHEM_BUF_SZ
+     block_sz  - stream size of each block                    default 100000
+     burst     - most ticks per stream written as one span    default 1
+
+   The real engine (and service) must NOT be running: we need its pipe names.
+   Unless the libraries were built with NO_KGBLNS the rings are created in the
+   Global namespace, which needs an elevated prompt - same as the engine.
+
+   x64: cl /EHsc /O2 /DTHIS_IMPORTS_IMPLEMENTATION /I..\..\include e2e_bench.cpp
+            ..\..\bin\Release\x64\tos-databridge-0.8-x64.lib
+            ..\..\bin\Release\x64\_tos-databridge-x64.lib
+        (with both dlls copied alongside; see TestBuild.bat)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tos_databridge.h"
+#include "ipc.hpp"
+
+static const char* BLOCK_PREFIX = "E2E_";
+static const TOS_Topics::TOPICS TOPIC = TOS_Topics::TOPICS::VOLUME; /* ext_size_type */
+
+struct Config{
+    int streams;
+    int blocks;
+    double rate;
+    int secs;
+    int readers;
+    unsigned long latency;
+    unsigned int ring_sz;
+    size_type block_sz;
+    int burst;
+};
+
+static Config config = {10, 1, 1000, 10, 2, Fast, TOSDB_SHEM_BUF_SZ, 100000, 1};
+
+
+long long
+now_micro()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+/* the same conversion DDE_Data<T>::_init_datetime does in the engine */
+void
+micro_to_stamp(long long micro, DateTimeStamp* dts)
+{
+    time_t t = (time_t)(micro / 1000000);
+    dts->micro_second = (long)(micro % 1000000);
+    localtime_s(&dts->ctime_struct, &t);
+}
+
+
+class SimEngine{
+    struct Ring{
+        HANDLE hfile;
+        HANDLE hmtx;
+        pBufferHead head;
+        unsigned int refs;
+        long long seq; /* next value to write */
+    };
+
+    IPCSlave _slave;
+    std::map<std::string, Ring> _rings; /* by item */
+    std::mutex _rings_mtx;
+    std::thread _comm_thread;
+    std::atomic<bool> _stop;
+
+    int
+    _add(std::string item)
+    {
+        std::lock_guard<std::mutex> lock(_rings_mtx);
+
+        auto r = _rings.find(item);
+        if(r != _rings.end()){
+            ++(r->second.refs);
+            return 0;
+        }
+
+        std::string name = CreateBufferName(TOS_Topics::map[TOPIC], item);
+        Ring ring = Ring();
+
+        ring.hfile = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+                                       config.ring_sz, name.c_str());
+        if(!ring.hfile){
+            fprintf(stderr, "CreateFileMapping failed for %s (%lu)\n", name.c_str(), GetLastError());
+            return TOSDB_ERROR_SHEM_BUFFER;
+        }
+
+        ring.head = (pBufferHead)MapViewOfFile(ring.hfile, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+        ring.hmtx = CreateMutex(NULL, FALSE, (name + "_mtx").c_str());
+        if(!ring.head || !ring.hmtx){
+            fprintf(stderr, "failed to map/create mutex for %s (%lu)\n", name.c_str(), GetLastError());
+            if(ring.head)
+                UnmapViewOfFile(ring.head);
+            CloseHandle(ring.hfile);
+            return TOSDB_ERROR_SHEM_BUFFER;
+        }
+
+        /* same layout as CreateBuffer in engine.cpp */
+        ring.head->loop_seq = 0;
+        ring.head->next_offset = ring.head->beg_offset = sizeof(BufferHead);
+        ring.head->elem_size = TOS_Topics::TypeSize(TOPIC) + sizeof(DateTimeStamp);
+        ring.head->end_offset = ring.head->beg_offset
+                              + ((config.ring_sz - ring.head->beg_offset) / ring.head->elem_size)
+                              * ring.head->elem_size;
+        ring.refs = 1;
+        ring.seq = 0;
+
+        _rings.insert(std::make_pair(item, ring));
+        return 0;
+    }
+
+    int
+    _remove(std::string item)
+    {
+        std::lock_guard<std::mutex> lock(_rings_mtx);
+
+        auto r = _rings.find(item);
+        if(r == _rings.end())
+            return TOSDB_ERROR_ENGINE_NO_ITEM;
+
+        if(--(r->second.refs) == 0){
+            UnmapViewOfFile(r->second.head);
+            CloseHandle(r->second.hfile);
+            CloseHandle(r->second.hmtx);
+            _rings.erase(r);
+        }
+        return 0;
+    }
+
+    int
+    _handle(const std::string& msg)
+    {
+        std::vector<std::string> args;
+        ParseArgs(args, msg);
+
+        if(args.empty())
+            return TOSDB_ERROR_IPC_MSG;
+
+        unsigned int op = (unsigned int)std::stoul(args[0]);
+        if(op == TOSDB_SIG_STOP){
+            _stop.store(true);
+            return TOSDB_SIG_GOOD;
+        }
+
+        if(args.size() != 4 || TOS_Topics::MAP()[args[1]] != TOPIC)
+            return TOSDB_ERROR_IPC_MSG;
+
+        switch(op){
+        case TOSDB_SIG_ADD:
+            return _add(args[2]);
+        case TOSDB_SIG_REMOVE:
+            return _remove(args[2]);
+        case TOSDB_SIG_TEST:
+            return 0;
+        default:
+            return TOSDB_SIG_BAD;
+        }
+    }
+
+    /* the engine's RunMainCommLoop, minus the logging */
+    void
+    _comm_loop()
+    {
+        std::string msg;
+
+        while(!_stop.load()){
+            if( !_slave.wait_for_master() )
+                break;
+
+            if( !_slave.recv(&msg) ){
+                _slave.drop_master();
+                continue;
+            }
+
+            int resp;
+            try{
+                resp = _handle(msg);
+            }catch(...){
+                resp = TOSDB_ERROR_IPC_MSG;
+            }
+
+            _slave.send(std::to_string(resp));
+            _slave.drop_master();
+        }
+    }
+
+public:
+    SimEngine()
+        :
+            _slave(TOSDB_COMM_CHANNEL),
+            _stop(false)
+        {
+            _comm_thread = std::thread(std::bind(&SimEngine::_comm_loop, this));
+        }
+
+    ~SimEngine()
+        {
+            /* a STOP gets the comm loop out of wait_for_master */
+            IPCMaster master(TOSDB_COMM_CHANNEL);
+            std::string msg = std::to_string(TOSDB_SIG_STOP);
+            master.call(&msg, TOSDB_DEF_TIMEOUT);
+
+            if(_comm_thread.joinable())
+                _comm_thread.join();
+
+            for(auto& r : _rings){
+                UnmapViewOfFile(r.second.head);
+                CloseHandle(r.second.hfile);
+                CloseHandle(r.second.hmtx);
+            }
+        }
+
+    /* RouteToBuffer from engine.cpp: 'n' ticks to each ring as one span, 
+       returns ticks written */
+    long long
+    write_all(int n)
+    {
+        std::lock_guard<std::mutex> lock(_rings_mtx);
+
+        for(auto& r : _rings){
+            pBufferHead head = r.second.head;
+            char* spot;
+
+            WaitForSingleObject(r.second.hmtx, INFINITE);
+            /* --- (INTER-PROCESS) CRITICAL SECTION --- */
+            unsigned int next = head->next_offset;
+            unsigned int loop_seq = head->loop_seq;
+            for(int i = 0; i < n; ++i){
+                spot = (char*)head + next;
+                *(ext_size_type*)spot = (ext_size_type)(r.second.seq++);
+                micro_to_stamp(now_micro(),
+                               (pDateTimeStamp)(spot + head->elem_size - sizeof(DateTimeStamp)));
+
+                if((next + head->elem_size) >= head->end_offset){
+                    next = head->beg_offset;
+                    ++loop_seq;
+                }else{
+                    next += head->elem_size;
+                }
+            }
+            head->loop_seq = loop_seq;
+            head->next_offset = next;
+            /* --- (INTER-PROCESS) CRITICAL SECTION --- */
+            ReleaseMutex(r.second.hmtx);
+        }
+
+        return (long long)_rings.size() * n;
+    }
+
+    size_t
+    nrings()
+    {
+        std::lock_guard<std::mutex> lock(_rings_mtx);
+        return _rings.size();
+    }
+};
+
+
+struct Stream{
+    std::string block;
+    std::string item;
+    long long last_seq;
+};
+
+struct ReaderStats{
+    long long delivered;
+    long long dropped;
+    long long dirty;
+    std::vector<long long> lat_us;
+
+    ReaderStats() : delivered(0), dropped(0), dirty(0) {}
+};
+
+/* returns ticks read */
+long long
+read_stream(Stream& s,
+            std::vector<ext_size_type>& vals,
+            std::vector<long long>& micros,
+            ReaderStats& stats)
+{
+    long get_size = 0;
+
+    int err = TOSDB_GetStreamSnapshotLongLongsFromMarkerWithEpoch(
+                  s.block.c_str(), s.item.c_str(), TOS_Topics::map[TOPIC].c_str(),
+                  &vals[0], (size_type)vals.size(), &micros[0], 0, &get_size);
+    if(err){
+        fprintf(stderr, "FromMarker failed for %s/%s (%d)\n", s.block.c_str(), s.item.c_str(), err);
+        return 0;
+    }
+
+    if(get_size < 0){
+        ++stats.dirty;
+        get_size *= -1;
+    }
+
+    long long now = now_micro();
+    for(long i = get_size - 1; i >= 0; --i){ /* oldest first */
+        long long seq = vals[i];
+        if(seq > s.last_seq + 1)
+            stats.dropped += seq - s.last_seq - 1;
+        s.last_seq = seq;
+        stats.lat_us.push_back(now - micros[i]);
+    }
+
+    stats.delivered += get_size;
+    return get_size;
+}
+
+void
+reader(std::vector<Stream*> streams, std::atomic<bool>* stop, ReaderStats* stats)
+{
+    std::vector<ext_size_type> vals(config.block_sz);
+    std::vector<long long> micros(config.block_sz);
+
+    while(!stop->load()){
+        long long n = 0;
+        for(Stream* s : streams)
+            n += read_stream(*s, vals, micros, *stats);
+        if(!n)
+            std::this_thread::yield();
+    }
+
+    for(Stream* s : streams) /* drain */
+        read_stream(*s, vals, micros, *stats);
+}
+
+
+long long
+percentile(const std::vector<long long>& sorted, double p)
+{
+    if(sorted.empty())
+        return 0;
+    size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+
+int
+main(int argc, char* argv[])
+{
+    if(argc > 1) config.streams = atoi(argv[1]);
+    if(argc > 2) config.blocks = atoi(argv[2]);
+    if(argc > 3) config.rate = atof(argv[3]);
+    if(argc > 4) config.secs = atoi(argv[4]);
+    if(argc > 5) config.readers = atoi(argv[5]);
+    if(argc > 6) config.latency = strtoul(argv[6], NULL, 10);
+    if(argc > 7) config.ring_sz = (unsigned int)strtoul(argv[7], NULL, 10);
+    if(argc > 8) config.block_sz = (size_type)strtoul(argv[8], NULL, 10);
+    if(argc > 9) config.burst = atoi(argv[9]);
+
+    if(config.streams < 1 || config.blocks < 1 || config.rate <= 0 || config.readers < 1
+       || config.burst < 1)
+    {
+        fprintf(stderr, "usage: e2e_bench [streams] [blocks] [rate] [secs] [readers] "
+                        "[latency] [ring_sz] [block_sz] [burst]\n");
+        return 1;
+    }
+
+    SimEngine engine;
+
+    if( TOSDB_Connect() || !TOSDB_IsConnectedToEngine() ){
+        fprintf(stderr, "client couldn't connect to the simulated engine "
+                        "(is the real one running?)\n");
+        return 1;
+    }
+
+    TOSDB_SetLatency((UpdateLatency)config.latency);
+
+    std::vector<std::string> items;
+    for(int i = 0; i < config.streams; ++i)
+        items.push_back("SIM" + std::to_string(i));
+
+    std::vector<Stream> streams;
+    for(int b = 0; b < config.blocks; ++b){
+        std::string id = BLOCK_PREFIX + std::to_string(b);
+        if( TOSDB_CreateBlock(id.c_str(), config.block_sz, TRUE, TOSDB_DEF_TIMEOUT) ){
+            fprintf(stderr, "failed to create block %s\n", id.c_str());
+            return 1;
+        }
+        TOSDB_AddTopic(id.c_str(), TOS_Topics::map[TOPIC].c_str());
+        for(auto& i : items){
+            if( TOSDB_AddItem(id.c_str(), i.c_str()) ){
+                fprintf(stderr, "failed to add %s to block %s\n", i.c_str(), id.c_str());
+                return 1;
+            }
+            Stream s = {id, i, -1};
+            streams.push_back(s);
+        }
+    }
+
+    if(engine.nrings() != items.size()){
+        fprintf(stderr, "expected %d rings, engine has %d\n", (int)items.size(), (int)engine.nrings());
+        return 1;
+    }
+
+    /* round-robin the streams over the readers */
+    std::atomic<bool> stop_readers(false);
+    std::vector<ReaderStats> stats(config.readers);
+    std::vector<std::thread> readers;
+    for(int r = 0; r < config.readers; ++r){
+        std::vector<Stream*> mine;
+        for(size_t s = r; s < streams.size(); s += config.readers)
+            mine.push_back(&streams[s]);
+        readers.push_back(std::thread(reader, mine, &stop_readers, &stats[r]));
+    }
+
+    /* the writer: keep each stream at 'rate' ticks/sec, in bursts if we fall behind */
+    using namespace std::chrono;
+    long long written = 0;
+    long long per_stream = 0;
+    long long writer_ns = 0;
+    auto tbeg = steady_clock::now();
+    auto tstop = tbeg + seconds(config.secs);
+    for(auto t = tbeg; t < tstop; t = steady_clock::now()){
+        long long due = (long long)(duration<double>(t - tbeg).count() * config.rate);
+        if(per_stream >= due){
+            std::this_thread::sleep_for(microseconds(std::max(1LL, (long long)(1e6 / config.rate / 2))));
+            continue;
+        }
+        auto wbeg = steady_clock::now();
+        while(per_stream < due){
+            int n = (int)std::min<long long>(config.burst, due - per_stream);
+            written += engine.write_all(n);
+            per_stream += n;
+        }
+        writer_ns += duration_cast<nanoseconds>(steady_clock::now() - wbeg).count();
+    }
+    double elapsed = duration<double>(steady_clock::now() - tbeg).count();
+
+    /* let the extract loop and readers catch up, then account for the tail */
+    std::this_thread::sleep_for(milliseconds(2 * config.latency + 250));
+    stop_readers.store(true);
+    for(auto& t : readers)
+        t.join();
+
+    ReaderStats total;
+    for(auto& s : stats){
+        total.delivered += s.delivered;
+        total.dropped += s.dropped;
+        total.dirty += s.dirty;
+        total.lat_us.insert(total.lat_us.end(), s.lat_us.begin(), s.lat_us.end());
+    }
+    for(auto& s : streams){
+        if(s.last_seq + 1 < per_stream)
+            total.dropped += per_stream - s.last_seq - 1;
+    }
+    std::sort(total.lat_us.begin(), total.lat_us.end());
+
+    for(int b = 0; b < config.blocks; ++b)
+        TOSDB_CloseBlock((BLOCK_PREFIX + std::to_string(b)).c_str());
+    TOSDB_Disconnect();
+
+    long long expected = written * config.blocks;
+    double tps = total.delivered / elapsed;
+    double wns = written ? (double)writer_ns / written : 0;
+
+    printf("streams: %d x %d blocks, %.0f ticks/sec/stream for %.2f sec, %d readers, "
+           "latency %lu ms, ring %u bytes, block %u, burst %d\n",
+           config.streams, config.blocks, config.rate, elapsed, config.readers,
+           config.latency, config.ring_sz, config.block_sz, config.burst);
+    printf("written: %lld (x%d blocks = %lld)  delivered: %lld  dropped: %lld  dirty reads: %lld\n",
+           written, config.blocks, expected, total.delivered, total.dropped, total.dirty);
+    printf("throughput: %.1f ticks/sec delivered\n", tps);
+    printf("writer: %.1f nsec/tick\n", wns);
+    printf("latency (usec): p50 %lld  p90 %lld  p99 %lld  p99.9 %lld  max %lld\n",
+           percentile(total.lat_us, .5), percentile(total.lat_us, .9),
+           percentile(total.lat_us, .99), percentile(total.lat_us, .999),
+           total.lat_us.empty() ? 0LL : total.lat_us.back());
+
+    printf("{\"streams\":%d,\"blocks\":%d,\"rate\":%.0f,\"readers\":%d,\"latency_ms\":%lu,"
+           "\"ring_sz\":%u,\"block_sz\":%u,\"burst\":%d,\"secs\":%.2f,\"written\":%lld,"
+           "\"delivered\":%lld,\"dropped\":%lld,\"dirty\":%lld,\"ticks_per_sec\":%.1f,"
+           "\"writer_ns_tick\":%.1f,"
+           "\"lat_us\":{\"p50\":%lld,\"p90\":%lld,\"p99\":%lld,\"p999\":%lld,\"max\":%lld}}\n",
+           config.streams, config.blocks, config.rate, config.readers, config.latency,
+           config.ring_sz, config.block_sz, config.burst, elapsed, written, total.delivered,
+           total.dropped, total.dirty, tps, wns,
+           percentile(total.lat_us, .5), percentile(total.lat_us, .9),
+           percentile(total.lat_us, .99), percentile(total.lat_us, .999),
+           total.lat_us.empty() ? 0LL : total.lat_us.back());
+
+    return (total.delivered + total.dropped == expected) ? 0 : 2;
+}
@@ -0,0 +1,235 @@
+/* hot-standby failover (failover.hpp) against simulated engines.
+
+   Two 'engines' get the same feed and write it into their own rings - a
+   BufferHead and the slots after it, like CreateBuffer's - each stamping
+   ticks with its own,
+   slightly different, clock. Each has a FailoverMonitor on a shared
+   EngineControl driven by a fake clock. A reader does what the client's
+   extract loop does. The primary dies mid-feed; the standby has to take
+   over once the heartbeat goes stale, and the reader, moving to its ring
+   with RingResumeCursor, has to get every tick exactly once. */
+
+#define THIS_IMPORTS_IMPLEMENTATION /* for BufferHead; nothing's linked */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "tos_databridge.h"
+#include "failover.hpp"
+#include "test_checks.hpp"
+
+
+struct Elem{
+    int seq;
+    long long stamp; /* where the engine puts its DateTimeStamp */
+};
+
+
+/* one engine's buffer for one stream */
+struct Ring{
+    std::vector<char> mem;
+
+    Ring(unsigned int nslots)
+        : mem(sizeof(BufferHead) + nslots * sizeof(Elem))
+    {
+        BufferHead *h = head();
+        h->loop_seq = 0;
+        h->elem_size = sizeof(Elem);
+        h->dict_offset = 0;
+        h->next_offset = h->beg_offset = sizeof(BufferHead); /* > elem_size */
+        h->end_offset = h->beg_offset + nslots * h->elem_size;
+    }
+
+    BufferHead*
+    head()
+    {
+        return (BufferHead*)&mem[0];
+    }
+
+    Elem*
+    at(unsigned int offset)
+    {
+        return (Elem*)&mem[offset];
+    }
+
+    /* what the engine's write does */
+    void
+    write(int seq, long long stamp)
+    {
+        BufferHead *h = head();
+        Elem *e = at(h->next_offset);
+        e->seq = seq;
+        e->stamp = stamp;
+        unsigned int loop_seq = h->loop_seq;
+        h->next_offset = RingNextOffset(h, h->next_offset, &loop_seq);
+        h->loop_seq = loop_seq;
+    }
+};
+
+
+/* the client's side: a cursor into one ring (what _extractFromBuffer keeps) */
+struct Reader{
+    Ring *ring;
+    unsigned int cur_offset;
+    unsigned int cur_loop_seq;
+    std::vector<int> got;
+
+    Reader(Ring *r) : ring(r), cur_offset(0), cur_loop_seq(0) {}
+
+    void
+    read()
+    {
+        BufferHead *h = ring->head();
+        long long nelems = RingNewElements(h, cur_offset, cur_loop_seq);
+        for( ; nelems > 0; --nelems) /* oldest first */
+            got.push_back( ring->at(RingElementOffset(h, h->next_offset, (unsigned int)nelems))->seq );
+
+        cur_offset = h->next_offset - h->beg_offset;
+        cur_loop_seq = h->loop_seq;
+    }
+
+    /* what _remapBuffer does */
+    unsigned int
+    move_to(Ring *r)
+    {
+        Ring *old = ring;
+        Elem last = *old->at( RingElementOffset(old->head(), old->head()->beg_offset
+                                                + cur_offset, 1) );
+        ring = r;
+        return RingResumeCursor(r->head(),
+                                [&](unsigned int offset){
+                                    Elem *e = r->at(offset);
+                                    return FailoverNewer(e->stamp, last.stamp, e->seq == last.seq);
+                                },
+                                &cur_offset, &cur_loop_seq);
+    }
+};
+
+
+/* every tick exactly once, in order */
+bool
+exactly_once(const std::vector<int>& got, int n)
+{
+    if((int)got.size() != n)
+        return false;
+    for(int i = 0; i < n; ++i){
+        if(got[i] != i)
+            return false;
+    }
+    return true;
+}
+
+
+int
+main()
+{
+    printf("-- ring offsets\n");
+    {
+        Ring r(4);
+        BufferHead *h = r.head();
+        for(int i = 0; i < 6; ++i)
+            r.write(i, i);
+        CHECK(h->loop_seq == 1);
+        CHECK(r.at( RingElementOffset(h, h->next_offset, 1) )->seq == 5);
+        CHECK(r.at( RingElementOffset(h, h->next_offset, 4) )->seq == 2);
+
+        unsigned int off, loop;
+        CHECK(RingResumeCursor(h, [&](unsigned int o){ return r.at(o)->stamp > 3; },
+                               &off, &loop) == 2);
+        Reader rd(&r);
+        rd.cur_offset = off;
+        rd.cur_loop_seq = loop;
+        rd.read();
+        CHECK(rd.got.size() == 2 && rd.got[0] == 4 && rd.got[1] == 5);
+    }
+
+    printf("-- monitor: take-over only after the timeout, and only if healthy\n");
+    {
+        EngineControl ctrl;
+        memset((void*)&ctrl, 0, sizeof(ctrl)); /* a new segment */
+        unsigned long long now = 0;
+        FailoverMonitor primary(&ctrl, 0, now);
+        FailoverMonitor standby(&ctrl, 1, now);
+
+        for( ; now < 2000; now += FAILOVER_HEARTBEAT){
+            CHECK(primary.beat(now) == FailoverMonitor::NONE || now == 0);
+            standby.beat(now);
+        }
+        CHECK(primary.active() && !standby.active());
+
+        /* primary stops beating; a sick standby waits */
+        for(int i = 0; i < 20; ++i, now += FAILOVER_HEARTBEAT)
+            CHECK(standby.beat(now, false) == FailoverMonitor::NONE);
+        CHECK(ctrl.active.load() == 0 && ctrl.generation.load() == 0);
+
+        FailoverMonitor::Event ev = FailoverMonitor::NONE;
+        unsigned long long t0 = now;
+        for( ; ev == FailoverMonitor::NONE && now < t0 + 5000; now += FAILOVER_HEARTBEAT)
+            ev = standby.beat(now);
+        CHECK(ev == FailoverMonitor::PROMOTED);
+        CHECK(ctrl.active.load() == 1 && ctrl.generation.load() == 1);
+
+        /* the old primary comes back as the standby */
+        CHECK(primary.beat(now) == FailoverMonitor::DEMOTED);
+        for(int i = 0; i < 30; ++i, now += FAILOVER_HEARTBEAT){
+            standby.beat(now);
+            CHECK(primary.beat(now) == FailoverMonitor::NONE);
+        }
+        CHECK(ctrl.active.load() == 1 && ctrl.generation.load() == 1);
+    }
+
+    printf("-- primary dies mid-feed; reader follows the standby\n");
+    {
+        const int NTICKS = 5000;
+        const unsigned long long DIES = 3000; /* msec */
+
+        EngineControl ctrl;
+        memset((void*)&ctrl, 0, sizeof(ctrl));
+        FailoverMonitor primary(&ctrl, 0, 0);
+        FailoverMonitor standby(&ctrl, 1, 0);
+
+        Ring rings[2] = { Ring(4096), Ring(4096) };
+        Reader reader(&rings[0]);
+        unsigned int gen = 0;
+        unsigned int resumed = 0;
+        unsigned long long switched = 0;
+
+        /* a tick every 2 msec; each engine stamps it (micro-seconds) with a
+           bit of its own jitter, the standby's usually later */
+        for(int seq = 0; seq < NTICKS; ++seq){
+            unsigned long long now = seq * 2;
+            long long t = (long long)now * 1000;
+
+            if(now < DIES)
+                rings[0].write(seq, t + (seq * 7) % 300);
+            rings[1].write(seq, t + 150 + (seq * 13) % 300);
+
+            if(now % FAILOVER_HEARTBEAT == 0){
+                if(now < DIES)
+                    primary.beat(now);
+                standby.beat(now);
+            }
+
+            if(now % 30 == 0){ /* the extract loop */
+                reader.read();
+                if(ctrl.generation.load() != gen){
+                    gen = ctrl.generation.load();
+                    resumed = reader.move_to(&rings[ctrl.active.load()]);
+                    switched = now;
+                }
+            }
+        }
+        reader.read();
+
+        CHECK(ctrl.active.load() == 1 && gen == 1);
+        CHECK(switched + FAILOVER_HEARTBEAT >= DIES + FAILOVER_TIMEOUT);
+        CHECK(switched < DIES + 2 * FAILOVER_TIMEOUT);
+        printf("      (took over after %llu msec, %u ticks resumed from the standby)\n",
+               switched - DIES, resumed);
+        CHECK(resumed > 0);
+        CHECK(exactly_once(reader.got, NTICKS));
+    }
+
+    return CHECKS_RESULT();
+}
@@ -0,0 +1,221 @@
+/*
+   wake-up/run jitter of a periodic thread, with and without thread_sched.hpp
+
+   A 'loop' thread stands in for _threadedExtractLoop (or the engine's message
+   thread): every 'period' it wakes up and does a fixed chunk of work. NOISE
+   threads spin on all the CPUs, like busy strategy threads would. For each
+   period we record how late the wake-up was and how long the work took; both
+   blow up when the loop thread is waiting for a CPU or gets preempted.
+
+   Three runs of 'secs' each:
+
+     float    : everything left to the scheduler
+     priority : the loop thread at 'priority' (SetThreadSchedule, no mask)
+     pinned   : the loop thread on 'cpu' at 'priority', the noise threads on
+                every other CPU - what a thread config file gives you when the
+                rest of the process is kept off the pinned core
+
+   Prints a summary and one JSON line per run:
+
+     {"run":"pinned","period_us":1000,"noise":8,"cpu":2,"priority":3,"n":5000,
+      "late_us":{"p50":..,"p99":..,"p999":..,"max":..},
+      "work_us":{"p50":..,"p99":..,"p999":..,"max":..},"err":0}
+
+   args (all optional, in order):
+     secs      - length of each run                           default 5
+     period_us - loop period (microseconds)                   default 1000
+     noise     - spinning threads (0 = one per CPU)           default 0
+     cpu       - CPU the loop thread is pinned to             default 1
+     priority  - thread_sched.hpp priority name               default realtime
+
+   'err' is SetThreadSchedule's return: with pthreads 'realtime'/'highest'
+   need CAP_SYS_NICE (or root), otherwise that part is a no-op.
+
+   linux:   g++ -std=c++11 -O2 -I../../include jitter_bench.cpp -pthread -o jitter_bench
+   windows: cl /EHsc /O2 /I..\..\include jitter_bench.cpp
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "thread_sched.hpp"
+
+typedef std::chrono::steady_clock clock_type;
+
+struct Config{
+    int secs;
+    long period_us;
+    int noise;
+    int cpu;
+    int priority;
+};
+
+static Config config = {5, 1000, 0, 1, TOSDB_THREAD_PRI_REALTIME};
+
+struct Result{
+    std::vector<long long> late_us;
+    std::vector<long long> work_us;
+    int err;
+};
+
+static volatile double sink = 0;
+
+
+long long
+micros(clock_type::duration d)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+
+/* about as much as moving a few hundred ticks out of the shared buffers */
+void
+work()
+{
+    double x = 1.0;
+    for(int i = 0; i < 20000; ++i)
+        x = x * 1.0000001 + 0.5 / (i + 1);
+    sink = x;
+}
+
+
+void
+spin(std::atomic<bool>* stop, unsigned long long cpu_mask)
+{
+    if(cpu_mask)
+        SetThreadSchedule(CurrentNativeThread(), cpu_mask, TOSDB_THREAD_PRI_UNCHANGED);
+
+    double x = 1.0;
+    while( !stop->load(std::memory_order_relaxed) )
+        x = x * 0.9999999 + 1.0;
+    sink = x;
+}
+
+
+void
+loop(std::string run, Result* res)
+{
+    res->err = 0;
+    if(run == "priority")
+        res->err = SetThreadSchedule(CurrentNativeThread(), 0, config.priority);
+    else if(run == "pinned")
+        res->err = SetThreadSchedule(CurrentNativeThread(), 1ULL << config.cpu, config.priority);
+
+    clock_type::duration period = std::chrono::microseconds(config.period_us);
+    clock_type::time_point end = clock_type::now() + std::chrono::seconds(config.secs);
+    clock_type::time_point next = clock_type::now() + period;
+
+    while(next < end){
+        std::this_thread::sleep_until(next);
+        clock_type::time_point woke = clock_type::now();
+        work();
+        res->late_us.push_back(micros(woke - next));
+        res->work_us.push_back(micros(clock_type::now() - woke));
+        next += period;
+        if(next < woke) /* don't try to catch up */
+            next = woke + period;
+    }
+}
+
+
+Result
+measure(std::string run, int ncpus)
+{
+    Result res;
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> noise;
+
+    /* everything but the pinned cpu (only matters for the 'pinned' run) */
+    unsigned long long others = 0;
+    if(run == "pinned"){
+        for(int i = 0; i < ncpus && i < 64; ++i){
+            if(i != config.cpu)
+                others |= (1ULL << i);
+        }
+    }
+
+    for(int i = 0; i < config.noise; ++i)
+        noise.push_back( std::thread(spin, &stop, others) );
+
+    std::thread t(loop, run, &res);
+    t.join();
+
+    stop.store(true);
+    for(std::thread& n : noise)
+        n.join();
+
+    std::sort(res.late_us.begin(), res.late_us.end());
+    std::sort(res.work_us.begin(), res.work_us.end());
+    return res;
+}
+
+
+long long
+percentile(const std::vector<long long>& sorted, double p)
+{
+    if(sorted.empty())
+        return 0;
+    size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+
+void
+report(std::string run, const Result& res)
+{
+    const std::vector<long long>& l = res.late_us;
+    const std::vector<long long>& w = res.work_us;
+
+    printf("%-9s late (usec): p50 %lld  p99 %lld  p99.9 %lld  max %lld\n"
+           "          work (usec): p50 %lld  p99 %lld  p99.9 %lld  max %lld%s\n",
+           run.c_str(), percentile(l, .5), percentile(l, .99), percentile(l, .999),
+           percentile(l, 1), percentile(w, .5), percentile(w, .99), percentile(w, .999),
+           percentile(w, 1), res.err ? "  (SetThreadSchedule failed)" : "");
+
+    printf("{\"run\":\"%s\",\"period_us\":%ld,\"noise\":%d,\"cpu\":%d,\"priority\":%d,"
+           "\"n\":%u,\"late_us\":{\"p50\":%lld,\"p99\":%lld,\"p999\":%lld,\"max\":%lld},"
+           "\"work_us\":{\"p50\":%lld,\"p99\":%lld,\"p999\":%lld,\"max\":%lld},\"err\":%d}\n",
+           run.c_str(), config.period_us, config.noise, config.cpu, config.priority,
+           (unsigned int)l.size(), percentile(l, .5), percentile(l, .99), percentile(l, .999),
+           percentile(l, 1), percentile(w, .5), percentile(w, .99), percentile(w, .999),
+           percentile(w, 1), res.err);
+}
+
+
+int
+main(int argc, char* argv[])
+{
+    int ncpus = (int)std::thread::hardware_concurrency();
+    if(ncpus < 1)
+        ncpus = 1;
+
+    if(argc > 1) config.secs = atoi(argv[1]);
+    if(argc > 2) config.period_us = atol(argv[2]);
+    if(argc > 3) config.noise = atoi(argv[3]);
+    if(argc > 4) config.cpu = atoi(argv[4]);
+    if(argc > 5 && !ParseThreadPriority(argv[5], &config.priority)){
+        fprintf(stderr, "bad priority: %s\n", argv[5]);
+        return 1;
+    }
+
+    if(config.noise <= 0)
+        config.noise = ncpus;
+
+    if(config.cpu >= ncpus || config.cpu >= 64)
+        config.cpu = ncpus - 1;
+
+    printf("cpus: %d  noise threads: %d  period: %ld usec  run: %d sec\n\n",
+           ncpus, config.noise, config.period_us, config.secs);
+
+    const char* runs[] = {"float", "priority", "pinned"};
+    for(int i = 0; i < 3; ++i)
+        report(runs[i], measure(runs[i], ncpus));
+
+    return 0;
+}
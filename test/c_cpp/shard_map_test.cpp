@@ -0,0 +1,75 @@
+/* ShardMap (shard_map.hpp): the order a stream's shard is picked in (item
+   assignment, topic assignment, hash of the item), that the hash keeps an
+   item's topics together and spreads items over the shards, and reading a
+   shard map file. */
+
+#include <stdio.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "shard_map.hpp"
+#include "test_checks.hpp"
+
+
+int
+main()
+{
+    ShardMap m;
+
+    printf("-- one shard: everything on 0\n");
+    CHECK(m.count() == 1);
+    CHECK(m.route("LAST", "SPY") == 0 && m.route("BID", "QQQ") == 0);
+    CHECK(!m.set_count(0) && !m.set_count(TOSDB_MAX_SHARDS + 1));
+
+    printf("-- hash: same shard for every topic of an item, all shards used\n");
+    CHECK(m.set_count(4));
+    CHECK(m.route("LAST", "SPY") == m.route("BID", "SPY"));
+    CHECK(m.route("LAST", "SPY") == m.route("VOLUME", "SPY"));
+    std::vector<int> used(4, 0);
+    for(int i = 0; i < 400; ++i)
+        ++used[ m.route("LAST", "ITEM" + std::to_string(i)) ];
+    CHECK(used[0] > 50 && used[1] > 50 && used[2] > 50 && used[3] > 50);
+
+    printf("-- assignments: item beats topic beats hash\n");
+    m.assign_topic("LAST", 3);
+    m.assign_item("SPY", 1);
+    CHECK(m.route("LAST", "QQQ") == 3);
+    CHECK(m.route("LAST", "SPY") == 1 && m.route("BID", "SPY") == 1);
+    m.assign_item("SPY", TOSDB_MAX_SHARDS); /* remove */
+    CHECK(m.route("LAST", "SPY") == 3);
+
+    printf("-- assignments past the shard count route by hash\n");
+    m.assign_topic("BID", 7);
+    CHECK(m.route("BID", "QQQ") == m.route("ASK", "QQQ"));
+
+    printf("-- shard map file\n");
+    {
+        std::ofstream f("shard_map_test.cfg");
+        f << "# test map\n"
+          << "shards 3\n"
+          << "\n"
+          << "topic  LAST  2   # trailing comment\n"
+          << "item   SPY   0\n";
+    }
+    ShardMap fm;
+    std::string err;
+    CHECK(ReadShardMap("shard_map_test.cfg", &fm, &err));
+    CHECK(fm.count() == 3);
+    CHECK(fm.route("LAST", "QQQ") == 2 && fm.route("LAST", "SPY") == 0);
+
+    {
+        std::ofstream f("shard_map_test.cfg");
+        f << "shards 2\n"
+          << "topic LAST\n";
+    }
+    ShardMap bad;
+    CHECK(!ReadShardMap("shard_map_test.cfg", &bad, &err) && err.find(":2:") != std::string::npos);
+    CHECK(bad.count() == 1); /* untouched */
+    printf("      (%s)\n", err.c_str());
+    remove("shard_map_test.cfg");
+
+    CHECK(!ReadShardMap("no_such_shard_map.cfg", &bad, &err));
+
+    return CHECKS_RESULT();
+}
@@ -0,0 +1,164 @@
+/* the segments of a shared block (shared_block.hpp).
+
+   A stream's SharedRing has to give back what was pushed, newest first, and
+   drop what the owner overwrote after a read started, whether the
+   secondaries go to an array or a sink. A writer thread then pushes into a
+   ring while a reader copies out of it, the way an attached block's Get
+   calls do: the reader must never get an element that's torn or out of
+   order. Last, the block directory: a reader gets what the owner
+   lists and can tell when it's mid-change. */
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "shared_block.hpp"
+#include "test_checks.hpp"
+
+
+int
+main()
+{
+    printf("-- pushes come back newest first\n");
+    {
+        const unsigned int BOUND = 4;
+        std::vector<char> mem(SharedRing<long, long long>::SegmentSize(BOUND));
+        SharedRing<long, long long> ring(&mem[0]);
+        ring.create(BOUND);
+        CHECK(ring.matches(BOUND) && !ring.matches(BOUND + 1));
+        SharedRing<std::string, long long> other(&mem[0]); /* another type */
+        CHECK(!other.matches(BOUND));
+
+        long vals[BOUND];
+        long long secs[BOUND];
+        CHECK(ring.read_latest(0, BOUND - 1, vals, secs) == 0);
+
+        for(long i = 0; i < 2; ++i)
+            ring.push(i, i * 10);
+        CHECK(ring.read_latest(0, BOUND - 1, vals, secs) == 2);
+        CHECK(vals[0] == 1 && vals[1] == 0 && secs[0] == 10 && secs[1] == 0);
+
+        for(long i = 2; i < 11; ++i)
+            ring.push(i, i * 10);
+        unsigned long long at;
+        CHECK(ring.read_latest(1, BOUND - 1, vals, NULL, &at) == 3 && at == 11);
+        CHECK(vals[0] == 9 && vals[1] == 8 && vals[2] == 7);
+
+        /* as of 8 pushed (elements 7..4); 11 pushed since, so 6 and older
+           may have been overwritten */
+        CHECK(ring.read(8, 0, 3, vals, secs) == 1);
+        CHECK(vals[0] == 7 && secs[0] == 70);
+        CHECK(ring.read(6, 0, 3, vals, secs) == 0);
+        CHECK(ring.read(11, 3, 2, vals, secs) == 0);
+
+        /* secondaries through a sink instead of an array, same ones good */
+        struct Halve{
+            long long *dest;
+            void operator()(size_t i, long long sec) const { dest[i] = sec / 2; }
+        } halve = {secs};
+        CHECK(ring.read_latest_into(0, 1, vals, halve) == 2);
+        CHECK(vals[0] == 10 && secs[0] == 50 && vals[1] == 9 && secs[1] == 45);
+        CHECK(ring.read_into(8, 0, 3, vals, halve) == 1 && secs[0] == 35);
+    }
+
+    printf("-- strings are truncated\n");
+    {
+        std::vector<char> mem(SharedRing<std::string, int>::SegmentSize(2));
+        SharedRing<std::string, int> ring(&mem[0]);
+        ring.create(2);
+        ring.push("NYSE", 1);
+        ring.push(std::string(2 * TOSDB_STR_DATA_SZ, 'x'), 2);
+        std::string vals[2];
+        CHECK(ring.read_latest(0, 1, vals, NULL) == 2);
+        CHECK(vals[0].size() == TOSDB_STR_DATA_SZ - 1 && vals[1] == "NYSE");
+    }
+
+    printf("-- a reader racing the owner never gets a torn element\n");
+    {
+        const unsigned int BOUND = 64;
+        const long long NPUSH = 2000000;
+
+        struct Elem{ long long a, b; }; /* b is always -a */
+        std::vector<char> mem(SharedRing<long long, Elem>::SegmentSize(BOUND));
+        SharedRing<long long, Elem> ring(&mem[0]);
+        ring.create(BOUND);
+
+        std::atomic<bool> started(false), done(false);
+        long long nreads = 0, ngot = 0, nbad = 0, nshort = 0;
+
+        std::thread reader([&](){
+            long long vals[BOUND];
+            Elem secs[BOUND];
+            while(!done.load()){
+                unsigned long long at;
+                size_t n = ring.read_latest(0, BOUND - 1, vals, secs, &at);
+                ++nreads;
+                ngot += n;
+                started.store(true);
+                if(at >= BOUND && n < BOUND)
+                    ++nshort;
+                for(size_t i = 0; i < n; ++i){
+                    if(vals[i] != (long long)(at - 1 - i)
+                       || secs[i].a != vals[i] || secs[i].b != -vals[i])
+                    {
+                        ++nbad;
+                    }
+                }
+            }
+        });
+
+        while(!started.load())
+            std::this_thread::yield();
+        for(long long i = 0; i < NPUSH; ++i){
+            Elem e = {i, -i};
+            ring.push(i, e);
+        }
+        done.store(true);
+        reader.join();
+
+        printf("      (%lld reads, %lld elements, %lld cut short)\n", nreads, ngot, nshort);
+        CHECK(nreads > 0 && ngot > 0);
+        CHECK(nbad == 0);
+        CHECK(ring.count() == (unsigned long long)NPUSH);
+    }
+
+    printf("-- the directory\n");
+    {
+        SharedBlockDir *dir = new SharedBlockDir();
+        memset((void*)dir, 0, sizeof(SharedBlockDir));
+
+        std::vector<std::string> items, got_items;
+        std::vector<unsigned int> topics, got_topics;
+        unsigned int version = 99;
+
+        CHECK(SharedBlockDirRead(dir, &got_items, &got_topics, &version));
+        CHECK(version == 0 && got_items.empty() && got_topics.empty());
+
+        items.push_back("SPY");
+        items.push_back("QQQ");
+        topics.push_back(0x19);
+        CHECK(SharedBlockDirWrite(dir, items, topics));
+        CHECK(SharedBlockDirRead(dir, &got_items, &got_topics, &version));
+        CHECK(version == 2 && got_items == items && got_topics == topics);
+
+        /* mid-change */
+        dir->version.store(3);
+        CHECK(!SharedBlockDirRead(dir, &got_items, &got_topics, &version));
+        dir->version.store(4);
+
+        std::vector<std::string> too_many(SHARED_BLOCK_MAX_ITEMS + 1, "X");
+        CHECK(!SharedBlockDirWrite(dir, too_many, topics));
+        CHECK(dir->version.load() == 4);
+
+        items.pop_back();
+        CHECK(SharedBlockDirWrite(dir, items, std::vector<unsigned int>()));
+        CHECK(SharedBlockDirRead(dir, &got_items, &got_topics, &version));
+        CHECK(version == 6 && got_items == items && got_topics.empty());
+
+        delete dir;
+    }
+
+    return CHECKS_RESULT();
+}
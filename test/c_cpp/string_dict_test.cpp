@@ -0,0 +1,107 @@
+/* StringDictWriter/Reader (string_dict.hpp): a repeated value keeps its
+   code, a slot is only reused once the ring no longer refers to it and its
+   old code then goes stale, more values than the dictionary holds go
+   inline instead of being lost, and long values are truncated like the
+   engine's ValToBuf. */
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "string_dict.hpp"
+#include "test_checks.hpp"
+
+#define RING_SLOTS 100
+
+
+int
+main()
+{
+    StringDict dict;
+    StringDictWriter w(&dict, RING_SLOTS);
+    StringDictReader r;
+    StringDictReader early; /* only ever sees the first codes */
+
+    printf("-- repeated values keep their code\n");
+    unsigned int q = w.encode("Q");
+    unsigned int n = w.encode("N");
+    CHECK(q != n && q != STRING_DICT_INLINE && n != STRING_DICT_INLINE);
+    CHECK(w.encode("Q") == q && w.encode("N") == n);
+    CHECK(w.size() == 2 && w.inlined() == 0);
+    CHECK(r.lookup(&dict, q) && *r.lookup(&dict, q) == "Q");
+    CHECK(r.lookup(&dict, n) && *r.lookup(&dict, n) == "N");
+    CHECK(!r.lookup(&dict, q + TOSDB_DICT_CODES)); /* not handed out yet */
+    CHECK(!r.lookup(&dict, STRING_DICT_INLINE));
+    CHECK(early.lookup(&dict, q) != NULL);
+
+    printf("-- more values than slots while the ring still refers to them go inline\n");
+    bool coded = true;
+    for(int i = 0; i < TOSDB_DICT_CODES - 2; ++i) /* ticks 5 - 66 */
+        coded = coded && w.encode("V" + std::to_string(i)) != STRING_DICT_INLINE;
+    CHECK(coded && w.size() == TOSDB_DICT_CODES);
+    CHECK(w.encode("X") == STRING_DICT_INLINE && w.inlined() == 1);
+    CHECK(w.encode("X") == STRING_DICT_INLINE && w.inlined() == 2);
+    CHECK(w.encode("N") == n); /* the ones it has still work; tick 69 */
+
+    StringDict at_inline = dict; /* what a reader saw then */
+
+    printf("-- once the ring has moved past a value its slot is reused\n");
+    for(int i = 0; i < 33; ++i) /* ticks 70 - 102; 'Q' (3) is out of the ring */
+        w.encode("N");
+    unsigned int x = w.encode("X");
+    CHECK(x != STRING_DICT_INLINE && w.inlined() == 2);
+    CHECK(x % TOSDB_DICT_CODES == q % TOSDB_DICT_CODES); /* the oldest slot */
+    CHECK(w.size() == TOSDB_DICT_CODES);
+    CHECK(r.lookup(&dict, x) && *r.lookup(&dict, x) == "X");
+    CHECK(!r.lookup(&dict, q)); /* stale, even though r had it cached */
+    CHECK(!early.lookup(&dict, q));
+    CHECK(early.lookup(&at_inline, q) && *early.lookup(&at_inline, q) == "Q");
+
+    CHECK(w.encode("Q") == STRING_DICT_INLINE); /* 'V0' (5) is still in it */
+    w.encode("N");
+    unsigned int q2 = w.encode("Q"); /* tick 106: now it isn't */
+    CHECK(q2 != q && q2 != STRING_DICT_INLINE && w.inlined() == 3);
+    CHECK(r.lookup(&dict, q2) && *r.lookup(&dict, q2) == "Q");
+
+    printf("-- Store/Load round trip through an element, coded and inline\n");
+    {
+        char elem[STRING_DICT_ELEM_SZ];
+        std::string out;
+        StringDictStore(elem, &w, "N");
+        CHECK(*(unsigned int*)elem == n);
+        CHECK(StringDictLoad(elem, &dict, &r, &out) && out == "N");
+
+        StringDict d;
+        StringDictWriter wd(&d, 1000);
+        StringDictReader rd;
+        bool all = true;
+        for(int i = 0; i < 2 * TOSDB_DICT_CODES; ++i){
+            std::string v = "S" + std::to_string(i);
+            StringDictStore(elem, &wd, v);
+            all = all && StringDictLoad(elem, &d, &rd, &out) && out == v;
+        }
+        CHECK(all);
+        CHECK(wd.inlined() == TOSDB_DICT_CODES);
+
+        printf("-- long values are truncated, coded and inline\n");
+        std::string big(2 * TOSDB_STR_DATA_SZ, 'x');
+        StringDictStore(elem, &wd, big);
+        CHECK(*(unsigned int*)elem == STRING_DICT_INLINE);
+        CHECK(StringDictLoad(elem, &d, &rd, &out) && out == big.substr(0, TOSDB_STR_DATA_SZ - 1));
+
+        StringDict db;
+        StringDictWriter wb(&db, RING_SLOTS);
+        StringDictReader rb;
+        unsigned int b = wb.encode(big);
+        CHECK(wb.encode(big.substr(0, TOSDB_STR_DATA_SZ - 1)) == b);
+        CHECK(rb.lookup(&db, b) && rb.lookup(&db, b)->size() == TOSDB_STR_DATA_SZ - 1);
+    }
+
+    printf("-- a new writer starts the dictionary over\n");
+    StringDictWriter w2(&dict, RING_SLOTS);
+    CHECK(w2.size() == 0 && w2.inlined() == 0);
+    CHECK(!r.lookup(&dict, n));
+    CHECK(w2.encode("Q") != STRING_DICT_INLINE);
+
+    return CHECKS_RESULT();
+}
@@ -0,0 +1,26 @@
+/*
+   checks for the unit tests of the header-only parts (*_test.cpp)
+
+   CHECK(cond) prints the condition and whether it held; main() ends with
+   'return CHECKS_RESULT();', which prints the tally and is non-zero if any
+   check failed. TestBuild.bat builds and runs each test in UNITtests.
+*/
+
+#ifndef JO_TOSDB_TEST_CHECKS
+#define JO_TOSDB_TEST_CHECKS
+
+#include <stdio.h>
+
+static int nfailed = 0;
+
+#define CHECK(cond) do{ \
+    bool ok_ = (cond); \
+    printf("%s  %s\n", ok_ ? "ok  " : "FAIL", #cond); \
+    if(!ok_) ++nfailed; \
+}while(0)
+
+#define CHECKS_RESULT() \
+    (printf("\n%s (%d failed)\n", nfailed ? "FAILED" : "PASSED", nfailed), \
+     nfailed ? 1 : 0)
+
+#endif /* JO_TOSDB_TEST_CHECKS */
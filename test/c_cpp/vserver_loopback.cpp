@@ -0,0 +1,459 @@
+/*
+   loopback test for the virtualization server/client (no engine or TOS needed)
+
+   runs a VServer with a fake in-memory handler on an ephemeral port and drives
+   it through VClient/VRemoteBlock, including pipelined requests; then
+   multicasts ticks over loopback (239.255.42.99) with some datagrams
+   'lost' and checks VMcastReceiver recovers them
+
+   'vserver_loopback --dump <file> [n]' instead writes the reply bodies
+   test/python/vnative_bench.py times (see dump_bodies)
+
+   linux:   g++ -std=c++11 -I../../include vserver_loopback.cpp ../../src/vserver/net.cpp
+                ../../src/vserver/vserver.cpp ../../src/vserver/vclient.cpp
+                ../../src/vserver/vmulticast.cpp -pthread
+   windows: cl /EHsc /I..\..\include vserver_loopback.cpp ..\..\src\vserver\net.cpp
+                ..\..\src\vserver\vserver.cpp ..\..\src\vserver\vclient.cpp
+                ..\..\src\vserver\vmulticast.cpp
+*/
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include "vserver.hpp"
+#include "vclient.hpp"
+#include "vmulticast.hpp"
+
+#define CHECK(cond) \
+do{ \
+    if( !(cond) ){ \
+        printf("  FAILED: %s (line %d)\n", #cond, __LINE__); \
+        ++failures; \
+    } \
+}while(0)
+
+static int failures = 0;
+
+
+void
+test_packed_columns()
+{
+    int64_t cols[][5] = {
+        {0, 0, 0, 0, 0},
+        {5, -3, 120, 127, -1},
+        {INT64_MAX, INT64_MIN, 0, -1, INT64_MAX}, /* wraps */
+        {1, 40000, 80000, 1 << 20, -(1 << 30)}
+    };
+    size_t widths[] = {1, 1, 8, 4};
+
+    for(int c = 0; c < 4; ++c){
+        std::vector<char> buf;
+        VWriter w(buf, true);
+        w.put_array_head(VTYPE_INTGR_BIT | VTYPE_QUAD_BIT, false, 5);
+        w.put_int_column(cols[c], 5, 8);
+        CHECK((uint8_t)buf[6] == widths[c]);
+
+        VReader rdr(buf.data(), buf.size());
+        VArray arr = VGetArray(rdr);
+        CHECK(arr.size() == 5 && rdr.remaining() == 0);
+        for(int i = 0; i < 5; ++i)
+            CHECK(arr.ints[i] == cols[c][i]);
+    }
+
+    /* the typed VPutArray the server's replies go through */
+    long longs[] = {7, 9, -2};
+    float floats[] = {1.5f, -2.25f, 3.0f};
+    int64_t micros[] = {30, 20, 10};
+    for(int packed = 0; packed < 2; ++packed){
+        std::vector<char> buf;
+        VWriter w(buf, packed != 0);
+        VPutArray(w, VTYPE_INTGR_BIT, longs, micros, 3);
+        VPutArray(w, 0, floats, nullptr, 3);
+
+        VReader rdr(buf.data(), buf.size());
+        VArray a = VGetArray(rdr);
+        VArray b = VGetArray(rdr);
+        CHECK(rdr.remaining() == 0);
+        CHECK(a.size() == 3 && a.ints[2] == -2 && a.micros[0] == 30 && a.micros[2] == 10);
+        CHECK(b.size() == 3 && b.reals[1] == -2.25 && b.micros.empty());
+    }
+}
+
+
+/* what vnative_bench.py times, built the way vhandler.cpp builds replies:
+   'n' doubles, then 'n' long longs, then a frame of min(n, 500) doubles,
+   each time-stamped and each plain then packed; written to 'path' as a 
+   uint32 length and the body. The values are the bench's own. */
+int
+dump_bodies(const char* path, int n)
+{
+    std::vector<double> prices;
+    std::vector<int64_t> volumes, micros;
+    std::vector<std::string> labels;
+
+    for(int i = 0; i < n; ++i){
+        micros.push_back(1500000000000000LL - i * 137000LL);
+        prices.push_back(100.0 + ((i * 7) % 23) * .01);
+        volumes.push_back(50000000 - i * 300);
+    }
+    int m = n < 500 ? n : 500;
+    for(int i = 0; i < m; ++i)
+        labels.push_back("ITEM" + std::to_string(i));
+
+    FILE *f = fopen(path, "wb");
+    if(!f){
+        printf("can't open %s\n", path);
+        return 1;
+    }
+
+    for(int what = 0; what < 3; ++what){
+        for(int packed = 0; packed < 2; ++packed){
+            std::vector<char> body;
+            VWriter w(body, packed != 0);
+            if(what == 0){
+                VPutArray(w, VTYPE_QUAD_BIT, prices.data(), micros.data(), n);
+            }else if(what == 1){
+                VPutArray(w, VTYPE_INTGR_BIT | VTYPE_QUAD_BIT, volumes.data(), micros.data(), n);
+            }else{
+                w.put_strings(labels);
+                VPutArray(w, VTYPE_QUAD_BIT, prices.data(), micros.data(), m);
+            }
+            uint32_t len = (uint32_t)body.size();
+            fwrite(&len, sizeof(len), 1, f);
+            fwrite(body.data(), 1, body.size(), f);
+        }
+    }
+
+    return fclose(f) ? 1 : 0;
+}
+
+/* blocks hold nothing; GET returns 'indx' as a long long stamped with
+   'indx' micro-seconds, snapshots return doubles end..beg; a subscription
+   gets 10 TICKS frames of 3 doubles each (0,1,2 then 3,4,5 ...) */
+class FakeHandler
+        : public VRequestHandler{
+    std::set<std::string> _blocks;
+    vconn_id_type _sub_conn;
+    std::string _sub_block;
+    std::string _sub_item;
+    std::string _sub_topic;
+    int _nticks;
+
+public:
+    FakeHandler()
+        :
+            _sub_conn(0),
+            _nticks(0)
+        {
+        }
+
+    void
+    on_idle(VServer& server)
+    {
+        if(!_sub_conn || _nticks >= 30)
+            return;
+
+        std::vector<char> body;
+        VWriter w(body);
+        w.put_string(_sub_block);
+        w.put<uint32_t>(0);
+        w.put<uint32_t>(1);
+        w.put_string(_sub_item);
+        w.put_string(_sub_topic);
+        w.put<int32_t>(3);
+        w.put_array_head(VTYPE_QUAD_BIT, false, 3);
+        for(int i = 2; i >= 0; --i) /* most recent first */
+            w.put<double>(_nticks + i);
+
+        if( server.push(_sub_conn, VOP_TICKS, body) )
+            _nticks += 3;
+    }
+
+    int16_t
+    handle(vconn_id_type conn, uint16_t op, VReader& in, VWriter& out)
+    {
+        if(op == VOP_PING){
+            out.put<uint32_t>(VPROTO_VERSION);
+            return VSTATUS_OK;
+        }
+
+        std::string id = in.get_string();
+        switch(op){
+        case VOP_CREATE_BLOCK:
+            return _blocks.insert(id).second ? VSTATUS_OK : -5;
+        case VOP_CLOSE_BLOCK:
+            return _blocks.erase(id) ? VSTATUS_OK : -6;
+        case VOP_GET:
+        {
+            in.get_string();
+            in.get_string();
+            int32_t indx = in.get<int32_t>();
+            bool dts = in.get<uint8_t>() != 0;
+            out.put<uint8_t>(VTYPE_INTGR_BIT | VTYPE_QUAD_BIT);
+            out.put<int64_t>(indx);
+            if(dts)
+                out.put<int64_t>(indx);
+            return VSTATUS_OK;
+        }
+        case VOP_SUBSCRIBE:
+        {
+            in.get<uint8_t>();
+            in.get<uint8_t>();
+            if(in.get<uint32_t>() != 1)
+                return VSTATUS_BAD_REQUEST;
+            _sub_item = in.get_string();
+            _sub_topic = in.get_string();
+            _sub_block = id;
+            _sub_conn = conn;
+            return VSTATUS_OK;
+        }
+        case VOP_STREAM_SNAPSHOT:
+        {
+            in.get_string();
+            std::string topic = in.get_string();
+            int32_t end = in.get<int32_t>();
+            int32_t beg = in.get<int32_t>();
+            in.get<uint8_t>();
+            uint8_t flags = in.get<uint8_t>();
+            out.set_packed( (flags & VARRAY_PACKED) != 0 );
+            if(topic == "VOLUME"){ /* long longs, time-stamped */
+                std::vector<int64_t> vals, micros;
+                for(int32_t i = beg; i <= end; ++i){
+                    vals.push_back(1000000 - i * 100);
+                    micros.push_back(1500000000000000LL - i * 250000);
+                }
+                out.put_array_head(VTYPE_INTGR_BIT | VTYPE_QUAD_BIT, true, end - beg + 1);
+                out.put_int_column(vals.data(), end - beg + 1, 8);
+                out.put_int_column(micros.data(), end - beg + 1, 8);
+                return VSTATUS_OK;
+            }
+            out.put_array_head(VTYPE_QUAD_BIT, false, end - beg + 1);
+            for(int32_t i = beg; i <= end; ++i)
+                out.put<double>(i * .5);
+            return VSTATUS_OK;
+        }
+        default:
+            return VSTATUS_BAD_OP;
+        }
+    }
+};
+
+
+/* publishes one batch per pass of the loop, up to 'limit': SPY LAST gets
+   the double 'k' (micro k), QQQ VOLUME the long longs 3k, 3k+1, 3k+2;
+   batch k goes out as datagram k+1 */
+class McastHandler
+        : public VRequestHandler{
+    VMcastPublisher& _pub;
+    int _next;
+
+public:
+    std::atomic<int> limit;
+
+    explicit McastHandler(VMcastPublisher& pub)
+        :
+            _pub(pub),
+            _next(0),
+            limit(0)
+        {
+        }
+
+    void
+    on_idle(VServer& server)
+    {
+        if(_next < limit.load()){
+            VArray last, vol;
+            last.type = VTYPE_QUAD_BIT;
+            last.reals.push_back(_next);
+            last.micros.push_back(_next);
+            vol.type = VTYPE_INTGR_BIT | VTYPE_QUAD_BIT;
+            for(int i = 2; i >= 0; --i)
+                vol.ints.push_back(_next * 3 + i);
+
+            _pub.publish("SPY", "LAST", last);
+            _pub.publish("QQQ", "VOLUME", vol);
+            _pub.flush();
+            ++_next;
+        }
+        _pub.heartbeat();
+    }
+
+    int16_t
+    handle(vconn_id_type conn, uint16_t op, VReader& in, VWriter& out)
+    {
+        if(op == VOP_PING){
+            out.put<uint32_t>(VPROTO_VERSION);
+            return VSTATUS_OK;
+        }
+        return _pub.handle(op, in, out);
+    }
+};
+
+
+void
+test_multicast()
+{
+    std::atomic<uint64_t> drop_lo(5), drop_hi(6), drop_tail(40);
+
+    VMcastPublisher pub("239.255.42.99", 55611, "127.0.0.1", 1, 16);
+    pub.set_drop_filter([&](uint64_t seq){
+        return (seq >= drop_lo.load() && seq <= drop_hi.load()) || seq == drop_tail.load();
+    });
+
+    McastHandler handler(pub);
+    VServer server("127.0.0.1", 0, handler);
+    std::thread server_thread([&]{ server.run(10); });
+
+    try{
+        VMcastReceiver rcvr("239.255.42.99", 55611, "127.0.0.1", server.port(), "127.0.0.1");
+        auto wait_for = [&](std::function<bool()> done){
+            auto t = std::chrono::steady_clock::now();
+            while( !done() && std::chrono::steady_clock::now() - t < std::chrono::seconds(5) )
+                rcvr.update(10);
+        };
+
+        /* sync on a heartbeat before anything's published */
+        wait_for([&]{ return rcvr.stats().snapshots == 1; });
+        CHECK(rcvr.stats().snapshots == 1 && rcvr.seq() == 0);
+
+        printf("multicast, retransmit\n");
+        handler.limit.store(40);
+        wait_for([&]{ return rcvr.seq() == 40; }); /* 40 (the tail) needs a heartbeat */
+
+        const VMcastReceiver::stream_type& last = rcvr.stream("SPY", "LAST");
+        const VMcastReceiver::stream_type& vol = rcvr.stream("QQQ", "VOLUME");
+        CHECK(rcvr.seq() == 40 && last.size() == 40 && vol.size() == 120);
+        CHECK(last.front().r == 39 && last.front().micro == 39 && last.back().r == 0);
+        CHECK(vol.front().i == 119 && vol.back().i == 0);
+        CHECK(rcvr.stats().gaps == 2 && rcvr.stats().retransmitted == 3);
+        CHECK(rcvr.stats().lost == 0 && rcvr.stats().snapshots == 1);
+
+        printf("multicast, snapshot recovery\n");
+        drop_lo.store(41); /* more than the publisher keeps */
+        drop_hi.store(60);
+        handler.limit.store(70);
+        wait_for([&]{ return rcvr.seq() == 70; });
+
+        CHECK(rcvr.seq() == 70 && rcvr.stats().snapshots == 2 && rcvr.stats().lost >= 20);
+        CHECK(rcvr.stream("SPY", "LAST").front().r == 69);
+        CHECK(rcvr.stream("SPY", "LAST").size() < 30); /* started over */
+        CHECK(rcvr.stream("QQQ", "VOLUME").front().i == 209);
+    }catch(const std::exception& e){
+        printf("  FAILED: exception: %s\n", e.what());
+        ++failures;
+    }
+
+    server.stop();
+    server_thread.join();
+}
+
+
+int
+main(int argc, char* argv[])
+{
+    if(argc > 2 && strcmp(argv[1], "--dump") == 0)
+        return dump_bodies(argv[2], argc > 3 ? atoi(argv[3]) : 10000);
+
+    printf("\n*** BEGIN %s BEGIN ***\n\n", argv[0]);
+
+    printf("packed columns\n");
+    test_packed_columns();
+
+    if( !NetStartup() )
+        return 1;
+
+    FakeHandler handler;
+    VServer server("127.0.0.1", 0, handler);
+    std::thread server_thread([&]{ server.run(10); });
+
+    try{
+        VClient client("127.0.0.1", server.port());
+
+        printf("ping\n");
+        CHECK(client.ping() == VPROTO_VERSION);
+
+        printf("create/close\n");
+        {
+            VRemoteBlock block(client, "block1");
+            bool threw = false;
+            try{
+                VRemoteBlock dup(client, "block1");
+            }catch(const VStatusError& e){
+                threw = (e.status() == -5);
+            }
+            CHECK(threw);
+        }
+        std::vector<char> body;
+        VWriter(body).put_string("block1");
+        CHECK(client.call(VOP_CLOSE_BLOCK, body).head.status == -6);
+
+        printf("get\n");
+        VRemoteBlock block(client, "block2");
+        VValue v = block.get("SPY", "VOLUME", 7, true);
+        CHECK(v.i == 7 && v.micro == 7);
+
+        printf("pipelined get x1000\n");
+        std::vector<uint32_t> ids;
+        for(int i = 0; i < 1000; ++i)
+            ids.push_back( block.get_async("SPY", "VOLUME", i) );
+        for(int i = 999; i >= 0; --i) /* collect out of order */
+            CHECK(block.get_result(ids[i]).i == i);
+
+        printf("stream snapshot\n");
+        VArray arr = block.stream_snapshot("SPY", "LAST", 99, 0);
+        CHECK(arr.size() == 100 && arr.reals[99] == 49.5);
+
+        printf("packed snapshot\n");
+        arr = block.stream_snapshot("SPY", "VOLUME", 99, 0, true, true);
+        CHECK(arr.size() == 100 && arr.ints[99] == 1000000 - 9900
+              && arr.micros[99] == 1500000000000000LL - 99 * 250000);
+        block.set_packed(false);
+        VArray arr2 = block.stream_snapshot("SPY", "VOLUME", 99, 0, true, true);
+        CHECK(arr2.ints == arr.ints && arr2.micros == arr.micros);
+        block.set_packed(true);
+
+        printf("push/mirror\n");
+        {
+            VMirror mirror(client);
+            std::vector<VMirror::stream_key_type> streams;
+            streams.push_back( VMirror::stream_key_type("SPY", "LAST") );
+            mirror.subscribe(block, streams, VPUSH_CONFLATE, 20);
+
+            size_t n = 0;
+            for(int i = 0; i < 100 && n < 30; ++i)
+                n += mirror.update(10);
+
+            const VMirror::stream_type& strm = mirror.stream("block2", "SPY", "LAST");
+            CHECK(n == 30);
+            CHECK(strm.size() == 20 && strm.front().r == 29 && strm.back().r == 10);
+            CHECK(mirror.dropped("block2") == 0 && mirror.conflated("block2") == 0);
+            /* pushes interleaved with replies don't confuse call() */
+            CHECK(client.ping() == VPROTO_VERSION);
+        }
+
+        printf("bad op\n");
+        body.clear();
+        VWriter(body).put_string("block2");
+        CHECK(client.call(99, body).head.status == VSTATUS_BAD_OP);
+
+        printf("bad request\n");
+        CHECK(client.call(VOP_GET, body).head.status == VSTATUS_BAD_REQUEST);
+    }catch(const std::exception& e){
+        printf("  FAILED: exception: %s\n", e.what());
+        ++failures;
+    }
+
+    server.stop();
+    server_thread.join();
+
+    test_multicast();
+    NetCleanup();
+
+    printf("\n*** END %s END (%d failures) ***\n\n", argv[0], failures);
+    return failures ? 1 : 0;
+}
@@ -1,12 +1,31 @@
 @echo off
 
+rem CompileAndRun.bat [test name] [test args...]
+rem   rebuilds java/tosdatabridge.jar (jna.jar + java/src), then compiles and runs
+rem   the test (default TOSDataBridgeTest; e.g. SnapshotBench 30 SPY QQQ)
+
 set version=0.8
 set bArch=x64
 set bArchDir=x64
 set jarPath=../../java/tosdatabridge.jar
+set jarFile=..\..\java\tosdatabridge.jar
+set jnaFile=..\..\java\jna.jar
+set srcDir=..\..\java\src
+set classDir=jar_classes
 set execName=TOSDataBridgeTest
+set execArgs=
 set libPath=../../bin/Release/%bArchDir%/tos-databridge-%version%-%bArch%.dll
 
+if "%~1"=="" goto :build
+set execName=%~1
+shift
+:args
+if "%~1"=="" goto :build
+set execArgs=%execArgs% %1
+shift
+goto :args
+
+:build
 echo + x64 only! (be sure x64 engine is running)
 echo + Test File: %execName%.java
 echo + Version: %version%
@@ -14,28 +33,42 @@ echo + Build: %bArch%
 echo + Library Path: %libPath%
 
 
-javac -classpath %jarPath% %execName%.java
+echo + Rebuilding %jarFile%
 
-IF ERRORLEVEL 1 (
-    echo - Failed to compile %execName%.java
-    EXIT /B 1
-)   
+if exist %classDir% rmdir /S /Q %classDir%
+mkdir %classDir%
+dir /S /B %srcDir%\*.java > %classDir%\sources.txt
 
-java -classpath %jarPath%;. %execName% %libPath%
+javac -classpath %jnaFile% -d %classDir% @%classDir%\sources.txt
 
 IF ERRORLEVEL 1 (
-    echo - Failed to run %execName%
+    echo - Failed to compile %srcDir%
     EXIT /B 1
-) 
-
-EXIT /B 0
-
+)
 
+copy /Y %jnaFile% %jarFile% >NUL
+jar uf %jarFile% -C %classDir% io
 
+IF ERRORLEVEL 1 (
+    echo - Failed to rebuild %jarFile%
+    EXIT /B 1
+)
 
+rmdir /S /Q %classDir%
 
 
+javac -classpath %jarPath% %execName%.java
 
+IF ERRORLEVEL 1 (
+    echo - Failed to compile %execName%.java
+    EXIT /B 1
+)
 
+java -classpath %jarPath%;. %execName% %libPath%%execArgs%
 
+IF ERRORLEVEL 1 (
+    echo - Failed to run %execName%
+    EXIT /B 1
+)
 
+EXIT /B 0
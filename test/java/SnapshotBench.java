@@ -0,0 +1,170 @@
+/*
+Copyright (C) 2017 Jonathon Ogden   <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+import io.github.jeog.tosdatabridge.TOSDataBridge;
+import io.github.jeog.tosdatabridge.TOSDataBridge.*;
+import io.github.jeog.tosdatabridge.DataBlockWithDateTime;
+import io.github.jeog.tosdatabridge.DateTime.DateTimePair;
+import io.github.jeog.tosdatabridge.SnapshotBuffer;
+import io.github.jeog.tosdatabridge.Topic;
+
+import java.util.*;
+
+/**
+ * SnapshotBench.java
+ *
+ * Compares the List/JNA-array snapshot calls with the SnapshotBuffer (direct
+ * buffer) calls on a live block, JMH-style: warm-up iterations, then timed
+ * iterations, reporting the mean/min time per operation. Each operation also
+ * touches every value (sums them) so neither path gets away with lazy work.
+ *
+ * 1) load native library and connect (engine and TOS must be running)
+ * 2) fill a block of LAST for the items passed (waits for 'fill' seconds)
+ * 3) time: one stream, one stream with date-time, all streams
+ *
+ *    javac -classpath ../../java/tosdatabridge.jar SnapshotBench.java
+ *    java -classpath ../../java/tosdatabridge.jar;. SnapshotBench
+ *        ../../bin/Release/x64/tos-databridge-0.8-x64.dll [fill] [item ...]
+ *
+ * @author Jonathon Ogden
+ * @version 0.8
+ */
+public class SnapshotBench {
+    private static final int BLOCK_SZ = 100000;
+    private static final int WARMUP_ITERS = 200;
+    private static final int ITERS = 1000;
+
+    private interface Op {
+        double run() throws Exception;
+    }
+
+    private static double sink = 0; /* keep results live */
+
+    public static void
+    main(String[] args) throws Exception
+    {
+        if(args.length == 0 || args[0] == null){
+            System.err.println("TOSDataBridge library path must be passed as arg0");
+            return;
+        }
+        int fill = args.length > 1 ? Integer.parseInt(args[1]) : 30;
+        List<String> items = args.length > 2
+                ? Arrays.asList(Arrays.copyOfRange(args, 2, args.length))
+                : Arrays.asList("SPY", "QQQ", "IWM", "/ES", "/NQ");
+
+        if( !TOSDataBridge.init(args[0]) ){
+            throw new RuntimeException("library failed to connect to Engine/TOS");
+        }
+
+        final DataBlockWithDateTime block = new DataBlockWithDateTime(BLOCK_SZ);
+        final Topic topic = Topic.LAST;
+        final String item = items.get(0);
+        block.addTopic(topic);
+        for(String i : items) {
+            block.addItem(i);
+        }
+        System.out.println("Filling block for " + fill + " sec...");
+        Thread.sleep(fill * 1000L);
+
+        int occ = block.getStreamOccupancy(item, topic);
+        System.out.println(item + " " + topic + ": " + occ + " data-points");
+        System.out.println();
+
+        final SnapshotBuffer one = new SnapshotBuffer(BLOCK_SZ, false);
+        final SnapshotBuffer oneDT = new SnapshotBuffer(BLOCK_SZ, true);
+        final SnapshotBuffer all = new SnapshotBuffer(BLOCK_SZ * items.size(), items.size(), false);
+
+        bench("stream (List<Double>)", new Op(){ public double run() throws Exception {
+            double s = 0;
+            for(Double d : block.getStreamSnapshotDoubles(item, topic)) {
+                s += d;
+            }
+            return s;
+        }});
+
+        bench("stream (SnapshotBuffer)", new Op(){ public double run() throws Exception {
+            double s = 0;
+            int n = block.getStreamSnapshotToBuffer(item, topic, one);
+            for(int i = 0; i < n; ++i) {
+                s += one.getDouble(i);
+            }
+            return s;
+        }});
+
+        bench("stream w/ date-time (List<DateTimePair>)", new Op(){ public double run() throws Exception {
+            double s = 0;
+            for(DateTimePair<Double> p : block.getStreamSnapshotDoublesWithDateTime(item, topic)) {
+                s += p.first + p.second.microSeconds.longValue();
+            }
+            return s;
+        }});
+
+        bench("stream w/ date-time (SnapshotBuffer)", new Op(){ public double run() throws Exception {
+            double s = 0;
+            int n = block.getStreamSnapshotToBuffer(item, topic, oneDT);
+            for(int i = 0; i < n; ++i) {
+                s += oneDT.getDouble(i) + oneDT.getEpochMicro(i);
+            }
+            return s;
+        }});
+
+        final List<String> allItems = items;
+        bench(items.size() + " streams (List<Double> each)", new Op(){ public double run() throws Exception {
+            double s = 0;
+            for(String i : allItems) {
+                for(Double d : block.getStreamSnapshotDoubles(i, topic)) {
+                    s += d;
+                }
+            }
+            return s;
+        }});
+
+        bench(items.size() + " streams (SnapshotBuffer, one call)", new Op(){ public double run() throws Exception {
+            double s = 0;
+            int n = block.getStreamSnapshotsToBuffer(allItems, topic, all, BLOCK_SZ - 1, 0);
+            for(int i = 0; i < n; ++i) {
+                s += all.getDouble(i);
+            }
+            return s;
+        }});
+
+        block.close();
+        System.out.println();
+        System.out.println("(sink: " + sink + ")");
+    }
+
+    private static void
+    bench(String name, Op op) throws Exception
+    {
+        for(int i = 0; i < WARMUP_ITERS; ++i) {
+            sink += op.run();
+        }
+        System.gc();
+
+        long min = Long.MAX_VALUE;
+        long total = 0;
+        for(int i = 0; i < ITERS; ++i) {
+            long t = System.nanoTime();
+            sink += op.run();
+            t = System.nanoTime() - t;
+            total += t;
+            min = Math.min(min, t);
+        }
+        System.out.println(String.format("  %-42s mean %10.1f usec   min %10.1f usec", name,
+                total / (double) ITERS / 1000, min / 1000.0));
+    }
+}
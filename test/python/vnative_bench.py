@@ -0,0 +1,133 @@
+# Copyright (C) 2014 Jonathon Ogden   < jeog.dev@gmail.com >
+#
+#   This program is free software: you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#   See the GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License,
+#   'LICENSE.txt', along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+# wire size and client-side decode cost of snapshot/frame results: the
+# pickled objects VTOSDB_DataBlock gets from the python hub vs. the binary
+# arrays VNativeDataBlock gets from tos-databridge-vserver (plain, packed,
+# and decoded to numpy). No server needed; the bodies come from the server's
+# own encoder (VPutArray in vprotocol.hpp), dumped by a vserver_loopback
+# built from test/c_cpp (see dump_bodies there).
+#
+#   python vnative_bench.py --loopback path/to/vserver_loopback [--n 10000] [--reps 20]
+
+import os
+import pickle
+import struct
+import subprocess
+import tempfile
+from argparse import ArgumentParser
+from time import perf_counter, localtime
+
+from tosdb._common import TOSDB_DateTime
+from tosdb.vnative import _Reader
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+
+def dump_bodies(loopback, n):
+    """ [doubles, long longs, frame] x [plain, packed], as vserver_loopback 
+    --dump writes them """
+    fd, path = tempfile.mkstemp()
+    os.close(fd)
+    try:
+        subprocess.check_call([loopback, '--dump', path, str(n)])
+        with open(path, 'rb') as f:
+            b = f.read()
+    finally:
+        os.remove(path)
+    bodies, pos = [], 0
+    while pos < len(b):
+        l, = struct.unpack_from('<I', b, pos)
+        bodies.append(b[pos + 4:pos + 4 + l])
+        pos += 4 + l
+    return bodies
+
+
+def to_dt(micro):
+    return TOSDB_DateTime(localtime(micro // 1000000), micro % 1000000)
+
+
+def bench(f, reps):
+    t = perf_counter()
+    for _ in range(reps):
+        f()
+    return (perf_counter() - t) / reps * 1e6
+
+
+def run(name, objs, body_plain, body_packed, reps, labels=False):
+    def decode(b):
+        r = _Reader(b)
+        if labels:
+            r.strings()
+        return r.array()
+
+    def decode_np(b):
+        r = _Reader(b)
+        if labels:
+            r.strings()
+        return r.ndarray()
+
+    pkl = pickle.dumps(objs)
+    rows = [('pickle', len(pkl), bench(lambda: pickle.loads(pkl), reps)),
+            ('binary', len(body_plain), bench(lambda: decode(body_plain), reps)),
+            ('binary packed', len(body_packed), bench(lambda: decode(body_packed), reps))]
+    if numpy:
+        rows += [('binary -> numpy', len(body_plain), bench(lambda: decode_np(body_plain), reps)),
+                 ('packed -> numpy', len(body_packed), bench(lambda: decode_np(body_packed), reps))]
+
+    print(name)
+    for r in rows:
+        print('  %-16s %10d bytes %12.1f usec' % r)
+    print()
+
+
+if __name__ == '__main__':
+    parser = ArgumentParser()
+    parser.add_argument('--loopback', required=True,
+                        help='a vserver_loopback built from test/c_cpp')
+    parser.add_argument('--n', type=int, default=10000, help='points per snapshot')
+    parser.add_argument('--reps', type=int, default=20)
+    args = parser.parse_args()
+
+    n = args.n
+    micros = [1500000000000000 - i * 137000 for i in range(n)] # most recent first
+    dts = [to_dt(m) for m in micros]
+    prices = [100.0 + ((i * 7) % 23) * .01 for i in range(n)]
+    volumes = [50000000 - i * 300 for i in range(n)]
+    m = min(n, 500)
+    labels = ['ITEM%d' % i for i in range(m)]
+
+    bodies = dump_bodies(args.loopback, n)
+    # the same values as what gets pickled
+    assert _Reader(bodies[1]).array()[0] == prices
+    assert _Reader(bodies[3]).array()[0] == volumes
+    r = _Reader(bodies[5])
+    assert r.strings() == labels and r.array()[0] == prices[:m]
+
+    run('stream_snapshot (%d doubles, date_time)' % n,
+        list(zip(prices, dts)),
+        bodies[0], bodies[1], args.reps)
+
+    run('stream_snapshot (%d long longs, date_time)' % n,
+        list(zip(volumes, dts)),
+        bodies[2], bodies[3], args.reps)
+    run('item_frame (%d items, date_time)' % m,
+        (labels, list(zip(prices[:m], dts[:m]))), # what _dumpnamedtuple pickles
+        bodies[4], bodies[5], args.reps,
+        labels=True)